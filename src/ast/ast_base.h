@@ -2,9 +2,20 @@
 #define _AST_BASE_H
 #include "../lexer/token.h"
 #include "../lexer/value.h"
+#include <cassert>
+#include <cstdint>
 #include <unordered_map>
 
-enum class IdentifierNameSpace;
+// The name spaces of C identifiers (6.2.3). Each scope keeps a table per
+// name space, so a label never hides a variable of the same name.
+enum class IdentifierNameSpace : uint8_t {
+  UNKNOWN,
+  LABEL_NAME,
+  STRUCT_UNION_ENUM_TAG,
+  STRUCT_UNION_MEM,
+  ORDINARY_IDENTIFIER,
+  COUNT
+};
 
 class ASTNode;
 class Stmt;
@@ -39,23 +50,49 @@ class FunctionCallExpr;
 class Constant;
 class Identifier;
 
-enum class EXPR {
-  PRIMARY_EXPR = 1,
-  POSTFIX_EXPR,
-  UNARY_EXPR,
-  CAST_EXPR,
-  MULTIPLICATIVE_EXPR,
-  ADDITIVE_EXPR,
-  SHIFT_EXPR,
-  RELATIONAL_EXPR,
-  EQUALITY_EXPR,
-  AND_EXPR,
-  EXCLUSIVE_OR_EXPR,
-  INCLUSIVE_OR_EXPR,
-  LOGICAL_AND_EXPR,
-  LOGICAL_OR_EXPR,
-  CONDITIONAL_EXPR,
-  ASSIGNMENT_EXPR
+/**
+ * Kind tag of every concrete AST node. Each abstract class covers one
+ * contiguous range, so isa<> on it is two compares.
+ */
+enum class NodeKind : uint8_t {
+  // Stmt
+  LABELED_STMT,
+  COMPOUND_STMT,
+  EXPRESSION_STMT,
+  // SelectionStmt
+  IF_STMT,
+  SWITCH_STMT,
+  // IterationStmt
+  WHILE_STMT,
+  DO_WHILE_STMT,
+  FOR_STMT,
+  // JumpStmt
+  GOTO_STMT,
+  CONTINUE_STMT,
+  BREAK_STMT,
+  RETURN_STMT,
+
+  // Expr
+  // PrimaryExpr
+  IDENTIFIER,
+  CONSTANT,
+  UNARY_OPERATOR_EXPR,
+  BINARY_OPERATOR_EXPR,
+  TENARY_OPERATOR_EXPR,
+  FUNCTION_CALL_EXPR,
+
+  FIRST_STMT = LABELED_STMT,
+  LAST_STMT = RETURN_STMT,
+  FIRST_SELECTION_STMT = IF_STMT,
+  LAST_SELECTION_STMT = SWITCH_STMT,
+  FIRST_ITERATION_STMT = WHILE_STMT,
+  LAST_ITERATION_STMT = FOR_STMT,
+  FIRST_JUMP_STMT = GOTO_STMT,
+  LAST_JUMP_STMT = RETURN_STMT,
+  FIRST_EXPR = IDENTIFIER,
+  LAST_EXPR = FUNCTION_CALL_EXPR,
+  FIRST_PRIMARY_EXPR = IDENTIFIER,
+  LAST_PRIMARY_EXPR = CONSTANT,
 };
 
 enum class OP {
@@ -106,42 +143,54 @@ enum class OP {
   LEFT_SHIFT_ASSIGN,
   RIGHT_SHIFT_ASSIGN,
   AND_ASSIGN,
-  NOT_ASSIGN,
+  XOR_ASSIGN,
   OR_ASSIGN,
 };
 
+/**
+ * Nodes carry their kind instead of a vtable. Passes dispatch on it through
+ * ASTVisitor and RecursiveASTWalker (ast_visitor.h), and isa<>, cast<> and
+ * dyn_cast<> below test it through each class's classof().
+ *
+ * Nodes live in the parser's Arena and are freed with it without being
+ * destroyed, so no node may own anything: children are plain pointers and
+ * the destructors stay trivial.
+ */
 class ASTNode {
-  friend std::ostream &operator<<(std::ostream &os, const ASTNode &node) {
-    node.print(os);
-    return os;
-  }
-
 public:
-  virtual ~ASTNode() {}
-  virtual void print(std::ostream &os) const { os << "ASTNode"; }
+  NodeKind kind() const { return _kind; }
+
+protected:
+  explicit ASTNode(NodeKind kind) : _kind(kind) {}
+
+private:
+  NodeKind _kind;
 };
 
 class Stmt : public ASTNode {
-  friend std::ostream &operator<<(std::ostream &os, const Stmt &stmt) {
-    stmt.print(os);
-    return os;
+public:
+  static bool classof(const ASTNode *node) {
+    return node->kind() >= NodeKind::FIRST_STMT &&
+           node->kind() <= NodeKind::LAST_STMT;
   }
 
-public:
-  virtual ~Stmt() {}
-  virtual void print(std::ostream &os) const { os << "Stmt"; }
+protected:
+  explicit Stmt(NodeKind kind) : ASTNode(kind) {}
 };
 
 class Expr : public ASTNode {
-  friend std::ostream &operator<<(std::ostream &os, const Expr &expr) {
-    expr.print(os);
-    return os;
-  }
 public:
-  void set_token(std::unique_ptr<Token> token) { _token = std::move(token); }
-  virtual ~Expr() {}
-  virtual void print(std::ostream &os) const { os << "Expr: " << *_token; }
-  static inline std::unordered_map<OP, std::string> op_to_string{
+  static bool classof(const ASTNode *node) {
+    return node->kind() >= NodeKind::FIRST_EXPR &&
+           node->kind() <= NodeKind::LAST_EXPR;
+  }
+  Token token() const { return _token; }
+  void set_token(Token token) { _token = token; }
+  bool IsLValue() const {
+    return kind() == NodeKind::IDENTIFIER ||
+           kind() == NodeKind::UNARY_OPERATOR_EXPR;
+  }
+  static inline const std::unordered_map<OP, std::string> op_to_string{
       {OP::AND, "&"},
       {OP::AND_ASSIGN, "&="},
       {OP::ARROW_REFERENCE, "->"},
@@ -170,7 +219,6 @@ public:
       {OP::NE, "!="},
       {OP::NEGATION, "!"},
       {OP::NEGATIVE, "- (negative)"},
-      {OP::NOT_ASSIGN, "^="},
       {OP::OR, "|"},
       {OP::OR_ASSIGN, "|="},
       {OP::PLUS, "+"},
@@ -185,13 +233,36 @@ public:
       {OP::RIGHT_SHIFT_ASSIGN, ">>="},
       {OP::SIZEOF, "sizeof"},
       {OP::XOR, "xor"},
+      {OP::XOR_ASSIGN, "^="},
   };
 
 protected:
-  Expr(std::shared_ptr<Token> token) : _token(token) {}
-  virtual bool IsLValue() const { return false; }
-  std::shared_ptr<Token> _token;
+  Expr(NodeKind kind, Token token) : ASTNode(kind), _token(token) {}
+  Token _token;
 };
 
+template <typename To, typename From> bool isa(const From *node) {
+  return To::classof(node);
+}
+
+template <typename To, typename From> To *cast(From *node) {
+  assert(isa<To>(node));
+  return static_cast<To *>(node);
+}
+
+template <typename To, typename From> const To *cast(const From *node) {
+  assert(isa<To>(node));
+  return static_cast<const To *>(node);
+}
+
+// nullptr unless `node` is a To.
+template <typename To, typename From> To *dyn_cast(From *node) {
+  return isa<To>(node) ? static_cast<To *>(node) : nullptr;
+}
+
+template <typename To, typename From> const To *dyn_cast(const From *node) {
+  return isa<To>(node) ? static_cast<const To *>(node) : nullptr;
+}
+
 #endif
 
@@ -0,0 +1,61 @@
+#ifndef _AST_PRINTER_H_
+#define _AST_PRINTER_H_
+
+#include "ast_visitor.h"
+#include <ostream>
+
+/**
+ * Writes a node and the expressions under it in the layout the parser's
+ * trace output uses.
+ */
+class ASTPrinter : public ConstASTVisitor<ASTPrinter> {
+public:
+  explicit ASTPrinter(std::ostream &os) : _os(os) {}
+
+  void VisitNode(const ASTNode *) { _os << "ASTNode"; }
+  void VisitStmt(const Stmt *) { _os << "Stmt"; }
+  void VisitLabeledStmt(const LabeledStmt *node) {
+    _os << "Labeled Statement: " << node->label();
+  }
+  void VisitExpr(const Expr *node) { _os << "Expr: " << node->token(); }
+  void VisitIdentifier(const Identifier *node) {
+    _os << "Identifier: " << node->token();
+  }
+  void VisitConstant(const Constant *node) {
+    _os << "Constant: " << node->token();
+  }
+  void VisitUnaryOperatorExpr(const UnaryOperatorExpr *node) {
+    _os << "Unary Operator Expression: \n";
+    _os << "OP: " << Expr::op_to_string.at(node->op()) << '\n';
+    _os << "unary operand: ";
+    Visit(node->operand());
+  }
+  void VisitBinaryOperatorExpr(const BinaryOperatorExpr *node) {
+    _os << "Binary Operator Expression: \n";
+    Visit(node->operand1());
+    _os << "\nOP: " << Expr::op_to_string.at(node->op()) << '\n';
+    Visit(node->operand2());
+  }
+  void VisitTenaryOperatorExpr(const TenaryOperatorExpr *node) {
+    _os << "Tenary Operator Expression: \n";
+    Visit(node->operand1());
+    _os << "\nOP1: " << Expr::op_to_string.at(node->op1()) << '\n';
+    Visit(node->operand2());
+    _os << "\nOP2: " << Expr::op_to_string.at(node->op2()) << '\n';
+    Visit(node->operand3());
+  }
+  void VisitFunctionCallExpr(const FunctionCallExpr *node) {
+    _os << "Function Call Expression: \n";
+    Visit(node->designator());
+  }
+
+private:
+  std::ostream &_os;
+};
+
+inline std::ostream &operator<<(std::ostream &os, const ASTNode &node) {
+  ASTPrinter(os).Visit(&node);
+  return os;
+}
+
+#endif
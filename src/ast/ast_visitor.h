@@ -0,0 +1,248 @@
+#ifndef _AST_VISITOR_H_
+#define _AST_VISITOR_H_
+
+#include "ast_base.h"
+#include "expr.h"
+#include "stmt.h"
+
+namespace ast_visitor_detail {
+template <typename T> using Pointer = T *;
+template <typename T> using ConstPointer = const T *;
+} // namespace ast_visitor_detail
+
+/**
+ * Dispatches on the node kind with one switch and no virtual calls.
+ * `Derived` overrides the Visit functions it cares about; the others fall
+ * back to the function of the parent class, up to VisitNode, so
+ * VisitIfStmt -> VisitSelectionStmt -> VisitStmt -> VisitNode.
+ *
+ *   struct CountCalls : ASTVisitor<CountCalls> {
+ *     int calls = 0;
+ *     void VisitFunctionCallExpr(FunctionCallExpr *) { ++calls; }
+ *   };
+ */
+template <template <typename> class Ptr, typename Derived, typename RetTy>
+class ASTVisitorBase {
+public:
+  RetTy Visit(Ptr<ASTNode> node) {
+    switch (node->kind()) {
+    case NodeKind::LABELED_STMT:
+      return derived().VisitLabeledStmt(Cast<LabeledStmt>(node));
+    case NodeKind::COMPOUND_STMT:
+      return derived().VisitCompoundStmt(Cast<CompoundStmt>(node));
+    case NodeKind::EXPRESSION_STMT:
+      return derived().VisitExpressionStmt(Cast<ExpressionStmt>(node));
+    case NodeKind::IF_STMT:
+      return derived().VisitIfStmt(Cast<IfStmt>(node));
+    case NodeKind::SWITCH_STMT:
+      return derived().VisitSwitchStmt(Cast<SwitchStmt>(node));
+    case NodeKind::WHILE_STMT:
+      return derived().VisitWhileStmt(Cast<WhileStmt>(node));
+    case NodeKind::DO_WHILE_STMT:
+      return derived().VisitDoWhileStmt(Cast<DoWhileStmt>(node));
+    case NodeKind::FOR_STMT:
+      return derived().VisitForStmt(Cast<ForStmt>(node));
+    case NodeKind::GOTO_STMT:
+      return derived().VisitGotoStmt(Cast<GotoStmt>(node));
+    case NodeKind::CONTINUE_STMT:
+      return derived().VisitContinueStmt(Cast<ContinueStmt>(node));
+    case NodeKind::BREAK_STMT:
+      return derived().VisitBreakStmt(Cast<BreakStmt>(node));
+    case NodeKind::RETURN_STMT:
+      return derived().VisitReturnStmt(Cast<ReturnStmt>(node));
+    case NodeKind::IDENTIFIER:
+      return derived().VisitIdentifier(Cast<Identifier>(node));
+    case NodeKind::CONSTANT:
+      return derived().VisitConstant(Cast<Constant>(node));
+    case NodeKind::UNARY_OPERATOR_EXPR:
+      return derived().VisitUnaryOperatorExpr(Cast<UnaryOperatorExpr>(node));
+    case NodeKind::BINARY_OPERATOR_EXPR:
+      return derived().VisitBinaryOperatorExpr(Cast<BinaryOperatorExpr>(node));
+    case NodeKind::TENARY_OPERATOR_EXPR:
+      return derived().VisitTenaryOperatorExpr(Cast<TenaryOperatorExpr>(node));
+    case NodeKind::FUNCTION_CALL_EXPR:
+      return derived().VisitFunctionCallExpr(Cast<FunctionCallExpr>(node));
+    }
+    assert(false && "unknown NodeKind");
+    return RetTy();
+  }
+
+  RetTy VisitNode(Ptr<ASTNode>) { return RetTy(); }
+
+  RetTy VisitStmt(Ptr<Stmt> node) { return derived().VisitNode(node); }
+  RetTy VisitLabeledStmt(Ptr<LabeledStmt> node) {
+    return derived().VisitStmt(node);
+  }
+  RetTy VisitCompoundStmt(Ptr<CompoundStmt> node) {
+    return derived().VisitStmt(node);
+  }
+  RetTy VisitExpressionStmt(Ptr<ExpressionStmt> node) {
+    return derived().VisitStmt(node);
+  }
+  RetTy VisitSelectionStmt(Ptr<SelectionStmt> node) {
+    return derived().VisitStmt(node);
+  }
+  RetTy VisitIfStmt(Ptr<IfStmt> node) {
+    return derived().VisitSelectionStmt(node);
+  }
+  RetTy VisitSwitchStmt(Ptr<SwitchStmt> node) {
+    return derived().VisitSelectionStmt(node);
+  }
+  RetTy VisitIterationStmt(Ptr<IterationStmt> node) {
+    return derived().VisitStmt(node);
+  }
+  RetTy VisitWhileStmt(Ptr<WhileStmt> node) {
+    return derived().VisitIterationStmt(node);
+  }
+  RetTy VisitDoWhileStmt(Ptr<DoWhileStmt> node) {
+    return derived().VisitIterationStmt(node);
+  }
+  RetTy VisitForStmt(Ptr<ForStmt> node) {
+    return derived().VisitIterationStmt(node);
+  }
+  RetTy VisitJumpStmt(Ptr<JumpStmt> node) { return derived().VisitStmt(node); }
+  RetTy VisitGotoStmt(Ptr<GotoStmt> node) {
+    return derived().VisitJumpStmt(node);
+  }
+  RetTy VisitContinueStmt(Ptr<ContinueStmt> node) {
+    return derived().VisitJumpStmt(node);
+  }
+  RetTy VisitBreakStmt(Ptr<BreakStmt> node) {
+    return derived().VisitJumpStmt(node);
+  }
+  RetTy VisitReturnStmt(Ptr<ReturnStmt> node) {
+    return derived().VisitJumpStmt(node);
+  }
+
+  RetTy VisitExpr(Ptr<Expr> node) { return derived().VisitNode(node); }
+  RetTy VisitPrimaryExpr(Ptr<PrimaryExpr> node) {
+    return derived().VisitExpr(node);
+  }
+  RetTy VisitIdentifier(Ptr<Identifier> node) {
+    return derived().VisitPrimaryExpr(node);
+  }
+  RetTy VisitConstant(Ptr<Constant> node) {
+    return derived().VisitPrimaryExpr(node);
+  }
+  RetTy VisitUnaryOperatorExpr(Ptr<UnaryOperatorExpr> node) {
+    return derived().VisitExpr(node);
+  }
+  RetTy VisitBinaryOperatorExpr(Ptr<BinaryOperatorExpr> node) {
+    return derived().VisitExpr(node);
+  }
+  RetTy VisitTenaryOperatorExpr(Ptr<TenaryOperatorExpr> node) {
+    return derived().VisitExpr(node);
+  }
+  RetTy VisitFunctionCallExpr(Ptr<FunctionCallExpr> node) {
+    return derived().VisitExpr(node);
+  }
+
+private:
+  Derived &derived() { return *static_cast<Derived *>(this); }
+  // The switch has already checked the kind.
+  template <typename T> static Ptr<T> Cast(Ptr<ASTNode> node) {
+    return static_cast<Ptr<T>>(node);
+  }
+};
+
+template <typename Derived, typename RetTy = void>
+using ASTVisitor =
+    ASTVisitorBase<ast_visitor_detail::Pointer, Derived, RetTy>;
+
+template <typename Derived, typename RetTy = void>
+using ConstASTVisitor =
+    ASTVisitorBase<ast_visitor_detail::ConstPointer, Derived, RetTy>;
+
+/**
+ * Walks a tree depth first, visiting every node before its children and the
+ * children from left to right. The Visit functions return bool: false
+ * skips the children of that node. Null children are skipped, since the
+ * parser leaves unsupported constructs empty.
+ *
+ *   struct CountIdentifiers : RecursiveASTWalker<CountIdentifiers> {
+ *     int identifiers = 0;
+ *     bool VisitIdentifier(Identifier *) { ++identifiers; return true; }
+ *   };
+ *   CountIdentifiers counter;
+ *   counter.Walk(function_body);
+ */
+template <typename Derived>
+class RecursiveASTWalker : public ASTVisitor<Derived, bool> {
+public:
+  void Walk(ASTNode *node) {
+    if (node == nullptr || !this->Visit(node)) {
+      return;
+    }
+    switch (node->kind()) {
+    case NodeKind::COMPOUND_STMT:
+      for (auto stmt : static_cast<CompoundStmt *>(node)->stmts()) {
+        Walk(stmt);
+      }
+      break;
+    case NodeKind::EXPRESSION_STMT:
+      Walk(static_cast<ExpressionStmt *>(node)->expression());
+      break;
+    case NodeKind::IF_STMT: {
+      auto if_stmt = static_cast<IfStmt *>(node);
+      Walk(if_stmt->condition());
+      Walk(if_stmt->if_stmt());
+      Walk(if_stmt->else_stmt());
+      break;
+    }
+    case NodeKind::SWITCH_STMT:
+      Walk(static_cast<SwitchStmt *>(node)->selection());
+      break;
+    case NodeKind::WHILE_STMT:
+    case NodeKind::FOR_STMT: {
+      auto loop = static_cast<IterationStmt *>(node);
+      Walk(loop->condition());
+      Walk(loop->loop_body());
+      break;
+    }
+    case NodeKind::DO_WHILE_STMT: {
+      auto loop = static_cast<IterationStmt *>(node);
+      Walk(loop->loop_body());
+      Walk(loop->condition());
+      break;
+    }
+    case NodeKind::RETURN_STMT:
+      Walk(static_cast<ReturnStmt *>(node)->returned());
+      break;
+    case NodeKind::UNARY_OPERATOR_EXPR:
+      Walk(static_cast<UnaryOperatorExpr *>(node)->operand());
+      break;
+    case NodeKind::BINARY_OPERATOR_EXPR: {
+      auto binary = static_cast<BinaryOperatorExpr *>(node);
+      Walk(binary->operand1());
+      Walk(binary->operand2());
+      break;
+    }
+    case NodeKind::TENARY_OPERATOR_EXPR: {
+      auto tenary = static_cast<TenaryOperatorExpr *>(node);
+      Walk(tenary->operand1());
+      Walk(tenary->operand2());
+      Walk(tenary->operand3());
+      break;
+    }
+    case NodeKind::FUNCTION_CALL_EXPR: {
+      auto call = static_cast<FunctionCallExpr *>(node);
+      Walk(call->designator());
+      for (auto argument : call->parameters()) {
+        Walk(argument);
+      }
+      break;
+    }
+    case NodeKind::LABELED_STMT:
+    case NodeKind::GOTO_STMT:
+    case NodeKind::CONTINUE_STMT:
+    case NodeKind::BREAK_STMT:
+    case NodeKind::IDENTIFIER:
+    case NodeKind::CONSTANT:
+      break;
+    }
+  }
+
+  bool VisitNode(ASTNode *) { return true; }
+};
+
+#endif
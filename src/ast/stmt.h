@@ -1,147 +1,207 @@
 #ifndef _STMT_H_
 #define _STMT_H_
-#include "../symbol/scope.h"
+#include "../symbol/symbol_table.h"
+#include "../util/arena.h"
 #include "ast_base.h"
-#include <atomic>
-#include <iterator>
-#include <list>
-#include <memory>
 #include <string>
 #include <utility>
-#include <vector>
 
 class Type;
 
 class LabeledStmt : public Stmt {
 private:
-  std::string _label;
-protected:
-  virtual void print(std::ostream &os) const override {
-    os << "Labeled Statement: " << _label;
-  }
+  Token _label;
+
 public:
-  const std::string &label() const { return _label; }
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::LABELED_STMT;
+  }
+  LabeledStmt() : Stmt(NodeKind::LABELED_STMT) {}
+  explicit LabeledStmt(Token label)
+      : Stmt(NodeKind::LABELED_STMT), _label(label) {}
+  Token label() const { return _label; }
 };
 
 class CompoundStmt : public Stmt {
 private:
-  std::vector<std::unique_ptr<Stmt>> _stmts;
-  std::weak_ptr<Scope> _self_scope;
+  ArenaArray<Stmt *> _stmts;
+  // The scope of the block in the parser's SymbolTable.
+  ScopeId _scope = SymbolTable::NONE;
 
 public:
-  CompoundStmt() = default;
-  std::vector<std::unique_ptr<Stmt>> &stmts() { return _stmts; }
-  void AddStmts(std::vector<std::unique_ptr<Stmt>> &stmts) {
-    _stmts.insert(_stmts.end(), std::make_move_iterator(stmts.begin()),
-                  std::make_move_iterator(stmts.end()));
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::COMPOUND_STMT;
   }
-  void set_scope(std::weak_ptr<Scope> &scope) { _self_scope = scope; }
+  CompoundStmt() : Stmt(NodeKind::COMPOUND_STMT) {}
+  ArenaArray<Stmt *> stmts() const { return _stmts; }
+  void set_stmts(ArenaArray<Stmt *> stmts) { _stmts = stmts; }
+  ScopeId scope() const { return _scope; }
+  void set_scope(ScopeId scope) { _scope = scope; }
 };
 
-class SelectionStmt : public Stmt {};
+class SelectionStmt : public Stmt {
+public:
+  static bool classof(const ASTNode *node) {
+    return node->kind() >= NodeKind::FIRST_SELECTION_STMT &&
+           node->kind() <= NodeKind::LAST_SELECTION_STMT;
+  }
+
+protected:
+  explicit SelectionStmt(NodeKind kind) : Stmt(kind) {}
+};
 
 class IfStmt : public SelectionStmt {
 public:
-  IfStmt(std::unique_ptr<Expr> &condition, std::unique_ptr<Stmt> &if_stmt,
-         std::unique_ptr<Stmt> &else_stmt)
-      : _condition_expr(std::move(condition)), _if_stmt(std::move(if_stmt)),
-        _else_stmt(std::move(else_stmt)) {}
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::IF_STMT;
+  }
+  IfStmt(Expr *condition, Stmt *if_stmt, Stmt *else_stmt)
+      : SelectionStmt(NodeKind::IF_STMT), _condition_expr(condition),
+        _if_stmt(if_stmt), _else_stmt(else_stmt) {}
+  Expr *condition() const { return _condition_expr; }
+  Stmt *if_stmt() const { return _if_stmt; }
+  Stmt *else_stmt() const { return _else_stmt; }
 
 private:
-  std::unique_ptr<Expr> _condition_expr;
-  std::unique_ptr<Stmt> _if_stmt;
-  std::unique_ptr<Stmt> _else_stmt;
+  Expr *_condition_expr;
+  Stmt *_if_stmt;
+  Stmt *_else_stmt;
 };
 
 class SwitchStmt : public SelectionStmt {
 public:
-  SwitchStmt(Expr *selection) : _selection_expr(selection) {}
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::SWITCH_STMT;
+  }
+  SwitchStmt(Expr *selection)
+      : SelectionStmt(NodeKind::SWITCH_STMT), _selection_expr(selection) {}
+  Expr *selection() const { return _selection_expr; }
 
 private:
-  std::unique_ptr<Expr> _selection_expr;
+  Expr *_selection_expr;
   std::pair<Constant *, Stmt *> _value_stmt_pair;
 };
 
 class ExpressionStmt : public Stmt {
 private:
-  std::unique_ptr<Expr> _expression;
+  Expr *_expression;
 
 public:
-  ExpressionStmt(std::unique_ptr<Expr> &expression)
-      : _expression(std::move(expression)) {}
-  std::unique_ptr<Expr> &expression() { return _expression; }
-  void set_expression(std::unique_ptr<Expr> &expression) {
-    _expression = std::move(expression);
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::EXPRESSION_STMT;
   }
+  ExpressionStmt(Expr *expression)
+      : Stmt(NodeKind::EXPRESSION_STMT), _expression(expression) {}
+  Expr *expression() const { return _expression; }
+  void set_expression(Expr *expression) { _expression = expression; }
 };
 
 class IterationStmt : public Stmt {
 private:
-  std::unique_ptr<Expr> _condition;
-  std::unique_ptr<Stmt> _loop_body;
+  Expr *_condition;
+  Stmt *_loop_body;
   bool _execute_first = false;
 
 public:
-  IterationStmt(std::unique_ptr<Expr> &condition,
-                std::unique_ptr<Stmt> &loop_body, bool execute_first)
-      : _condition(std::move(condition)), _loop_body(std::move(loop_body)),
-        _execute_first(execute_first) {}
+  static bool classof(const ASTNode *node) {
+    return node->kind() >= NodeKind::FIRST_ITERATION_STMT &&
+           node->kind() <= NodeKind::LAST_ITERATION_STMT;
+  }
+  Expr *condition() const { return _condition; }
+  Stmt *loop_body() const { return _loop_body; }
   bool execute_before_condition() { return _execute_first; }
+
+protected:
+  IterationStmt(NodeKind kind, Expr *condition, Stmt *loop_body,
+                bool execute_first)
+      : Stmt(kind), _condition(condition), _loop_body(loop_body),
+        _execute_first(execute_first) {}
 };
 
 class WhileStmt : public IterationStmt {
 public:
-  WhileStmt(std::unique_ptr<Expr> &condition, std::unique_ptr<Stmt> &loop_body)
-      : IterationStmt(condition, loop_body, false) {}
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::WHILE_STMT;
+  }
+  WhileStmt(Expr *condition, Stmt *loop_body)
+      : IterationStmt(NodeKind::WHILE_STMT, condition, loop_body, false) {}
 };
 
 class DoWhileStmt : public IterationStmt {
 public:
-  DoWhileStmt(std::unique_ptr<Expr> &condition,
-              std::unique_ptr<Stmt> &loop_body)
-      : IterationStmt(condition, loop_body, true) {}
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::DO_WHILE_STMT;
+  }
+  DoWhileStmt(Expr *condition, Stmt *loop_body)
+      : IterationStmt(NodeKind::DO_WHILE_STMT, condition, loop_body, true) {}
 };
 
 class ForStmt : public IterationStmt {
 public:
-  ForStmt(std::unique_ptr<Expr> &condition, std::unique_ptr<Stmt> &body)
-      : IterationStmt(condition, body, false) {}
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::FOR_STMT;
+  }
+  ForStmt(Expr *condition, Stmt *body)
+      : IterationStmt(NodeKind::FOR_STMT, condition, body, false) {}
 };
 
 class JumpStmt : public Stmt {
 private:
-  std::unique_ptr<Stmt> _jump_to;
+  Stmt *_jump_to;
 
 public:
-  JumpStmt(Stmt *jump_to) : _jump_to(jump_to) {}
+  static bool classof(const ASTNode *node) {
+    return node->kind() >= NodeKind::FIRST_JUMP_STMT &&
+           node->kind() <= NodeKind::LAST_JUMP_STMT;
+  }
+  // Where control goes; not a child.
+  Stmt *jump_to() const { return _jump_to; }
+  void set_jump_to(Stmt *jump_to) { _jump_to = jump_to; }
+
+protected:
+  JumpStmt(NodeKind kind, Stmt *jump_to) : Stmt(kind), _jump_to(jump_to) {}
 };
 
 class GotoStmt : public JumpStmt {
 public:
-  GotoStmt(Stmt *jump_to, Token *ident_token)
-      : JumpStmt(jump_to), _ident_token(ident_token) {}
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::GOTO_STMT;
+  }
+  GotoStmt(Stmt *jump_to, Token ident_token)
+      : JumpStmt(NodeKind::GOTO_STMT, jump_to), _ident_token(ident_token) {}
+  Token identifier() const { return _ident_token; }
 
 private:
-  std::shared_ptr<Token> _ident_token = nullptr;
+  Token _ident_token;
 };
 
 class ContinueStmt : public JumpStmt {
 public:
-  ContinueStmt(Stmt *jump_to) : JumpStmt(jump_to) {}
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::CONTINUE_STMT;
+  }
+  ContinueStmt(Stmt *jump_to) : JumpStmt(NodeKind::CONTINUE_STMT, jump_to) {}
 };
 
 class BreakStmt : public JumpStmt {
 public:
-  BreakStmt(Stmt *jump_to) : JumpStmt(jump_to) {}
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::BREAK_STMT;
+  }
+  BreakStmt(Stmt *jump_to) : JumpStmt(NodeKind::BREAK_STMT, jump_to) {}
 };
 
 class ReturnStmt : public JumpStmt {
 public:
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::RETURN_STMT;
+  }
   ReturnStmt(Stmt *jump_to, Expr *returned)
-      : JumpStmt(jump_to), _returned(returned) {}
+      : JumpStmt(NodeKind::RETURN_STMT, jump_to), _returned(returned) {}
+  Expr *returned() const { return _returned; }
 
 private:
-  std::unique_ptr<Expr> _returned;
+  Expr *_returned;
 };
 
 #endif
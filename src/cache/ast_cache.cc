@@ -0,0 +1,868 @@
+#include "ast_cache.h"
+#include "../util/hash.h"
+#include "precompiled_header.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+namespace ast_cache {
+namespace {
+
+constexpr size_t RECORD_SIZES[SECTION_COUNT] = {
+    sizeof(TOKEN),        sizeof(uint32_t),    sizeof(uint32_t),
+    sizeof(uint64_t),     sizeof(Spelling),    sizeof(char),
+    sizeof(Node),         sizeof(uint32_t),    sizeof(TypeRecord),
+    sizeof(uint32_t),     sizeof(SymbolRecord), sizeof(uint32_t),
+    sizeof(BindingRecord), sizeof(uint32_t),    sizeof(SourceRecord),
+    sizeof(char),         sizeof(uint32_t),    sizeof(uint32_t),
+    sizeof(LineMarkerRecord), sizeof(MacroRecord), sizeof(MacroToken),
+    sizeof(ExpansionRecord)};
+
+size_t AlignUp(size_t offset) { return (offset + 7) & ~size_t(7); }
+
+template <typename T> uint32_t Size(const std::vector<T> &records) {
+  return static_cast<uint32_t>(records.size());
+}
+
+/**
+ * Flattens the results of a parser into the section arrays. The symbols
+ * declarations declared are written first, each after its type, its
+ * parameters and its body, then the function definitions, so every run of
+ * symbols, statements or arguments stays contiguous. Types are shared, so
+ * each is written once, after the types it refers to. The bindings of the
+ * symbol table then refer to those symbols by number; compound statements
+ * already refer to scopes by number. The atoms of a preprocessor state
+ * become spellings like those of tokens.
+ */
+class Writer {
+public:
+  explicit Writer(const Parser &parser)
+      : _parser(parser), _tokens(parser.lexer().token_list()),
+        _spelling_numbers(Interner::ForThread().size(), NONE) {}
+
+  // False if the parser holds something the format cannot express.
+  bool Flatten();
+  void AddState(const PreprocessorState &state);
+  bool Save(uint64_t source_hash, uint64_t source_size,
+            const std::string &path) const;
+
+private:
+  void WriteTokens();
+  // `symbols` holds pointers or unique_ptrs to them.
+  template <typename Symbols> uint32_t WriteSymbols(const Symbols &symbols);
+  uint32_t WriteType(const Type *type);
+  uint32_t WriteNode(const ASTNode *node);
+  uint32_t WriteList(const std::vector<uint32_t> &numbers);
+  uint32_t SpellingOf(Atom atom);
+  uint32_t SpellingOrNone(uint32_t atom) {
+    return atom == NONE ? NONE : SpellingOf(static_cast<Atom>(atom));
+  }
+  uint32_t TokenNumber(Token token) const {
+    return token ? token.index() : NONE;
+  }
+
+  const Parser &_parser;
+  const TokenList &_tokens;
+  std::vector<uint32_t> _spelling_numbers; // indexed by atom
+  std::unordered_map<const Symbol *, uint32_t> _symbol_numbers;
+  std::unordered_map<const Type *, uint32_t> _type_numbers;
+  std::unordered_map<const Stmt *, uint32_t> _stmt_numbers;
+  // Jump statements and their targets, numbered once everything is written.
+  std::vector<std::pair<uint32_t, const Stmt *>> _jumps;
+  bool _unsupported = false;
+
+  std::vector<TOKEN> _tags;
+  std::vector<uint32_t> _offsets;
+  std::vector<uint32_t> _lengths;
+  std::vector<uint64_t> _payloads;
+  std::vector<Spelling> _spellings;
+  std::vector<char> _spelling_bytes;
+  std::vector<Node> _nodes;
+  std::vector<uint32_t> _node_lists;
+  std::vector<TypeRecord> _types;
+  std::vector<uint32_t> _type_lists;
+  std::vector<SymbolRecord> _symbols;
+  std::vector<uint32_t> _scopes;
+  std::vector<BindingRecord> _bindings;
+  std::vector<uint32_t> _functions;
+  PreprocessorState _state;
+};
+
+bool Writer::Flatten() {
+  WriteTokens();
+  auto &table = _parser.symbol_table();
+  for (ScopeId scope = 0; scope < table.scope_count(); ++scope) {
+    _scopes.push_back(table.parent(scope));
+  }
+  std::vector<Symbol *> declared;
+  for (auto &binding : table.bindings()) {
+    if (binding.owned) {
+      declared.push_back(binding.symbol);
+    }
+  }
+  WriteSymbols(declared);
+  auto &definitions = _parser.function_definitions();
+  auto first = WriteSymbols(definitions);
+  for (uint32_t i = 0; i < definitions.size(); ++i) {
+    _functions.push_back(first + i);
+  }
+  for (auto &binding : table.bindings()) {
+    auto iter = _symbol_numbers.find(binding.symbol);
+    if (iter == _symbol_numbers.end()) {
+      return false;
+    }
+    _bindings.push_back({iter->second, binding.scope, binding.name_space,
+                         binding.owned, binding.is_typedef, 0});
+  }
+  for (auto &jump : _jumps) {
+    auto iter = _stmt_numbers.find(jump.second);
+    if (iter == _stmt_numbers.end()) {
+      return false;
+    }
+    _nodes[jump.first].children[0] = iter->second;
+  }
+  return !_unsupported;
+}
+
+void Writer::AddState(const PreprocessorState &state) {
+  _state = state;
+  for (auto &source : _state.sources) {
+    source.guard = SpellingOrNone(source.guard);
+  }
+  for (auto &macro : _state.macros) {
+    macro.name = SpellingOf(static_cast<Atom>(macro.name));
+  }
+  for (auto &token : _state.macro_tokens) {
+    if (TokenList::ValueKind(token.tag) == Value::Kind::ATOM) {
+      token.payload = SpellingOf(static_cast<Atom>(token.payload));
+    }
+  }
+  for (auto &expansion : _state.expansions) {
+    expansion.macro = SpellingOf(static_cast<Atom>(expansion.macro));
+  }
+}
+
+void Writer::WriteTokens() {
+  auto size = _tokens.size();
+  _tags.reserve(size);
+  _offsets.reserve(size);
+  _lengths.reserve(size);
+  _payloads.reserve(size);
+  for (uint32_t i = 0; i < size; ++i) {
+    auto tag = _tokens.tag(i);
+    auto payload = _tokens.payload(i);
+    if (TokenList::ValueKind(tag) == Value::Kind::ATOM) {
+      payload = SpellingOf(static_cast<Atom>(payload));
+    }
+    _tags.push_back(tag);
+    _offsets.push_back(_tokens.offset(i));
+    _lengths.push_back(_tokens.length(i));
+    _payloads.push_back(payload);
+  }
+}
+
+uint32_t Writer::SpellingOf(Atom atom) {
+  auto &number = _spelling_numbers[static_cast<uint32_t>(atom)];
+  if (number == NONE) {
+    auto spelling = Interner::ForThread().spelling(atom);
+    number = Size(_spellings);
+    _spellings.push_back({Size(_spelling_bytes),
+                          static_cast<uint32_t>(spelling.size())});
+    _spelling_bytes.insert(_spelling_bytes.end(), spelling.begin(),
+                           spelling.end());
+  }
+  return number;
+}
+
+template <typename Symbols>
+uint32_t Writer::WriteSymbols(const Symbols &symbols) {
+  std::vector<SymbolRecord> records;
+  for (auto &symbol : symbols) {
+    SymbolRecord record;
+    record.token = TokenNumber(symbol->token());
+    record.type = WriteType(symbol->type());
+    record.parameter_count = Size(symbol->parameters());
+    record.first_parameter = record.parameter_count == 0
+                                 ? NONE
+                                 : WriteSymbols(symbol->parameters());
+    record.body = WriteNode(symbol->body());
+    record.specifiers = symbol->specifiers();
+    records.push_back(record);
+  }
+  auto first = Size(_symbols);
+  for (size_t i = 0; i < symbols.size(); ++i) {
+    _symbol_numbers[&*symbols[i]] = Size(_symbols);
+    _symbols.push_back(records[i]);
+  }
+  return first;
+}
+
+uint32_t Writer::WriteType(const Type *type) {
+  if (type == nullptr) {
+    return NONE;
+  }
+  auto iter = _type_numbers.find(type);
+  if (iter != _type_numbers.end()) {
+    return iter->second;
+  }
+  TypeRecord record{};
+  record.kind = TypeContext::KindOf(type);
+  record.builtin = type->builtin();
+  record.flags = type->flags();
+  record.base = NONE;
+  record.first_parameter = NONE;
+  if (type->IsFunctionType()) {
+    auto function = static_cast<const FunctionType *>(type);
+    record.variadic = function->variadic();
+    record.base = WriteType(function->base());
+    std::vector<uint32_t> parameters;
+    for (auto parameter : function->parameters()) {
+      parameters.push_back(WriteType(parameter));
+    }
+    record.first_parameter = Size(_type_lists);
+    record.parameter_count = Size(parameters);
+    _type_lists.insert(_type_lists.end(), parameters.begin(),
+                       parameters.end());
+  } else if (type->IsArrayType()) {
+    auto array = static_cast<const ArrayType *>(type);
+    record.base = WriteType(array->base());
+    record.length = static_cast<int32_t>(array->length());
+  } else if (type->IsPointerType()) {
+    record.base = WriteType(static_cast<const PointerType *>(type)->base());
+  } else if (type->IsDerivedType()) {
+    // Structures, unions and atomics are not parsed yet.
+    _unsupported = true;
+  }
+  auto number = Size(_types);
+  _types.push_back(record);
+  _type_numbers[type] = number;
+  return number;
+}
+
+uint32_t Writer::WriteList(const std::vector<uint32_t> &numbers) {
+  auto first = Size(_node_lists);
+  _node_lists.insert(_node_lists.end(), numbers.begin(), numbers.end());
+  return first;
+}
+
+uint32_t Writer::WriteNode(const ASTNode *node) {
+  if (node == nullptr) {
+    return NONE;
+  }
+  auto number = Size(_nodes);
+  _nodes.emplace_back();
+  Node record{};
+  record.kind = node->kind();
+  record.token = NONE;
+  std::fill(std::begin(record.children), std::end(record.children), NONE);
+  if (auto expr = dyn_cast<Expr>(node)) {
+    record.token = TokenNumber(expr->token());
+  } else {
+    _stmt_numbers[cast<Stmt>(node)] = number;
+  }
+  auto &children = record.children;
+  switch (node->kind()) {
+  case NodeKind::LABELED_STMT:
+    record.token = TokenNumber(cast<LabeledStmt>(node)->label());
+    break;
+  case NodeKind::COMPOUND_STMT: {
+    auto compound = cast<CompoundStmt>(node);
+    std::vector<uint32_t> stmts;
+    for (auto stmt : compound->stmts()) {
+      stmts.push_back(WriteNode(stmt));
+    }
+    children[0] = WriteList(stmts);
+    children[1] = Size(stmts);
+    children[2] = compound->scope();
+    break;
+  }
+  case NodeKind::EXPRESSION_STMT:
+    children[0] = WriteNode(cast<ExpressionStmt>(node)->expression());
+    break;
+  case NodeKind::IF_STMT: {
+    auto if_stmt = cast<IfStmt>(node);
+    children[0] = WriteNode(if_stmt->condition());
+    children[1] = WriteNode(if_stmt->if_stmt());
+    children[2] = WriteNode(if_stmt->else_stmt());
+    break;
+  }
+  case NodeKind::SWITCH_STMT:
+    children[0] = WriteNode(cast<SwitchStmt>(node)->selection());
+    break;
+  case NodeKind::WHILE_STMT:
+  case NodeKind::DO_WHILE_STMT:
+  case NodeKind::FOR_STMT: {
+    auto loop = cast<IterationStmt>(node);
+    children[0] = WriteNode(loop->condition());
+    children[1] = WriteNode(loop->loop_body());
+    break;
+  }
+  case NodeKind::GOTO_STMT:
+    record.token = TokenNumber(cast<GotoStmt>(node)->identifier());
+    break;
+  case NodeKind::RETURN_STMT:
+    children[1] = WriteNode(cast<ReturnStmt>(node)->returned());
+    break;
+  case NodeKind::CONTINUE_STMT:
+  case NodeKind::BREAK_STMT:
+  case NodeKind::CONSTANT:
+    break;
+  case NodeKind::IDENTIFIER:
+    record.op1 =
+        static_cast<uint8_t>(cast<Identifier>(node)->name_space());
+    break;
+  case NodeKind::UNARY_OPERATOR_EXPR: {
+    auto unary = cast<UnaryOperatorExpr>(node);
+    record.op1 = static_cast<uint8_t>(unary->op());
+    children[0] = WriteNode(unary->operand());
+    break;
+  }
+  case NodeKind::BINARY_OPERATOR_EXPR: {
+    auto binary = cast<BinaryOperatorExpr>(node);
+    record.op1 = static_cast<uint8_t>(binary->op());
+    children[0] = WriteNode(binary->operand1());
+    children[1] = WriteNode(binary->operand2());
+    break;
+  }
+  case NodeKind::TENARY_OPERATOR_EXPR: {
+    auto tenary = cast<TenaryOperatorExpr>(node);
+    record.op1 = static_cast<uint8_t>(tenary->op1());
+    record.op2 = static_cast<uint8_t>(tenary->op2());
+    children[0] = WriteNode(tenary->operand1());
+    children[1] = WriteNode(tenary->operand2());
+    children[2] = WriteNode(tenary->operand3());
+    break;
+  }
+  case NodeKind::FUNCTION_CALL_EXPR: {
+    auto call = cast<FunctionCallExpr>(node);
+    children[0] = WriteNode(call->designator());
+    std::vector<uint32_t> arguments;
+    for (auto argument : call->parameters()) {
+      arguments.push_back(WriteNode(argument));
+    }
+    children[1] = WriteList(arguments);
+    children[2] = Size(arguments);
+    break;
+  }
+  }
+  if (auto jump = dyn_cast<JumpStmt>(node)) {
+    if (jump->jump_to() != nullptr) {
+      _jumps.emplace_back(number, jump->jump_to());
+    }
+  }
+  _nodes[number] = record;
+  return number;
+}
+
+bool Writer::Save(uint64_t source_hash, uint64_t source_size,
+                  const std::string &path) const {
+  struct Bytes {
+    const void *data;
+    size_t size;
+  };
+  auto bytes = [](const auto &records) {
+    return Bytes{records.data(), records.size() * sizeof(records[0])};
+  };
+  const Bytes sections[SECTION_COUNT] = {
+      bytes(_tags),          bytes(_offsets),        bytes(_lengths),
+      bytes(_payloads),      bytes(_spellings),      bytes(_spelling_bytes),
+      bytes(_nodes),         bytes(_node_lists),     bytes(_types),
+      bytes(_type_lists),    bytes(_symbols),        bytes(_scopes),
+      bytes(_bindings),      bytes(_functions),
+      bytes(_state.sources), bytes(_state.source_bytes),
+      bytes(_state.token_sources), bytes(_state.token_expansions),
+      bytes(_state.line_markers), bytes(_state.macros),
+      bytes(_state.macro_tokens), bytes(_state.expansions)};
+  Header header{};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.section_count = SECTION_COUNT;
+  header.source_hash = source_hash;
+  header.source_size = source_size;
+  header.options_hash = _state.options_hash;
+  auto offset = AlignUp(sizeof(Header));
+  for (uint32_t i = 0; i < SECTION_COUNT; ++i) {
+    header.sections[i] = {offset, sections[i].size / RECORD_SIZES[i]};
+    offset = AlignUp(offset + sections[i].size);
+  }
+
+  // Written aside, under a name of this thread's own, and renamed into
+  // place, so no reader maps half a file.
+  auto temporary =
+      path + ".tmp." + std::to_string(getpid()) + "." +
+      std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+  std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+  const char padding[8] = {};
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.write(padding, AlignUp(sizeof(header)) - sizeof(header));
+  for (auto &section : sections) {
+    out.write(static_cast<const char *>(section.data), section.size);
+    out.write(padding, AlignUp(section.size) - section.size);
+  }
+  out.close();
+  if (!out || std::rename(temporary.c_str(), path.c_str()) != 0) {
+    std::remove(temporary.c_str());
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Builds nodes, types and symbols from their records. Nodes go to the
+ * parser's arena and are built once each, children first; a record that
+ * refers outside its section, or back to one of its ancestors, fails the
+ * whole load. So does loading a symbol twice, since each has one owner.
+ * Types are interned into the parser's TypeContext once each; a type may
+ * only refer to types written before it.
+ */
+class Loader {
+public:
+  Loader(const CachedUnit &unit, Arena &arena, TypeContext &type_context,
+         const TokenList &tokens)
+      : _unit(unit), _arena(arena), _type_context(type_context),
+        _tokens(tokens), _nodes(unit.count(NODES)),
+        _loading(unit.count(NODES)), _symbols(unit.count(SYMBOLS)),
+        _types(unit.count(TYPES)) {}
+
+  std::vector<std::unique_ptr<Symbol>> LoadSymbols(uint32_t first,
+                                                   uint32_t count);
+  // A symbol already owned by a function or definition.
+  Symbol *LoadedSymbol(uint32_t number) {
+    if (number >= _symbols.size() || _symbols[number] == nullptr) {
+      Fail();
+      return nullptr;
+    }
+    return _symbols[number];
+  }
+  void ResolveJumps() {
+    for (auto &jump : _jumps) {
+      jump.first->set_jump_to(LoadChild<Stmt>(jump.second));
+    }
+  }
+  bool failed() const { return _failed; }
+
+private:
+  // `limit` is the number of the type referring to this one.
+  const Type *LoadType(uint32_t number, uint32_t limit);
+  ASTNode *LoadNode(uint32_t number);
+  ASTNode *BuildNode(const Node &record);
+  template <typename T> T *LoadChild(uint32_t number) {
+    auto node = LoadNode(number);
+    if (node != nullptr && !isa<T>(node)) {
+      Fail();
+      return nullptr;
+    }
+    return static_cast<T *>(node);
+  }
+  template <typename T> ArenaArray<T *> LoadList(uint32_t first,
+                                                 uint32_t count) {
+    if (uint64_t(first) + count > _unit.count(NODE_LISTS)) {
+      Fail();
+      return {};
+    }
+    auto numbers = _unit.section<uint32_t>(NODE_LISTS) + first;
+    std::vector<T *> children;
+    for (uint32_t i = 0; i < count; ++i) {
+      children.push_back(LoadChild<T>(numbers[i]));
+    }
+    return _arena.NewArray(children);
+  }
+  Token TokenAt(uint32_t number) {
+    if (number == NONE) {
+      return Token();
+    }
+    if (number >= _tokens.size()) {
+      Fail();
+      return Token();
+    }
+    return _tokens[number];
+  }
+  OP OpOf(uint8_t op) {
+    if (op > static_cast<uint8_t>(OP::OR_ASSIGN)) {
+      Fail();
+    }
+    return static_cast<OP>(op);
+  }
+  void Fail() { _failed = true; }
+
+  const CachedUnit &_unit;
+  Arena &_arena;
+  TypeContext &_type_context;
+  const TokenList &_tokens;
+  std::vector<ASTNode *> _nodes;
+  std::vector<bool> _loading;
+  std::vector<Symbol *> _symbols;
+  std::vector<const Type *> _types;
+  std::vector<std::pair<JumpStmt *, uint32_t>> _jumps;
+  bool _failed = false;
+};
+
+std::vector<std::unique_ptr<Symbol>> Loader::LoadSymbols(uint32_t first,
+                                                         uint32_t count) {
+  std::vector<std::unique_ptr<Symbol>> symbols;
+  if (uint64_t(first) + count > _unit.count(SYMBOLS)) {
+    Fail();
+    return symbols;
+  }
+  for (uint32_t i = first; i < first + count; ++i) {
+    if (_symbols[i] != nullptr) {
+      Fail();
+      return {};
+    }
+    auto &record = _unit.symbol(i);
+    auto type = LoadType(record.type, _unit.count(TYPES));
+    auto symbol = std::make_unique<Symbol>(TokenAt(record.token), type);
+    symbol->set_specifiers(record.specifiers);
+    _symbols[i] = symbol.get();
+    if (record.parameter_count != 0) {
+      symbol->set_parameters(
+          LoadSymbols(record.first_parameter, record.parameter_count));
+    }
+    symbol->set_body(LoadChild<CompoundStmt>(record.body));
+    symbols.push_back(std::move(symbol));
+  }
+  return symbols;
+}
+
+const Type *Loader::LoadType(uint32_t number, uint32_t limit) {
+  if (number == NONE) {
+    return nullptr;
+  }
+  if (number >= limit) {
+    Fail();
+    return nullptr;
+  }
+  if (_types[number] != nullptr) {
+    return _types[number];
+  }
+  auto &record = _unit.type(number);
+  if (record.flags & (SCS_MASK | TS_MASK)) {
+    Fail();
+    return nullptr;
+  }
+  const Type *type = nullptr;
+  switch (record.kind) {
+  case TypeKind::VOID:
+  case TypeKind::CHAR:
+  case TypeKind::INT:
+  case TypeKind::FLOAT:
+  case TypeKind::BOOL:
+    if (record.builtin == BuiltinKind::NONE ||
+        record.builtin >= BuiltinKind::COUNT ||
+        TypeContext::KindOf(record.builtin) != record.kind) {
+      Fail();
+      return nullptr;
+    }
+    type = _type_context.Builtin(record.builtin, record.flags);
+    break;
+  case TypeKind::ARRAY:
+    type = _type_context.Array(LoadType(record.base, number), record.length);
+    break;
+  case TypeKind::POINTER:
+    type = _type_context.Pointer(LoadType(record.base, number));
+    break;
+  case TypeKind::FUNCTION: {
+    if (uint64_t(record.first_parameter) + record.parameter_count >
+        _unit.count(TYPE_LISTS)) {
+      Fail();
+      return nullptr;
+    }
+    auto numbers = _unit.section<uint32_t>(TYPE_LISTS) +
+                   record.first_parameter;
+    std::vector<const Type *> parameters;
+    for (uint32_t i = 0; i < record.parameter_count; ++i) {
+      parameters.push_back(LoadType(numbers[i], number));
+    }
+    type = _type_context.Function(LoadType(record.base, number),
+                                  std::move(parameters), record.variadic);
+    break;
+  }
+  default:
+    Fail();
+    return nullptr;
+  }
+  // The qualifiers of a pointer.
+  type = _type_context.WithFlags(type, record.flags);
+  _types[number] = type;
+  return type;
+}
+
+ASTNode *Loader::LoadNode(uint32_t number) {
+  if (number == NONE) {
+    return nullptr;
+  }
+  if (number >= _nodes.size() || _loading[number]) {
+    Fail();
+    return nullptr;
+  }
+  if (_nodes[number] == nullptr) {
+    _loading[number] = true;
+    _nodes[number] = BuildNode(_unit.node(number));
+    _loading[number] = false;
+  }
+  return _nodes[number];
+}
+
+ASTNode *Loader::BuildNode(const Node &record) {
+  auto &children = record.children;
+  auto token = TokenAt(record.token);
+  switch (record.kind) {
+  case NodeKind::LABELED_STMT:
+    return _arena.New<LabeledStmt>(token);
+  case NodeKind::COMPOUND_STMT: {
+    auto compound = _arena.New<CompoundStmt>();
+    compound->set_stmts(LoadList<Stmt>(children[0], children[1]));
+    if (children[2] != NONE && children[2] >= _unit.count(SCOPES)) {
+      Fail();
+      return nullptr;
+    }
+    compound->set_scope(children[2]);
+    return compound;
+  }
+  case NodeKind::EXPRESSION_STMT:
+    return _arena.New<ExpressionStmt>(LoadChild<Expr>(children[0]));
+  case NodeKind::IF_STMT: {
+    auto condition = LoadChild<Expr>(children[0]);
+    auto if_stmt = LoadChild<Stmt>(children[1]);
+    auto else_stmt = LoadChild<Stmt>(children[2]);
+    return _arena.New<IfStmt>(condition, if_stmt, else_stmt);
+  }
+  case NodeKind::SWITCH_STMT:
+    return _arena.New<SwitchStmt>(LoadChild<Expr>(children[0]));
+  case NodeKind::WHILE_STMT:
+    return _arena.New<WhileStmt>(LoadChild<Expr>(children[0]),
+                                 LoadChild<Stmt>(children[1]));
+  case NodeKind::DO_WHILE_STMT:
+    return _arena.New<DoWhileStmt>(LoadChild<Expr>(children[0]),
+                                   LoadChild<Stmt>(children[1]));
+  case NodeKind::FOR_STMT:
+    return _arena.New<ForStmt>(LoadChild<Expr>(children[0]),
+                               LoadChild<Stmt>(children[1]));
+  case NodeKind::GOTO_STMT:
+  case NodeKind::CONTINUE_STMT:
+  case NodeKind::BREAK_STMT:
+  case NodeKind::RETURN_STMT: {
+    JumpStmt *jump;
+    if (record.kind == NodeKind::GOTO_STMT) {
+      jump = _arena.New<GotoStmt>(nullptr, token);
+    } else if (record.kind == NodeKind::CONTINUE_STMT) {
+      jump = _arena.New<ContinueStmt>(nullptr);
+    } else if (record.kind == NodeKind::BREAK_STMT) {
+      jump = _arena.New<BreakStmt>(nullptr);
+    } else {
+      jump = _arena.New<ReturnStmt>(nullptr, LoadChild<Expr>(children[1]));
+    }
+    // The target may not be built yet.
+    if (children[0] != NONE) {
+      _jumps.emplace_back(jump, children[0]);
+    }
+    return jump;
+  }
+  case NodeKind::IDENTIFIER:
+    if (record.op1 >
+        static_cast<uint8_t>(IdentifierNameSpace::ORDINARY_IDENTIFIER)) {
+      Fail();
+      return nullptr;
+    }
+    return _arena.New<Identifier>(
+        token, static_cast<IdentifierNameSpace>(record.op1));
+  case NodeKind::CONSTANT:
+    return _arena.New<Constant>(token);
+  case NodeKind::UNARY_OPERATOR_EXPR:
+    return _arena.New<UnaryOperatorExpr>(
+        OpOf(record.op1), LoadChild<Expr>(children[0]), token);
+  case NodeKind::BINARY_OPERATOR_EXPR: {
+    auto operand1 = LoadChild<Expr>(children[0]);
+    auto operand2 = LoadChild<Expr>(children[1]);
+    return _arena.New<BinaryOperatorExpr>(OpOf(record.op1), operand1,
+                                          operand2, token);
+  }
+  case NodeKind::TENARY_OPERATOR_EXPR: {
+    auto operand1 = LoadChild<Expr>(children[0]);
+    auto operand2 = LoadChild<Expr>(children[1]);
+    auto operand3 = LoadChild<Expr>(children[2]);
+    return _arena.New<TenaryOperatorExpr>(OpOf(record.op1), OpOf(record.op2),
+                                          operand1, operand2, operand3,
+                                          token);
+  }
+  case NodeKind::FUNCTION_CALL_EXPR: {
+    auto designator = LoadChild<Expr>(children[0]);
+    auto arguments = LoadList<Expr>(children[1], children[2]);
+    return _arena.New<FunctionCallExpr>(designator, arguments, token);
+  }
+  }
+  Fail();
+  return nullptr;
+}
+
+} // namespace
+} // namespace ast_cache
+
+std::unique_ptr<CachedUnit> CachedUnit::Open(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat st;
+  void *mapping = MAP_FAILED;
+  if (fstat(fd, &st) == 0 &&
+      static_cast<size_t>(st.st_size) >= sizeof(ast_cache::Header)) {
+    mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return nullptr;
+  }
+  std::unique_ptr<CachedUnit> unit(new CachedUnit());
+  unit->_data = static_cast<const char *>(mapping);
+  unit->_size = st.st_size;
+  if (!unit->Valid()) {
+    return nullptr;
+  }
+  return unit;
+}
+
+CachedUnit::~CachedUnit() {
+  if (_data != nullptr) {
+    munmap(const_cast<char *>(_data), _size);
+  }
+}
+
+bool CachedUnit::Valid() const {
+  auto &header = this->header();
+  if (std::memcmp(header.magic, ast_cache::MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != ast_cache::VERSION ||
+      header.section_count != ast_cache::SECTION_COUNT) {
+    return false;
+  }
+  for (uint32_t i = 0; i < ast_cache::SECTION_COUNT; ++i) {
+    auto &section = header.sections[i];
+    if (section.offset % 8 != 0 || section.offset > _size ||
+        section.count > UINT32_MAX ||
+        section.count > (_size - section.offset) /
+                            ast_cache::RECORD_SIZES[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool CachedUnit::InternSpellings(std::vector<Atom> &atoms) const {
+  using namespace ast_cache;
+  // Atoms are numbered per process, so every spelling is interned again.
+  auto spellings = section<Spelling>(SPELLINGS);
+  auto spelling_bytes = section<char>(SPELLING_BYTES);
+  atoms.clear();
+  atoms.reserve(count(SPELLINGS));
+  for (uint32_t i = 0; i < count(SPELLINGS); ++i) {
+    if (uint64_t(spellings[i].offset) + spellings[i].length >
+        count(SPELLING_BYTES)) {
+      return false;
+    }
+    atoms.push_back(Interner::ForThread().Intern(
+        spelling_bytes + spellings[i].offset, spellings[i].length));
+  }
+  return true;
+}
+
+bool CachedUnit::LoadResults(Parser &parser) const {
+  using namespace ast_cache;
+  auto &table = parser._symbols;
+  auto parents = section<uint32_t>(SCOPES);
+  if (count(SCOPES) == 0 || parents[0] != NONE ||
+      table.scope_count() != 1) {
+    return false;
+  }
+  for (uint32_t i = 1; i < count(SCOPES); ++i) {
+    if (parents[i] >= i) {
+      return false;
+    }
+    table.RestoreScope(parents[i]);
+  }
+
+  Loader loader(*this, parser._ast_arena, parser._types,
+                parser.lexer().token_list());
+  auto functions = section<uint32_t>(FUNCTIONS);
+  for (uint32_t i = 0; i < count(FUNCTIONS); ++i) {
+    auto symbols = loader.LoadSymbols(functions[i], 1);
+    if (symbols.empty()) {
+      return false;
+    }
+    parser._function_definitions.push_back(std::move(symbols[0]));
+  }
+  // Replayed in order, so the file scope ends up with the names a parse
+  // leaves visible; the other scopes have closed.
+  for (uint32_t i = 0; i < count(BINDINGS); ++i) {
+    auto &record = binding(i);
+    if (record.scope >= count(SCOPES) ||
+        record.name_space >= IdentifierNameSpace::COUNT) {
+      return false;
+    }
+    if (record.owned) {
+      auto symbols = loader.LoadSymbols(record.symbol, 1);
+      if (symbols.empty()) {
+        return false;
+      }
+      table.Restore(std::move(symbols[0]), record.scope, record.is_typedef);
+    } else if (auto symbol = loader.LoadedSymbol(record.symbol)) {
+      table.Restore(symbol, record.scope, record.name_space);
+    } else {
+      return false;
+    }
+  }
+  loader.ResolveJumps();
+  return !loader.failed();
+}
+
+bool CachedUnit::Write(const Parser &parser, uint64_t source_hash,
+                       const std::string &path,
+                       const ast_cache::PreprocessorState &state) {
+  ast_cache::Writer writer(parser);
+  if (!writer.Flatten()) {
+    return false;
+  }
+  writer.AddState(state);
+  return writer.Save(source_hash, parser.lexer().source().size(), path);
+}
+
+ASTCache::ASTCache(std::string directory) : _directory(std::move(directory)) {
+  // Fails harmlessly if the directory exists; any other failure shows up
+  // as files that cannot be written.
+  mkdir(_directory.c_str(), 0755);
+}
+
+std::string ASTCache::PathFor(const Preprocessor &preprocessor,
+                              const std::string &path) const {
+  auto key = HashCombine(PrecompiledHeader::OptionsHash(preprocessor),
+                         HashBytes(path.data(), path.size()));
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.ast",
+                static_cast<unsigned long long>(key));
+  return _directory + "/" + name;
+}
+
+std::unique_ptr<Parser> ASTCache::Load(Preprocessor &preprocessor,
+                                       const std::string &path) {
+  if (auto unit = PrecompiledHeader::Open(PathFor(preprocessor, path))) {
+    if (auto parser = unit->LoadUnit(preprocessor, path)) {
+      ++_hits;
+      return parser;
+    }
+  }
+  ++_misses;
+  return nullptr;
+}
+
+bool ASTCache::Store(const Preprocessor &preprocessor, const Parser &parser,
+                     const std::string &path) const {
+  return PrecompiledHeader::Write(preprocessor, parser,
+                                  PathFor(preprocessor, path));
+}
@@ -0,0 +1,359 @@
+#ifndef YYQC_SRC_CACHE_AST_CACHE_H_
+#define YYQC_SRC_CACHE_AST_CACHE_H_
+
+#include "../parser/parser.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * On-disk form of a parsed translation unit: its tokens, AST, types and
+ * scopes, each flattened into an array of fixed-size records. Records refer
+ * to each other by their number in the array, never by address, so a file
+ * is used in place once mapped and any record can be read without decoding
+ * the rest.
+ *
+ * The file is a Header followed by the sections it lists, each aligned to
+ * 8 bytes. Atoms are numbered per process, so the file keeps the spelling
+ * of every atom it uses and token payloads and typedef-names refer to
+ * spellings instead. Text payloads are offsets into the source, which is
+ * mapped anyway to check its hash. Scopes are kept as the parser's
+ * SymbolTable logged them: their parents, and every binding in the order
+ * it was made.
+ *
+ * The sections from SOURCES on hold the preprocessor's state after the
+ * unit (see precompiled_header.h), for a precompiled header and for the
+ * units an ASTCache keeps alike. The tokens come from many sources, so
+ * their offsets and text payloads are relative to each token's own.
+ */
+namespace ast_cache {
+
+constexpr char MAGIC[8] = {'Y', 'Y', 'Q', 'C', 'A', 'S', 'T', '\0'};
+// Bumped whenever a record changes layout or meaning.
+constexpr uint32_t VERSION = 7;
+// A missing child, token, type or scope.
+constexpr uint32_t NONE = UINT32_MAX;
+
+enum Section : uint32_t {
+  TOKEN_TAGS,     // TOKEN
+  TOKEN_OFFSETS,  // uint32_t
+  TOKEN_LENGTHS,  // uint32_t
+  TOKEN_PAYLOADS, // uint64_t, with atoms replaced by spelling numbers
+  SPELLINGS,      // Spelling
+  SPELLING_BYTES, // char
+  NODES,          // Node
+  NODE_LISTS,     // uint32_t node numbers of statement and argument lists
+  TYPES,          // TypeRecord, each after the types it refers to
+  TYPE_LISTS,     // uint32_t type numbers of parameter type lists
+  SYMBOLS,        // SymbolRecord
+  SCOPES,         // uint32_t parent of each scope; NONE for the file scope
+  BINDINGS,       // BindingRecord, in the order they were made
+  FUNCTIONS,      // uint32_t symbol numbers of the function definitions
+  // Precompiled headers only.
+  SOURCES,          // SourceRecord of each preprocessor output source
+  SOURCE_BYTES,     // char: source names, and text the preprocessor made
+  TOKEN_SOURCES,    // uint32_t source of each token
+  TOKEN_EXPANSIONS, // uint32_t ExpansionRecord of each token, or NONE
+  LINE_MARKERS,     // LineMarkerRecord, by source and then offset
+  MACROS,           // MacroRecord of each macro defined, in definition order
+  MACRO_TOKENS,     // MacroToken
+  EXPANSIONS,       // ExpansionRecord
+  SECTION_COUNT
+};
+
+struct SectionEntry {
+  uint64_t offset;
+  uint64_t count;
+};
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t section_count;
+  // Of the source the unit was parsed from.
+  uint64_t source_hash;
+  uint64_t source_size;
+  // Of the preprocessor options the unit was preprocessed with.
+  uint64_t options_hash;
+  SectionEntry sections[SECTION_COUNT];
+};
+
+struct Spelling {
+  uint32_t offset; // in SPELLING_BYTES
+  uint32_t length;
+};
+
+/**
+ * One AST node. `token` is the token of an expression, the label of a
+ * labeled-statement or the identifier of a goto. The children are:
+ *   COMPOUND_STMT        first NODE_LISTS entry, statement count, scope
+ *   EXPRESSION_STMT      expression
+ *   IF_STMT              condition, then-statement, else-statement
+ *   SWITCH_STMT          selection
+ *   WHILE, DO_WHILE, FOR condition, body
+ *   jump statements      jump target, and the returned value of a return
+ *   UNARY_OPERATOR_EXPR  operand
+ *   BINARY_OPERATOR_EXPR operand1, operand2
+ *   TENARY_OPERATOR_EXPR operand1, operand2, operand3
+ *   FUNCTION_CALL_EXPR   designator, first NODE_LISTS entry, argument count
+ */
+struct Node {
+  NodeKind kind;
+  // The OP of an operator expression (op1 of a tenary one), or the
+  // IdentifierNameSpace of an identifier.
+  uint8_t op1;
+  uint8_t op2;
+  uint8_t padding;
+  uint32_t token;
+  uint32_t children[4];
+};
+
+// One type of the unit's TypeContext, written once however many symbols
+// share it.
+struct TypeRecord {
+  TypeKind kind;
+  BuiltinKind builtin;
+  uint8_t variadic;
+  uint8_t padding;
+  // Qualifiers and function specifiers, as Type::flags() packs them.
+  uint32_t flags;
+  // Element type of an array, pointee, or returned type of a function.
+  uint32_t base;
+  int32_t length;
+  // Parameter types of a function are a run of TYPE_LISTS.
+  uint32_t first_parameter;
+  uint32_t parameter_count;
+};
+
+struct SymbolRecord {
+  uint32_t token;
+  uint32_t type;
+  // Parameters of a function declarator are a run of SYMBOLS.
+  uint32_t first_parameter;
+  uint32_t parameter_count;
+  // The COMPOUND_STMT of a function-definition.
+  uint32_t body;
+  // SCS_* and TS_* it was declared with, as Symbol::specifiers() packs
+  // them.
+  uint32_t specifiers;
+};
+
+// An owned symbol is an ordinary identifier declared by a declaration;
+// the others are parameters and function definitions, which the symbols
+// of their functions and FUNCTIONS own.
+struct BindingRecord {
+  uint32_t symbol;
+  uint32_t scope;
+  IdentifierNameSpace name_space;
+  uint8_t owned;
+  uint8_t is_typedef;
+  uint8_t padding;
+};
+
+// A source of a precompiled header's tokens: a file, which a use checks
+// against the hash of its bytes, or text the preprocessor made, such as
+// the spelling of a pasted token, which is kept in SOURCE_BYTES.
+struct SourceRecord {
+  uint64_t hash;
+  uint32_t size;
+  // Offsets in SOURCE_BYTES; `text` is NONE for a file.
+  uint32_t name;
+  uint32_t name_length;
+  uint32_t text;
+  // Spelling of the include guard the file was found to have, or NONE.
+  uint32_t guard;
+  uint8_t pragma_once;
+  uint8_t padding[3];
+};
+
+// A #line directive or line marker of one source.
+struct LineMarkerRecord {
+  uint32_t source;
+  uint32_t offset;
+  uint32_t row;
+  uint32_t number;
+  // The file it names, in SOURCE_BYTES.
+  uint32_t file;
+  uint32_t file_length;
+};
+
+struct MacroRecord {
+  uint32_t name; // spelling
+  uint8_t builtin;
+  uint8_t function_like;
+  uint8_t variadic;
+  uint8_t pastes;
+  uint16_t parameter_count;
+  uint16_t padding;
+  // The body is a run of MACRO_TOKENS.
+  uint32_t first_token;
+  uint32_t token_count;
+};
+
+// A token of a macro body, with an atom payload as a spelling number.
+struct MacroToken {
+  TOKEN tag;
+  uint8_t flags;
+  uint16_t parameter;
+  uint32_t source;
+  uint32_t offset;
+  uint32_t length;
+  uint64_t payload;
+};
+
+// A macro invocation some tokens came out of; see Preprocessor.
+struct ExpansionRecord {
+  uint32_t macro; // spelling
+  uint32_t source;
+  uint32_t offset;
+  uint32_t parent;
+  uint32_t root;
+};
+
+static_assert(sizeof(Node) == 24 && sizeof(TypeRecord) == 24 &&
+                  sizeof(SymbolRecord) == 24 && sizeof(BindingRecord) == 12 &&
+                  sizeof(SourceRecord) == 32 &&
+                  sizeof(LineMarkerRecord) == 24 &&
+                  sizeof(MacroRecord) == 20 && sizeof(MacroToken) == 24 &&
+                  sizeof(ExpansionRecord) == 20,
+              "records are written as they are laid out in memory");
+static_assert(std::is_trivially_copyable<Header>::value &&
+                  std::is_trivially_copyable<Node>::value &&
+                  std::is_trivially_copyable<TypeRecord>::value &&
+                  std::is_trivially_copyable<SymbolRecord>::value &&
+                  std::is_trivially_copyable<BindingRecord>::value &&
+                  std::is_trivially_copyable<SourceRecord>::value &&
+                  std::is_trivially_copyable<MacroToken>::value,
+              "records are copied bytewise");
+
+/**
+ * The preprocessor's side of a precompiled header, as it is handed to
+ * CachedUnit::Write: the records of the sections from SOURCES on, with
+ * atoms still as atoms where the file has spelling numbers. Those are the
+ * guard of a source, the name of a macro or an expansion, and the payload
+ * of a name in a macro body.
+ */
+struct PreprocessorState {
+  uint64_t options_hash = 0;
+  std::vector<SourceRecord> sources;
+  std::vector<char> source_bytes;
+  std::vector<uint32_t> token_sources;
+  std::vector<uint32_t> token_expansions;
+  std::vector<LineMarkerRecord> line_markers;
+  std::vector<MacroRecord> macros;
+  std::vector<MacroToken> macro_tokens;
+  std::vector<ExpansionRecord> expansions;
+};
+
+} // namespace ast_cache
+
+class Preprocessor;
+
+/**
+ * A cache file mapped read-only. The sections are views into the mapping;
+ * LoadResults() rebuilds the AST, types and scopes of the parser the file
+ * was written from, without lexing or parsing, into a parser that
+ * PrecompiledHeader has given the same tokens.
+ */
+class CachedUnit {
+public:
+  // nullptr if `path` is missing, truncated, or of another VERSION.
+  static std::unique_ptr<CachedUnit> Open(const std::string &path);
+  ~CachedUnit();
+  CachedUnit(const CachedUnit &) = delete;
+  CachedUnit &operator=(const CachedUnit &) = delete;
+
+  uint64_t source_hash() const { return header().source_hash; }
+  uint64_t source_size() const { return header().source_size; }
+  uint64_t options_hash() const { return header().options_hash; }
+  size_t file_size() const { return _size; }
+
+  template <typename T> const T *section(ast_cache::Section id) const {
+    return reinterpret_cast<const T *>(_data + header().sections[id].offset);
+  }
+  uint32_t count(ast_cache::Section id) const {
+    return static_cast<uint32_t>(header().sections[id].count);
+  }
+  const ast_cache::Node &node(uint32_t i) const {
+    return section<ast_cache::Node>(ast_cache::NODES)[i];
+  }
+  const ast_cache::TypeRecord &type(uint32_t i) const {
+    return section<ast_cache::TypeRecord>(ast_cache::TYPES)[i];
+  }
+  const ast_cache::SymbolRecord &symbol(uint32_t i) const {
+    return section<ast_cache::SymbolRecord>(ast_cache::SYMBOLS)[i];
+  }
+  const ast_cache::BindingRecord &binding(uint32_t i) const {
+    return section<ast_cache::BindingRecord>(ast_cache::BINDINGS)[i];
+  }
+
+  // The atom of every spelling, interned in this process; false if the
+  // spellings run outside their section.
+  bool InternSpellings(std::vector<Atom> &atoms) const;
+  // Rebuilds the types, symbols and scopes of the file into `parser`, whose
+  // tokens start with the file's and which has parsed nothing. False if
+  // the records do not hang together.
+  bool LoadResults(Parser &parser) const;
+
+  // Writes the results of `parser`, which has parsed a whole translation
+  // unit from bytes hashing to `source_hash`, and the preprocessor's
+  // `state` after it. False if they hold a type the format has no record
+  // for, or the file cannot be written.
+  static bool Write(const Parser &parser, uint64_t source_hash,
+                    const std::string &path,
+                    const ast_cache::PreprocessorState &state);
+
+private:
+  CachedUnit() = default;
+  // Checks the header and that every section lies inside the file.
+  bool Valid() const;
+  const ast_cache::Header &header() const {
+    return *reinterpret_cast<const ast_cache::Header *>(_data);
+  }
+
+  const char *_data = nullptr;
+  size_t _size = 0;
+};
+
+/**
+ * Parsed translation units kept in `directory`, one file per unit and set
+ * of preprocessor options, named after a hash of both. A file holds the
+ * preprocessor's state after the unit as a precompiled header does, so it
+ * keeps the hash of every file the unit entered, and a use checks each
+ * against the file as it is now. A unit none of whose files has changed
+ * is loaded instead of being preprocessed and parsed again; an edit to the
+ * unit or to anything it includes makes it stale, and it is parsed afresh.
+ *
+ * Several threads may use one ASTCache at a time.
+ */
+class ASTCache {
+public:
+  explicit ASTCache(std::string directory);
+
+  // The unit at `path`, done parsing, as `preprocessor` would preprocess
+  // it, with the sources of its tokens added to `preprocessor`. nullptr if
+  // none is kept or it is stale, or if the file is damaged, which may have
+  // left `preprocessor` half set up.
+  std::unique_ptr<Parser> Load(Preprocessor &preprocessor,
+                               const std::string &path);
+  // Keeps what `parser` parsed of the unit at `path`, all of which
+  // `preprocessor` preprocessed; false if it could not be written.
+  bool Store(const Preprocessor &preprocessor, const Parser &parser,
+             const std::string &path) const;
+  std::string PathFor(const Preprocessor &preprocessor,
+                      const std::string &path) const;
+
+  uint64_t hits() const { return _hits; }
+  uint64_t misses() const { return _misses; }
+
+private:
+  std::string _directory;
+  std::atomic<uint64_t> _hits{0};
+  std::atomic<uint64_t> _misses{0};
+};
+
+#endif
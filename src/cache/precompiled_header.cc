@@ -0,0 +1,427 @@
+#include "precompiled_header.h"
+#include "../util/hash.h"
+#include <algorithm>
+#include <unordered_map>
+
+using namespace ast_cache;
+
+namespace {
+
+// A run of SOURCE_BYTES, or false if it is out of bounds.
+bool BytesAt(const CachedUnit &unit, uint32_t offset, uint32_t length,
+             std::string &bytes) {
+  if (uint64_t(offset) + length > unit.count(SOURCE_BYTES)) {
+    return false;
+  }
+  bytes.assign(unit.section<char>(SOURCE_BYTES) + offset, length);
+  return true;
+}
+
+// Appends `bytes` to `state`'s SOURCE_BYTES, returning their offset.
+uint32_t AddBytes(PreprocessorState &state, const std::string &bytes) {
+  auto offset = static_cast<uint32_t>(state.source_bytes.size());
+  state.source_bytes.insert(state.source_bytes.end(), bytes.begin(),
+                            bytes.end());
+  return offset;
+}
+
+} // namespace
+
+std::unique_ptr<PrecompiledHeader>
+PrecompiledHeader::Open(const std::string &path) {
+  auto unit = CachedUnit::Open(path);
+  if (!unit || unit->count(SOURCES) == 0) {
+    return nullptr;
+  }
+  return std::unique_ptr<PrecompiledHeader>(
+      new PrecompiledHeader(std::move(unit)));
+}
+
+uint64_t PrecompiledHeader::OptionsHash(const Preprocessor &preprocessor) {
+  auto &predefined = preprocessor._predefined;
+  auto hash = HashBytes(predefined.data(), predefined.size());
+  for (auto &directory : preprocessor._include_paths) {
+    hash = HashCombine(hash, HashBytes(directory.data(), directory.size()));
+  }
+  return hash;
+}
+
+bool PrecompiledHeader::Build(Preprocessor &preprocessor,
+                              const std::string &header,
+                              const std::string &path) {
+  Parser parser(preprocessor.Run(header));
+  if (!parser.TranslationUnit()) {
+    return false;
+  }
+  return Write(preprocessor, parser, path);
+}
+
+bool PrecompiledHeader::Write(const Preprocessor &preprocessor,
+                              const Parser &parser, const std::string &path) {
+  auto &pp = preprocessor;
+  PreprocessorState state;
+  state.options_hash = OptionsHash(pp);
+  // Every file source is the source of a file the header entered.
+  std::unordered_map<const SourceBuffer *, const FileCache::File *> files;
+  for (auto file : pp._entered) {
+    files.emplace(file->source().get(), file);
+  }
+  std::unordered_map<const SourceBuffer *, uint64_t> hashes;
+  for (uint32_t i = 0; i < pp._buffers.size(); ++i) {
+    auto buffer = pp._buffers[i];
+    SourceRecord record{};
+    record.size = static_cast<uint32_t>(buffer->size());
+    record.name = AddBytes(state, pp._source_names[i]);
+    record.name_length = static_cast<uint32_t>(pp._source_names[i].size());
+    record.guard = NONE;
+    auto file = files.find(buffer);
+    if (file != files.end()) {
+      auto known = hashes.find(buffer);
+      if (known == hashes.end()) {
+        known = hashes.emplace(buffer, HashBytes(buffer->data(),
+                                                 buffer->size())).first;
+      }
+      record.hash = known->second;
+      record.text = NONE;
+      if (file->second->guard() != Atom::NONE) {
+        record.guard = static_cast<uint32_t>(file->second->guard());
+      }
+      record.pragma_once = file->second->pragma_once();
+    } else {
+      record.text = AddBytes(state, std::string(buffer->data(),
+                                                buffer->size()));
+    }
+    state.sources.push_back(record);
+    for (auto &marker : pp._line_markers[i]) {
+      state.line_markers.push_back(
+          {i, marker.offset, marker.row, marker.number,
+           AddBytes(state, marker.file),
+           static_cast<uint32_t>(marker.file.size())});
+    }
+  }
+
+  auto &tokens = parser.lexer().token_list();
+  for (uint32_t i = 0; i < tokens.size(); ++i) {
+    state.token_sources.push_back(tokens.source_id(i));
+  }
+  state.token_expansions = pp._output_expansions;
+  for (auto &expansion : pp._expansions) {
+    state.expansions.push_back(
+        {static_cast<uint32_t>(expansion.macro), expansion.source,
+         expansion.offset, expansion.parent, expansion.root});
+  }
+  // The macros defined at the end, in the order they were.
+  std::vector<uint32_t> defined;
+  for (auto index : pp._macro_of) {
+    if (index != Preprocessor::NONE) {
+      defined.push_back(index);
+    }
+  }
+  std::sort(defined.begin(), defined.end());
+  for (auto index : defined) {
+    auto &macro = pp._macros[index];
+    state.macros.push_back(
+        {static_cast<uint32_t>(macro.name),
+         static_cast<uint8_t>(macro.builtin), macro.function_like,
+         macro.variadic, macro.pastes, macro.parameter_count, 0,
+         static_cast<uint32_t>(state.macro_tokens.size()),
+         static_cast<uint32_t>(macro.body.size())});
+    for (auto &token : macro.body) {
+      state.macro_tokens.push_back({token.tag, token.flags, token.parameter,
+                                    token.source, token.offset, token.length,
+                                    token.payload});
+    }
+  }
+
+  auto &source = parser.lexer().source();
+  return CachedUnit::Write(parser, HashBytes(source.data(), source.size()),
+                           path, state);
+}
+
+bool PrecompiledHeader::OpenSources(
+    std::vector<std::shared_ptr<const SourceBuffer>> &buffers) const {
+  auto &unit = *_unit;
+  auto records = unit.section<SourceRecord>(SOURCES);
+  // A file included several times is several sources.
+  std::unordered_map<std::string, std::shared_ptr<const SourceBuffer>> files;
+  for (uint32_t i = 0; i < unit.count(SOURCES); ++i) {
+    auto &record = records[i];
+    std::string name, text;
+    if (!BytesAt(unit, record.name, record.name_length, name)) {
+      return false;
+    }
+    if (record.text != NONE) {
+      if (!BytesAt(unit, record.text, record.size, text)) {
+        return false;
+      }
+      buffers.push_back(SourceBuffer::FromText(text));
+      continue;
+    }
+    auto &file = files[name];
+    if (!file) {
+      file = SourceBuffer::Open(name);
+      if (!file || file->size() != record.size ||
+          HashBytes(file->data(), file->size()) != record.hash) {
+        return false;
+      }
+    }
+    buffers.push_back(file);
+  }
+  return true;
+}
+
+bool PrecompiledHeader::Valid(
+    const std::vector<std::shared_ptr<const SourceBuffer>> &buffers,
+    const std::vector<Atom> &atoms) const {
+  auto &unit = *_unit;
+  auto source_count = unit.count(SOURCES);
+  auto spans = [&](uint32_t source, uint64_t offset, uint64_t length) {
+    return source < source_count && offset + length <= buffers[source]->size();
+  };
+  auto payload_valid = [&](TOKEN tag, uint32_t source, uint64_t payload) {
+    switch (TokenList::ValueKind(tag)) {
+    case Value::Kind::ATOM:
+      return payload < atoms.size();
+    case Value::Kind::TEXT:
+      return spans(source, payload >> 32, static_cast<uint32_t>(payload));
+    default:
+      return true;
+    }
+  };
+
+  auto token_count = unit.count(TOKEN_TAGS);
+  if (token_count == 0 || unit.count(TOKEN_OFFSETS) != token_count ||
+      unit.count(TOKEN_LENGTHS) != token_count ||
+      unit.count(TOKEN_PAYLOADS) != token_count ||
+      unit.count(TOKEN_SOURCES) != token_count ||
+      unit.count(TOKEN_EXPANSIONS) != token_count ||
+      unit.section<TOKEN>(TOKEN_TAGS)[token_count - 1] != TOKEN::FILE_EOF) {
+    return false;
+  }
+  auto expansion_count = unit.count(EXPANSIONS);
+  for (uint32_t i = 0; i + 1 < token_count; ++i) {
+    auto tag = unit.section<TOKEN>(TOKEN_TAGS)[i];
+    auto source = unit.section<uint32_t>(TOKEN_SOURCES)[i];
+    auto expansion = unit.section<uint32_t>(TOKEN_EXPANSIONS)[i];
+    if (!spans(source, unit.section<uint32_t>(TOKEN_OFFSETS)[i],
+               unit.section<uint32_t>(TOKEN_LENGTHS)[i]) ||
+        !payload_valid(tag, source,
+                       unit.section<uint64_t>(TOKEN_PAYLOADS)[i]) ||
+        (expansion != NONE && expansion >= expansion_count)) {
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < source_count; ++i) {
+    auto guard = unit.section<SourceRecord>(SOURCES)[i].guard;
+    if (guard != NONE && guard >= atoms.size()) {
+      return false;
+    }
+  }
+  auto markers = unit.section<LineMarkerRecord>(LINE_MARKERS);
+  for (uint32_t i = 0; i < unit.count(LINE_MARKERS); ++i) {
+    if (markers[i].source >= source_count ||
+        uint64_t(markers[i].file) + markers[i].file_length >
+            unit.count(SOURCE_BYTES)) {
+      return false;
+    }
+  }
+  auto macro_tokens = unit.section<MacroToken>(MACRO_TOKENS);
+  auto macros = unit.section<MacroRecord>(MACROS);
+  for (uint32_t i = 0; i < unit.count(MACROS); ++i) {
+    auto &macro = macros[i];
+    if (macro.name >= atoms.size() ||
+        macro.builtin > static_cast<uint8_t>(Preprocessor::Builtin::LINE) ||
+        uint64_t(macro.first_token) + macro.token_count >
+            unit.count(MACRO_TOKENS)) {
+      return false;
+    }
+    for (uint32_t k = 0; k < macro.token_count; ++k) {
+      auto &token = macro_tokens[macro.first_token + k];
+      if (!spans(token.source, token.offset, token.length) ||
+          !payload_valid(token.tag, token.source, token.payload) ||
+          token.parameter > macro.parameter_count) {
+        return false;
+      }
+    }
+  }
+  auto expansions = unit.section<ExpansionRecord>(EXPANSIONS);
+  for (uint32_t i = 0; i < expansion_count; ++i) {
+    auto &expansion = expansions[i];
+    if (expansion.macro >= atoms.size() ||
+        (expansion.source != NONE && expansion.source >= source_count) ||
+        (expansion.parent != NONE && expansion.parent >= i) ||
+        expansion.root > i) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool PrecompiledHeader::Current(
+    const Preprocessor &preprocessor,
+    std::vector<std::shared_ptr<const SourceBuffer>> &buffers,
+    std::vector<Atom> &atoms) const {
+  return _unit->options_hash() == OptionsHash(preprocessor) &&
+         OpenSources(buffers) && _unit->InternSpellings(atoms) &&
+         Valid(buffers, atoms);
+}
+
+void PrecompiledHeader::AddOutput(
+    Preprocessor &preprocessor,
+    const std::vector<std::shared_ptr<const SourceBuffer>> &buffers,
+    const std::vector<Atom> &atoms, uint32_t first, uint32_t count) const {
+  auto &unit = *_unit;
+  auto &pp = preprocessor;
+  auto source_of = [first](uint32_t source) {
+    return source == NONE ? NONE : source + first;
+  };
+  auto records = unit.section<SourceRecord>(SOURCES);
+  for (uint32_t i = 0; i < unit.count(SOURCES); ++i) {
+    std::string name;
+    BytesAt(unit, records[i].name, records[i].name_length, name);
+    pp.AddSource(buffers[i], name);
+  }
+  auto markers = unit.section<LineMarkerRecord>(LINE_MARKERS);
+  for (uint32_t i = 0; i < unit.count(LINE_MARKERS); ++i) {
+    Preprocessor::LineMarker marker{markers[i].offset, markers[i].row,
+                                    markers[i].number, std::string()};
+    BytesAt(unit, markers[i].file, markers[i].file_length, marker.file);
+    pp._line_markers[source_of(markers[i].source)].push_back(
+        std::move(marker));
+  }
+  auto expansions = unit.section<ExpansionRecord>(EXPANSIONS);
+  pp._expansions.reserve(unit.count(EXPANSIONS));
+  for (uint32_t i = 0; i < unit.count(EXPANSIONS); ++i) {
+    auto &record = expansions[i];
+    pp._expansions.push_back({atoms[record.macro], source_of(record.source),
+                              record.offset, record.parent, record.root});
+  }
+
+  auto tags = unit.section<TOKEN>(TOKEN_TAGS);
+  auto offsets = unit.section<uint32_t>(TOKEN_OFFSETS);
+  auto lengths = unit.section<uint32_t>(TOKEN_LENGTHS);
+  auto payloads = unit.section<uint64_t>(TOKEN_PAYLOADS);
+  auto sources = unit.section<uint32_t>(TOKEN_SOURCES);
+  auto token_expansions = unit.section<uint32_t>(TOKEN_EXPANSIONS);
+  for (uint32_t i = 0; i < count; ++i) {
+    auto payload = payloads[i];
+    if (TokenList::ValueKind(tags[i]) == Value::Kind::ATOM) {
+      payload = static_cast<uint32_t>(atoms[payload]);
+    }
+    pp._output.AddEncoded(tags[i], offsets[i], lengths[i], payload,
+                          sources[i] + first);
+  }
+  pp._output_expansions.insert(pp._output_expansions.end(),
+                               token_expansions, token_expansions + count);
+}
+
+std::unique_ptr<Parser>
+PrecompiledHeader::Load(Preprocessor &preprocessor,
+                        const std::string &path) const {
+  auto &unit = *_unit;
+  std::vector<std::shared_ptr<const SourceBuffer>> buffers;
+  std::vector<Atom> atoms;
+  if (!Current(preprocessor, buffers, atoms)) {
+    return nullptr;
+  }
+
+  // The unit is source 0, so the header's sources come one later. Its
+  // tokens go in without its FILE_EOF.
+  auto &pp = preprocessor;
+  auto file = pp.EnterUnit(path);
+  auto header_tokens = unit.count(TOKEN_TAGS) - 1;
+  auto unit_tokens = file->lexer().token_list().size();
+  pp._output.reserve(header_tokens + unit_tokens);
+  pp._output_expansions.reserve(header_tokens + unit_tokens);
+  AddOutput(pp, buffers, atoms, 1, header_tokens);
+  // Files found again, so that including them skips them as the header did.
+  auto records = unit.section<SourceRecord>(SOURCES);
+  for (uint32_t i = 0; i < unit.count(SOURCES); ++i) {
+    std::string name;
+    BytesAt(unit, records[i].name, records[i].name_length, name);
+    if (records[i].text != NONE) {
+      continue;
+    }
+    if (auto entered = pp._files.Find(name)) {
+      if (records[i].guard != NONE && entered->guard() == Atom::NONE) {
+        entered->set_guard(atoms[records[i].guard]);
+      }
+      if (records[i].pragma_once) {
+        entered->set_pragma_once();
+      }
+      pp._entered.insert(entered);
+    }
+  }
+
+  // The header's macros replace the predefined ones.
+  std::fill(pp._macro_of.begin(), pp._macro_of.end(), Preprocessor::NONE);
+  auto macro_tokens = unit.section<MacroToken>(MACRO_TOKENS);
+  auto macros = unit.section<MacroRecord>(MACROS);
+  for (uint32_t i = 0; i < unit.count(MACROS); ++i) {
+    auto &record = macros[i];
+    Preprocessor::Macro macro{
+        atoms[record.name],
+        static_cast<Preprocessor::Builtin>(record.builtin),
+        record.function_like != 0,
+        record.variadic != 0,
+        record.parameter_count,
+        {},
+        record.pastes != 0};
+    macro.body.reserve(record.token_count);
+    for (uint32_t k = 0; k < record.token_count; ++k) {
+      auto &token = macro_tokens[record.first_token + k];
+      auto payload = token.payload;
+      if (TokenList::ValueKind(token.tag) == Value::Kind::ATOM) {
+        payload = static_cast<uint32_t>(atoms[payload]);
+      }
+      macro.body.push_back({token.tag, token.flags, token.parameter,
+                            token.source + 1, token.offset, token.length,
+                            payload, HideSetTable::EMPTY_SET,
+                            Preprocessor::NONE});
+    }
+    pp.DefineMacro(std::move(macro));
+  }
+
+  auto parser = std::make_unique<Parser>(pp.ExpandUnit(file));
+  if (!unit.LoadResults(*parser)) {
+    return nullptr;
+  }
+  parser->LexerPutBack(header_tokens);
+  return parser;
+}
+
+std::unique_ptr<Parser>
+PrecompiledHeader::LoadUnit(Preprocessor &preprocessor,
+                            const std::string &path) const {
+  auto &unit = *_unit;
+  auto &record = unit.section<SourceRecord>(SOURCES)[0];
+  std::string name;
+  std::vector<std::shared_ptr<const SourceBuffer>> buffers;
+  std::vector<Atom> atoms;
+  if (record.text != NONE ||
+      !BytesAt(unit, record.name, record.name_length, name) || name != path ||
+      !Current(preprocessor, buffers, atoms)) {
+    return nullptr;
+  }
+  // The unit's sources are the output's, from source 0 on, and so is its
+  // FILE_EOF, which Valid leaves to the caller.
+  auto last = unit.count(TOKEN_TAGS) - 1;
+  if (unit.section<uint32_t>(TOKEN_SOURCES)[last] != 0 ||
+      unit.section<uint32_t>(TOKEN_OFFSETS)[last] != buffers[0]->size() ||
+      unit.section<uint32_t>(TOKEN_EXPANSIONS)[last] != NONE) {
+    return nullptr;
+  }
+  auto &pp = preprocessor;
+  pp._output.reserve(last + 1);
+  pp._output_expansions.reserve(last + 1);
+  AddOutput(pp, buffers, atoms, 0, last + 1);
+  pp._statistics.output_tokens = last;
+  auto parser = std::make_unique<Parser>(
+      std::make_unique<Lexer>(buffers[0], path, std::move(pp._output)));
+  if (!unit.LoadResults(*parser)) {
+    return nullptr;
+  }
+  // Where TranslationUnit() stops.
+  parser->LexerPutBack(last);
+  return parser;
+}
@@ -0,0 +1,95 @@
+#ifndef YYQC_SRC_CACHE_PRECOMPILED_HEADER_H_
+#define YYQC_SRC_CACHE_PRECOMPILED_HEADER_H_
+
+#include "../preprocessor/preprocessor.h"
+#include "ast_cache.h"
+#include <memory>
+#include <string>
+
+/**
+ * A header that translation units start with, preprocessed and parsed once
+ * for all of them, as -include-pch does. The file is a unit file (see
+ * ast_cache.h) of the header, so its tokens, its types and the symbols of
+ * its file scope are records read in place, and the spellings of its
+ * atoms are interned again on use. Beside them are the preprocessor's
+ * state after the header: every source its tokens came from, the macros
+ * defined, their expansion records and the #line markers.
+ *
+ * A unit is then preprocessed from its own first line, with the header's
+ * tokens already in the output and its macros defined, and parsed from the
+ * first token after the header, with the header's declarations in scope.
+ * The unit's own #include of the header, or of anything the header
+ * included, is skipped by the include guards and #pragma once the header
+ * found.
+ *
+ * The hash and size of every file the header entered are kept, and a use
+ * checks each against the file as it is now; so are the predefined macros
+ * and include paths it was built with. A header any of them has changed
+ * for is stale, and is not used.
+ *
+ * An ASTCache keeps whole units the same way, each as a header nothing
+ * comes after.
+ */
+class PrecompiledHeader {
+public:
+  // nullptr if `path` is missing, damaged, of another VERSION, or not a
+  // precompiled header.
+  static std::unique_ptr<PrecompiledHeader> Open(const std::string &path);
+
+  // Preprocesses and parses `header` with `preprocessor`, which is then
+  // used up, and writes the result to `path`. False on a syntax error, if
+  // the header holds something the format has no record for, or if the
+  // file cannot be written.
+  static bool Build(Preprocessor &preprocessor, const std::string &header,
+                    const std::string &path);
+  // Writes what `parser` parsed of all that `preprocessor` preprocessed,
+  // and the preprocessor's state after it, to `path`. False as
+  // CachedUnit::Write.
+  static bool Write(const Preprocessor &preprocessor, const Parser &parser,
+                    const std::string &path);
+  // Of the options that change what a file preprocesses to.
+  static uint64_t OptionsHash(const Preprocessor &preprocessor);
+
+  // A parser of the unit at `path` as if it began with an #include of the
+  // header, which `preprocessor` has preprocessed and which Scan() parses
+  // from where the header ended. nullptr if the header is stale, which
+  // leaves `preprocessor` as it was, or if its records do not hang
+  // together.
+  std::unique_ptr<Parser> Load(Preprocessor &preprocessor,
+                               const std::string &path) const;
+  // The parser Write wrote of the unit at `path`, done parsing, with the
+  // sources of its tokens added to `preprocessor`, which has read nothing.
+  // nullptr as Load, or if the file is of another unit.
+  std::unique_ptr<Parser> LoadUnit(Preprocessor &preprocessor,
+                                   const std::string &path) const;
+
+  size_t file_size() const { return _unit->file_size(); }
+
+private:
+  explicit PrecompiledHeader(std::unique_ptr<CachedUnit> unit)
+      : _unit(std::move(unit)) {}
+  // Whether the options are those of `preprocessor` and every file is as
+  // it was; then the bytes of every source and the atom of every spelling.
+  bool Current(const Preprocessor &preprocessor,
+               std::vector<std::shared_ptr<const SourceBuffer>> &buffers,
+               std::vector<Atom> &atoms) const;
+  // The bytes of every source, files read as they are now; false if a
+  // file has changed or a record is out of bounds.
+  bool OpenSources(
+      std::vector<std::shared_ptr<const SourceBuffer>> &buffers) const;
+  // Whether every preprocessor record refers inside its sections, its
+  // sources and `atoms`.
+  bool Valid(const std::vector<std::shared_ptr<const SourceBuffer>> &buffers,
+             const std::vector<Atom> &atoms) const;
+  // Adds the sources to `preprocessor`, which numbers them from `first` on,
+  // with their #line markers, the expansion records and the first `count`
+  // tokens of the output.
+  void AddOutput(
+      Preprocessor &preprocessor,
+      const std::vector<std::shared_ptr<const SourceBuffer>> &buffers,
+      const std::vector<Atom> &atoms, uint32_t first, uint32_t count) const;
+
+  std::unique_ptr<CachedUnit> _unit;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#include "code_generator.h"
+#include "../error/error.h"
+#include "emitter.h"
+#include "lowering.h"
+#include <unordered_set>
+
+CodeGenerator::CodeGenerator(const Parser &parser, Locator locate)
+    : _parser(parser), _interner(Interner::ForThread()),
+      _locate(std::move(locate)) {}
+
+std::string CodeGenerator::Generate(ThreadPool *pool) const {
+  // Built here, so the tasks only read it.
+  _parser.root_scope();
+  auto &functions = _parser.function_definitions();
+  std::vector<Piece> pieces(functions.size());
+  auto compile = [&](size_t i) { CompileFunction(*functions[i], pieces[i]); };
+  if (pool != nullptr && pool->size() > 1) {
+    pool->ParallelFor(functions.size(), compile);
+  } else {
+    for (size_t i = 0; i < functions.size(); ++i) {
+      compile(i);
+    }
+  }
+
+  auto text = FileScopeObjects();
+  size_t failed = 0;
+  for (auto &piece : pieces) {
+    for (auto &message : piece.messages) {
+      if (auto diagnostics = Diagnostics::current()) {
+        diagnostics->Report(message);
+      } else {
+        std::cerr << message << std::endl;
+      }
+    }
+    failed += piece.failed;
+    text += piece.text;
+  }
+  if (failed > 0) {
+    Error{std::to_string(failed) +
+          (failed == 1 ? " function" : " functions") +
+          " failed to compile."};
+  }
+  return text;
+}
+
+std::string CodeGenerator::FileScopeObjects() const {
+  std::string text;
+  std::unordered_set<Atom> defined;
+  for (auto symbol : _parser.root_scope().symbols()) {
+    auto type = symbol->type();
+    auto storage = symbol->storage_class();
+    // A name declared again is still one object.
+    if ((storage & (SCS_TYPEDEF | SCS_EXTERN)) || type->IsFunctionType() ||
+        SizeOf(type) == 0 || !defined.insert(symbol->name()).second) {
+      continue;
+    }
+    text += EmitCommon(std::string(_interner.spelling(symbol->name())),
+                       SizeOf(type), AlignmentOf(type),
+                       !(storage & SCS_STATIC));
+  }
+  return text;
+}
+
+void CodeGenerator::CompileFunction(const Symbol &function,
+                                    Piece &piece) const {
+  // The task's own, so what it reports stays in its piece whichever
+  // thread runs it.
+  Diagnostics diagnostics;
+  try {
+    auto &symbols = _parser.symbol_table();
+    TypeChecker checker(symbols, _interner, _locate);
+    checker.Check(function);
+    piece.text =
+        EmitFunction(Lowering(symbols, _interner, checker).Lower(function));
+  } catch (const Diagnostics::Fatal &) {
+    piece.failed = true;
+  }
+  piece.messages = diagnostics.messages();
+}
@@ -0,0 +1,49 @@
+#ifndef YYQC_SRC_CODEGEN_CODE_GENERATOR_H_
+#define YYQC_SRC_CODEGEN_CODE_GENERATOR_H_
+
+#include "../parser/parser.h"
+#include "../util/thread_pool.h"
+#include "type_checker.h"
+#include <string>
+
+/**
+ * Compiles a parsed translation unit to assembly (see emitter.h). The
+ * file-scope objects are laid out first, on the calling thread; then each
+ * function definition is type checked, lowered and emitted on its own,
+ * spread over a ThreadPool, and the pieces are joined in source order.
+ *
+ * Once the parser is done, the file-scope declarations are all a body
+ * depends on besides itself, and a function task only reads them: the
+ * scope tree is built before the tasks start, no type is made, and names
+ * are spelled through the Interner of the thread that parsed the unit.
+ * Each task writes nothing but its own piece, so the output and the
+ * messages are the same, byte for byte, however many threads made them.
+ */
+class CodeGenerator {
+public:
+  // To be made on the thread that parsed the unit, whose Interner spells
+  // its names. `locate` may be called from any thread.
+  CodeGenerator(const Parser &parser, Locator locate);
+
+  // The unit's assembly. Without a pool, or with a pool of one, the
+  // functions are compiled one after another on the calling thread. A
+  // function that fails reports its first error; if any did, an Error
+  // ends the unit once they all have.
+  std::string Generate(ThreadPool *pool = nullptr) const;
+
+private:
+  struct Piece {
+    std::string text;
+    std::vector<std::string> messages;
+    bool failed = false;
+  };
+
+  std::string FileScopeObjects() const;
+  void CompileFunction(const Symbol &function, Piece &piece) const;
+
+  const Parser &_parser;
+  const Interner &_interner;
+  Locator _locate;
+};
+
+#endif // !YYQC_SRC_CODEGEN_CODE_GENERATOR_H_
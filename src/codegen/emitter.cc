@@ -0,0 +1,407 @@
+#include "emitter.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+using ir::Opcode;
+using ir::Reg;
+
+// Registers values are allocated to; the two after them carry spilled
+// operands.
+constexpr int REGISTERS = 6;
+constexpr int SCRATCH_A = 6;
+constexpr int SCRATCH_B = 7;
+constexpr int SPILLED = -1;
+
+const char *Suffix(BuiltinKind kind) {
+  switch (kind) {
+  case BuiltinKind::CHAR:
+  case BuiltinKind::SIGNED_CHAR:
+    return "i8";
+  case BuiltinKind::BOOL:
+  case BuiltinKind::UNSIGNED_CHAR:
+    return "u8";
+  case BuiltinKind::SHORT:
+    return "i16";
+  case BuiltinKind::UNSIGNED_SHORT:
+    return "u16";
+  case BuiltinKind::INT:
+    return "i32";
+  case BuiltinKind::UNSIGNED_INT:
+    return "u32";
+  case BuiltinKind::LONG:
+  case BuiltinKind::LONG_LONG:
+    return "i64";
+  case BuiltinKind::UNSIGNED_LONG:
+  case BuiltinKind::UNSIGNED_LONG_LONG:
+    return "u64";
+  case BuiltinKind::FLOAT:
+    return "f32";
+  case BuiltinKind::DOUBLE:
+    return "f64";
+  case BuiltinKind::LONG_DOUBLE:
+    return "f128";
+  default:
+    return "v";
+  }
+}
+
+const char *Mnemonic(Opcode op) {
+  switch (op) {
+  case Opcode::ADD:
+    return "add";
+  case Opcode::SUB:
+    return "sub";
+  case Opcode::MUL:
+    return "mul";
+  case Opcode::DIV:
+    return "div";
+  case Opcode::REM:
+    return "rem";
+  case Opcode::SHL:
+    return "shl";
+  case Opcode::SHR:
+    return "shr";
+  case Opcode::AND:
+    return "and";
+  case Opcode::OR:
+    return "or";
+  case Opcode::XOR:
+    return "xor";
+  case Opcode::EQ:
+    return "seq";
+  case Opcode::NE:
+    return "sne";
+  case Opcode::LT:
+    return "slt";
+  case Opcode::LE:
+    return "sle";
+  case Opcode::GT:
+    return "sgt";
+  case Opcode::GE:
+    return "sge";
+  case Opcode::NEG:
+    return "neg";
+  default:
+    return "not";
+  }
+}
+
+std::string Register(int physical) { return "r" + std::to_string(physical); }
+
+std::string Offset(int32_t offset) {
+  return offset == 0  ? ""
+         : offset > 0 ? "+" + std::to_string(offset)
+                      : std::to_string(offset);
+}
+
+/**
+ * One function's allocation and text. Intervals are found in one pass over
+ * the code, allocated in order of their starts, and the text written in a
+ * second pass.
+ */
+class FunctionEmitter {
+public:
+  explicit FunctionEmitter(const ir::Function &function)
+      : _function(function), _frame_size(function.frame_size),
+        _start(function.registers.size(), UINT32_MAX),
+        _end(function.registers.size(), 0),
+        _physical(function.registers.size(), SPILLED),
+        _slot(function.registers.size(), 0) {}
+
+  std::string Emit() {
+    FindIntervals();
+    Allocate();
+    std::string body;
+    for (uint32_t i = 0; i < _function.code.size(); ++i) {
+      EmitInstruction(i, body);
+    }
+    std::string text = "\t.text\n";
+    if (_function.global) {
+      text += "\t.globl\t" + _function.name + "\n";
+    }
+    text += _function.name + ":\n\tenter\t" +
+            std::to_string((_frame_size + 15) / 16 * 16) + "\n" + body;
+    if (!_function.strings.empty()) {
+      text += "\t.section\t.rodata\n";
+      for (size_t i = 0; i < _function.strings.size(); ++i) {
+        text += _function.names[_function.string_names[i]] + ":\n\t.string\t" +
+                Quote(_function.strings[i]) + "\n";
+      }
+    }
+    for (auto &object : _function.statics) {
+      text += EmitCommon(object.name, object.size, object.alignment, false);
+    }
+    return text;
+  }
+
+private:
+  template <typename F> void ForEachRegister(const ir::Instruction &i, F f) {
+    for (auto reg : {i.dst, i.a, i.b}) {
+      if (reg != ir::NO_REG) {
+        f(reg);
+      }
+    }
+    if (UsesAddress(i.op) && i.address.base == ir::Address::Base::REGISTER) {
+      f(i.address.index);
+    }
+  }
+
+  static bool UsesAddress(Opcode op) {
+    return op == Opcode::ADDRESS || op == Opcode::LOAD ||
+           op == Opcode::STORE || op == Opcode::CALL;
+  }
+
+  void FindIntervals() {
+    for (uint32_t i = 0; i < _function.code.size(); ++i) {
+      ForEachRegister(_function.code[i], [&](Reg reg) {
+        _start[reg] = std::min(_start[reg], i);
+        _end[reg] = std::max(_end[reg], i);
+      });
+    }
+  }
+
+  void Allocate() {
+    std::vector<Reg> order;
+    for (Reg reg = 0; reg < _start.size(); ++reg) {
+      if (_start[reg] != UINT32_MAX) {
+        order.push_back(reg);
+      }
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](Reg a, Reg b) { return _start[a] < _start[b]; });
+    // The register each machine register holds, if any.
+    Reg active[REGISTERS];
+    std::fill(active, active + REGISTERS, ir::NO_REG);
+    _held.resize(REGISTERS);
+    for (auto reg : order) {
+      // A register whose last use is where this one starts may share: an
+      // instruction reads its operands before it writes.
+      int free = -1, furthest = -1;
+      for (int p = 0; p < REGISTERS; ++p) {
+        if (active[p] != ir::NO_REG && _end[active[p]] <= _start[reg]) {
+          active[p] = ir::NO_REG;
+        }
+        if (active[p] == ir::NO_REG) {
+          free = free < 0 ? p : free;
+        } else if (furthest < 0 || _end[active[p]] > _end[active[furthest]]) {
+          furthest = p;
+        }
+      }
+      if (free < 0 && _end[active[furthest]] > _end[reg]) {
+        Spill(active[furthest]);
+        free = furthest;
+      }
+      if (free < 0) {
+        Spill(reg);
+        continue;
+      }
+      active[free] = reg;
+      _physical[reg] = free;
+      _held[free].push_back(reg);
+    }
+  }
+
+  void Spill(Reg reg) {
+    uint32_t size = std::max<uint32_t>(
+        8, LayoutOf(_function.registers[reg]).size);
+    _frame_size = (_frame_size + size + size - 1) / size * size;
+    _slot[reg] = -static_cast<int32_t>(_frame_size);
+    _physical[reg] = SPILLED;
+  }
+
+  // The machine registers holding a value live across instruction `i`.
+  std::vector<int> LiveAcross(uint32_t i) {
+    std::vector<int> live;
+    for (int p = 0; p < REGISTERS; ++p) {
+      auto &held = _held[p];
+      auto &cursor = _cursor[p];
+      while (cursor < held.size() &&
+             (_end[held[cursor]] <= i || _physical[held[cursor]] != p)) {
+        ++cursor;
+      }
+      if (cursor < held.size() && _start[held[cursor]] < i) {
+        live.push_back(p);
+      }
+    }
+    return live;
+  }
+
+  std::string Address(const ir::Address &address, std::string &before) {
+    switch (address.base) {
+    case ir::Address::Base::FRAME:
+      return "[fp" + Offset(address.offset) + "]";
+    case ir::Address::Base::SYMBOL:
+      return _function.names[address.index] + Offset(address.offset);
+    default:
+      return "[" + Use(address.index, SCRATCH_B, before) +
+             Offset(address.offset) + "]";
+    }
+  }
+
+  // A register to read `reg` from, loading it first if it was spilled.
+  std::string Use(Reg reg, int scratch, std::string &before) {
+    if (_physical[reg] != SPILLED) {
+      return Register(_physical[reg]);
+    }
+    before += std::string("\tld.") + Suffix(_function.registers[reg]) +
+              "\t" + Register(scratch) + ", [fp" + Offset(_slot[reg]) + "]\n";
+    return Register(scratch);
+  }
+
+  // A register to write `reg` to, storing it afterwards if it was spilled.
+  std::string Define(Reg reg, std::string &after) {
+    if (_physical[reg] != SPILLED) {
+      return Register(_physical[reg]);
+    }
+    after += std::string("\tst.") + Suffix(_function.registers[reg]) +
+             "\t[fp" + Offset(_slot[reg]) + "], " + Register(SCRATCH_A) + "\n";
+    return Register(SCRATCH_A);
+  }
+
+  std::string Label(uint32_t label) {
+    return ".L" + _function.name + "." + std::to_string(label);
+  }
+
+  void EmitInstruction(uint32_t index, std::string &text) {
+    auto &i = _function.code[index];
+    std::string before, after, line;
+    std::string kind = Suffix(i.kind);
+    switch (i.op) {
+    case Opcode::IMMEDIATE: {
+      std::string value = std::to_string(i.integer);
+      if (IsFloatingBuiltin(i.kind)) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.17g", i.floating);
+        value = buffer;
+      }
+      line = "li." + kind + "\t" + Define(i.dst, after) + ", " + value;
+      break;
+    }
+    case Opcode::ADDRESS: {
+      auto address = Address(i.address, before);
+      line = "la\t" + Define(i.dst, after) + ", " + address;
+      break;
+    }
+    case Opcode::LOAD: {
+      auto address = Address(i.address, before);
+      line = "ld." + kind + "\t" + Define(i.dst, after) + ", " + address;
+      break;
+    }
+    case Opcode::STORE: {
+      auto value = Use(i.a, SCRATCH_A, before);
+      line = "st." + kind + "\t" + Address(i.address, before) + ", " + value;
+      break;
+    }
+    case Opcode::CONVERT: {
+      auto a = Use(i.a, SCRATCH_A, before);
+      line = std::string("cvt.") + Suffix(i.from) + "." + kind + "\t" +
+             Define(i.dst, after) + ", " + a;
+      break;
+    }
+    case Opcode::COPY: {
+      auto a = Use(i.a, SCRATCH_A, before);
+      auto dst = Define(i.dst, after);
+      if (dst == a && after.empty()) {
+        return;
+      }
+      line = "mov\t" + dst + ", " + a;
+      break;
+    }
+    case Opcode::NEG:
+    case Opcode::NOT: {
+      auto a = Use(i.a, SCRATCH_A, before);
+      line = std::string(Mnemonic(i.op)) + "." + kind + "\t" +
+             Define(i.dst, after) + ", " + a;
+      break;
+    }
+    case Opcode::LABEL:
+      text += Label(i.label) + ":\n";
+      return;
+    case Opcode::JUMP:
+      line = "jmp\t" + Label(i.label);
+      break;
+    case Opcode::BRANCH_ZERO:
+      line = "bz\t" + Use(i.a, SCRATCH_A, before) + ", " + Label(i.label);
+      break;
+    case Opcode::ARGUMENT:
+      line = "arg." + kind + "\t" + std::to_string(i.integer) + ", " +
+             Use(i.a, SCRATCH_A, before);
+      break;
+    case Opcode::CALL: {
+      auto live = LiveAcross(index);
+      for (auto p : live) {
+        before += "\tpush\t" + Register(p) + "\n";
+      }
+      auto target = Address(i.address, before);
+      line = "call\t" + (i.dst != ir::NO_REG ? Define(i.dst, after) + ", "
+                                             : std::string()) +
+             target;
+      std::string pops;
+      for (auto p = live.rbegin(); p != live.rend(); ++p) {
+        pops += "\tpop\t" + Register(*p) + "\n";
+      }
+      after = pops + after;
+      break;
+    }
+    case Opcode::RETURN:
+      line = "leave\n\tret";
+      if (i.a != ir::NO_REG) {
+        line += "\t" + Use(i.a, SCRATCH_A, before);
+      }
+      break;
+    default: {
+      auto a = Use(i.a, SCRATCH_A, before);
+      auto b = Use(i.b, SCRATCH_B, before);
+      line = std::string(Mnemonic(i.op)) + "." + kind + "\t" +
+             Define(i.dst, after) + ", " + a + ", " + b;
+      break;
+    }
+    }
+    text += before + "\t" + line + "\n" + after;
+  }
+
+  static std::string Quote(const std::string &bytes) {
+    std::string quoted = "\"";
+    for (unsigned char c : bytes) {
+      if (c == '"' || c == '\\') {
+        quoted += '\\';
+        quoted += c;
+      } else if (c >= 0x20 && c < 0x7f) {
+        quoted += c;
+      } else {
+        char buffer[8];
+        std::snprintf(buffer, sizeof(buffer), "\\%03o", c);
+        quoted += buffer;
+      }
+    }
+    return quoted + "\"";
+  }
+
+  const ir::Function &_function;
+  uint32_t _frame_size;
+  // Per virtual register: the first and last instruction that names it,
+  // the machine register it was given or SPILLED, and its frame slot if
+  // spilled.
+  std::vector<uint32_t> _start;
+  std::vector<uint32_t> _end;
+  std::vector<int> _physical;
+  std::vector<int32_t> _slot;
+  // Per machine register, the virtual registers it was given, in order,
+  // and how far LiveAcross() has got through them.
+  std::vector<std::vector<Reg>> _held;
+  size_t _cursor[REGISTERS] = {};
+};
+
+} // namespace
+
+std::string EmitFunction(const ir::Function &function) {
+  return FunctionEmitter(function).Emit();
+}
+
+std::string EmitCommon(const std::string &name, uint32_t size,
+                       uint32_t alignment, bool global) {
+  return (global ? "" : "\t.local\t" + name + "\n") + "\t.comm\t" + name +
+         "," + std::to_string(size) + "," + std::to_string(alignment) + "\n";
+}
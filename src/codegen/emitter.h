@@ -0,0 +1,29 @@
+#ifndef YYQC_SRC_CODEGEN_EMITTER_H_
+#define YYQC_SRC_CODEGEN_EMITTER_H_
+
+#include "ir.h"
+#include <string>
+
+/**
+ * Writes lowered functions as assembly for the target type_layout.h
+ * describes: a load-store machine with eight registers r0-r7, any of
+ * which holds a value of any kind, and a frame pointer fp. An instruction
+ * names the kind it works in as a suffix, i8 to u64 and f32 to f128, and
+ * `cvt.F.T` converts from kind F to kind T.
+ *
+ * Virtual registers are allocated to r0-r5 by linear scan over the order
+ * of the code, which is sound because lowering keeps every register live
+ * over one stretch of it. The register live longest is spilled to a frame
+ * slot when they run out; r6 and r7 carry spilled operands. A call may
+ * clobber any register, so the caller pushes those live across it.
+ * Arguments are passed with `arg`, and a callee finds argument i at
+ * fp+16+8*i.
+ */
+std::string EmitFunction(const ir::Function &function);
+
+// An object without an initializer, such as a tentative definition, in
+// the common section; `global` unless it has internal linkage.
+std::string EmitCommon(const std::string &name, uint32_t size,
+                       uint32_t alignment, bool global);
+
+#endif // !YYQC_SRC_CODEGEN_EMITTER_H_
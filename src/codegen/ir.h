@@ -0,0 +1,122 @@
+#ifndef YYQC_SRC_CODEGEN_IR_H_
+#define YYQC_SRC_CODEGEN_IR_H_
+
+#include "../type/type_layout.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ir {
+
+// A virtual register. Lowering makes as many as it needs, each holding one
+// value of one BuiltinKind; the emitter maps them onto the machine's.
+using Reg = uint32_t;
+constexpr Reg NO_REG = UINT32_MAX;
+
+// Pointers are held and added as unsigned integers of their size.
+constexpr BuiltinKind POINTER_KIND = BuiltinKind::UNSIGNED_INT;
+static_assert(LayoutOf(POINTER_KIND).size == POINTER_LAYOUT.size,
+              "a pointer fits its integer kind");
+
+enum class Opcode : uint8_t {
+  IMMEDIATE, // dst = integer, or floating for a floating kind
+  ADDRESS,   // dst = &address
+  LOAD,      // dst = *(kind *)&address
+  STORE,     // *(kind *)&address = a
+  CONVERT,   // dst = (kind)a, a being of kind `from`
+  COPY,      // dst = a
+
+  // dst = a op b, both of kind.
+  ADD,
+  SUB,
+  MUL,
+  DIV,
+  REM,
+  SHL,
+  SHR,
+  AND,
+  OR,
+  XOR,
+  // dst = a op b compared as kind, 1 or 0 of the dst's kind.
+  EQ,
+  NE,
+  LT,
+  LE,
+  GT,
+  GE,
+  // dst = op a.
+  NEG,
+  NOT,
+
+  LABEL,       // label:
+  JUMP,        // goto label
+  BRANCH_ZERO, // if (a == 0) goto label
+  ARGUMENT,    // the `integer`th argument of the next CALL is a
+  CALL,        // dst = address(...), no dst for a void function
+  RETURN,      // return a, or nothing without a
+};
+
+struct Address {
+  enum class Base : uint8_t {
+    // `offset` bytes from the frame pointer: locals below it, parameters
+    // above.
+    FRAME,
+    // `offset` bytes from the symbol Function::names[index].
+    SYMBOL,
+    // `offset` bytes from the address in register `index`.
+    REGISTER,
+  };
+  Base base = Base::FRAME;
+  uint32_t index = 0;
+  int32_t offset = 0;
+};
+
+struct Instruction {
+  Opcode op;
+  // The kind the operation works in, or the kind of the value it moves.
+  BuiltinKind kind = BuiltinKind::NONE;
+  // CONVERT's source kind.
+  BuiltinKind from = BuiltinKind::NONE;
+  Reg dst = NO_REG;
+  Reg a = NO_REG;
+  Reg b = NO_REG;
+  uint32_t label = 0;
+  Address address;
+  long long integer = 0;
+  double floating = 0;
+};
+
+// An object a function defines outside its frame: a block-scope static.
+struct StaticObject {
+  std::string name;
+  uint32_t size;
+  uint32_t alignment;
+};
+
+/**
+ * One function definition lowered to three-address code over virtual
+ * registers. Lowering keeps no value across a statement, so every register
+ * is live over one contiguous stretch of `code` and never across a loop's
+ * back edge, which is what lets the emitter allocate in one linear pass.
+ */
+struct Function {
+  std::string name;
+  bool global = true;
+  // Bytes of the frame the locals take, below the frame pointer.
+  uint32_t frame_size = 0;
+  uint32_t labels = 0;
+  // The kind of each virtual register.
+  std::vector<BuiltinKind> registers;
+  std::vector<Instruction> code;
+  // Symbols addresses refer to, by index.
+  std::vector<std::string> names;
+  // The bytes of each string literal, without the null that ends it, and
+  // the index in `names` of the symbol it is at.
+  std::vector<std::string> strings;
+  std::vector<uint32_t> string_names;
+  std::vector<StaticObject> statics;
+};
+
+} // namespace ir
+
+#endif // !YYQC_SRC_CODEGEN_IR_H_
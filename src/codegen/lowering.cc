@@ -0,0 +1,558 @@
+#include "lowering.h"
+
+namespace {
+
+using ir::Opcode;
+using Category = ExprType::Category;
+
+Opcode OpcodeOf(OP op) {
+  switch (op) {
+  case OP::PLUS:
+    return Opcode::ADD;
+  case OP::MINUS:
+    return Opcode::SUB;
+  case OP::MULTIPLY:
+    return Opcode::MUL;
+  case OP::DIVIDE:
+    return Opcode::DIV;
+  case OP::MOD:
+    return Opcode::REM;
+  case OP::LEFT_SHIFT:
+    return Opcode::SHL;
+  case OP::RIGHT_SHIFT:
+    return Opcode::SHR;
+  case OP::AND:
+    return Opcode::AND;
+  case OP::OR:
+    return Opcode::OR;
+  case OP::XOR:
+    return Opcode::XOR;
+  case OP::LESS:
+    return Opcode::LT;
+  case OP::GREATER:
+    return Opcode::GT;
+  case OP::LE:
+    return Opcode::LE;
+  case OP::GE:
+    return Opcode::GE;
+  case OP::EQ:
+    return Opcode::EQ;
+  default:
+    return Opcode::NE;
+  }
+}
+
+bool IsComparison(OP op) { return op >= OP::LESS && op <= OP::NE; }
+
+// The type an argument without a parameter is passed as (6.5.2.2p6).
+ExprType Promoted(const ExprType &type) {
+  if (!type.arithmetic()) {
+    return type;
+  }
+  return ExprType::Arithmetic(type.builtin == BuiltinKind::FLOAT
+                                  ? BuiltinKind::DOUBLE
+                                  : PromoteBuiltin(type.builtin));
+}
+
+} // namespace
+
+ir::Function Lowering::Lower(const Symbol &function) {
+  _function = ir::Function();
+  _addresses.clear();
+  _names.clear();
+  _function.name = std::string(_interner.spelling(function.name()));
+  _function.global = !(function.storage_class() & SCS_STATIC);
+  // Above the frame pointer are the caller's frame pointer and return
+  // address, then one eight-byte slot per argument.
+  int32_t offset = 16;
+  for (auto &parameter : function.parameters()) {
+    _addresses[parameter.get()] = {ir::Address::Base::FRAME, 0, offset};
+    offset += 8;
+  }
+  AllocateLocals(_symbols.scope(function.body()->scope()));
+  Visit(function.body());
+  // Reaching the end of main returns 0 (5.1.2.2.3).
+  auto returned = static_cast<const FunctionType *>(function.type())->base();
+  auto value = ir::NO_REG;
+  if (_function.name == "main" && returned->builtin() == BuiltinKind::INT) {
+    value = Integer(BuiltinKind::INT, 0);
+  }
+  Emit(Opcode::RETURN, value == ir::NO_REG ? BuiltinKind::VOID
+                                           : BuiltinKind::INT)
+      .a = value;
+  return std::move(_function);
+}
+
+void Lowering::AllocateLocals(const Scope &scope) {
+  for (auto symbol : scope.symbols()) {
+    auto type = symbol->type();
+    auto storage = symbol->storage_class();
+    if ((storage & (SCS_TYPEDEF | SCS_EXTERN)) || type->IsFunctionType()) {
+      continue;
+    }
+    auto size = SizeOf(type);
+    auto alignment = AlignmentOf(type);
+    if (storage & SCS_STATIC) {
+      auto name = _function.name + "." +
+                  std::string(_interner.spelling(symbol->name())) + "." +
+                  std::to_string(_function.statics.size());
+      _function.statics.push_back({name, size, alignment});
+      _addresses[symbol] = {ir::Address::Base::SYMBOL, Name(name), 0};
+      continue;
+    }
+    _function.frame_size =
+        (_function.frame_size + size + alignment - 1) / alignment * alignment;
+    _addresses[symbol] = {ir::Address::Base::FRAME, 0,
+                          -static_cast<int32_t>(_function.frame_size)};
+  }
+  for (auto child : scope.children()) {
+    AllocateLocals(*child);
+  }
+}
+
+ir::Reg Lowering::VisitCompoundStmt(const CompoundStmt *stmt) {
+  for (auto child : stmt->stmts()) {
+    if (child) {
+      Visit(child);
+    }
+  }
+  return ir::NO_REG;
+}
+
+ir::Reg Lowering::VisitExpressionStmt(const ExpressionStmt *stmt) {
+  if (stmt->expression()) {
+    Value(stmt->expression());
+  }
+  return ir::NO_REG;
+}
+
+ir::Reg Lowering::VisitIfStmt(const IfStmt *stmt) {
+  auto otherwise = NewLabel();
+  Jump(Opcode::BRANCH_ZERO, otherwise, Condition(stmt->condition()));
+  Visit(stmt->if_stmt());
+  if (stmt->else_stmt()) {
+    auto end = NewLabel();
+    Jump(Opcode::JUMP, end);
+    Label(otherwise);
+    Visit(stmt->else_stmt());
+    Label(end);
+  } else {
+    Label(otherwise);
+  }
+  return ir::NO_REG;
+}
+
+ir::Reg Lowering::VisitWhileStmt(const WhileStmt *stmt) {
+  auto top = NewLabel();
+  auto end = NewLabel();
+  Label(top);
+  Jump(Opcode::BRANCH_ZERO, end, Condition(stmt->condition()));
+  Visit(stmt->loop_body());
+  Jump(Opcode::JUMP, top);
+  Label(end);
+  return ir::NO_REG;
+}
+
+ir::Reg Lowering::VisitDoWhileStmt(const DoWhileStmt *stmt) {
+  auto top = NewLabel();
+  auto end = NewLabel();
+  Label(top);
+  Visit(stmt->loop_body());
+  Jump(Opcode::BRANCH_ZERO, end, Condition(stmt->condition()));
+  Jump(Opcode::JUMP, top);
+  Label(end);
+  return ir::NO_REG;
+}
+
+ir::Reg Lowering::VisitConstant(const Constant *constant) {
+  auto token = constant->token();
+  switch (token.tag()) {
+  case TOKEN::INTEGER_CONTANT:
+    return Integer(_checker.type(constant).builtin,
+                   token.value().get_integral_value());
+  case TOKEN::FLOATING_CONSTANT:
+    return Floating(BuiltinKind::DOUBLE, token.value().get_float_value());
+  case TOKEN::CHARACTER_CONSTANT: {
+    // A plain char is signed, and a multi-character constant is its first.
+    auto bytes = DecodeLiteral(token.value().text());
+    return Integer(BuiltinKind::INT,
+                   bytes.empty() ? 0 : static_cast<signed char>(bytes[0]));
+  }
+  default: {
+    auto name = Name(".L" + _function.name + ".str" +
+                     std::to_string(_function.strings.size()));
+    _function.strings.push_back(DecodeLiteral(token.value().text()));
+    _function.string_names.push_back(name);
+    return AddressValue({ir::Address::Base::SYMBOL, name, 0});
+  }
+  }
+}
+
+ir::Reg Lowering::VisitUnaryOperatorExpr(const UnaryOperatorExpr *expr) {
+  auto operand = expr->operand();
+  auto &type = _checker.type(expr);
+  switch (expr->op()) {
+  case OP::GET_ADDRESS:
+    return AddressValue(AddressOf(operand));
+  case OP::POSITIVE:
+    return ValueAs(operand, type);
+  case OP::NEGATIVE: {
+    auto a = ValueAs(operand, type);
+    auto dst = NewRegister(type.kind());
+    auto &negate = Emit(Opcode::NEG, type.kind());
+    negate.dst = dst;
+    negate.a = a;
+    return dst;
+  }
+  case OP::NEGATION: {
+    auto kind = _checker.type(operand).Decay().kind();
+    auto a = Value(operand);
+    return Binary(Opcode::EQ, kind, a, Zero(kind), BuiltinKind::INT);
+  }
+  case OP::SIZEOF: {
+    auto &operand_type = _checker.type(operand);
+    uint32_t size =
+        operand_type.string
+            ? DecodeLiteral(operand->token().value().text()).size() + 1
+        : operand_type.category == Category::ARRAY
+            ? SizeOf(operand_type.target)
+        : operand_type.pointer() ? POINTER_LAYOUT.size
+                                 : LayoutOf(operand_type.builtin).size;
+    return Integer(type.builtin, size);
+  }
+  case OP::PREFIX_INC:
+  case OP::PREFIX_DEC:
+  case OP::POSTFIX_INC:
+  case OP::POSTFIX_DEC:
+    return Increment(expr);
+  default:
+    // An indirection is an lvalue or a function, which Value() takes the
+    // address of instead.
+    return ir::NO_REG;
+  }
+}
+
+ir::Reg Lowering::VisitBinaryOperatorExpr(const BinaryOperatorExpr *expr) {
+  auto op = expr->op();
+  if (op >= OP::ASSIGN) {
+    return Assign(expr);
+  }
+  if (op == OP::LOGICAL_AND || op == OP::LOGICAL_OR) {
+    // 1 or 0, the right operand only evaluated when the left one does not
+    // decide.
+    auto result = NewRegister(BuiltinKind::INT);
+    auto end = NewLabel();
+    Set(result, op == OP::LOGICAL_AND ? 0 : 1);
+    auto left = Condition(expr->operand1());
+    if (op == OP::LOGICAL_AND) {
+      Jump(Opcode::BRANCH_ZERO, end, left);
+      Jump(Opcode::BRANCH_ZERO, end, Condition(expr->operand2()));
+      Set(result, 1);
+    } else {
+      auto right = NewLabel();
+      auto zero = NewLabel();
+      Jump(Opcode::BRANCH_ZERO, right, left);
+      Jump(Opcode::JUMP, end);
+      Label(right);
+      Jump(Opcode::BRANCH_ZERO, zero, Condition(expr->operand2()));
+      Jump(Opcode::JUMP, end);
+      Label(zero);
+      Set(result, 0);
+    }
+    Label(end);
+    return result;
+  }
+  auto a = Value(expr->operand1());
+  auto b = Value(expr->operand2());
+  return Operate(op, a, _checker.type(expr->operand1()).Decay(), b,
+                 _checker.type(expr->operand2()).Decay(),
+                 _checker.type(expr));
+}
+
+ir::Reg Lowering::VisitTenaryOperatorExpr(const TenaryOperatorExpr *expr) {
+  auto &type = _checker.type(expr);
+  bool has_value = type.category != Category::VOID;
+  auto result = has_value ? NewRegister(type.kind()) : ir::NO_REG;
+  auto otherwise = NewLabel();
+  auto end = NewLabel();
+  auto arm = [&](const Expr *operand) {
+    if (!has_value) {
+      Value(operand);
+      return;
+    }
+    auto value = ValueAs(operand, type);
+    auto &copy = Emit(Opcode::COPY, type.kind());
+    copy.dst = result;
+    copy.a = value;
+  };
+  Jump(Opcode::BRANCH_ZERO, otherwise, Condition(expr->operand1()));
+  arm(expr->operand2());
+  Jump(Opcode::JUMP, end);
+  Label(otherwise);
+  arm(expr->operand3());
+  Label(end);
+  return result;
+}
+
+ir::Reg Lowering::VisitFunctionCallExpr(const FunctionCallExpr *expr) {
+  auto designator = expr->designator();
+  auto function = static_cast<const FunctionType *>(
+      _checker.type(designator).Decay().target);
+  ir::Address address;
+  if (_checker.type(designator).category == Category::FUNCTION) {
+    address = AddressOf(designator);
+  } else {
+    address = {ir::Address::Base::REGISTER, Value(designator), 0};
+  }
+  auto &parameters = function->parameters();
+  auto arguments = expr->parameters();
+  std::vector<ir::Reg> values;
+  for (size_t i = 0; i < arguments.size(); ++i) {
+    values.push_back(ValueAs(arguments[i],
+                             i < parameters.size()
+                                 ? ExprType::Of(parameters[i])
+                                 : Promoted(_checker.type(arguments[i]).Decay())));
+  }
+  for (size_t i = 0; i < values.size(); ++i) {
+    auto &argument =
+        Emit(Opcode::ARGUMENT, _function.registers[values[i]]);
+    argument.a = values[i];
+    argument.integer = i;
+  }
+  auto &type = _checker.type(expr);
+  auto dst = type.category == Category::VOID ? ir::NO_REG
+                                             : NewRegister(type.kind());
+  auto &call = Emit(Opcode::CALL, type.kind());
+  call.dst = dst;
+  call.address = address;
+  return dst;
+}
+
+ir::Reg Lowering::Value(const Expr *expr) {
+  auto &type = _checker.type(expr);
+  if (type.category == Category::ARRAY ||
+      type.category == Category::FUNCTION) {
+    return AddressValue(AddressOf(expr));
+  }
+  if (!type.lvalue) {
+    return Visit(expr);
+  }
+  auto address = AddressOf(expr);
+  auto dst = NewRegister(type.kind());
+  auto &load = Emit(Opcode::LOAD, type.kind());
+  load.dst = dst;
+  load.address = address;
+  return dst;
+}
+
+ir::Reg Lowering::ValueAs(const Expr *expr, const ExprType &type) {
+  auto value = Value(expr);
+  return Convert(value, _checker.type(expr).Decay().kind(),
+                 type.Decay().kind());
+}
+
+ir::Reg Lowering::Condition(const Expr *expr) {
+  auto value = Value(expr);
+  auto kind = _checker.type(expr).Decay().kind();
+  if (!IsFloatingBuiltin(kind)) {
+    return value;
+  }
+  return Binary(Opcode::NE, kind, value, Zero(kind), BuiltinKind::INT);
+}
+
+ir::Address Lowering::AddressOf(const Expr *expr) {
+  if (auto identifier = dyn_cast<Identifier>(expr)) {
+    auto symbol = _checker.symbol(identifier);
+    auto local = _addresses.find(symbol);
+    if (local != _addresses.end()) {
+      return local->second;
+    }
+    return {ir::Address::Base::SYMBOL,
+            Name(std::string(_interner.spelling(symbol->name()))), 0};
+  }
+  // The checker only lets identifiers and indirections be lvalues.
+  auto pointer = cast<UnaryOperatorExpr>(expr)->operand();
+  return {ir::Address::Base::REGISTER, Value(pointer), 0};
+}
+
+ir::Reg Lowering::AddressValue(const ir::Address &address) {
+  if (address.base == ir::Address::Base::REGISTER && address.offset == 0) {
+    return address.index;
+  }
+  auto dst = NewRegister(ir::POINTER_KIND);
+  auto &instruction = Emit(Opcode::ADDRESS, ir::POINTER_KIND);
+  instruction.dst = dst;
+  instruction.address = address;
+  return dst;
+}
+
+ir::Reg Lowering::Operate(OP op, ir::Reg a, const ExprType &left, ir::Reg b,
+                          const ExprType &right, const ExprType &result) {
+  if (result.pointer()) {
+    // pointer + integer, integer + pointer or pointer - integer: the
+    // integer counts elements.
+    if (!left.pointer()) {
+      return Operate(op, b, right, a, left, result);
+    }
+    auto index = Convert(b, right.kind(), ir::POINTER_KIND);
+    auto size = left.pointee_size();
+    if (size != 1) {
+      index = Binary(Opcode::MUL, ir::POINTER_KIND, index,
+                     Integer(ir::POINTER_KIND, size));
+    }
+    return Binary(OpcodeOf(op), ir::POINTER_KIND, a, index);
+  }
+  if (op == OP::MINUS && left.pointer() && right.pointer()) {
+    auto bytes = Convert(Binary(Opcode::SUB, ir::POINTER_KIND, a, b),
+                         ir::POINTER_KIND, result.kind());
+    auto size = left.pointee_size();
+    return size == 1 ? bytes
+                     : Binary(Opcode::DIV, result.kind(), bytes,
+                              Integer(result.kind(), size));
+  }
+  auto kind = result.kind();
+  if (IsComparison(op)) {
+    kind = left.pointer() || right.pointer()
+               ? ir::POINTER_KIND
+               : CommonBuiltin(left.builtin, right.builtin);
+  }
+  a = Convert(a, left.kind(), kind);
+  b = Convert(b, right.kind(), kind);
+  return Binary(OpcodeOf(op), kind, a, b, result.kind());
+}
+
+ir::Reg Lowering::Assign(const BinaryOperatorExpr *expr) {
+  auto &type = _checker.type(expr->operand1());
+  auto kind = type.kind();
+  auto address = AddressOf(expr->operand1());
+  ir::Reg value;
+  if (expr->op() == OP::ASSIGN) {
+    value = ValueAs(expr->operand2(), type);
+  } else {
+    auto old = NewRegister(kind);
+    auto &load = Emit(Opcode::LOAD, kind);
+    load.dst = old;
+    load.address = address;
+    auto op = Applied(expr->op());
+    auto left = type.Decay();
+    auto right = _checker.type(expr->operand2()).Decay();
+    auto result =
+        left.pointer() ? left
+        : op == OP::LEFT_SHIFT || op == OP::RIGHT_SHIFT
+            ? ExprType::Arithmetic(PromoteBuiltin(left.builtin))
+            : ExprType::Arithmetic(CommonBuiltin(left.builtin, right.builtin));
+    value = Operate(op, old, left, Value(expr->operand2()), right, result);
+    value = Convert(value, result.kind(), kind);
+  }
+  auto &store = Emit(Opcode::STORE, kind);
+  store.a = value;
+  store.address = address;
+  return value;
+}
+
+ir::Reg Lowering::Increment(const UnaryOperatorExpr *expr) {
+  auto op = expr->op();
+  auto type = _checker.type(expr->operand()).Decay();
+  auto kind = type.kind();
+  auto address = AddressOf(expr->operand());
+  auto old = NewRegister(kind);
+  auto &load = Emit(Opcode::LOAD, kind);
+  load.dst = old;
+  load.address = address;
+  bool increment = op == OP::PREFIX_INC || op == OP::POSTFIX_INC;
+  ir::Reg value;
+  if (kind == BuiltinKind::BOOL) {
+    // A _Bool becomes 1, or is flipped by --.
+    value = increment ? Integer(kind, 1)
+                      : Binary(Opcode::XOR, kind, old, Integer(kind, 1));
+  } else {
+    auto step = type.pointer() ? Integer(kind, type.pointee_size())
+                : IsFloatingBuiltin(kind) ? Floating(kind, 1)
+                                          : Integer(kind, 1);
+    value = Binary(increment ? Opcode::ADD : Opcode::SUB, kind, old, step);
+  }
+  auto &store = Emit(Opcode::STORE, kind);
+  store.a = value;
+  store.address = address;
+  return op == OP::POSTFIX_INC || op == OP::POSTFIX_DEC ? old : value;
+}
+
+ir::Reg Lowering::Convert(ir::Reg reg, BuiltinKind from, BuiltinKind to) {
+  if (from == to) {
+    return reg;
+  }
+  if (to == BuiltinKind::BOOL) {
+    return Binary(Opcode::NE, from, reg, Zero(from), BuiltinKind::BOOL);
+  }
+  auto dst = NewRegister(to);
+  auto &convert = Emit(Opcode::CONVERT, to);
+  convert.from = from;
+  convert.dst = dst;
+  convert.a = reg;
+  return dst;
+}
+
+ir::Reg Lowering::Binary(Opcode op, BuiltinKind kind, ir::Reg a, ir::Reg b,
+                         BuiltinKind result) {
+  auto dst = NewRegister(result == BuiltinKind::NONE ? kind : result);
+  auto &instruction = Emit(op, kind);
+  instruction.dst = dst;
+  instruction.a = a;
+  instruction.b = b;
+  return dst;
+}
+
+ir::Reg Lowering::Integer(BuiltinKind kind, long long value) {
+  auto dst = NewRegister(kind);
+  Set(dst, value);
+  return dst;
+}
+
+ir::Reg Lowering::Floating(BuiltinKind kind, double value) {
+  auto dst = NewRegister(kind);
+  auto &immediate = Emit(Opcode::IMMEDIATE, kind);
+  immediate.dst = dst;
+  immediate.floating = value;
+  return dst;
+}
+
+ir::Reg Lowering::Zero(BuiltinKind kind) {
+  return IsFloatingBuiltin(kind) ? Floating(kind, 0) : Integer(kind, 0);
+}
+
+void Lowering::Set(ir::Reg reg, long long value) {
+  auto &immediate = Emit(Opcode::IMMEDIATE, _function.registers[reg]);
+  immediate.dst = reg;
+  immediate.integer = value;
+}
+
+ir::Reg Lowering::NewRegister(BuiltinKind kind) {
+  _function.registers.push_back(kind);
+  return static_cast<ir::Reg>(_function.registers.size() - 1);
+}
+
+ir::Instruction &Lowering::Emit(Opcode op, BuiltinKind kind) {
+  _function.code.emplace_back();
+  auto &instruction = _function.code.back();
+  instruction.op = op;
+  instruction.kind = kind;
+  return instruction;
+}
+
+void Lowering::Label(uint32_t label) {
+  Emit(Opcode::LABEL, BuiltinKind::VOID).label = label;
+}
+
+void Lowering::Jump(Opcode op, uint32_t label, ir::Reg a) {
+  auto &jump = Emit(op, BuiltinKind::VOID);
+  jump.label = label;
+  jump.a = a;
+}
+
+uint32_t Lowering::Name(const std::string &name) {
+  auto entry = _names.emplace(name, _function.names.size());
+  if (entry.second) {
+    _function.names.push_back(name);
+  }
+  return entry.first->second;
+}
@@ -0,0 +1,80 @@
+#ifndef YYQC_SRC_CODEGEN_LOWERING_H_
+#define YYQC_SRC_CODEGEN_LOWERING_H_
+
+#include "ir.h"
+#include "type_checker.h"
+#include <unordered_map>
+
+/**
+ * Lowers one checked function definition to an ir::Function. Its locals
+ * get slots in the frame, each expression becomes loads, stores and
+ * operations on virtual registers in the kinds the TypeChecker found, and
+ * statements become labels and branches. Like the checker it only reads
+ * what the parser made, so any thread may run it.
+ */
+class Lowering : public ConstASTVisitor<Lowering, ir::Reg> {
+public:
+  Lowering(const SymbolTable &symbols, const Interner &interner,
+           const TypeChecker &checker)
+      : _symbols(symbols), _interner(interner), _checker(checker) {}
+
+  ir::Function Lower(const Symbol &function);
+
+  ir::Reg VisitCompoundStmt(const CompoundStmt *stmt);
+  ir::Reg VisitExpressionStmt(const ExpressionStmt *stmt);
+  ir::Reg VisitIfStmt(const IfStmt *stmt);
+  ir::Reg VisitWhileStmt(const WhileStmt *stmt);
+  ir::Reg VisitDoWhileStmt(const DoWhileStmt *stmt);
+  ir::Reg VisitConstant(const Constant *constant);
+  ir::Reg VisitUnaryOperatorExpr(const UnaryOperatorExpr *expr);
+  ir::Reg VisitBinaryOperatorExpr(const BinaryOperatorExpr *expr);
+  ir::Reg VisitTenaryOperatorExpr(const TenaryOperatorExpr *expr);
+  ir::Reg VisitFunctionCallExpr(const FunctionCallExpr *expr);
+
+private:
+  // Frame slots for the locals of `scope` and the scopes inside it, and
+  // symbols for its statics.
+  void AllocateLocals(const Scope &scope);
+  // The value of `expr`, an array or function decayed to its address.
+  ir::Reg Value(const Expr *expr);
+  // The value of `expr` converted to `type`'s kind.
+  ir::Reg ValueAs(const Expr *expr, const ExprType &type);
+  // Nonzero when `expr` is, in a kind BRANCH_ZERO can test.
+  ir::Reg Condition(const Expr *expr);
+  // Where the object an lvalue or function designator denotes is.
+  ir::Address AddressOf(const Expr *expr);
+  ir::Reg AddressValue(const ir::Address &address);
+  // `a op b` for a binary arithmetic, shift, comparison or pointer
+  // operator, with operands of types `left` and `right` and a result of
+  // type `result`.
+  ir::Reg Operate(OP op, ir::Reg a, const ExprType &left, ir::Reg b,
+                  const ExprType &right, const ExprType &result);
+  ir::Reg Assign(const BinaryOperatorExpr *expr);
+  ir::Reg Increment(const UnaryOperatorExpr *expr);
+  ir::Reg Convert(ir::Reg reg, BuiltinKind from, BuiltinKind to);
+  // `a op b` in `kind`, into a register of kind `result` if that is given.
+  ir::Reg Binary(ir::Opcode op, BuiltinKind kind, ir::Reg a, ir::Reg b,
+                 BuiltinKind result = BuiltinKind::NONE);
+  ir::Reg Integer(BuiltinKind kind, long long value);
+  ir::Reg Floating(BuiltinKind kind, double value);
+  ir::Reg Zero(BuiltinKind kind);
+  // Sets a register that already has a value, as a logical operator's.
+  void Set(ir::Reg reg, long long value);
+
+  ir::Reg NewRegister(BuiltinKind kind);
+  uint32_t NewLabel() { return _function.labels++; }
+  ir::Instruction &Emit(ir::Opcode op, BuiltinKind kind);
+  void Label(uint32_t label);
+  void Jump(ir::Opcode op, uint32_t label, ir::Reg a = ir::NO_REG);
+  uint32_t Name(const std::string &name);
+
+  const SymbolTable &_symbols;
+  const Interner &_interner;
+  const TypeChecker &_checker;
+  ir::Function _function;
+  // Where each local and parameter lives.
+  std::unordered_map<const Symbol *, ir::Address> _addresses;
+  std::unordered_map<std::string, uint32_t> _names;
+};
+
+#endif // !YYQC_SRC_CODEGEN_LOWERING_H_
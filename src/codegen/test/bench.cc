@@ -0,0 +1,78 @@
+#include "../code_generator.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+using namespace std;
+
+const int FUNCTIONS = 4000;
+
+static string Locate(const Token &token) {
+  auto position = token.position();
+  return to_string(position.row()) + ":" + to_string(position.column());
+}
+
+// One generated file of many functions with expression-dense bodies, of
+// uneven lengths for the pool to balance.
+static string Corpus() {
+  string text = "int state[64]; double weight; int step();\n";
+  for (int f = 0; f < FUNCTIONS; ++f) {
+    text += "int function_" + to_string(f) + "(int a, int b, int *p) {\n"
+            "  int x; int y; double d;\n";
+    for (int i = 0; i < 1 + f % 5; ++i) {
+      auto n = to_string(i);
+      text += "  x = (a * " + n + " + b) ^ (p[" + n + "] >> 2) | state[" +
+              to_string((f + i) % 64) + "];\n"
+              "  y = x < a && b || !p ? x - " + n + " : (x + a) * (b - " +
+              n + ");\n"
+              "  d = d * weight + x / 3.0;\n"
+              "  while (y > " + n + ") { y -= step() + x; a += y & 7; }\n";
+    }
+    text += "}\n";
+  }
+  return text;
+}
+
+int main() {
+  auto text = Corpus();
+  Parser parser(SourceBuffer::FromText(text), "generated.c");
+  auto start = chrono::steady_clock::now();
+  if (!parser.TranslationUnit()) {
+    return 1;
+  }
+  auto parsed = chrono::steady_clock::now();
+  cout << FUNCTIONS << " functions, " << text.size() / 1024 << " KiB, "
+       << thread::hardware_concurrency() << " hardware threads" << endl;
+  cout << "parse: " << chrono::duration<double>(parsed - start).count() * 1e3
+       << " ms" << endl;
+
+  CodeGenerator generator(parser, Locate);
+  const int rounds = 3;
+  string expected;
+  double serial = 0;
+  for (unsigned threads : {1u, 2u, 4u, 8u}) {
+    ThreadPool pool(threads);
+    double best = 1e30;
+    for (int round = 0; round < rounds; ++round) {
+      auto start = chrono::steady_clock::now();
+      auto assembly = generator.Generate(&pool);
+      auto end = chrono::steady_clock::now();
+      if (threads == 1 && round == 0) {
+        expected = assembly;
+      } else if (assembly != expected) {
+        cout << threads << " threads: output differs" << endl;
+        return 1;
+      }
+      best = min(best, chrono::duration<double>(end - start).count());
+    }
+    if (threads == 1) {
+      serial = best;
+    }
+    cout << threads << " threads: best of " << rounds << ": " << best * 1e3
+         << " ms, " << serial / best << "x" << endl;
+  }
+  cout << expected.size() / 1024 << " KiB of assembly, the same each time"
+       << endl;
+  return 0;
+}
@@ -0,0 +1,192 @@
+#include "../code_generator.h"
+#include "../../error/error.h"
+#include "../../util/check.h"
+#include <iostream>
+#include <string>
+using namespace std;
+
+static string Locate(const Token &token) {
+  auto position = token.position();
+  return to_string(position.row()) + ":" + to_string(position.column());
+}
+
+struct Output {
+  string text;
+  vector<string> messages;
+  bool failed = false;
+};
+
+static Output Generate(const Parser &parser, ThreadPool *pool) {
+  Output output;
+  Diagnostics diagnostics;
+  try {
+    output.text = CodeGenerator(parser, Locate).Generate(pool);
+  } catch (const Diagnostics::Fatal &) {
+    output.failed = true;
+  }
+  output.messages = diagnostics.messages();
+  return output;
+}
+
+static bool Same(const Output &a, const Output &b) {
+  return a.text == b.text && a.messages == b.messages && a.failed == b.failed;
+}
+
+static bool Has(const string &text, const string &part) {
+  return text.find(part) != string::npos;
+}
+
+// Functions of every shape the parser makes, some with expressions deep
+// enough to spill and calls with values live across them.
+static string Corpus(int functions) {
+  string text = "int counter; static long total; int table[16];\n"
+                "double scale; char *name; static char *cursor;\n"
+                "int next();\n";
+  for (int f = 0; f < functions; ++f) {
+    string n = to_string(f);
+    text += (f % 3 == 0 ? "static " : "") + string("int function_") + n +
+            "(int a, int *p) {\n"
+            "  int x; double d; static int calls;\n"
+            "  x = a * " + n + " + p[" + to_string(f % 4) + "];\n"
+            "  d = x / 2.0 + scale;\n"
+            "  if (x < " + n + " && a || !p) { x++; } else { --x; }\n"
+            "  while (x > 0) { x -= 3; total += x; }\n"
+            "  do { x = x + a; } while (x < 10);\n"
+            "  x = a + (a * (a + (a * (a + (a * (a + (a * (a + a))))))));\n"
+            "  x = a + next() * x;\n"
+            "  table[x & 15] = x ? next() : 'a';\n"
+            "  name = \"function_" + n + "\\n\";\n"
+            "  calls++;\n"
+            "}\n";
+  }
+  return text + "int main() { counter = sizeof table; }\n";
+}
+
+int main() {
+  auto text = Corpus(120);
+  Parser parser(SourceBuffer::FromText(text), "corpus.c");
+  Check(parser.TranslationUnit(), "the corpus parses");
+
+  auto serial = Generate(parser, nullptr);
+  Check(!serial.failed && serial.messages.empty(), "the corpus compiles");
+  auto &assembly = serial.text;
+  Check(Has(assembly, "\t.comm\tcounter,4,4\n") &&
+            Has(assembly, "\t.local\ttotal\n\t.comm\ttotal,8,8\n") &&
+            Has(assembly, "\t.comm\ttable,64,4\n") &&
+            Has(assembly, "\t.local\tcursor\n\t.comm\tcursor,4,4\n"),
+        "file-scope objects");
+  Check(Has(assembly, "\t.globl\tfunction_1\n") &&
+            !Has(assembly, "\t.globl\tfunction_0\n"),
+        "static functions are not global");
+  Check(Has(assembly, "\t.local\tfunction_7.calls.0\n"), "static locals");
+  Check(Has(assembly, ".Lfunction_7.str0:\n\t.string\t\"function_7\\012\"\n"),
+        "string literals");
+  Check(Has(assembly, "\tld.i32\tr6, [fp-") &&
+            Has(assembly, "\tst.i32\t[fp-"),
+        "deep expressions spill");
+  Check(Has(assembly, "\tpush\tr0\n\tcall\tr1, next\n\tpop\tr0\n"),
+        "values live across a call are saved");
+  Check(Has(assembly, "main:\n\tenter\t0\n\tli.u64\tr0, 64\n"
+                      "\tcvt.u64.i32\tr0, r0\n\tst.i32\tcounter, r0\n"
+                      "\tli.i32\tr0, 0\n\tleave\n\tret\tr0\n"),
+        "main returns 0");
+  // Functions come out in source order.
+  size_t previous = 0;
+  bool ordered = true;
+  for (int f = 0; f < 120; ++f) {
+    auto at = assembly.find("\nfunction_" + to_string(f) + ":\n");
+    ordered = ordered && at != string::npos && at > previous;
+    previous = at;
+  }
+  Check(ordered, "functions in source order");
+
+  // Any number of threads writes the same bytes.
+  for (unsigned threads : {1u, 2u, 4u, 8u}) {
+    ThreadPool pool(threads);
+    Check(Same(Generate(parser, &pool), serial),
+          to_string(threads) + " threads give what one does");
+  }
+  // So does a unit compiled by a task of the pool its functions go to.
+  {
+    ThreadPool pool(4);
+    Output nested;
+    pool.Submit([&] {
+      // The task's thread parses, so its Interner spells the names.
+      Parser parser(SourceBuffer::FromText(text), "corpus.c");
+      parser.TranslationUnit();
+      nested = Generate(parser, &pool);
+    });
+    pool.Wait();
+    Check(Same(nested, serial), "from a task of the same pool");
+  }
+
+  // A storage class does not make another type: a static array of pointers
+  // decays to the pointer type a plain one does.
+  Parser storage(SourceBuffer::FromText("static int *a[2]; int *b[2];\n"
+                                        "int **pp;\n"
+                                        "int f() { int x; x = a - b; }\n"
+                                        "int g() { pp = a; }\n"),
+                 "storage.c");
+  Check(storage.TranslationUnit(), "the storage unit parses");
+  auto stored = Generate(storage, nullptr);
+  Check(!stored.failed && stored.messages.empty(),
+        "static and plain arrays of pointers mix");
+  // Nor does the spelling of a builtin type.
+  Parser spelled(SourceBuffer::FromText("long **p; long int **q;\n"
+                                        "int **r; signed **s; int x;\n"
+                                        "int f() { p = q; x = r - s; }\n"),
+                 "spelled.c");
+  Check(spelled.TranslationUnit(), "the spelled unit parses");
+  auto respelled = Generate(spelled, nullptr);
+  Check(!respelled.failed && respelled.messages.empty(),
+        "long int is long and signed is int");
+  // Pointers to other types of the same size do not mix (6.5.16.1).
+  Parser mixed(SourceBuffer::FromText("int *p; float *q; unsigned *u;\n"
+                                      "int f() { p = q; }\n"
+                                      "int g() { p = u; }\n"
+                                      "int h() { u = p; }\n"),
+               "mixed.c");
+  Check(mixed.TranslationUnit(), "the mixed unit parses");
+  auto unmixed = Generate(mixed, nullptr);
+  Check(unmixed.failed && unmixed.messages.size() == 4 &&
+            unmixed.messages[0] ==
+                "Incompatible types in assignment at 2:13." &&
+            unmixed.messages[1] ==
+                "Incompatible types in assignment at 3:13." &&
+            unmixed.messages[2] ==
+                "Incompatible types in assignment at 4:13.",
+        "int * from float * or unsigned *, and back");
+
+  // ^= is the compound assignment of ^.
+  Parser compound(SourceBuffer::FromText("int f(int a) { a ^= 3; }\n"),
+                  "compound.c");
+  Check(compound.TranslationUnit(), "^= parses");
+  auto xored = Generate(compound, nullptr);
+  Check(!xored.failed && Has(xored.text, "\txor.i32\t"), "^= compiles");
+
+  // Each function reports its first error, in source order, and the unit
+  // fails once all have.
+  Parser bad(SourceBuffer::FromText("int g;\n"
+                                    "int first() { g = missing; }\n"
+                                    "int good() { g = 1; }\n"
+                                    "int second() { int *p; p = 1.5; *g; }\n"
+                                    "int third() { 3 = g; }\n"),
+             "bad.c");
+  Check(bad.TranslationUnit(), "the bad unit parses");
+  auto failed = Generate(bad, nullptr);
+  Check(failed.failed && failed.messages.size() == 4 &&
+            failed.messages[0] ==
+                "Use of undeclared identifier 'missing' at 2:19." &&
+            failed.messages[1] == "Incompatible types in assignment at 4:26." &&
+            failed.messages[2] == "Expression is not assignable at 5:17." &&
+            failed.messages[3] == "3 functions failed to compile.",
+        "errors in order");
+  for (unsigned threads : {2u, 8u}) {
+    ThreadPool pool(threads);
+    Check(Same(Generate(bad, &pool), failed),
+          "errors with " + to_string(threads) + " threads");
+  }
+
+  cout << (passed ? "codegen: ok" : "codegen: FAILED") << endl;
+  return passed ? 0 : 1;
+}
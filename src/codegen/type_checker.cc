@@ -0,0 +1,552 @@
+#include "type_checker.h"
+#include "../error/error.h"
+
+namespace {
+
+using Category = ExprType::Category;
+
+// The first token in `expr`: an array subscript's addition has none of its
+// own.
+Token TokenOf(const Expr *expr) {
+  while (!expr->token()) {
+    if (auto binary = dyn_cast<BinaryOperatorExpr>(expr)) {
+      expr = binary->operand1();
+    } else if (auto unary = dyn_cast<UnaryOperatorExpr>(expr)) {
+      expr = unary->operand();
+    } else if (auto tenary = dyn_cast<TenaryOperatorExpr>(expr)) {
+      expr = tenary->operand1();
+    } else {
+      break;
+    }
+  }
+  return expr->token();
+}
+
+std::string Spelling(OP op) {
+  auto spelling = Expr::op_to_string.find(op);
+  return spelling == Expr::op_to_string.end() ? "operator" : spelling->second;
+}
+
+} // namespace
+
+OP Applied(OP op) {
+  switch (op) {
+  case OP::MULTIPLY_ASSIGN:
+    return OP::MULTIPLY;
+  case OP::DIVIDE_ASSIGN:
+    return OP::DIVIDE;
+  case OP::MOD_ASSIGN:
+    return OP::MOD;
+  case OP::PLUS_ASSIGN:
+    return OP::PLUS;
+  case OP::MINUS_ASSIGN:
+    return OP::MINUS;
+  case OP::LEFT_SHIFT_ASSIGN:
+    return OP::LEFT_SHIFT;
+  case OP::RIGHT_SHIFT_ASSIGN:
+    return OP::RIGHT_SHIFT;
+  case OP::AND_ASSIGN:
+    return OP::AND;
+  case OP::XOR_ASSIGN:
+    return OP::XOR;
+  case OP::OR_ASSIGN:
+    return OP::OR;
+  default:
+    return op;
+  }
+}
+
+ExprType ExprType::Of(const Type *type) {
+  ExprType result;
+  if (type->builtin() != BuiltinKind::NONE) {
+    if (type->builtin() != BuiltinKind::VOID) {
+      result = Arithmetic(type->builtin());
+    }
+  } else if (type->IsPointerType()) {
+    result = PointerTo(static_cast<const PointerType *>(type)->base());
+  } else if (type->IsArrayType()) {
+    result.category = Category::ARRAY;
+    result.target = type;
+  } else if (type->IsFunctionType()) {
+    result.category = Category::FUNCTION;
+    result.target = type;
+  } else {
+    // A structure or union: nothing can be done with it yet but declare
+    // it, which lowering refuses.
+    result.category = Category::ARRAY;
+    result.target = type;
+  }
+  result.declared = type;
+  return result;
+}
+
+ExprType ExprType::Arithmetic(BuiltinKind kind) {
+  ExprType result;
+  result.category = Category::ARITHMETIC;
+  result.builtin = kind;
+  return result;
+}
+
+ExprType ExprType::PointerTo(const Type *pointee) {
+  ExprType result;
+  result.category = Category::POINTER;
+  if (pointee->builtin() != BuiltinKind::NONE) {
+    result.builtin = pointee->builtin();
+  } else {
+    result.builtin = BuiltinKind::NONE;
+    result.target = pointee;
+  }
+  return result;
+}
+
+uint32_t ExprType::pointee_size() const {
+  return target ? SizeOf(target) : LayoutOf(builtin).size;
+}
+
+ExprType ExprType::Decay() const {
+  ExprType result;
+  if (category == Category::ARRAY && target->IsArrayType()) {
+    result = PointerTo(static_cast<const ArrayType *>(target)->base());
+  } else if (category == Category::FUNCTION) {
+    result.category = Category::POINTER;
+    result.builtin = BuiltinKind::NONE;
+    result.target = target;
+  } else {
+    result = *this;
+    result.lvalue = false;
+    result.declared = nullptr;
+  }
+  return result;
+}
+
+uint32_t SizeOf(const Type *type) {
+  if (type->builtin() != BuiltinKind::NONE) {
+    return LayoutOf(type->builtin()).size;
+  }
+  if (type->IsPointerType()) {
+    return POINTER_LAYOUT.size;
+  }
+  if (type->IsArrayType()) {
+    auto array = static_cast<const ArrayType *>(type);
+    return array->length() * SizeOf(array->base());
+  }
+  return 0;
+}
+
+uint32_t AlignmentOf(const Type *type) {
+  if (type->builtin() != BuiltinKind::NONE) {
+    return LayoutOf(type->builtin()).alignment;
+  }
+  if (type->IsPointerType()) {
+    return POINTER_LAYOUT.alignment;
+  }
+  if (type->IsArrayType()) {
+    return AlignmentOf(static_cast<const ArrayType *>(type)->base());
+  }
+  return 1;
+}
+
+std::string DecodeLiteral(std::string_view text) {
+  std::string bytes;
+  size_t end = text.size();
+  auto digit = [](char c, int base) {
+    int value = c >= '0' && c <= '9'   ? c - '0'
+                : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                                       : base;
+    return value < base ? value : -1;
+  };
+  for (size_t i = 0; i < end; ++i) {
+    if (text[i] != '\\' || i + 1 == end) {
+      bytes += text[i];
+      continue;
+    }
+    char c = text[++i];
+    if (digit(c, 8) >= 0) {
+      int value = 0;
+      for (int n = 0; n < 3 && i < end && digit(text[i], 8) >= 0;
+           ++n, ++i) {
+        value = value * 8 + digit(text[i], 8);
+      }
+      --i;
+      bytes += static_cast<char>(value);
+    } else if (c == 'x') {
+      int value = 0;
+      while (i + 1 < end && digit(text[i + 1], 16) >= 0) {
+        value = value * 16 + digit(text[++i], 16);
+      }
+      bytes += static_cast<char>(value);
+    } else {
+      static const std::string escapes = "a\ab\bf\fn\nr\rt\tv\v";
+      auto escape = escapes.find(c);
+      bytes += escape != std::string::npos && escape % 2 == 0
+                   ? escapes[escape + 1]
+                   : c;
+    }
+  }
+  return bytes;
+}
+
+void TypeChecker::Check(const Symbol &function) {
+  _types.clear();
+  _identifiers.clear();
+  for (auto &parameter : function.parameters()) {
+    if (!ExprType::Of(parameter->type()).scalar()) {
+      Fail(parameter->token(),
+           "Code generation does not support this parameter type yet");
+    }
+  }
+  Visit(function.body());
+}
+
+ExprType TypeChecker::VisitStmt(const Stmt *) {
+  // The parser makes no other statement yet.
+  Error{"Code generation does not support this statement yet."};
+  return ExprType();
+}
+
+ExprType TypeChecker::VisitCompoundStmt(const CompoundStmt *stmt) {
+  auto enclosing = _scope;
+  _scope = &_symbols.scope(stmt->scope());
+  for (auto symbol : _scope->symbols()) {
+    auto type = symbol->type();
+    if (!(symbol->storage_class() & (SCS_TYPEDEF | SCS_EXTERN)) &&
+        !type->IsFunctionType() && SizeOf(type) == 0) {
+      Fail(symbol->token(), "Variable '" +
+                                std::string(_interner.spelling(symbol->name())) +
+                                "' has a type code generation does not "
+                                "support yet");
+    }
+  }
+  for (auto child : stmt->stmts()) {
+    if (child) {
+      Visit(child);
+    }
+  }
+  _scope = enclosing;
+  return ExprType();
+}
+
+ExprType TypeChecker::VisitExpressionStmt(const ExpressionStmt *stmt) {
+  if (stmt->expression()) {
+    CheckExpr(stmt->expression());
+  }
+  return ExprType();
+}
+
+ExprType TypeChecker::VisitIfStmt(const IfStmt *stmt) {
+  CheckCondition(stmt->condition());
+  Visit(stmt->if_stmt());
+  if (stmt->else_stmt()) {
+    Visit(stmt->else_stmt());
+  }
+  return ExprType();
+}
+
+ExprType TypeChecker::VisitIterationStmt(const IterationStmt *stmt) {
+  CheckCondition(stmt->condition());
+  Visit(stmt->loop_body());
+  return ExprType();
+}
+
+ExprType TypeChecker::VisitIdentifier(const Identifier *identifier) {
+  auto name = identifier->token().value().get_atom();
+  if (identifier->name_space() == IdentifierNameSpace::STRUCT_UNION_MEM) {
+    Fail(identifier, "Member access is not supported yet");
+  }
+  auto symbol = _scope->Lookup(name);
+  if (symbol == nullptr) {
+    Fail(identifier, "Use of undeclared identifier '" +
+                         std::string(_interner.spelling(name)) + "'");
+  }
+  if (symbol->storage_class() & SCS_TYPEDEF) {
+    Fail(identifier, "Unexpected type name '" +
+                         std::string(_interner.spelling(name)) + "'");
+  }
+  _identifiers.emplace(identifier, symbol);
+  auto type = ExprType::Of(symbol->type());
+  type.lvalue = type.category != Category::FUNCTION;
+  return type;
+}
+
+ExprType TypeChecker::VisitConstant(const Constant *constant) {
+  auto token = constant->token();
+  switch (token.tag()) {
+  case TOKEN::INTEGER_CONTANT: {
+    auto value = token.value().get_integral_value();
+    auto type = ExprType::Arithmetic(
+        value == static_cast<int32_t>(value) ? BuiltinKind::INT
+                                             : BuiltinKind::LONG);
+    type.null_pointer = value == 0;
+    return type;
+  }
+  case TOKEN::FLOATING_CONSTANT:
+    return ExprType::Arithmetic(BuiltinKind::DOUBLE);
+  case TOKEN::CHARACTER_CONSTANT:
+    return ExprType::Arithmetic(BuiltinKind::INT);
+  case TOKEN::STRING_LITERAL: {
+    auto type = ExprType::Arithmetic(BuiltinKind::CHAR);
+    type.category = Category::POINTER;
+    type.string = true;
+    return type;
+  }
+  default:
+    Fail(constant, "Code generation does not support this constant yet");
+  }
+}
+
+ExprType TypeChecker::VisitUnaryOperatorExpr(const UnaryOperatorExpr *expr) {
+  auto operand = CheckExpr(expr->operand());
+  auto value = operand.Decay();
+  auto op = expr->op();
+  switch (op) {
+  case OP::GET_ADDRESS:
+    if (!operand.lvalue && operand.category != Category::FUNCTION) {
+      Fail(expr, "Cannot take the address of an rvalue");
+    }
+    if (operand.declared) {
+      return ExprType::PointerTo(operand.declared);
+    }
+    value.category = Category::POINTER;
+    return value;
+  case OP::DEREFERENCE: {
+    if (!value.pointer()) {
+      Fail(expr, "Indirection requires a pointer operand");
+    }
+    if (value.target == nullptr) {
+      if (value.builtin == BuiltinKind::VOID) {
+        Fail(expr, "Cannot dereference a pointer to void");
+      }
+      auto type = ExprType::Arithmetic(value.builtin);
+      type.lvalue = true;
+      return type;
+    }
+    auto type = ExprType::Of(value.target);
+    type.lvalue = type.category != Category::FUNCTION;
+    return type;
+  }
+  case OP::POSITIVE:
+  case OP::NEGATIVE:
+    if (!value.arithmetic()) {
+      Fail(expr, "Invalid operand to " + Spelling(op));
+    }
+    return ExprType::Arithmetic(PromoteBuiltin(value.builtin));
+  case OP::NEGATION:
+    if (!value.scalar()) {
+      Fail(expr, "Invalid operand to " + Spelling(op));
+    }
+    return ExprType::Arithmetic(BuiltinKind::INT);
+  case OP::SIZEOF:
+    if (operand.category == Category::FUNCTION ||
+        (!operand.string && !operand.scalar() &&
+         (operand.category != Category::ARRAY ||
+          SizeOf(operand.target) == 0))) {
+      Fail(expr, "Invalid application of sizeof");
+    }
+    return ExprType::Arithmetic(BuiltinKind::UNSIGNED_LONG);
+  case OP::PREFIX_INC:
+  case OP::PREFIX_DEC:
+  case OP::POSTFIX_INC:
+  case OP::POSTFIX_DEC:
+    CheckModifiable(expr, operand);
+    if (value.pointer() && value.pointee_size() == 0) {
+      Fail(expr, "Arithmetic on a pointer to an incomplete type");
+    }
+    return value;
+  default:
+    Fail(expr, "Code generation does not support this operator yet");
+  }
+}
+
+ExprType TypeChecker::VisitBinaryOperatorExpr(const BinaryOperatorExpr *expr) {
+  auto op = expr->op();
+  if (op == OP::POINT_REFERENCE || op == OP::ARROW_REFERENCE) {
+    Fail(expr, "Member access is not supported yet");
+  }
+  auto left = CheckExpr(expr->operand1());
+  auto right = CheckExpr(expr->operand2()).Decay();
+  if (op == OP::ASSIGN) {
+    CheckModifiable(expr, left);
+    if (!Assignable(left, right)) {
+      Fail(expr, "Incompatible types in assignment");
+    }
+    return left.Decay();
+  }
+  if (op >= OP::ASSIGN) {
+    CheckModifiable(expr, left);
+    auto result = Arithmetic(expr, Applied(op), left.Decay(), right);
+    if (!Assignable(left, result)) {
+      Fail(expr, "Incompatible types in " + Spelling(op));
+    }
+    return left.Decay();
+  }
+  return Arithmetic(expr, op, left.Decay(), right);
+}
+
+ExprType TypeChecker::VisitTenaryOperatorExpr(const TenaryOperatorExpr *expr) {
+  CheckCondition(expr->operand1());
+  auto left = CheckExpr(expr->operand2()).Decay();
+  auto right = CheckExpr(expr->operand3()).Decay();
+  if (left.arithmetic() && right.arithmetic()) {
+    return ExprType::Arithmetic(CommonBuiltin(left.builtin, right.builtin));
+  }
+  auto result = left.pointer() ? left : right;
+  result.null_pointer = false;
+  if ((left.category == Category::VOID &&
+       right.category == Category::VOID) ||
+      (left.pointer() && (right.pointer() || right.null_pointer)) ||
+      (right.pointer() && left.null_pointer)) {
+    return result;
+  }
+  Fail(expr, "Incompatible operand types in a conditional expression");
+}
+
+ExprType TypeChecker::VisitFunctionCallExpr(const FunctionCallExpr *expr) {
+  auto designator = CheckExpr(expr->designator()).Decay();
+  if (!designator.pointer() || designator.target == nullptr ||
+      !designator.target->IsFunctionType()) {
+    Fail(expr, "Called object is not a function");
+  }
+  auto function = static_cast<const FunctionType *>(designator.target);
+  auto &parameters = function->parameters();
+  auto arguments = expr->parameters();
+  // `f()` declares nothing about its parameters.
+  bool prototyped = !parameters.empty();
+  if (prototyped && (arguments.size() < parameters.size() ||
+                     (arguments.size() > parameters.size() &&
+                      !function->variadic()))) {
+    Fail(expr, "Wrong number of arguments");
+  }
+  for (size_t i = 0; i < arguments.size(); ++i) {
+    auto argument = CheckExpr(arguments[i]).Decay();
+    if (i < parameters.size() &&
+        !Assignable(ExprType::Of(parameters[i]), argument)) {
+      Fail(arguments[i], "Incompatible type of argument " +
+                             std::to_string(i + 1));
+    } else if (!argument.scalar()) {
+      Fail(arguments[i], "Invalid argument");
+    }
+  }
+  auto returned = ExprType::Of(function->base());
+  if (returned.category != Category::VOID && !returned.scalar()) {
+    Fail(expr, "Code generation does not support this return type yet");
+  }
+  return returned;
+}
+
+ExprType TypeChecker::CheckExpr(const Expr *expr) {
+  auto type = Visit(expr);
+  _types[expr] = type;
+  return type;
+}
+
+void TypeChecker::CheckCondition(const Expr *expr) {
+  if (!CheckExpr(expr).Decay().scalar()) {
+    Fail(expr, "A condition must have a scalar type");
+  }
+}
+
+bool TypeChecker::Assignable(const ExprType &to, const ExprType &from) const {
+  auto target = to.Decay();
+  if (target.arithmetic()) {
+    return from.arithmetic();
+  }
+  if (target.pointer()) {
+    // Any object pointer converts to and from a pointer to void.
+    return from.null_pointer ||
+           (from.pointer() &&
+            (target.SamePointee(from) ||
+             (target.target == nullptr &&
+              target.builtin == BuiltinKind::VOID) ||
+             (from.target == nullptr && from.builtin == BuiltinKind::VOID)));
+  }
+  return false;
+}
+
+ExprType TypeChecker::Arithmetic(const BinaryOperatorExpr *expr, OP op,
+                                 const ExprType &left,
+                                 const ExprType &right) {
+  auto invalid = [&] {
+    Fail(expr, "Invalid operands to " + Spelling(op));
+  };
+  switch (op) {
+  case OP::MULTIPLY:
+  case OP::DIVIDE:
+    if (!left.arithmetic() || !right.arithmetic()) {
+      invalid();
+    }
+    return ExprType::Arithmetic(CommonBuiltin(left.builtin, right.builtin));
+  case OP::MOD:
+  case OP::AND:
+  case OP::XOR:
+  case OP::OR:
+    if (!left.integer() || !right.integer()) {
+      invalid();
+    }
+    return ExprType::Arithmetic(CommonBuiltin(left.builtin, right.builtin));
+  case OP::LEFT_SHIFT:
+  case OP::RIGHT_SHIFT:
+    if (!left.integer() || !right.integer()) {
+      invalid();
+    }
+    return ExprType::Arithmetic(PromoteBuiltin(left.builtin));
+  case OP::PLUS:
+  case OP::MINUS:
+    if (left.arithmetic() && right.arithmetic()) {
+      return ExprType::Arithmetic(CommonBuiltin(left.builtin, right.builtin));
+    }
+    if (left.pointer() && right.integer() && left.pointee_size() > 0) {
+      return left;
+    }
+    if (op == OP::PLUS && left.integer() && right.pointer() &&
+        right.pointee_size() > 0) {
+      return right;
+    }
+    if (op == OP::MINUS && left.pointer() && right.pointer() &&
+        left.SamePointee(right) && left.pointee_size() > 0) {
+      // ptrdiff_t, as wide as a pointer.
+      return ExprType::Arithmetic(BuiltinKind::INT);
+    }
+    Fail(expr, "Invalid operands to " + Spelling(op));
+  case OP::LESS:
+  case OP::GREATER:
+  case OP::LE:
+  case OP::GE:
+  case OP::EQ:
+  case OP::NE:
+    if (!(left.arithmetic() && right.arithmetic()) &&
+        !(left.pointer() && right.pointer()) &&
+        !((op == OP::EQ || op == OP::NE) &&
+          ((left.pointer() && right.null_pointer) ||
+           (left.null_pointer && right.pointer())))) {
+      invalid();
+    }
+    return ExprType::Arithmetic(BuiltinKind::INT);
+  case OP::LOGICAL_AND:
+  case OP::LOGICAL_OR:
+    if (!left.scalar() || !right.scalar()) {
+      invalid();
+    }
+    return ExprType::Arithmetic(BuiltinKind::INT);
+  default:
+    Fail(expr, "Code generation does not support this operator yet");
+  }
+}
+
+void TypeChecker::CheckModifiable(const Expr *expr, const ExprType &type) {
+  if (!type.lvalue || !type.scalar()) {
+    Fail(expr, "Expression is not assignable");
+  }
+  if (type.declared && (type.declared->type_qualifier() & TQ_CONST)) {
+    Fail(expr, "Cannot assign to a const-qualified object");
+  }
+}
+
+void TypeChecker::Fail(const Expr *expr, const std::string &message) const {
+  Fail(TokenOf(expr), message);
+}
+
+void TypeChecker::Fail(Token token, const std::string &message) const {
+  Error{message + (token ? " at " + _locate(token) : "") + "."};
+  throw Diagnostics::Fatal{};
+}
@@ -0,0 +1,131 @@
+#ifndef YYQC_SRC_CODEGEN_TYPE_CHECKER_H_
+#define YYQC_SRC_CODEGEN_TYPE_CHECKER_H_
+
+#include "../ast/ast_visitor.h"
+#include "../lexer/interner.h"
+#include "../symbol/symbol_table.h"
+#include "../type/type_derived.h"
+#include "ir.h"
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+/**
+ * The type of an expression, as far as code generation needs it. The
+ * functions of a unit are checked in parallel, and its TypeContext must
+ * not change meanwhile, so the checker never makes a type: a pointer it
+ * derives (`&x`, a decayed array) is kept as what it points to, and an
+ * arithmetic type it derives (a promotion, the int of a comparison) as its
+ * kind. A pointee of void or arithmetic type is always kept as its kind,
+ * so two pointers to the same type compare equal however they were made.
+ */
+struct ExprType {
+  enum class Category : uint8_t { VOID, ARITHMETIC, POINTER, ARRAY, FUNCTION };
+
+  Category category = Category::VOID;
+  // VOID and ARITHMETIC: the type. POINTER without a target: the pointee.
+  BuiltinKind builtin = BuiltinKind::VOID;
+  // POINTER: the pointee, if it is not builtin. ARRAY and FUNCTION: the
+  // type itself.
+  const Type *target = nullptr;
+  // The type an lvalue was declared with, for taking its address; none for
+  // what a pointer kept as a kind points to.
+  const Type *declared = nullptr;
+  bool lvalue = false;
+  // The integer constant 0, which converts to any pointer.
+  bool null_pointer = false;
+  // A string literal, which is a char array decayed already.
+  bool string = false;
+
+  // An object or function of `type`.
+  static ExprType Of(const Type *type);
+  static ExprType Arithmetic(BuiltinKind kind);
+  static ExprType PointerTo(const Type *pointee);
+
+  bool arithmetic() const { return category == Category::ARITHMETIC; }
+  bool integer() const { return arithmetic() && IsIntegerBuiltin(builtin); }
+  bool pointer() const { return category == Category::POINTER; }
+  bool scalar() const { return arithmetic() || pointer(); }
+  // The kind of the value in a register.
+  BuiltinKind kind() const { return pointer() ? ir::POINTER_KIND : builtin; }
+  // Bytes of what a pointer points to; 0 for void, a function or an
+  // incomplete type.
+  uint32_t pointee_size() const;
+  bool SamePointee(const ExprType &other) const {
+    return target == other.target && builtin == other.builtin;
+  }
+  // As the value of an expression: an array becomes a pointer to its first
+  // element and a function a pointer to it (6.3.2.1).
+  ExprType Decay() const;
+};
+
+// Bytes and alignment of an object of `type` on the target; 0 if it has
+// no size there.
+uint32_t SizeOf(const Type *type);
+uint32_t AlignmentOf(const Type *type);
+// The bytes the text between the quotes of a character constant or string
+// literal stands for, its escape sequences replaced.
+std::string DecodeLiteral(std::string_view text);
+// The operator a compound assignment applies, such as PLUS for
+// PLUS_ASSIGN; `op` itself for any other.
+OP Applied(OP op);
+
+/**
+ * Checks the body of one function definition against C's constraints on
+ * expressions and finds the type of each expression and the symbol each
+ * identifier denotes, for lowering. The first violation is reported as an
+ * Error, with where `locate` says it is.
+ *
+ * Identifiers are looked up in the scope tree of the parser's SymbolTable,
+ * which must have been built before checkers on several threads share it.
+ * A checker only reads what the parser made, and spells names through the
+ * Interner it is given rather than the thread's, so any thread may run it.
+ */
+class TypeChecker : public ConstASTVisitor<TypeChecker, ExprType> {
+public:
+  TypeChecker(const SymbolTable &symbols, const Interner &interner,
+              const Locator &locate)
+      : _symbols(symbols), _interner(interner), _locate(locate) {}
+
+  void Check(const Symbol &function);
+  // What Check() found.
+  const ExprType &type(const Expr *expr) const { return _types.at(expr); }
+  const Symbol *symbol(const Identifier *identifier) const {
+    return _identifiers.at(identifier);
+  }
+
+  ExprType VisitStmt(const Stmt *stmt);
+  ExprType VisitCompoundStmt(const CompoundStmt *stmt);
+  ExprType VisitExpressionStmt(const ExpressionStmt *stmt);
+  ExprType VisitIfStmt(const IfStmt *stmt);
+  ExprType VisitIterationStmt(const IterationStmt *stmt);
+  ExprType VisitForStmt(const ForStmt *stmt) { return VisitStmt(stmt); }
+  ExprType VisitIdentifier(const Identifier *identifier);
+  ExprType VisitConstant(const Constant *constant);
+  ExprType VisitUnaryOperatorExpr(const UnaryOperatorExpr *expr);
+  ExprType VisitBinaryOperatorExpr(const BinaryOperatorExpr *expr);
+  ExprType VisitTenaryOperatorExpr(const TenaryOperatorExpr *expr);
+  ExprType VisitFunctionCallExpr(const FunctionCallExpr *expr);
+
+private:
+  // Visits `expr` and records its type.
+  ExprType CheckExpr(const Expr *expr);
+  void CheckCondition(const Expr *expr);
+  // Whether a value of type `from` may be assigned to an object of type
+  // `to` (6.5.16.1), as it is for arguments as well.
+  bool Assignable(const ExprType &to, const ExprType &from) const;
+  ExprType Arithmetic(const BinaryOperatorExpr *expr, OP op,
+                      const ExprType &left, const ExprType &right);
+  void CheckModifiable(const Expr *expr, const ExprType &type);
+  [[noreturn]] void Fail(const Expr *expr, const std::string &message) const;
+  [[noreturn]] void Fail(Token token, const std::string &message) const;
+
+  const SymbolTable &_symbols;
+  const Interner &_interner;
+  const Locator &_locate;
+  const Scope *_scope = nullptr;
+  std::unordered_map<const Expr *, ExprType> _types;
+  std::unordered_map<const Identifier *, const Symbol *> _identifiers;
+};
+
+#endif // !YYQC_SRC_CODEGEN_TYPE_CHECKER_H_
@@ -0,0 +1,135 @@
+#include "driver.h"
+#include "../codegen/code_generator.h"
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+// The file-scope symbols with their types, then every function-definition.
+std::string PrintSymbols(const Parser &parser) {
+  std::ostringstream os;
+  for (auto &symbol : parser.root_scope().symbols()) {
+    os << *symbol << '\n' << DeclarationMessage{*symbol};
+  }
+  for (auto &function : parser.function_definitions()) {
+    auto type = static_cast<const FunctionType *>(function->type());
+    os << *function << '\n'
+       << FunctionDefinitionMessage{*type, function->body(),
+                                    function->specifiers()};
+  }
+  return os.str();
+}
+
+} // namespace
+
+std::vector<Driver::Result>
+Driver::Compile(const std::vector<std::string> &paths) const {
+  std::vector<Result> results(paths.size());
+  std::unique_ptr<PrecompiledHeader> header;
+  if (!_options.precompiled_header.empty() && !_options.includes.empty()) {
+    header = PrecompiledHeader::Open(_options.precompiled_header);
+  }
+  std::unique_ptr<ASTCache> ast_cache;
+  if (!_options.ast_cache.empty()) {
+    ast_cache.reset(new ASTCache(_options.ast_cache));
+  }
+  unsigned jobs = _options.generate_code
+                      ? _options.jobs
+                      : std::min<size_t>(_options.jobs, paths.size());
+  ThreadPool pool(std::max(jobs, 1u));
+  std::vector<std::unique_ptr<FileCache>> files(pool.size());
+  for (size_t i = 0; i < paths.size(); ++i) {
+    results[i].path = paths[i];
+    pool.Submit([this, &results, &files, &pool, &header, &ast_cache, i] {
+      auto &cache = files[pool.worker()];
+      if (!cache) {
+        cache.reset(new FileCache);
+      }
+      CompileUnit(results[i], *cache, header.get(), ast_cache.get(), pool);
+    });
+  }
+  pool.Wait();
+  return results;
+}
+
+bool Driver::BuildPrecompiledHeader(const std::string &path) const {
+  if (_options.includes.empty()) {
+    return false;
+  }
+  FileCache files;
+  auto preprocessor = MakePreprocessor(files, _options.includes.size());
+  return PrecompiledHeader::Build(*preprocessor, _options.includes[0], path);
+}
+
+void Driver::CompileUnit(Result &result, FileCache &files,
+                         const PrecompiledHeader *header, ASTCache *cache,
+                         ThreadPool &pool) const {
+  Diagnostics diagnostics;
+  try {
+    std::unique_ptr<Preprocessor> preprocessor;
+    std::unique_ptr<Parser> parser;
+    if (cache != nullptr) {
+      preprocessor = MakePreprocessor(files, 0);
+      parser = cache->Load(*preprocessor, result.path);
+      result.used_ast_cache = parser != nullptr;
+    }
+    if (!parser && header != nullptr) {
+      preprocessor = MakePreprocessor(files, 1);
+      parser = header->Load(*preprocessor, result.path);
+      result.used_precompiled_header = parser != nullptr;
+    }
+    if (!parser) {
+      // No header, or a stale one: the first -include is preprocessed
+      // like the others.
+      preprocessor = MakePreprocessor(files, 0);
+      parser = std::make_unique<Parser>(preprocessor->Run(result.path));
+    }
+    // Tokens of a header are where the preprocessor found them.
+    auto locate = [&preprocessor](const Token &token) {
+      return preprocessor->Location(token);
+    };
+    parser->set_locator(locate);
+    if (!result.used_ast_cache) {
+      if (!parser->TranslationUnit()) {
+        Error{"Syntax error at " + parser->Location(parser->current_token()) +
+              "."};
+      }
+      // A unit read after a precompiled header does not start from the
+      // options the cache is keyed on, and the warnings of a unit are
+      // reported again, so neither is kept.
+      if (cache != nullptr && !result.used_precompiled_header &&
+          diagnostics.messages().empty()) {
+        cache->Store(*preprocessor, *parser, result.path);
+      }
+    }
+    result.tokens = parser->lexer().token_list().size();
+    if (_options.print_symbols) {
+      result.output = PrintSymbols(*parser);
+    }
+    if (_options.generate_code) {
+      result.output += CodeGenerator(*parser, locate).Generate(&pool);
+    }
+    result.succeeded = true;
+  } catch (const Diagnostics::Fatal &) {
+  }
+  result.diagnostics = diagnostics.messages();
+}
+
+std::unique_ptr<Preprocessor>
+Driver::MakePreprocessor(FileCache &files, size_t first_include) const {
+  auto preprocessor = std::make_unique<Preprocessor>(files);
+  for (auto &directory : _options.include_paths) {
+    preprocessor->AddIncludePath(directory);
+  }
+  for (auto &macro : _options.macros) {
+    if (macro[0] == 'U') {
+      preprocessor->Undefine(macro.substr(1));
+    } else {
+      preprocessor->Define(macro.substr(1));
+    }
+  }
+  for (size_t i = first_include; i < _options.includes.size(); ++i) {
+    preprocessor->AddInclude(_options.includes[i]);
+  }
+  return preprocessor;
+}
@@ -0,0 +1,85 @@
+#ifndef YYQC_SRC_DRIVER_DRIVER_H_
+#define YYQC_SRC_DRIVER_DRIVER_H_
+
+#include "../cache/precompiled_header.h"
+#include "../parser/parser.h"
+#include "../preprocessor/preprocessor.h"
+#include "../util/thread_pool.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Compiles translation units, as many at a time as there are jobs, each
+ * unit a task of a work-stealing ThreadPool. A unit is preprocessed and
+ * parsed on one thread from start to end, so everything it makes (its
+ * arena, its types and symbols, the atoms of its thread's Interner) stays
+ * there, and nothing is shared between tasks but the options, the
+ * precompiled header, which is only read, and the AST cache. Each worker keeps a FileCache
+ * for the units it compiles, so a header is lexed once per worker.
+ *
+ * What a unit reports goes to a Diagnostics of its own, and a fatal error
+ * ends that unit only. Results come back in the order of the paths, so the
+ * output of a build does not depend on the number of jobs or on which unit
+ * finished first.
+ *
+ * With generate_code, a unit's function definitions are compiled by the
+ * same pool once the unit is parsed (see CodeGenerator), so the pool has
+ * all the jobs even for fewer files, and one large file keeps them busy.
+ */
+class Driver {
+public:
+  struct Options {
+    std::vector<std::string> include_paths;
+    // -D and -U as given, "DNAME=VALUE" or "UNAME", applied in order.
+    std::vector<std::string> macros;
+    // -include, in order.
+    std::vector<std::string> includes;
+    // A precompiled header of the first -include, as BuildPrecompiledHeader
+    // writes it, used instead of it when it is up to date and there is no
+    // other -include.
+    std::string precompiled_header;
+    // A directory an ASTCache keeps parsed units in: a unit none of whose
+    // files has changed since is loaded instead of preprocessed and parsed.
+    std::string ast_cache;
+    unsigned jobs = 1;
+    // Whether a unit's output lists its file-scope symbols and function
+    // definitions.
+    bool print_symbols = false;
+    // Whether a unit's output ends with its assembly.
+    bool generate_code = false;
+  };
+
+  struct Result {
+    std::string path;
+    bool succeeded = false;
+    // Errors and warnings, in the order they were reported.
+    std::vector<std::string> diagnostics;
+    std::string output;
+    bool used_precompiled_header = false;
+    bool used_ast_cache = false;
+    uint64_t tokens = 0;
+  };
+
+  explicit Driver(Options options) : _options(std::move(options)) {}
+
+  // One result per path, in the same order.
+  std::vector<Result> Compile(const std::vector<std::string> &paths) const;
+  // Precompiles the first -include to `path`, for the precompiled_header
+  // option of later builds with the same options. False if there is no
+  // -include, or as PrecompiledHeader::Build.
+  bool BuildPrecompiledHeader(const std::string &path) const;
+
+private:
+  void CompileUnit(Result &result, FileCache &files,
+                   const PrecompiledHeader *header, ASTCache *cache,
+                   ThreadPool &pool) const;
+  // A preprocessor set up with the options, and with the -includes from
+  // `first_include` on: a precompiled header stands for the first.
+  std::unique_ptr<Preprocessor> MakePreprocessor(FileCache &files,
+                                                 size_t first_include) const;
+
+  Options _options;
+};
+
+#endif
@@ -0,0 +1,84 @@
+#include "../driver.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+using namespace std;
+
+const int HEADERS = 20;
+const int UNITS = 96;
+
+// Guarded headers of declarations and function-like macros, and units that
+// include all of them and use the macros in expression-dense bodies, as
+// the preprocessor bench writes them.
+static vector<string> WriteCorpus(const string &directory) {
+  for (int i = 0; i < HEADERS; ++i) {
+    ofstream out(directory + "/header_" + to_string(i) + ".h");
+    out << "#ifndef HEADER_" << i << "_H\n#define HEADER_" << i << "_H\n"
+        << "#define MIX_" << i << "(x, y) ((x) * " << i + 1
+        << " ^ (y) >> 1)\n"
+        << "typedef unsigned long size_" << i << ";\n";
+    for (int j = 0; j < 20; ++j) {
+      out << "int function_" << i << "_" << j << "(int a, char b);\n";
+    }
+    out << "#endif\n";
+  }
+  vector<string> paths;
+  for (int unit = 0; unit < UNITS; ++unit) {
+    paths.push_back(directory + "/unit_" + to_string(unit) + ".c");
+    ofstream out(paths.back());
+    for (int i = 0; i < HEADERS; ++i) {
+      out << "#include \"header_" << i << ".h\"\n";
+    }
+    // Units of very different sizes, for the pool to balance.
+    for (int f = 0; f < 20 + unit % 7 * 30; ++f) {
+      out << "int unit_" << unit << "_" << f << "(int a, int b) {\n";
+      for (int i = f % 4; i < HEADERS; i += 4) {
+        out << "  a = MIX_" << i << "(a, b) + MIX_" << (i + 1) % HEADERS
+            << "(b, a);\n  while (a) { b = b + a; a = a - 1; }\n";
+      }
+      out << "}\n";
+    }
+  }
+  return paths;
+}
+
+int main(int argc, char **argv) {
+  char pattern[] = "/tmp/yyqc_driver_bench_XXXXXX";
+  string directory = mkdtemp(pattern);
+  auto paths = WriteCorpus(directory);
+  const int rounds = 3;
+
+  cout << UNITS << " units, " << thread::hardware_concurrency()
+       << " hardware threads" << endl;
+  double serial = 0;
+  for (unsigned jobs : {1u, 2u, 4u, 8u}) {
+    Driver::Options options;
+    options.jobs = jobs;
+    Driver driver(options);
+    double best = 1e30;
+    for (int round = 0; round < rounds; ++round) {
+      auto start = chrono::steady_clock::now();
+      auto results = driver.Compile(paths);
+      auto end = chrono::steady_clock::now();
+      for (auto &result : results) {
+        if (!result.succeeded) {
+          return 1;
+        }
+      }
+      best = min(best, chrono::duration<double>(end - start).count());
+    }
+    if (jobs == 1) {
+      serial = best;
+    }
+    cout << jobs << " jobs: best of " << rounds << ": " << best * 1e3
+         << " ms, " << serial / best << "x" << endl;
+  }
+
+  system(("rm -rf " + directory).c_str());
+  return 0;
+}
@@ -0,0 +1,243 @@
+#include "../../util/check.h"
+#include "../driver.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+static string directory;
+
+static string Write(const string &name, const string &text) {
+  string path = directory + "/" + name;
+  ofstream(path) << text;
+  return path;
+}
+
+const int UNITS = 24;
+
+// Units that include a common header and a prefix, and a few that fail in
+// the preprocessor, in the parser or before either: their results are in
+// between the others'.
+static vector<string> WriteCorpus() {
+  system(("mkdir -p " + directory + "/include").c_str());
+  Write("include/common.h", "#ifndef COMMON_H\n#define COMMON_H\n"
+                            "typedef unsigned long size_t;\n"
+                            "#define SCALE(x) ((x) * FACTOR)\n"
+                            "int shared(int a, char *b);\n"
+                            "#endif\n");
+  Write("prefix.h", "#include <common.h>\n"
+                    "typedef int count_t;\n"
+                    "count_t table[8];\n");
+  vector<string> paths;
+  for (int unit = 0; unit < UNITS; ++unit) {
+    string name = "unit_" + to_string(unit);
+    string text = "#include <common.h>\n";
+    for (int f = 0; f <= unit % 5; ++f) {
+      string function = name + "_" + to_string(f);
+      text += "count_t " + function + "(count_t a, size_t b) {\n"
+              "  count_t " + name + "_local;\n"
+              "  a = SCALE(a) + b;\n"
+              "  while (a) { a = a - 1; }\n"
+              "}\n";
+    }
+    paths.push_back(Write(name + ".c", text));
+    if (unit == 5) {
+      paths.push_back(Write("syntax.c", "count_t good;\nint 3;\n"));
+      paths.push_back(Write("specifier.c", "count_t good;\nint float f;\n"));
+      paths.push_back(Write("match.c", "int f() {\n  goto ;\n}\n"));
+    } else if (unit == 11) {
+      paths.push_back(Write("error.c", "#include <common.h>\n"
+                                       "#warning before the error\n"
+                                       "#error stop here\n"
+                                       "int never;\n"));
+    } else if (unit == 17) {
+      paths.push_back(Write("warning.c", "#warning careful\n"
+                                         "count_t fine;\n"));
+      paths.push_back(directory + "/missing.c");
+    }
+  }
+  return paths;
+}
+
+static Driver::Options MakeOptions(unsigned jobs) {
+  Driver::Options options;
+  options.include_paths.push_back(directory + "/include");
+  options.macros = {"DFACTOR=3", "DUNUSED", "UUNUSED"};
+  options.includes.push_back(directory + "/prefix.h");
+  options.jobs = jobs;
+  options.print_symbols = true;
+  return options;
+}
+
+static bool Same(const Driver::Result &a, const Driver::Result &b) {
+  return a.path == b.path && a.succeeded == b.succeeded &&
+         a.diagnostics == b.diagnostics && a.output == b.output &&
+         a.tokens == b.tokens;
+}
+
+static bool Failed(const Driver::Result &result, const string &message) {
+  return !result.succeeded && !result.diagnostics.empty() &&
+         result.diagnostics.back().find(message) != string::npos;
+}
+
+int main() {
+  char pattern[] = "/tmp/yyqc_driver_XXXXXX";
+  directory = mkdtemp(pattern);
+  auto paths = WriteCorpus();
+
+  auto serial = Driver(MakeOptions(1)).Compile(paths);
+  Check(serial.size() == paths.size(), "one result per file");
+  int succeeded = 0;
+  for (size_t i = 0; i < serial.size(); ++i) {
+    auto &result = serial[i];
+    Check(result.path == paths[i], "results in the order of the files");
+    succeeded += result.succeeded;
+    if (result.path.find("unit_") != string::npos) {
+      auto name = result.path.substr(result.path.rfind('/') + 1);
+      name = name.substr(0, name.size() - 2) + "_0";
+      Check(result.succeeded && result.diagnostics.empty() &&
+                result.output.find(name) != string::npos,
+            result.path + " compiles");
+    }
+  }
+  Check(succeeded == UNITS + 1, "all but the bad files compile");
+
+  auto find = [&](const string &name) -> const Driver::Result & {
+    for (auto &result : serial) {
+      if (result.path == directory + "/" + name) {
+        return result;
+      }
+    }
+    return serial[0];
+  };
+  Check(Failed(find("syntax.c"), "Syntax error at"), "a syntax error");
+  Check(Failed(find("specifier.c"), "Invalid combination of type specifiers "
+                                    "at " + directory + "/specifier.c:2:1."),
+        "a specifier error at its file, row and column");
+  // A token the grammar does not allow there fails its unit alone; the
+  // units after it still compile.
+  Check(Failed(find("match.c"),
+               "Syntax error at " + directory + "/match.c:2:8."),
+        "a missing identifier after goto");
+  auto &error = find("error.c");
+  Check(Failed(error, "#error stop here") && error.diagnostics.size() == 2 &&
+            error.diagnostics[0].find("#warning before the error") == 0,
+        "#error ends the unit after its warning");
+  auto &warning = find("warning.c");
+  Check(warning.succeeded && warning.diagnostics.size() == 1 &&
+            warning.diagnostics[0].find("#warning careful") == 0,
+        "a warning does not");
+  Check(Failed(find("missing.c"), "Cannot open file"), "a missing file");
+
+  // Any number of jobs gives the same results.
+  for (unsigned jobs : {2u, 4u, 8u, 64u}) {
+    auto parallel = Driver(MakeOptions(jobs)).Compile(paths);
+    bool same = parallel.size() == serial.size();
+    for (size_t i = 0; same && i < parallel.size(); ++i) {
+      same = Same(parallel[i], serial[i]);
+    }
+    Check(same, to_string(jobs) + " jobs give what one does");
+  }
+
+  // With the prefix precompiled, every unit the preprocessor gets through
+  // uses it, and ends up as it did without it.
+  string pch = directory + "/prefix.pch";
+  auto options = MakeOptions(4);
+  Check(Driver(options).BuildPrecompiledHeader(pch), "prefix precompiles");
+  options.precompiled_header = pch;
+  auto precompiled = Driver(options).Compile(paths);
+  for (size_t i = 0; i < precompiled.size(); ++i) {
+    auto &result = precompiled[i];
+    Check(Same(result, serial[i]), result.path + " with the header");
+    Check(result.used_precompiled_header ==
+              (result.path.find("missing") == string::npos &&
+               result.path.find("error") == string::npos),
+          result.path + " uses the header");
+  }
+  // A stale one is preprocessed instead.
+  options.macros.push_back("DOTHER");
+  auto stale = Driver(options).Compile(paths);
+  for (size_t i = 0; i < stale.size(); ++i) {
+    Check(!stale[i].used_precompiled_header && Same(stale[i], serial[i]),
+          stale[i].path + " with a stale header");
+  }
+
+  // With an AST cache, the units that compile without a word are kept, and
+  // the next build loads them and ends up as the first did.
+  options = MakeOptions(4);
+  options.ast_cache = directory + "/ast";
+  auto storing = Driver(options).Compile(paths);
+  auto loading = Driver(options).Compile(paths);
+  for (size_t i = 0; i < paths.size(); ++i) {
+    bool kept = serial[i].succeeded && serial[i].diagnostics.empty();
+    Check(!storing[i].used_ast_cache && Same(storing[i], serial[i]),
+          paths[i] + " into the AST cache");
+    Check(loading[i].used_ast_cache == kept && Same(loading[i], serial[i]),
+          paths[i] + " from the AST cache");
+  }
+  // A header a unit included that changes, even where it preprocesses to
+  // the same tokens, makes the unit stale; so do other options.
+  ofstream(directory + "/include/common.h", ios::app) << "/* edited */\n";
+  auto edited = Driver(options).Compile(paths);
+  options.macros.push_back("DOTHER");
+  auto defined = Driver(options).Compile(paths);
+  for (size_t i = 0; i < paths.size(); ++i) {
+    Check(!edited[i].used_ast_cache && Same(edited[i], serial[i]),
+          paths[i] + " after an edit to a header");
+    Check(!defined[i].used_ast_cache && Same(defined[i], serial[i]),
+          paths[i] + " with other options");
+  }
+
+  // With code generation, a unit's assembly follows its symbols, the same
+  // however many jobs share out its functions.
+  auto generating = paths;
+  generating.push_back(Write("codegen.c", "#include <common.h>\n"
+                                          "int broken() { missing = 1; }\n"
+                                          "int fine() { table[1] = 2; }\n"));
+  options = MakeOptions(1);
+  options.generate_code = true;
+  auto generated = Driver(options).Compile(generating);
+  for (size_t i = 0; i < serial.size(); ++i) {
+    auto &result = generated[i];
+    auto name = result.path.substr(result.path.rfind('/') + 1);
+    Check(result.succeeded == serial[i].succeeded &&
+              result.output.compare(0, serial[i].output.size(),
+                                    serial[i].output) == 0 &&
+              (name.find("unit_") != 0 ||
+               result.output.find("\n" + name.substr(0, name.size() - 2) +
+                                  "_0:\n") != string::npos),
+          result.path + " generates code");
+  }
+  auto &broken = generated.back();
+  Check(!broken.succeeded && broken.diagnostics.size() == 2 &&
+            broken.diagnostics[0] == "Use of undeclared identifier "
+                                     "'missing' at " +
+                                         directory + "/codegen.c:2:16." &&
+            broken.diagnostics[1] == "1 function failed to compile.",
+        "an error in a function ends its unit");
+  for (unsigned jobs : {2u, 8u}) {
+    options.jobs = jobs;
+    auto parallel = Driver(options).Compile(generating);
+    bool same = parallel.size() == generated.size();
+    for (size_t i = 0; same && i < parallel.size(); ++i) {
+      same = Same(parallel[i], generated[i]);
+    }
+    Check(same, "code from " + to_string(jobs) + " jobs");
+  }
+  // Loaded units generate the same code as parsed ones.
+  options.ast_cache = directory + "/ast";
+  auto cached = Driver(options).Compile(generating);
+  bool same = cached.size() == generated.size();
+  for (size_t i = 0; same && i < cached.size(); ++i) {
+    same = Same(cached[i], generated[i]) &&
+           cached[i].used_ast_cache ==
+               (generated[i].succeeded && generated[i].diagnostics.empty());
+  }
+  Check(same, "code from the AST cache");
+
+  system(("rm -rf " + directory).c_str());
+  cout << (passed ? "driver: ok" : "driver: FAILED") << endl;
+  return passed ? 0 : 1;
+}
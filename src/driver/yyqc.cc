@@ -0,0 +1,134 @@
+#include "driver.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char USAGE[] =
+    "usage: yyqc [options] file...\n"
+    "  -jN                compile N files at a time (default: one per core)\n"
+    "  -I DIR             add DIR to the include path\n"
+    "  -D NAME[=VALUE]    define a macro\n"
+    "  -U NAME            undefine a macro\n"
+    "  -include FILE      include FILE before each file\n"
+    "  --pch=PCH          use PCH, a precompiled header of the first "
+    "-include,\n"
+    "                     while it is up to date\n"
+    "  --build-pch=PCH    precompile the first -include to PCH, and stop\n"
+    "  --ast-cache=DIR    keep parsed files in DIR, and load those whose\n"
+    "                     files have not changed instead of parsing them\n"
+    "  --print-symbols    print the symbols of each file\n"
+    "  -S                 print the assembly of each file, its functions\n"
+    "                     compiled by all the jobs\n"
+    "  --stats            print how long the build took\n"
+    "  --trace=CATEGORIES trace the front end, one file at a time\n";
+
+// The value of an option given as "-X VALUE" or "-XVALUE".
+bool OptionValue(int argc, char **argv, int &i, const std::string &option,
+                 std::string &value) {
+  std::string argument = argv[i];
+  if (argument.compare(0, option.size(), option) != 0) {
+    return false;
+  }
+  if (argument.size() > option.size()) {
+    value = argument.substr(option.size());
+    return true;
+  }
+  if (i + 1 == argc) {
+    return false;
+  }
+  value = argv[++i];
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Driver::Options options;
+  options.jobs = std::max(std::thread::hardware_concurrency(), 1u);
+  std::vector<std::string> paths;
+  std::string build_pch;
+  bool stats = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string argument = argv[i], value;
+    if (argument == "-include" && i + 1 < argc) {
+      options.includes.push_back(argv[++i]);
+    } else if (argument.compare(0, 2, "-j") == 0 && argument.size() > 2) {
+      options.jobs = std::max(std::atoi(argument.c_str() + 2), 1);
+    } else if (OptionValue(argc, argv, i, "-I", value)) {
+      options.include_paths.push_back(value);
+    } else if (OptionValue(argc, argv, i, "-D", value)) {
+      options.macros.push_back("D" + value);
+    } else if (OptionValue(argc, argv, i, "-U", value)) {
+      options.macros.push_back("U" + value);
+    } else if (argument.compare(0, 6, "--pch=") == 0) {
+      options.precompiled_header = argument.substr(6);
+    } else if (argument.compare(0, 12, "--build-pch=") == 0) {
+      build_pch = argument.substr(12);
+    } else if (argument.compare(0, 12, "--ast-cache=") == 0) {
+      options.ast_cache = argument.substr(12);
+    } else if (argument == "--print-symbols") {
+      options.print_symbols = true;
+    } else if (argument == "-S") {
+      options.generate_code = true;
+    } else if (argument == "--stats") {
+      stats = true;
+    } else if (argument.compare(0, 8, "--trace=") == 0) {
+      if (!Trace::Global().Enable(argument.substr(8))) {
+        std::cerr << "yyqc: unknown trace category in " << argument << '\n';
+        return 2;
+      }
+      options.jobs = 1;
+    } else if (argument[0] == '-') {
+      std::cerr << "yyqc: unknown option " << argument << '\n' << USAGE;
+      return 2;
+    } else {
+      paths.push_back(argument);
+    }
+  }
+
+  Driver driver(options);
+  if (!build_pch.empty()) {
+    if (!driver.BuildPrecompiledHeader(build_pch)) {
+      std::cerr << "yyqc: cannot precompile "
+                << (options.includes.empty() ? "without -include"
+                                             : options.includes[0])
+                << '\n';
+      return 1;
+    }
+    return 0;
+  }
+  if (paths.empty()) {
+    std::cerr << USAGE;
+    return 2;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  auto results = driver.Compile(paths);
+  auto end = std::chrono::steady_clock::now();
+  int failed = 0;
+  uint64_t tokens = 0;
+  for (auto &result : results) {
+    for (auto &message : result.diagnostics) {
+      std::cerr << result.path << ": " << message << '\n';
+    }
+    std::cout << result.output;
+    failed += !result.succeeded;
+    tokens += result.tokens;
+  }
+  if (stats) {
+    auto jobs = options.generate_code
+                    ? options.jobs
+                    : std::min<size_t>(options.jobs, paths.size());
+    std::cerr << results.size() << " files, " << failed << " failed, "
+              << tokens << " tokens in "
+              << std::chrono::duration<double>(end - start).count() * 1e3
+              << " ms on " << jobs << " jobs\n";
+  }
+  return failed == 0 ? 0 : 1;
+}
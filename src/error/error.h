@@ -1,15 +1,63 @@
 #ifndef _ERROR_H_
 #define _ERROR_H_
 
+#include <cstdlib>
 #include <iostream>
 #include <string>
+#include <vector>
+
+/**
+ * The messages of one translation unit. While a Diagnostics is alive it
+ * collects what Error and Warning report on its thread, instead of their
+ * going to stderr; a driver compiling several units at once gives each its
+ * own and prints them in order afterwards. An Error then ends only its unit,
+ * by throwing Diagnostics::Fatal for the driver to catch, and not the
+ * process.
+ */
+class Diagnostics {
+public:
+    struct Fatal {};
+
+    Diagnostics() : _previous(current()) { current() = this; }
+    ~Diagnostics() { current() = _previous; }
+    Diagnostics(const Diagnostics&) = delete;
+    Diagnostics& operator=(const Diagnostics&) = delete;
+
+    void Report(const std::string& message) { _messages.push_back(message); }
+    const std::vector<std::string>& messages() const { return _messages; }
+
+    // The innermost one alive on the calling thread, or nullptr.
+    static Diagnostics*& current() {
+        thread_local Diagnostics* diagnostics = nullptr;
+        return diagnostics;
+    }
+
+private:
+    Diagnostics* _previous;
+    std::vector<std::string> _messages;
+};
 
 class Error {
 public:
     Error(const std::string& message) {
+        if (auto diagnostics = Diagnostics::current()) {
+            diagnostics->Report(message);
+            throw Diagnostics::Fatal{};
+        }
         std::cerr << message << std::endl;
         exit(1);
     }
 };
 
+class Warning {
+public:
+    Warning(const std::string& message) {
+        if (auto diagnostics = Diagnostics::current()) {
+            diagnostics->Report(message);
+            return;
+        }
+        std::cerr << message << std::endl;
+    }
+};
+
 #endif
@@ -0,0 +1,160 @@
+#include "interner.h"
+#include "token.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const size_t CHUNK_SIZE = 64 * 1024;
+const size_t INITIAL_SLOTS = 4096;
+
+struct Keyword {
+  const char *spelling;
+  TOKEN tag;
+};
+
+const Keyword KEYWORDS[] = {
+    {"auto", TOKEN::AUTO},
+    {"break", TOKEN::BREAK},
+    {"case", TOKEN::CASE},
+    {"char", TOKEN::CHAR},
+    {"const", TOKEN::CONST},
+    {"continue", TOKEN::CONTINUE},
+    {"default", TOKEN::DEFAULT},
+    {"do", TOKEN::DO},
+    {"double", TOKEN::DOUBLE},
+    {"else", TOKEN::ELSE},
+    {"enum", TOKEN::ENUM},
+    {"extern", TOKEN::EXTERN},
+    {"float", TOKEN::FLOAT},
+    {"for", TOKEN::FOR},
+    {"goto", TOKEN::GOTO},
+    {"if", TOKEN::IF},
+    {"inline", TOKEN::INLINE},
+    {"int", TOKEN::INT},
+    {"long", TOKEN::LONG},
+    {"register", TOKEN::REGISTER},
+    {"restrict", TOKEN::RESTRICT},
+    {"return", TOKEN::RETURN},
+    {"short", TOKEN::SHORT},
+    {"signed", TOKEN::SIGNED},
+    {"sizeof", TOKEN::SIZEOF},
+    {"static", TOKEN::STATIC},
+    {"struct", TOKEN::STRUCT},
+    {"switch", TOKEN::SWITCH},
+    {"typedef", TOKEN::TYPEDEF},
+    {"union", TOKEN::UNION},
+    {"unsigned", TOKEN::UNSIGNED},
+    {"void", TOKEN::VOID},
+    {"volatile", TOKEN::VOLATILE},
+    {"while", TOKEN::WHILE},
+    {"alignas", TOKEN::ALIGNAS},
+    {"alignof", TOKEN::ALIGNOF},
+    {"atomic", TOKEN::ATOMIC},
+    {"complex", TOKEN::COMPLEX},
+    {"generic", TOKEN::GENERIC},
+    {"imaginary", TOKEN::IMAGINARY},
+    {"noreturn", TOKEN::NORETURN},
+    {"static_assert", TOKEN::STATIC_ASSERT},
+    {"thread_local", TOKEN::THREAD_LOCAL},
+};
+
+} // namespace
+
+Interner &Interner::ForThread() {
+  thread_local Interner interner;
+  return interner;
+}
+
+Interner::Interner() : _slots(INITIAL_SLOTS) {
+  // Atom::NONE
+  _spellings.push_back("");
+  _lengths.push_back(0);
+  _tags.push_back(TOKEN::IDENTIFIER);
+  for (auto &keyword : KEYWORDS) {
+    auto atom = Intern(keyword.spelling, std::strlen(keyword.spelling));
+    _tags[static_cast<uint32_t>(atom)] = keyword.tag;
+  }
+}
+
+// FNV-1a.
+uint32_t Interner::Hash(const char *str, uint32_t length) {
+  uint32_t hash = 2166136261u;
+  for (uint32_t i = 0; i < length; ++i) {
+    hash ^= static_cast<unsigned char>(str[i]);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+Atom Interner::Intern(const char *str, uint32_t length) {
+  auto hash = Hash(str, length);
+  auto mask = _slots.size() - 1;
+  for (auto i = hash & mask;; i = (i + 1) & mask) {
+    auto &slot = _slots[i];
+    if (slot.atom == Atom::NONE) {
+      auto atom = static_cast<Atom>(_spellings.size());
+      _spellings.push_back(Store(str, length));
+      _lengths.push_back(length);
+      _tags.push_back(TOKEN::IDENTIFIER);
+      slot.hash = hash;
+      slot.atom = atom;
+      // Keep the load factor under 1/2.
+      if (_spellings.size() * 2 > _slots.size()) {
+        Grow();
+      }
+      return atom;
+    }
+    auto id = static_cast<uint32_t>(slot.atom);
+    if (slot.hash == hash && _lengths[id] == length &&
+        std::memcmp(_spellings[id], str, length) == 0) {
+      return slot.atom;
+    }
+  }
+}
+
+Atom Interner::Find(const char *str, uint32_t length) const {
+  auto hash = Hash(str, length);
+  auto mask = _slots.size() - 1;
+  for (auto i = hash & mask;; i = (i + 1) & mask) {
+    auto &slot = _slots[i];
+    if (slot.atom == Atom::NONE) {
+      return Atom::NONE;
+    }
+    auto id = static_cast<uint32_t>(slot.atom);
+    if (slot.hash == hash && _lengths[id] == length &&
+        std::memcmp(_spellings[id], str, length) == 0) {
+      return slot.atom;
+    }
+  }
+}
+
+const char *Interner::Store(const char *str, uint32_t length) {
+  if (length > _chunk_left) {
+    auto size = std::max(CHUNK_SIZE, static_cast<size_t>(length));
+    _chunks.emplace_back(new char[size]);
+    _chunk_cursor = _chunks.back().get();
+    _chunk_left = size;
+  }
+  auto stored = _chunk_cursor;
+  std::memcpy(_chunk_cursor, str, length);
+  _chunk_cursor += length;
+  _chunk_left -= length;
+  return stored;
+}
+
+void Interner::Grow() {
+  std::vector<Slot> slots(_slots.size() * 2);
+  auto mask = slots.size() - 1;
+  for (auto &slot : _slots) {
+    if (slot.atom == Atom::NONE) {
+      continue;
+    }
+    auto i = slot.hash & mask;
+    while (slots[i].atom != Atom::NONE) {
+      i = (i + 1) & mask;
+    }
+    slots[i] = slot;
+  }
+  _slots = std::move(slots);
+}
@@ -0,0 +1,68 @@
+#ifndef YYQC_SRC_INTERNER_H_
+#define YYQC_SRC_INTERNER_H_
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class TOKEN : uint8_t;
+
+// A stable 32-bit name for an interned spelling. Equal spellings always get
+// the same atom, so names can be compared and hashed as integers.
+enum class Atom : uint32_t { NONE = 0 };
+
+/**
+ * Identifier table shared by every lexer of a thread. Each distinct
+ * spelling is copied once into a chunked string arena and indexed by an
+ * open-addressing hash table. The keywords are interned first, so they own
+ * atoms [1, keyword count] in every thread's table, and keyword recognition
+ * is a lookup in the same table as identifier interning.
+ *
+ * Threads that compile units of their own have tables of their own, so
+ * interning takes no lock. An atom only means something to the thread that
+ * made it: whatever holds atoms, a translation unit's tokens, symbols and
+ * types or a FileCache, stays with that thread.
+ */
+class Interner {
+public:
+  // The calling thread's table, made on first use.
+  static Interner &ForThread();
+
+  Atom Intern(const char *str, uint32_t length);
+  Atom Intern(std::string_view str) { return Intern(str.data(), str.size()); }
+  // Looks a spelling up without interning it; Atom::NONE if it is new. Never
+  // writes, so any number of threads may call it while nobody interns.
+  Atom Find(const char *str, uint32_t length) const;
+  std::string_view spelling(Atom atom) const {
+    auto id = static_cast<uint32_t>(atom);
+    return std::string_view(_spellings[id], _lengths[id]);
+  }
+  // TOKEN::IDENTIFIER unless the atom names a keyword.
+  TOKEN tag(Atom atom) const { return _tags[static_cast<uint32_t>(atom)]; }
+  uint32_t size() const { return _spellings.size(); }
+
+private:
+  Interner();
+  Interner(const Interner &) = delete;
+  Interner &operator=(const Interner &) = delete;
+  static uint32_t Hash(const char *str, uint32_t length);
+  const char *Store(const char *str, uint32_t length);
+  void Grow();
+
+  struct Slot {
+    uint32_t hash = 0;
+    Atom atom = Atom::NONE;
+  };
+  std::vector<Slot> _slots;
+  // Indexed by atom.
+  std::vector<const char *> _spellings;
+  std::vector<uint32_t> _lengths;
+  std::vector<TOKEN> _tags;
+  // String arena: spellings never move once stored.
+  std::vector<std::unique_ptr<char[]>> _chunks;
+  char *_chunk_cursor = nullptr;
+  size_t _chunk_left = 0;
+};
+
+#endif
@@ -1,435 +1,449 @@
 #include "lexer.h"
+#include <array>
 #include <cassert>
 #include <cctype>
 #include <cstddef>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <string>
-const size_t APPEND_SIZE = 10;
-
 bool HandleNumber(Lexer &);
 bool HandleIdentifier(Lexer &);
 bool HandleCharLiteral(Lexer &);
+bool HandleStringLiteral(Lexer &);
+bool HandlePunctuator(Lexer &);
 
+// Maps the file (or reads it once if it cannot be mapped). The buffer ends
+// with SourceBuffer::SENTINEL_SIZE '\0's, which terminates every scanning loop.
 bool Lexer::OpenFile(const std::string &path) {
-  std::ifstream ifs(path);
-  // TODO: if opening file not successfully?
-  std::string content = std::string((std::istreambuf_iterator<char>(ifs)),
-                                    (std::istreambuf_iterator<char>()));
-  content.append(std::string(APPEND_SIZE, '\0'));
-  _file_content_ptr = new std::string(content);
-  return true;
+  _source = SourceBuffer::Open(path);
+  return _source != nullptr;
 }
 
-bool Lexer::Tokenize() {
-  TOKEN tag = TOKEN::FILE_EOF;
-  bool need_space = false;
-  for (;;) {
-    while (isblank(PeekCurrentChar()) || PeekCurrentChar() == '\n') {
-      ConsumeChar();
-    }
+namespace {
 
-    Position start_position = _position;
-    if (PeekCurrentChar('\0')) {
-      AddToken(TOKEN::FILE_EOF, _position);
-      return true;
+enum class CharClass : uint8_t {
+  INVALID = 0,
+  END,          // '\0': the source buffer sentinel
+  BLANK,        // blanks the scan kernel leaves behind: '\v', '\f', '\r'
+  IDENTIFIER,   // [A-Za-z_]
+  DIGIT,        // [0-9]
+  DOT,          // '.': member access, ellipsis or a floating constant
+  SLASH,        // '/': division or a comment
+  DOUBLE_QUOTE, // string literal
+  SINGLE_QUOTE, // character constant
+  PUNCTUATOR,
+};
+
+struct Punctuator {
+  char spelling[4];
+  TOKEN tag;
+};
+
+// Grouped by the first character, longest spelling first, so the first
+// entry that matches is the maximal munch.
+constexpr Punctuator PUNCTUATORS[] = {
+    {"!=", TOKEN::NE},           {"!", TOKEN::LOGICAL_NOT},
+    {"#", TOKEN::SHARP},         {"$", TOKEN::DOLLAR},
+    {"%=", TOKEN::MOD_ASSIGN},   {"%", TOKEN::MOD},
+    {"&&", TOKEN::LOGICAL_AND},  {"&=", TOKEN::AND_ASSIGN},
+    {"&", TOKEN::AND},           {"(", TOKEN::LPAR},
+    {")", TOKEN::RPAR},          {"*=", TOKEN::MUL_ASSIGN},
+    {"*", TOKEN::STAR},          {"++", TOKEN::INCREMENT},
+    {"+=", TOKEN::ADD_ASSIGN},   {"+", TOKEN::ADD},
+    {",", TOKEN::COMMA},         {"--", TOKEN::DECREMENT},
+    {"-=", TOKEN::SUB_ASSIGN},   {"->", TOKEN::PTR_MEM_REF},
+    {"-", TOKEN::SUB},           {"...", TOKEN::ELLIPSIS},
+    {".", TOKEN::DOT},           {"/=", TOKEN::DIV_ASSIGN},
+    {"/", TOKEN::DIV},           {":", TOKEN::COLON},
+    {";", TOKEN::SEMI},          {"<<=", TOKEN::LEFT_ASSIGN},
+    {"<<", TOKEN::LEFT_SHIFT},   {"<=", TOKEN::LE},
+    {"<", TOKEN::LESS},          {"==", TOKEN::EQ},
+    {"=", TOKEN::ASSIGN},        {">>=", TOKEN::RIGHT_ASSIGN},
+    {">>", TOKEN::RIGHT_SHIFT},  {">=", TOKEN::GE},
+    {">", TOKEN::GREATER},       {"?", TOKEN::COND},
+    {"@", TOKEN::AT},            {"[", TOKEN::LSQUBRKT},
+    {"\\", TOKEN::BKSLASH},      {"]", TOKEN::RSQUBRKT},
+    {"^=", TOKEN::XOR_ASSIGN},   {"^", TOKEN::XOR},
+    {"`", TOKEN::BKQUT},         {"{", TOKEN::LBRACE},
+    {"|=", TOKEN::OR_ASSIGN},    {"||", TOKEN::LOGICAL_OR},
+    {"|", TOKEN::OR},            {"}", TOKEN::RBRACE},
+    {"~", TOKEN::NOT},
+};
+
+// PUNCTUATORS[begin, end) are the candidates for one leading character.
+struct PunctuatorRange {
+  uint8_t begin = 0;
+  uint8_t end = 0;
+};
+
+constexpr std::array<PunctuatorRange, 256> MakePunctuatorRanges() {
+  std::array<PunctuatorRange, 256> ranges{};
+  uint8_t count = sizeof(PUNCTUATORS) / sizeof(PUNCTUATORS[0]);
+  for (uint8_t i = count; i-- > 0;) {
+    auto first = static_cast<unsigned char>(PUNCTUATORS[i].spelling[0]);
+    auto &range = ranges[first];
+    if (range.end == 0) {
+      range.end = i + 1;
     }
+    range.begin = i;
+  }
+  return ranges;
+}
+
+constexpr std::array<CharClass, 256> MakeCharClasses() {
+  std::array<CharClass, 256> classes{};
+  for (auto &punctuator : PUNCTUATORS) {
+    classes[static_cast<unsigned char>(punctuator.spelling[0])] =
+        CharClass::PUNCTUATOR;
+  }
+  for (int c = 'a'; c <= 'z'; ++c) {
+    classes[c] = CharClass::IDENTIFIER;
+    classes[c - 'a' + 'A'] = CharClass::IDENTIFIER;
+  }
+  for (int c = '0'; c <= '9'; ++c) {
+    classes[c] = CharClass::DIGIT;
+  }
+  classes['_'] = CharClass::IDENTIFIER;
+  classes['\0'] = CharClass::END;
+  classes[' '] = CharClass::BLANK;
+  classes['\t'] = CharClass::BLANK;
+  classes['\n'] = CharClass::BLANK;
+  classes['\v'] = CharClass::BLANK;
+  classes['\f'] = CharClass::BLANK;
+  classes['\r'] = CharClass::BLANK;
+  classes['.'] = CharClass::DOT;
+  classes['/'] = CharClass::SLASH;
+  classes['"'] = CharClass::DOUBLE_QUOTE;
+  classes['\''] = CharClass::SINGLE_QUOTE;
+  return classes;
+}
+
+constexpr auto PUNCTUATOR_RANGES = MakePunctuatorRanges();
+constexpr auto CHAR_CLASSES = MakeCharClasses();
+
+inline bool IsIdentifierChar(char c) {
+  auto char_class = CHAR_CLASSES[static_cast<unsigned char>(c)];
+  return char_class == CharClass::IDENTIFIER || char_class == CharClass::DIGIT;
+}
 
+} // namespace
+
+bool Lexer::Tokenize() {
+  while (!_reached_eof) {
+    _reached_eof = !LexNext();
+  }
+  return true;
+}
+
+// Appends the next token to the list, skipping the blanks and comments in
+// front of it. Returns false once FILE_EOF has been appended.
+bool Lexer::LexToken() {
+  for (;;) {
+    ConsumeTo(scan_kernels.blanks(CurrentPointer()));
+    uint32_t start = _index;
     char curr = PeekCurrentChar();
-    if (need_space && curr != ' ') {
+    // A switch over the dense class enum compiles to a single jump table.
+    switch (CHAR_CLASSES[static_cast<unsigned char>(curr)]) {
+    case CharClass::END:
+      AddToken(TOKEN::FILE_EOF, start);
       return false;
-    }
-
-    if (curr == '!') {
-      // !
-      // !=
-      if (PeekNextChar('=')) {
-        tag = TOKEN::NE;
-        ConsumeChar();
-      } else {
-        tag = TOKEN::NOT;
-      }
-      AddToken(tag, start_position);
-      ConsumeChar();
-      continue;
-    } else if (curr == '\"') {
-      // string literal
-      size_t length = 0;
-      ConsumeChar();
-      unsigned literal_start = CurrentIndex();
-      while (PeekCurrentChar() != '\0' && PeekCurrentChar() != '\"') {
-        ConsumeChar();
-        ++length;
-      }
-      std::string string_value = file_content().substr(literal_start, length);
-      auto val = std::make_unique<Value>(string_value);
-      AddToken(TOKEN::STRING_LITERAL, start_position, val);
-      ConsumeChar();
-    } else if (curr == '#') {
-      /* TODO */
-      AddToken(TOKEN::SHARP, start_position);
-      ConsumeChar();
-      continue;
-    } else if (curr == '%') {
-      // %  modulo
-      // %= modulo assign
-      if (PeekNextChar('=')) {
-        tag = TOKEN::MOD_ASSIGN;
-        ConsumeChar();
-      } else {
-        tag = TOKEN::MOD;
-      }
-      AddToken(tag, start_position);
-      ConsumeChar();
-      continue;
-    } else if (curr == '&') {
-      // &
-      // &=
-      // &&
-      if (PeekNextChar('&')) {
-        tag = TOKEN::LOGICAL_AND;
-        ConsumeChar();
-      } else if (PeekNextChar('=')) {
-        tag = TOKEN::AND_ASSIGN;
-        ConsumeChar();
-      } else {
-        tag = TOKEN::AND;
-      }
-      AddToken(tag, start_position);
+    case CharClass::BLANK:
       ConsumeChar();
       continue;
-    } else if (curr == '\'') {
-      // char literal
-      HandleCharLiteral(*this);
-      continue;
-    } else if (curr == '(') {
-      AddToken(TOKEN::LPAR, start_position);
-      ConsumeChar();
-    } else if (curr == ')') {
-      AddToken(TOKEN::RPAR, start_position);
-      ConsumeChar();
-    } else if (curr == '*') {
-      // *        pointer, mul
-      // *=
-      if (PeekNextChar('=')) {
-        tag = TOKEN::MUL_ASSIGN;
-        ConsumeChar();
-      } else {
-        tag = TOKEN::STAR;
+    case CharClass::IDENTIFIER:
+      return HandleIdentifier(*this);
+    case CharClass::DIGIT:
+      return HandleNumber(*this);
+    case CharClass::DOT:
+      // .5       floating constant
+      if (isdigit(PeekNextChar())) {
+        return HandleNumber(*this);
       }
-      AddToken(tag, start_position);
-      ConsumeChar();
-    } else if (curr == '+') {
-      // +
-      // +=
-      // ++
-      if (PeekNextChar('=')) {
-        tag = TOKEN::ADD_ASSIGN;
-        ConsumeChar();
-      } else if (PeekNextChar('+')) {
-        tag = TOKEN::INCREMENT;
-        ConsumeChar();
-      } else {
-        tag = TOKEN::ADD;
-      }
-      AddToken(tag, start_position);
-      ConsumeChar();
-    } else if (curr == ',') {
-      AddToken(TOKEN::COMMA, start_position);
-      ConsumeChar();
-    } else if (curr == '-') {
-      // -
-      // --
-      // -=
-      // ->     dereference
-      if (PeekNextChar('=')) {
-        tag = TOKEN::SUB_ASSIGN;
-        ConsumeChar();
-      } else if (PeekNextChar('-')) {
-        tag = TOKEN::DECREMENT;
-        ConsumeChar();
-      } else if (PeekNextChar('>')) {
-        tag = TOKEN::PTR_MEM_REF;
-        ConsumeChar();
-      } else {
-        tag = TOKEN::SUB;
-      }
-      AddToken(tag, start_position);
-      ConsumeChar();
-    } else if (curr == '.') {
-      // ...      ellipsis
-      // .5       float number
-      // .        reference
-      std::string value;
-      if (PeekNextChar('.')) {
-        if (PeekForward(2) == '.') {
-          tag = TOKEN::ELLIPSIS;
-          value = "...";
-          ConsumeChars(2);
-        } else {
-          /* TODO: handle error. */
-        }
-      } else if (isdigit(PeekNextChar())) {
-        HandleNumber(*this);
-        continue;
-      } else {
-        tag = TOKEN::DOT;
-        value = ".";
-      }
-      AddToken(tag, start_position);
-      ConsumeChar();
-      continue;
-    } else if (curr == '/') {
-      // /
-      // /=
-      // /*
-      // //
+      return HandlePunctuator(*this);
+    case CharClass::SLASH:
       if (PeekNextChar('/')) {
-        while (PeekCurrentChar() != '\n') {
-          if (PeekCurrentChar('\0')) {
-            AddToken(TOKEN::FILE_EOF, _position);
-            return true;
-          }
-          ConsumeChar();
-        }
-        ConsumeChar();
+        // The newline, or the '\0' at the end, is left for the next round.
+        ConsumeTo(scan_kernels.line_end(CurrentPointer()));
         continue;
-      } else if (PeekNextChar('*')) {
+      }
+      if (PeekNextChar('*')) {
         ConsumeChars(2);
-        while (!PeekCurrentChar('\0') &&
-               !(PeekCurrentChar('*') && PeekNextChar('/'))) {
-          ConsumeChar();
-        }
+        ConsumeTo(scan_kernels.block_comment_end(CurrentPointer()));
         if (PeekCurrentChar('\0')) {
-          /* TODO: Handle error. */
-        } else {
-          ConsumeChars(2);
+          return Fail("Unterminated comment at " + Location(start) +
+                      ".");
         }
+        ConsumeChars(2);
         continue;
-      } else if (PeekNextChar('=')) {
-        tag = TOKEN::DIV_ASSIGN;
-        ConsumeChar();
-      } else {
-        tag = TOKEN::DIV;
       }
-      AddToken(tag, start_position);
-      continue;
-    } else if (curr == ':') {
-      AddToken(TOKEN::COLON, start_position);
-      ConsumeChar();
-      continue;
-    } else if (curr == ';') {
-      AddToken(TOKEN::SEMI, start_position);
-      ConsumeChar();
-      continue;
-    } else if (curr == '<') {
-      // <
-      // <=
-      // <<
-      // <<=
-      if (PeekNextChar('=')) {
-        tag = TOKEN::LE;
-        ConsumeChar();
-      } else if (PeekNextChar('<')) {
-        if (PeekForward(2) == '=') {
-          tag = TOKEN::LEFT_ASSIGN;
-          ConsumeToken();
-        } else {
-          tag = TOKEN::LEFT_SHIFT;
-        }
-        ConsumeChar();
-      } else {
-        tag = TOKEN::LESS;
-      }
-      AddToken(tag, start_position);
-      ConsumeChar();
-    } else if (curr == '=') {
-      if (PeekNextChar('=')) {
-        tag = TOKEN::EQ;
-        ConsumeChar();
-      } else {
-        tag = TOKEN::ASSIGN;
-      }
-      AddToken(tag, start_position);
-      ConsumeChar();
-    } else if (curr == '>') {
-      if (PeekNextChar('=')) {
-        tag = TOKEN::GE;
-        ConsumeChar();
-      } else if (PeekNextChar('>')) {
-        if (PeekForward(2) == '=') {
-          tag = TOKEN::RIGHT_ASSIGN;
-          ConsumeToken();
-        } else {
-          tag = TOKEN::RIGHT_SHIFT;
-        }
-        ConsumeChar();
-      } else {
-        tag = TOKEN::GREATER;
-      }
-      AddToken(tag, start_position);
-      ConsumeChar();
-    } else if (curr == '?') {
-      AddToken(TOKEN::COND, start_position);
-      ConsumeChar();
-    } else if (curr == '@') {
-      AddToken(TOKEN::AT, start_position);
-      ConsumeChar();
-    } else if (curr == '[') {
-      AddToken(TOKEN::LSQUBRKT, start_position);
-      ConsumeChar();
-    } else if (curr == '\\') {
-      /* TODO */
-    } else if (curr == ']') {
-      AddToken(TOKEN::RSQUBRKT, start_position);
-      ConsumeChar();
-    } else if (curr == '^') {
-      if (PeekNextChar('=')) {
-        tag = TOKEN::XOR_ASSIGN;
+      return HandlePunctuator(*this);
+    case CharClass::DOUBLE_QUOTE:
+      return HandleStringLiteral(*this);
+    case CharClass::SINGLE_QUOTE:
+      return HandleCharLiteral(*this);
+    case CharClass::PUNCTUATOR:
+      return HandlePunctuator(*this);
+    case CharClass::INVALID:
+      return Fail("Invalid character " +
+                  std::to_string(static_cast<unsigned char>(curr)) + " at " +
+                  Location(start) + ".");
+    }
+  }
+}
+
+std::string Lexer::Location(uint32_t offset) const {
+  auto position = _source->position(offset);
+  return std::to_string(position.row()) + ":" +
+         std::to_string(position.column());
+}
+
+bool Lexer::Fail(const std::string &message) {
+  if (!_speculative) {
+    Error{message};
+  }
+  return false;
+}
+
+/**
+ * Parallel lexing. The rest of the buffer is cut into chunks that start
+ * right after a newline, and each chunk is lexed by a speculative Lexer on
+ * the pool as if nothing came before it. Tokens only record offsets, so
+ * nothing about a token depends on where its chunk starts.
+ *
+ * The guess is wrong when a cut falls inside a block comment or a literal
+ * (or a string runs over the cut). Lexing only depends on where a token
+ * starts, so the chunks are stitched by lexing serially from where the
+ * previous part ended until a token starts at an offset where the chunk
+ * also has one. From there the chunk's tokens are exactly the serial ones
+ * and are copied over. A correct guess costs one token of serial lexing
+ * per chunk.
+ */
+bool Lexer::Tokenize(ThreadPool &pool, size_t min_chunk_size) {
+  const char *begin = CurrentPointer();
+  const char *end = file_content() + _source->size();
+  size_t chunk_count = std::min<size_t>(
+      pool.size(), (end - begin) / std::max<size_t>(min_chunk_size, 1));
+  if (_reached_eof || chunk_count < 2) {
+    return Tokenize();
+  }
+  uint32_t first_token = _token_list.size();
+  std::vector<uint32_t> starts = {CurrentIndex()};
+  for (size_t i = 1; i < chunk_count; ++i) {
+    const char *cut = begin + (end - begin) * i / chunk_count;
+    auto newline = static_cast<const char *>(
+        std::memchr(cut, '\n', end - cut));
+    if (newline == nullptr) {
+      break;
+    }
+    uint32_t start = newline + 1 - file_content();
+    if (start > starts.back()) {
+      starts.push_back(start);
+    }
+  }
+  starts.push_back(_source->size());
+  chunk_count = starts.size() - 1;
+
+  std::vector<std::unique_ptr<Lexer>> chunks;
+  for (size_t i = 0; i < chunk_count; ++i) {
+    chunks.emplace_back(new Lexer(_source, starts[i]));
+  }
+  // Speculative lexers never throw, as ParallelFor needs, and unlike Wait()
+  // this does not wait for other work on the pool.
+  pool.ParallelFor(chunk_count, [&chunks, &starts](size_t i) {
+    chunks[i]->LexChunk(starts[i + 1]);
+  });
+
+  size_t chunk = 0;
+  while (LexToken()) {
+    uint32_t offset = _token_list.back().offset();
+    while (chunk + 1 < chunk_count && offset >= starts[chunk + 1]) {
+      ++chunk;
+    }
+    const TokenList &tokens = chunks[chunk]->_token_list;
+    uint32_t low = 0, high = tokens.size();
+    while (low < high) {
+      uint32_t middle = (low + high) / 2;
+      if (tokens.offset(middle) < offset) {
+        low = middle + 1;
       } else {
-        tag = TOKEN::XOR;
+        high = middle;
       }
-      AddToken(tag, start_position);
-      ConsumeToken();
-    } else if (curr == '_') {
-      HandleIdentifier(*this);
+    }
+    if (low == tokens.size() || tokens.offset(low) != offset) {
       continue;
-    } else if (curr == '`') {
-      /* TODO */
-    } else if (curr == '{') {
-      AddToken(TOKEN::LBRACE, start_position);
-      ConsumeChar();
-    } else if (curr == '|') {
-      if (PeekNextChar('=')) {
-        tag = TOKEN::OR_ASSIGN;
-      } else if (PeekNextChar('|')) {
-        tag = TOKEN::LOGICAL_OR;
-      } else {
-        tag = TOKEN::OR;
-      }
-      AddToken(tag, start_position);
-      ConsumeToken();
-    } else if (curr == '}') {
-      AddToken(TOKEN::RBRACE, start_position);
-      ConsumeChar();
-    } else if (curr == '~') {
-      AddToken(TOKEN::NOT, start_position);
-      ConsumeChar();
-    } else if ((curr >= 'a' && curr <= 'z') || (curr >= 'A' && curr <= 'Z')) {
-      HandleIdentifier(*this);
+    }
+    // In sync. The chunk's last token either starts in the next chunk, is
+    // FILE_EOF or is the last one before a speculative error; it is lexed
+    // again from its start so that it gets synced or checked as well.
+    uint32_t last = tokens.size() - 1;
+    if (low < last) {
+      AppendChunk(*chunks[chunk], low + 1, last);
+      _index = tokens.offset(last);
+    }
+  }
+  _reached_eof = true;
+  if (Trace::Global().enabled(TraceCategory::LEXER)) {
+    for (uint32_t i = first_token; i < _token_list.size(); ++i) {
+      TRACE(LEXER, _token_list[i] << '\n');
+    }
+  }
+  return true;
+}
+
+// Lexes tokens until one starts at or after `end`, or until the first
+// error. That last token is kept so the stitching knows where to resume.
+void Lexer::LexChunk(uint32_t end) {
+  _token_list.reserve((end - CurrentIndex()) / 2 + 1);
+  while (LexToken() && _token_list.back().offset() < end) {
+  }
+}
+
+void Lexer::AppendChunk(const Lexer &chunk, uint32_t begin, uint32_t end) {
+  auto &interner = _interner;
+  const TokenList &tokens = chunk._token_list;
+  for (uint32_t i = begin; i < end; ++i) {
+    Value value = tokens.value(i);
+    if (!value) {
+      _token_list.Add(tokens.tag(i), tokens.offset(i), tokens.length(i));
+    } else if (tokens.tag(i) == TOKEN::IDENTIFIER &&
+               value.get_atom() == Atom::NONE) {
+      auto atom =
+          interner.Intern(file_content() + tokens.offset(i), tokens.length(i));
+      _token_list.Add(TOKEN::IDENTIFIER, tokens.offset(i), tokens.length(i),
+                      Value(atom));
     } else {
-      if (isdigit(PeekCurrentChar())) {
-        HandleNumber(*this);
-        continue;
-      }
+      _token_list.Add(tokens.tag(i), tokens.offset(i), tokens.length(i),
+                      value);
     }
   }
 }
 
 void Lexer::PrintTokenList() const {
-  for (auto &token_ptr : _token_list) {
-    std::cout << "tag: " << Token::tag_to_string[token_ptr->tag()] << ", "
+  for (uint32_t i = 0; i < _token_list.size(); ++i) {
+    auto token = _token_list[i];
+    std::cout << "tag: " << Token::TagName(token.tag()) << ", "
               << "val: ";
-    if (token_ptr->tag() != TOKEN::FILE_EOF) {
-      if (token_ptr->value() == nullptr) {
-        std::cout << std::string(1, (char)(token_ptr->tag()));
+    if (token.tag() != TOKEN::FILE_EOF) {
+      if (!token.value()) {
+        std::cout << std::string(1, (char)(token.tag()));
       } else {
-        std::cout << *token_ptr->value();
+        std::cout << token.value();
       }
     }
-    std::cout << ", position: (" << token_ptr->position().row() << ", "
-              << token_ptr->position().column() << ")";
+    std::cout << ", position: (" << token.position().row() << ", "
+              << token.position().column() << ")";
     std::cout << std::endl;
   }
 }
 
+// Scans a whole preprocessing number: digits, '.', identifier characters
+// (hexadecimal digits, suffixes) and the sign of an exponent, so that
+// `1+2` is three tokens and `1e+2` is one. The C library does the
+// conversion, including the 0x and octal prefixes.
 bool HandleNumber(Lexer &lexer) {
-  bool has_signed = false;
+  uint32_t start = lexer.CurrentIndex();
+  const char *begin = lexer.CurrentPointer();
+  bool is_hex = begin[0] == '0' && (begin[1] == 'x' || begin[1] == 'X');
   bool is_integer = true;
-  unsigned base = 0x0;
-  (void)base;
-  unsigned int literal_start = lexer.CurrentIndex();
-  Position start_position = lexer.position();
-  unsigned int length = 0;
-  TOKEN tag = TOKEN::INTEGER_CONTANT;
-  while (true) {
-    char current_char = lexer.PeekCurrentChar();
-    switch (current_char) {
-    case '.':
+  const char *p = begin;
+  for (;; ++p) {
+    char c = *p;
+    if (c == '.') {
       is_integer = false;
-      tag = TOKEN::FLOATING_CONSTANT;
-      break;
-    case '0' ... '9':
-    case 'e':
-    case 'E':
-      break;
-    case '+':
-    case '-':
-      if (has_signed) {
-        /* TODO: handle error */
-        break;
-      } else {
-        has_signed = true;
-        break;
-      }
-    case '\0':
-    default:
-      std::string str_val = lexer.file_content().substr(literal_start, length);
-      if (is_integer) {
-        // TODO
-        auto ll = std::stoll(str_val);
-        auto val = std::make_unique<Value>(ll);
-        lexer.AddToken(tag, start_position, val);
-      } else {
-        auto db = std::stod(str_val);
-        auto val = std::make_unique<Value>(db);
-        lexer.AddToken(tag, start_position, val);
+    } else if ((!is_hex && (c == 'e' || c == 'E')) ||
+               (is_hex && (c == 'p' || c == 'P'))) {
+      is_integer = false;
+      if (p[1] == '+' || p[1] == '-') {
+        ++p;
       }
-      return true;
+    } else if (!IsIdentifierChar(c)) {
+      break;
     }
-    ++length;
-    lexer.ConsumeChar();
   }
-  return false;
+  lexer.ConsumeChars(p - begin);
+  if (is_integer) {
+    lexer.AddToken(TOKEN::INTEGER_CONTANT, start,
+                   Value(std::strtoll(begin, nullptr, 0)));
+  } else {
+    lexer.AddToken(TOKEN::FLOATING_CONSTANT, start,
+                   Value(std::strtod(begin, nullptr)));
+  }
+  return true;
 }
 
 bool HandleIdentifier(Lexer &lexer) {
   unsigned int identifier_start = lexer.CurrentIndex();
-  Position start_position = lexer.position();
-  unsigned int length = 0;
-  bool first = true;
-  TOKEN tag = TOKEN::IDENTIFIER;
-  while (true) {
-    char current_char = lexer.PeekCurrentChar();
-    switch (current_char) {
-    case 'a' ... 'z':
-    case 'A' ... 'Z':
-    case '_':
-      break;
-    case '0' ... '9':
-      if (first) {
-        return false;
-      }
-      break;
-    default:
-      std::string word = lexer.file_content().substr(identifier_start, length);
-      if (Token::string_to_tag.find(word) != Token::string_to_tag.end()) {
-        tag = Token::string_to_tag[word];
-      }
-      std::string str_val =
-          lexer.file_content().substr(identifier_start, length);
-      auto val = std::make_unique<Value>(str_val);
-      lexer.AddToken(tag, start_position, val);
-      return true;
+  uint32_t start = lexer.CurrentIndex();
+  // Identifiers never span lines, so only the column moves.
+  const char *end = scan_kernels.identifier_end(lexer.CurrentPointer());
+  unsigned int length = end - lexer.CurrentPointer();
+  lexer.ConsumeChars(length);
+  // Keywords are pre-interned, so one lookup both interns the word and
+  // classifies it.
+  auto &interner = lexer._interner;
+  const char *spelling = lexer.file_content() + identifier_start;
+  // Other chunks are lexed at the same time, so a speculative lexer leaves
+  // new spellings as Atom::NONE for AppendChunk to intern in token order.
+  auto atom = lexer._speculative ? interner.Find(spelling, length)
+                                 : interner.Intern(spelling, length);
+  TOKEN tag = interner.tag(atom);
+  lexer.AddToken(tag, start, Value(atom));
+  return true;
+}
+
+bool HandlePunctuator(Lexer &lexer) {
+  uint32_t start = lexer.CurrentIndex();
+  const char *p = lexer.CurrentPointer();
+  auto range = PUNCTUATOR_RANGES[static_cast<unsigned char>(*p)];
+  for (auto i = range.begin; i < range.end; ++i) {
+    auto &punctuator = PUNCTUATORS[i];
+    // The first character matched through the range already; the '\0'
+    // sentinel stops the comparison at the end of the buffer.
+    unsigned length = 1;
+    while (punctuator.spelling[length] != '\0' &&
+           punctuator.spelling[length] == p[length]) {
+      ++length;
     }
-    ++length;
-    lexer.ConsumeChar();
-    if (first) {
-      first = false;
+    if (punctuator.spelling[length] == '\0') {
+      lexer.ConsumeChars(length);
+      lexer.AddToken(punctuator.tag, start);
+      return true;
     }
   }
   return false;
 }
 
+// The value is the text between the quotes; escape sequences are kept as
+// written, but an escaped '"' does not end the literal.
+bool HandleStringLiteral(Lexer &lexer) {
+  uint32_t start = lexer.CurrentIndex();
+  lexer.ConsumeChar();
+  unsigned literal_start = lexer.CurrentIndex();
+  const char *end = lexer.CurrentPointer();
+  for (;;) {
+    end = scan_kernels.string_end(end);
+    auto backslash = end;
+    while (backslash > lexer.CurrentPointer() && backslash[-1] == '\\') {
+      --backslash;
+    }
+    if (*end == '\0' || (end - backslash) % 2 == 0) {
+      break;
+    }
+    ++end;
+  }
+  lexer.ConsumeTo(end);
+  Value string_value(lexer.file_content() + literal_start,
+                     lexer.CurrentIndex() - literal_start);
+  if (lexer.PeekCurrentChar('\0')) {
+    return lexer.Fail("Unterminated string literal at " +
+                      lexer.Location(start) + ".");
+  }
+  lexer.ConsumeChar();
+  lexer.AddToken(TOKEN::STRING_LITERAL, start, string_value);
+  return true;
+}
+
 char stoc(const std::string &str) {
   if (str[0] != '\\') {
     assert(str.size() == 1);
@@ -440,18 +454,25 @@ char stoc(const std::string &str) {
 }
 
 bool HandleCharLiteral(Lexer &lexer) {
-  Position start_position = lexer.position();
+  uint32_t start = lexer.CurrentIndex();
   unsigned length = 0;
   lexer.ConsumeChar();
   unsigned literal_start = lexer.CurrentIndex();
   while ((!lexer.PeekCurrentChar('\0')) && (!lexer.PeekCurrentChar('\''))) {
+    if (lexer.PeekCurrentChar('\\') && !lexer.PeekNextChar('\0')) {
+      lexer.ConsumeChar();
+      ++length;
+    }
     lexer.ConsumeChar();
     ++length;
   }
-  std::string str_val = lexer.file_content().substr(literal_start, length);
-  auto val = std::make_unique<Value>(str_val);
-  lexer.AddToken(TOKEN::CHARACTER_CONSTANT, start_position, val);
+  Value char_value(lexer.file_content() + literal_start, length);
+  if (lexer.PeekCurrentChar('\0')) {
+    return lexer.Fail("Unterminated character constant at " +
+                      lexer.Location(start) + ".");
+  }
   lexer.ConsumeChar();
+  lexer.AddToken(TOKEN::CHARACTER_CONSTANT, start, char_value);
   return true;
 }
 
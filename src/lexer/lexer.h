@@ -1,8 +1,13 @@
 #ifndef YYQC_SRC_SCANNER_H_
 #define YYQC_SRC_SCANNER_H_
+#include "../error/error.h"
 #include "../public/position.h"
+#include "../util/thread_pool.h"
+#include "../util/trace.h"
+#include "scan.h"
+#include "source_buffer.h"
 #include "token.h"
-#include <fstream>
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -12,81 +17,155 @@ class Lexer {
   friend bool HandleNumber(Lexer &);
   friend bool HandleIdentifier(Lexer &);
   friend bool HandleCharLiteral(Lexer &);
+  friend bool HandleStringLiteral(Lexer &);
+  friend bool HandlePunctuator(Lexer &);
 
 public:
-  typedef std::vector<std::shared_ptr<Token>> TokenList;
-  std::shared_ptr<Token> PeekCurrentToken() const {
-    return _token_list[_current_token_index];
-  }
-  std::shared_ptr<Token> PeekNextToken() const {
-    return _token_list[_current_token_index + 1];
-  }
-  std::shared_ptr<Token> ConsumeToken() { return _token_list[_current_token_index++]; }
+  Token PeekCurrentToken() { return TokenAt(_current_token_index); }
+  Token PeekNextToken() { return TokenAt(_current_token_index + 1); }
+  Token ConsumeToken() { return TokenAt(_current_token_index++); }
+  // Lexes whatever is left of the file.
   bool Tokenize();
+  // Lexes whatever is left of the file on `pool`, in chunks of at least
+  // min_chunk_size bytes. The token list is identical to Tokenize()'s.
+  bool Tokenize(ThreadPool &pool, size_t min_chunk_size = MIN_CHUNK_SIZE);
+  bool LexToken();
   void PrintTokenList() const;
   void PrintPosition() const {
     std::cout << "(" << position().row() << ", " << position().column() << ")";
   }
   unsigned ScreenShot() { return _current_token_index; }
-  void PutBack(unsigned screenshot) { _current_token_index = screenshot; }
+  void PutBack(unsigned screenshot) {
+    if (screenshot < _current_token_index) {
+      _rewound_tokens += _current_token_index - screenshot;
+    }
+    _current_token_index = screenshot;
+  }
+  // Tokens handed out again because of PutBack. The parser decides every
+  // alternative from lookahead, so this stays 0 on well-formed input.
+  uint64_t rewound_tokens() const { return _rewound_tokens; }
+
+  static constexpr size_t MIN_CHUNK_SIZE = 256 * 1024;
 
 private:
-  Position _position;
+  // Offset of the next character; rows and columns are only worked out
+  // when a diagnostic needs them.
+  uint32_t _index = 0;
   TokenList _token_list;
   const std::string _file_name;
   unsigned int _current_token_index = 0;
-  std::string *_file_content_ptr;
+  uint64_t _rewound_tokens = 0;
+  bool _reached_eof = false;
+  std::shared_ptr<const SourceBuffer> _source;
+  // A speculative lexer lexes one chunk of a parallel Tokenize. It may have
+  // started inside a comment or a literal, so errors stop it instead of
+  // being reported, and identifiers are only looked up, not interned.
+  bool _speculative = false;
+  // That of the thread that made the lexer, which the chunks of a parallel
+  // Tokenize look identifiers up in from the pool's threads.
+  Interner &_interner = Interner::ForThread();
+  // Reports the error, or just stops a speculative lexer. Returns false so
+  // handlers can `return Fail(...)`.
+  bool Fail(const std::string &message);
+  void LexChunk(uint32_t end);
+  void AppendChunk(const Lexer &chunk, uint32_t begin, uint32_t end);
+  // "row:column" of an offset, for error messages.
+  std::string Location(uint32_t offset) const;
   bool OpenFile(const std::string &);
-  const std::string &file_content() const { return *_file_content_ptr; }
-  unsigned int CurrentIndex() { return _position.index(); }
+  void Start(bool tokenized) {
+    // Dense code runs close to one token per three bytes. Over-reserving is
+    // cheap: pages of the columns that are never written are never touched.
+    _token_list.reserve(_source->size() / 2 + 1);
+    _token_list.set_source(_source.get());
+    if (tokenized) {
+      Tokenize();
+    }
+  }
+  const char *file_content() const { return _source->data(); }
+  unsigned int CurrentIndex() const { return _index; }
   const char &file_content(const unsigned int i) const {
     return file_content()[i];
   }
+  std::string file_content(unsigned int start, unsigned int length) const {
+    return std::string(file_content() + start, length);
+  }
   const char &PeekCurrentChar() const {
-    return file_content(_position.index());
+    return file_content(_index);
   }
   bool PeekCurrentChar(const char ch) const { return PeekCurrentChar() == ch; }
   const char &PeekNextChar() const {
-    return file_content(_position.index() + 1);
+    return file_content(_index + 1);
   }
   bool PeekNextChar(const char ch) const { return PeekNextChar() == ch; }
   const char &PeekForward(int forward) const {
-    return file_content(_position.index() + forward);
-  }
-  const char &ConsumeChar() {
-    const char &current = file_content(_position.index());
-    if (current != '\n') {
-      _position.NextColumn();
-    } else {
-      _position.NewLine(_position.index() + 1);
-    }
-    return current;
+    return file_content(_index + forward);
   }
-  void ConsumeChars(unsigned int number) {
-    for (unsigned i = 0; i < number; ++i) {
-      ConsumeChar();
+  const char &ConsumeChar() { return file_content(_index++); }
+  void ConsumeChars(unsigned int number) { _index += number; }
+  // In streaming mode a token is lexed the first time the parser looks at
+  // it, so the lexer never runs further ahead than the parser's lookahead.
+  // Indices past the end all refer to the FILE_EOF token.
+  Token TokenAt(uint32_t index) {
+    while (index >= _token_list.size() && !_reached_eof) {
+      _reached_eof = !LexNext();
     }
+    return _token_list[std::min(index, _token_list.size() - 1)];
   }
+  // LexToken for the serial paths, which may trace what they lex.
+  bool LexNext() {
+    bool more = LexToken();
+    TRACE(LEXER, _token_list.back() << '\n');
+    return more;
+  }
+  const char *CurrentPointer() const { return file_content() + CurrentIndex(); }
+  // Jumps over a whole run found by a scan kernel.
+  void ConsumeTo(const char *end) { _index = end - file_content(); }
 
-  void AddToken(const TOKEN tag, const Position &position) {
-    auto token = std::make_shared<Token>(tag, position);
-    _token_list.push_back(token);
+  // The token runs from `start` up to the current index.
+  void AddToken(const TOKEN tag, uint32_t start) {
+    _token_list.Add(tag, start, CurrentIndex() - start);
   }
-  void AddToken(const TOKEN tag, const Position &position,
-                std::unique_ptr<Value> &value) {
-    auto token = std::make_shared<Token>(tag, position, value);
-    _token_list.push_back(token);
+  void AddToken(const TOKEN tag, uint32_t start, const Value &value) {
+    _token_list.Add(tag, start, CurrentIndex() - start, value);
   }
 
 public:
+  // With tokenized = false the lexer streams: nothing is lexed up front,
+  // and tokens are produced on demand by PeekCurrentToken, PeekNextToken and
+  // ConsumeToken.
   Lexer(const std::string path, bool tokenized = true) : _file_name(path) {
-    (void)tokenized;
     if (!OpenFile(_file_name)) {
-      // TODO: handle failure of opening file.
+      Error("Cannot open file: " + _file_name);
     }
-    Tokenize();
+    Start(tokenized);
+  }
+  // Lexes a source that is already loaded; `path` only names it.
+  Lexer(std::shared_ptr<const SourceBuffer> source, const std::string path,
+        bool tokenized = true)
+      : _file_name(path), _source(std::move(source)) {
+    Start(tokenized);
+  }
+  // Takes over the tokens of an earlier lexing of the same bytes, such as
+  // an AST cache keeps. There is nothing left to lex.
+  Lexer(std::shared_ptr<const SourceBuffer> source, const std::string path,
+        TokenList tokens)
+      : _index(source->size()), _token_list(std::move(tokens)),
+        _file_name(path), _reached_eof(true), _source(std::move(source)) {
+    _token_list.set_source(_source.get());
+  }
+
+private:
+  // Lexes a chunk of `source` starting at `start`.
+  Lexer(std::shared_ptr<const SourceBuffer> source, uint32_t start)
+      : _index(start), _source(std::move(source)), _speculative(true) {
+    _token_list.set_source(_source.get());
   }
-  const Position &position() const { return _position; }
+
+public:
+  Position position() const { return _source->position(_index); }
+  const SourceBuffer &source() const { return *_source; }
+  const TokenList &token_list() const { return _token_list; }
+  const std::string &file_name() const { return _file_name; }
 };
 
 #endif
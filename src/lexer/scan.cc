@@ -0,0 +1,295 @@
+#include "scan.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define YYQC_SCAN_X86
+#endif
+
+namespace {
+
+inline bool IsIdentifierChar(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '_';
+}
+
+const char *ScalarBlanks(const char *p) {
+  while (*p == ' ' || *p == '\t' || *p == '\n') {
+    ++p;
+  }
+  return p;
+}
+
+const char *ScalarLineEnd(const char *p) {
+  while (*p != '\n' && *p != '\0') {
+    ++p;
+  }
+  return p;
+}
+
+const char *ScalarBlockCommentEnd(const char *p) {
+  while (*p != '\0' && !(p[0] == '*' && p[1] == '/')) {
+    ++p;
+  }
+  return p;
+}
+
+const char *ScalarStringEnd(const char *p) {
+  while (*p != '"' && *p != '\0') {
+    ++p;
+  }
+  return p;
+}
+
+const char *ScalarIdentifierEnd(const char *p) {
+  while (IsIdentifierChar(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+size_t ScalarCountNewlines(const char *begin, const char *end,
+                           const char **last) {
+  size_t count = 0;
+  for (auto p = begin; p < end; ++p) {
+    if (*p == '\n') {
+      ++count;
+      *last = p;
+    }
+  }
+  return count;
+}
+
+#ifdef YYQC_SCAN_X86
+
+// Bytes of x in ['lo', 'hi']: shift the range to the bottom of the signed
+// byte range, where a single signed compare tests it.
+inline __m128i InRange16(__m128i x, char lo, char hi) {
+  auto shifted = _mm_add_epi8(x, _mm_set1_epi8((char)(0x80 - lo)));
+  return _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(0x80 + hi - lo + 1)));
+}
+
+inline __m128i IdentifierMask16(__m128i x) {
+  auto lower = _mm_or_si128(x, _mm_set1_epi8(0x20));
+  auto mask = InRange16(lower, 'a', 'z');
+  mask = _mm_or_si128(mask, InRange16(x, '0', '9'));
+  return _mm_or_si128(mask, _mm_cmpeq_epi8(x, _mm_set1_epi8('_')));
+}
+
+inline __m128i Load16(const char *p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+inline unsigned Mask16(__m128i x) { return _mm_movemask_epi8(x); }
+
+const char *SSE2Blanks(const char *p) {
+  for (;; p += 16) {
+    auto x = Load16(p);
+    auto blank = _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')),
+                              _mm_cmpeq_epi8(x, _mm_set1_epi8('\t')));
+    blank = _mm_or_si128(blank, _mm_cmpeq_epi8(x, _mm_set1_epi8('\n')));
+    unsigned stop = ~Mask16(blank) & 0xffff;
+    if (stop != 0) {
+      return p + __builtin_ctz(stop);
+    }
+  }
+}
+
+const char *SSE2LineEnd(const char *p) {
+  for (;; p += 16) {
+    auto x = Load16(p);
+    auto stop = _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\n')),
+                             _mm_cmpeq_epi8(x, _mm_setzero_si128()));
+    if (unsigned mask = Mask16(stop)) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+}
+
+const char *SSE2BlockCommentEnd(const char *p) {
+  for (;; p += 16) {
+    auto x = Load16(p);
+    auto next = Load16(p + 1);
+    auto close = _mm_and_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('*')),
+                               _mm_cmpeq_epi8(next, _mm_set1_epi8('/')));
+    auto stop = _mm_or_si128(close, _mm_cmpeq_epi8(x, _mm_setzero_si128()));
+    if (unsigned mask = Mask16(stop)) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+}
+
+const char *SSE2StringEnd(const char *p) {
+  for (;; p += 16) {
+    auto x = Load16(p);
+    auto stop = _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('"')),
+                             _mm_cmpeq_epi8(x, _mm_setzero_si128()));
+    if (unsigned mask = Mask16(stop)) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+}
+
+const char *SSE2IdentifierEnd(const char *p) {
+  // Most identifiers are short: settle them without touching vectors.
+  for (int i = 0; i < 8; ++i, ++p) {
+    if (!IsIdentifierChar(*p)) {
+      return p;
+    }
+  }
+  for (;; p += 16) {
+    unsigned stop = ~Mask16(IdentifierMask16(Load16(p))) & 0xffff;
+    if (stop != 0) {
+      return p + __builtin_ctz(stop);
+    }
+  }
+}
+
+size_t SSE2CountNewlines(const char *begin, const char *end,
+                         const char **last) {
+  size_t count = 0;
+  auto p = begin;
+  for (; p + 16 <= end; p += 16) {
+    unsigned mask = Mask16(_mm_cmpeq_epi8(Load16(p), _mm_set1_epi8('\n')));
+    if (mask != 0) {
+      count += __builtin_popcount(mask);
+      *last = p + 31 - __builtin_clz(mask);
+    }
+  }
+  return count + ScalarCountNewlines(p, end, last);
+}
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 inline __m256i Load32(const char *p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+
+AVX2 inline unsigned Mask32(__m256i x) { return _mm256_movemask_epi8(x); }
+
+AVX2 inline __m256i InRange32(__m256i x, char lo, char hi) {
+  auto shifted = _mm256_add_epi8(x, _mm256_set1_epi8((char)(0x80 - lo)));
+  return _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(0x80 + hi - lo + 1)),
+                           shifted);
+}
+
+AVX2 const char *AVX2Blanks(const char *p) {
+  for (;; p += 32) {
+    auto x = Load32(p);
+    auto blank = _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')),
+                                 _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\t')));
+    blank = _mm256_or_si256(blank, _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n')));
+    unsigned stop = ~Mask32(blank);
+    if (stop != 0) {
+      return p + __builtin_ctz(stop);
+    }
+  }
+}
+
+AVX2 const char *AVX2LineEnd(const char *p) {
+  for (;; p += 32) {
+    auto x = Load32(p);
+    auto stop = _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n')),
+                                _mm256_cmpeq_epi8(x, _mm256_setzero_si256()));
+    if (unsigned mask = Mask32(stop)) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+}
+
+AVX2 const char *AVX2BlockCommentEnd(const char *p) {
+  for (;; p += 32) {
+    auto x = Load32(p);
+    auto next = Load32(p + 1);
+    auto close =
+        _mm256_and_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('*')),
+                         _mm256_cmpeq_epi8(next, _mm256_set1_epi8('/')));
+    auto stop =
+        _mm256_or_si256(close, _mm256_cmpeq_epi8(x, _mm256_setzero_si256()));
+    if (unsigned mask = Mask32(stop)) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+}
+
+AVX2 const char *AVX2StringEnd(const char *p) {
+  for (;; p += 32) {
+    auto x = Load32(p);
+    auto stop = _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('"')),
+                                _mm256_cmpeq_epi8(x, _mm256_setzero_si256()));
+    if (unsigned mask = Mask32(stop)) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+}
+
+AVX2 const char *AVX2IdentifierEnd(const char *p) {
+  for (int i = 0; i < 8; ++i, ++p) {
+    if (!IsIdentifierChar(*p)) {
+      return p;
+    }
+  }
+  for (;; p += 32) {
+    auto x = Load32(p);
+    auto lower = _mm256_or_si256(x, _mm256_set1_epi8(0x20));
+    auto mask = InRange32(lower, 'a', 'z');
+    mask = _mm256_or_si256(mask, InRange32(x, '0', '9'));
+    mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(x, _mm256_set1_epi8('_')));
+    unsigned stop = ~Mask32(mask);
+    if (stop != 0) {
+      return p + __builtin_ctz(stop);
+    }
+  }
+}
+
+AVX2 size_t AVX2CountNewlines(const char *begin, const char *end,
+                              const char **last) {
+  size_t count = 0;
+  auto p = begin;
+  for (; p + 32 <= end; p += 32) {
+    unsigned mask =
+        Mask32(_mm256_cmpeq_epi8(Load32(p), _mm256_set1_epi8('\n')));
+    if (mask != 0) {
+      count += __builtin_popcount(mask);
+      *last = p + 31 - __builtin_clz(mask);
+    }
+  }
+  return count + SSE2CountNewlines(p, end, last);
+}
+
+#undef AVX2
+
+const ScanKernels SSE2_KERNELS = {
+    "sse2",        SSE2Blanks,        SSE2LineEnd,       SSE2BlockCommentEnd,
+    SSE2StringEnd, SSE2IdentifierEnd, SSE2CountNewlines,
+};
+
+const ScanKernels AVX2_KERNELS = {
+    "avx2",        AVX2Blanks,        AVX2LineEnd,       AVX2BlockCommentEnd,
+    AVX2StringEnd, AVX2IdentifierEnd, AVX2CountNewlines,
+};
+
+#endif // YYQC_SCAN_X86
+
+const ScanKernels SCALAR_KERNELS = {
+    "scalar",        ScalarBlanks,        ScalarLineEnd,
+    ScalarBlockCommentEnd, ScalarStringEnd, ScalarIdentifierEnd,
+    ScalarCountNewlines,
+};
+
+const ScanKernels &SelectScanKernels() {
+#ifdef YYQC_SCAN_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return AVX2_KERNELS;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return SSE2_KERNELS;
+  }
+#endif
+  return SCALAR_KERNELS;
+}
+
+} // namespace
+
+const ScanKernels &scan_kernels = SelectScanKernels();
+
+const ScanKernels &ScalarScanKernels() { return SCALAR_KERNELS; }
@@ -0,0 +1,36 @@
+#ifndef YYQC_SRC_SCAN_H_
+#define YYQC_SRC_SCAN_H_
+#include <cstddef>
+
+/**
+ * Scanning kernels for the long runs the lexer sees most: blanks, comments,
+ * string literal bodies and identifiers. Each kernel returns a pointer to
+ * the first character that ends the run, and never goes past the first
+ * '\0'. The vector versions look at 16 (SSE2) or 32 (AVX2) bytes at a time
+ * and may read up to 33 bytes past the returned position; the
+ * SourceBuffer::SENTINEL_SIZE tail of '\0's makes that safe.
+ *
+ * The best implementation for the running CPU is picked once at start-up,
+ * with a scalar fallback for other targets.
+ */
+struct ScanKernels {
+  const char *name;
+  // First character that is not ' ', '\t' or '\n'.
+  const char *(*blanks)(const char *p);
+  // First '\n' or '\0'.
+  const char *(*line_end)(const char *p);
+  // The '*' of the first "*/", or the first '\0'.
+  const char *(*block_comment_end)(const char *p);
+  // First '"' or '\0'.
+  const char *(*string_end)(const char *p);
+  // First character that is not in [A-Za-z0-9_].
+  const char *(*identifier_end)(const char *p);
+  // Number of '\n' in [begin, end); *last is set to the last one, if any.
+  size_t (*count_newlines)(const char *begin, const char *end,
+                           const char **last);
+};
+
+extern const ScanKernels &scan_kernels;
+const ScanKernels &ScalarScanKernels();
+
+#endif
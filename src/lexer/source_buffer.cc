@@ -0,0 +1,139 @@
+#include "source_buffer.h"
+#include "scan.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::unique_ptr<SourceBuffer> SourceBuffer::Open(const std::string &path) {
+  auto start = std::chrono::steady_clock::now();
+  std::unique_ptr<SourceBuffer> buffer(new SourceBuffer());
+  bool from_stdin = path == "-";
+  int fd = from_stdin ? STDIN_FILENO : open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat st;
+  bool success = false;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    success = buffer->Map(fd, st.st_size);
+  }
+  if (!success) {
+    // Pipes, devices, empty files or a failed mmap.
+    success = buffer->Read(fd);
+  }
+  if (!from_stdin) {
+    close(fd);
+  }
+  if (!success) {
+    return nullptr;
+  }
+  auto end = std::chrono::steady_clock::now();
+  buffer->_load_time =
+      std::chrono::duration<double, std::milli>(end - start).count();
+  return buffer;
+}
+
+std::unique_ptr<SourceBuffer> SourceBuffer::FromText(std::string_view text) {
+  std::unique_ptr<SourceBuffer> buffer(new SourceBuffer());
+  std::unique_ptr<char[]> data(new char[text.size() + SENTINEL_SIZE]);
+  std::memcpy(data.get(), text.data(), text.size());
+  std::memset(data.get() + text.size(), '\0', SENTINEL_SIZE);
+  buffer->_heap_buffer = std::move(data);
+  buffer->_data = buffer->_heap_buffer.get();
+  buffer->_size = text.size();
+  return buffer;
+}
+
+SourceBuffer::~SourceBuffer() {
+  if (_mapping != nullptr) {
+    munmap(_mapping, _mapping_size);
+  }
+}
+
+bool SourceBuffer::Map(int fd, size_t size) {
+  const size_t page = sysconf(_SC_PAGESIZE);
+  const size_t file_pages = (size + page - 1) / page * page;
+  const size_t total = (size + SENTINEL_SIZE + page - 1) / page * page;
+  void *region =
+      mmap(nullptr, total, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (region == MAP_FAILED) {
+    return false;
+  }
+  // Replace the head of the zero-filled reservation with the file itself.
+  void *file =
+      mmap(region, file_pages, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+  if (file == MAP_FAILED) {
+    munmap(region, total);
+    return false;
+  }
+  madvise(region, file_pages, MADV_SEQUENTIAL);
+  _mapping = region;
+  _mapping_size = total;
+  _data = static_cast<const char *>(region);
+  _size = size;
+  return true;
+}
+
+bool SourceBuffer::Read(int fd) {
+  size_t capacity = 64 * 1024;
+  size_t size = 0;
+  std::unique_ptr<char[]> buffer(new char[capacity + SENTINEL_SIZE]);
+  while (true) {
+    if (size == capacity) {
+      std::unique_ptr<char[]> grown(new char[capacity * 2 + SENTINEL_SIZE]);
+      std::memcpy(grown.get(), buffer.get(), size);
+      buffer = std::move(grown);
+      capacity *= 2;
+    }
+    ssize_t n = read(fd, buffer.get() + size, capacity - size);
+    if (n == 0) {
+      break;
+    }
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    size += n;
+  }
+  std::memset(buffer.get() + size, '\0', SENTINEL_SIZE);
+  _heap_buffer = std::move(buffer);
+  _data = _heap_buffer.get();
+  _size = size;
+  return true;
+}
+
+Position SourceBuffer::position(uint32_t offset) const {
+  std::call_once(_line_table_built, [this] { BuildLineTable(); });
+  auto line = std::upper_bound(_line_starts.begin(), _line_starts.end(),
+                               offset) -
+              1;
+  unsigned row = line - _line_starts.begin() + 1;
+  return Position(offset, *line, row, offset - *line + 1);
+}
+
+// The vectorized newline count sizes the table exactly; memchr then finds
+// each newline.
+void SourceBuffer::BuildLineTable() const {
+  const char *end = _data + _size;
+  const char *last;
+  _line_starts.reserve(scan_kernels.count_newlines(_data, end, &last) + 1);
+  _line_starts.push_back(0);
+  for (const char *p = _data;
+       (p = static_cast<const char *>(std::memchr(p, '\n', end - p)));) {
+    ++p;
+    _line_starts.push_back(p - _data);
+  }
+}
+
+void SourceBuffer::PrintStatistics(std::ostream &os) const {
+  os << "Source: " << _size << " bytes, "
+     << (mapped() ? "mapped " : "read ") << (mapped() ? _mapping_size : _size)
+     << " bytes in " << _load_time << " ms" << std::endl;
+}
@@ -0,0 +1,68 @@
+#ifndef YYQC_SRC_SOURCE_BUFFER_H_
+#define YYQC_SRC_SOURCE_BUFFER_H_
+#include "../public/position.h"
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Read-only view of a whole source file followed by at least SENTINEL_SIZE
+ * '\0' bytes, so the lexer may peek forward without bound checks.
+ *
+ * Regular files are mapped with mmap(2): an anonymous zero-filled region is
+ * reserved first and the file is mapped over its head, which leaves the tail
+ * of the last file page and the pages after it filled with zeros. Pipes,
+ * character devices and stdin ("-") cannot be mapped; they are read once
+ * into a heap buffer that already has room for the sentinel tail.
+ *
+ * Tokens only record byte offsets. Rows and columns are resolved on demand
+ * through a table of line starts, which is built the first time a position
+ * is asked for.
+ */
+class SourceBuffer {
+public:
+  static constexpr size_t SENTINEL_SIZE = 64;
+
+  // Returns nullptr if the file cannot be opened or read.
+  static std::unique_ptr<SourceBuffer> Open(const std::string &path);
+  // A copy of `text`, for sources that are made rather than read, such as
+  // the spelling of a pasted token.
+  static std::unique_ptr<SourceBuffer> FromText(std::string_view text);
+  ~SourceBuffer();
+  SourceBuffer(const SourceBuffer &) = delete;
+  SourceBuffer &operator=(const SourceBuffer &) = delete;
+
+  const char *data() const { return _data; }
+  // Size of the file content, not including the sentinel tail.
+  size_t size() const { return _size; }
+  bool mapped() const { return _mapping_size != 0; }
+  size_t bytes_mapped() const { return _mapping_size; }
+  // Wall time spent opening and mapping (or reading) the file, in ms.
+  double load_time() const { return _load_time; }
+  // Row and column of a byte offset. Safe to call from several threads.
+  Position position(uint32_t offset) const;
+  void PrintStatistics(std::ostream &os) const;
+
+private:
+  SourceBuffer() = default;
+  bool Map(int fd, size_t size);
+  bool Read(int fd);
+  void BuildLineTable() const;
+
+  const char *_data = nullptr;
+  size_t _size = 0;
+  void *_mapping = nullptr;
+  size_t _mapping_size = 0;
+  std::unique_ptr<char[]> _heap_buffer;
+  double _load_time = 0.0;
+  // Offset of the first byte of every line, in order.
+  mutable std::vector<uint32_t> _line_starts;
+  mutable std::once_flag _line_table_built;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#include "../lexer.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+using namespace std;
+
+static atomic<size_t> allocations(0);
+
+void *operator new(size_t size) {
+  ++allocations;
+  if (void *p = malloc(size ? size : 1)) {
+    return p;
+  }
+  throw bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+// Long string literals, which used to need a heap buffer each, next to the
+// usual mix of identifiers, keywords, numbers and punctuators. Identifier
+// spellings repeat, so the interner stops growing early.
+static void WriteCorpus(const string &path, int functions) {
+  ofstream out(path);
+  char line[256];
+  for (int i = 0; i < functions; ++i) {
+    snprintf(line, sizeof(line),
+             "static long f_%d(struct node *p, int n) {\n"
+             "  char *s = \"a string literal well past the SSO limit\";\n"
+             "  double d = 1.5e3 * n; long v = 0x%x + 'c';\n",
+             i % 100, i);
+    out << line;
+    out << "  return p->next ? v << 2 : (long)d;\n}\n";
+  }
+}
+
+int main(int argc, char **argv) {
+  string path = argc > 1 ? argv[1] : "alloc_input.c";
+  if (argc <= 1) {
+    WriteCorpus(path, 40000);
+  }
+  // The token columns are reserved when the lexer is constructed.
+  Lexer lexer(path, false);
+  size_t before = allocations;
+  lexer.Tokenize();
+  size_t during = allocations - before;
+  double tokens = lexer.token_list().size();
+  double per_million = during / tokens * 1e6;
+  cout << path << ": " << tokens << " tokens, " << during
+       << " allocations while lexing, " << per_million
+       << " per 1M tokens" << endl;
+  // Whatever is left comes from the interner growing, not from tokens.
+  if (per_million > 100) {
+    cout << "FAILED: lexing allocates per token" << endl;
+    return 1;
+  }
+  cout << "ok" << endl;
+  return 0;
+}
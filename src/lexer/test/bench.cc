@@ -0,0 +1,79 @@
+#include "../lexer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+using namespace std;
+
+// Writes a synthetic translation unit that mixes the token kinds of typical
+// C code: keywords, identifiers, multi-character operators, numbers, string
+// literals and comments.
+static void WriteCorpus(const string &path, int functions) {
+  ofstream out(path);
+  char line[256];
+  for (int i = 0; i < functions; ++i) {
+    snprintf(line, sizeof(line),
+             "/* Function %d of the benchmark corpus. */\n"
+             "static unsigned long func_%d(struct node *p, int n, ...) {\n",
+             i, i);
+    out << line;
+    snprintf(line, sizeof(line),
+             "  unsigned long sum_%d = 0; double ratio = 0.5e3;\n"
+             "  for (int i = 0; i < n; ++i) {\n",
+             i);
+    out << line;
+    snprintf(line, sizeof(line),
+             "    sum_%d += p->values[i] * 3 - (i << 2) + (i >> 1);\n"
+             "    sum_%d <<= 1; sum_%d >>= 2; sum_%d %%= 7;\n",
+             i, i, i, i);
+    out << line;
+    snprintf(line, sizeof(line),
+             "    if (sum_%d >= 1000 && p->next != 0) { p = p->next; }\n"
+             "    else { p->name = \"node %d\"; --n; }\n",
+             i, i);
+    out << line;
+    out << "    // Keep walking.\n"
+           "    ratio *= 1.25; p->tag = 'a';\n"
+           "  }\n"
+           "  return sum_"
+        << i << " ? sum_" << i << " : -1;\n}\n\n";
+  }
+}
+
+int main(int argc, char **argv) {
+  string path = argc > 1 ? argv[1] : "bench_input.c";
+  if (argc <= 1) {
+    WriteCorpus(path, 20000);
+  }
+  const int rounds = 10;
+  double best = 1e30;
+  size_t tokens = 0, bytes = 0;
+  for (int round = 0; round < rounds; ++round) {
+    auto start = chrono::steady_clock::now();
+    Lexer lexer(path);
+    auto end = chrono::steady_clock::now();
+    best = min(best, chrono::duration<double>(end - start).count());
+    tokens = lexer.token_list().size();
+    bytes = lexer.source().size();
+  }
+  cout << path << ": " << tokens << " tokens, " << bytes << " bytes" << endl;
+  cout << "best of " << rounds << ": " << best * 1e3 << " ms, "
+       << tokens / best / 1e6 << " M tokens/s, " << bytes / best / 1e6
+       << " MB/s" << endl;
+  unsigned threads = max(2u, thread::hardware_concurrency());
+  ThreadPool pool(threads);
+  best = 1e30;
+  for (int round = 0; round < rounds; ++round) {
+    auto start = chrono::steady_clock::now();
+    Lexer lexer(path, false);
+    lexer.Tokenize(pool);
+    auto end = chrono::steady_clock::now();
+    best = min(best, chrono::duration<double>(end - start).count());
+  }
+  cout << threads << " threads, best of " << rounds << ": " << best * 1e3
+       << " ms, " << tokens / best / 1e6 << " M tokens/s" << endl;
+  return 0;
+}
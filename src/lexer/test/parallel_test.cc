@@ -0,0 +1,106 @@
+#include "../lexer.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+using namespace std;
+
+// Writes a corpus that makes chunk cuts land inside block comments, string
+// literals and character constants, next to ordinary code.
+static void WriteCorpus(const string &path, int functions) {
+  ofstream out(path);
+  char line[256];
+  for (int i = 0; i < functions; ++i) {
+    snprintf(line, sizeof(line),
+             "/* Function %d.\n   \"Not a string\", 'nor a char'\n"
+             "   int not_code = 1; // */\n",
+             i);
+    out << line;
+    for (int j = 0; j < i % 7; ++j) {
+      out << " * padding line " << j << " with /* and \" inside\n";
+    }
+    out << " */\n";
+    snprintf(line, sizeof(line),
+             "static long func_%d(struct node *p, int n) {\n"
+             "  char *s = \"/* not a comment %d */ \\\" // still a string\";\n",
+             i, i);
+    out << line;
+    snprintf(line, sizeof(line),
+             "  char c = '\\''; long v_%d = 0x%x + .5e-3 + 07;\n"
+             "  v_%d <<= 1; v_%d >>= 2; // trailing /* comment\n",
+             i, i, i, i);
+    out << line;
+    out << "  return v_" << i << " ? p->n : -1;\n}\n\n";
+  }
+}
+
+static string Dump(const TokenList &tokens) {
+  ostringstream os;
+  for (uint32_t i = 0; i < tokens.size(); ++i) {
+    auto token = tokens[i];
+    auto position = token.position();
+    os << static_cast<int>(token.tag()) << ' ' << token.offset() << ' '
+       << token.length() << ' ' << position.index() << ' '
+       << position.line_head() << ' ' << position.row() << ' '
+       << position.column();
+    if (token.value()) {
+      os << ' ' << token.value();
+      if (token.tag() == TOKEN::IDENTIFIER || token.IsKeyword()) {
+        os << " #" << static_cast<uint32_t>(token.value().get_atom());
+      }
+    }
+    os << '\n';
+  }
+  return os.str();
+}
+
+// Lexes `path` serially and in parallel with several thread counts and
+// chunk sizes, and checks that the token lists are identical.
+static bool Compare(const string &path) {
+  string expected = Dump(Lexer(path).token_list());
+  bool passed = true;
+  for (unsigned threads : {2u, 3u, 8u}) {
+    ThreadPool pool(threads);
+    for (size_t chunk_size : {size_t(1), size_t(97), size_t(4096),
+                              Lexer::MIN_CHUNK_SIZE}) {
+      Lexer lexer(path, false);
+      lexer.Tokenize(pool, chunk_size);
+      if (Dump(lexer.token_list()) != expected) {
+        cout << path << ": " << threads << " threads, chunks of "
+             << chunk_size << " bytes: token lists differ" << endl;
+        passed = false;
+      }
+    }
+    // A task of the pool may lex on the pool too. Atoms come from the
+    // task's thread, so it lexes serially as well.
+    bool same = false;
+    pool.Submit([&] {
+      Lexer lexer(path, false);
+      lexer.Tokenize(pool, 97);
+      same = Dump(lexer.token_list()) == Dump(Lexer(path).token_list());
+    });
+    pool.Wait();
+    if (!same) {
+      cout << path << ": " << threads
+           << " threads, from a task: token lists differ" << endl;
+      passed = false;
+    }
+  }
+  cout << path << ": " << (passed ? "ok" : "FAILED") << endl;
+  return passed;
+}
+
+int main(int argc, char **argv) {
+  bool passed = true;
+  if (argc > 1) {
+    for (int i = 1; i < argc; ++i) {
+      passed = Compare(argv[i]) && passed;
+    }
+  } else {
+    WriteCorpus("parallel_input.c", 20000);
+    passed = Compare("parallel_input.c") && passed;
+    passed = Compare("test.txt") && passed;
+  }
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+#include "../../error/error.h"
+#include "../../util/check.h"
+#include "../lexer.h"
+#include <iostream>
+#include <string>
+using namespace std;
+
+static shared_ptr<const SourceBuffer> Source(const string &text) {
+  return SourceBuffer::FromText(text);
+}
+
+int main() {
+  // Nothing is lexed before the parser first looks, and then only as far
+  // as it looks.
+  {
+    Lexer lexer(Source("int a = 1;\n"), "lazy.c", false);
+    Check(lexer.token_list().size() == 0, "nothing lexed up front");
+    Check(lexer.PeekCurrentToken().tag() == TOKEN::INT &&
+              lexer.token_list().size() == 1,
+          "the first peek lexes one token");
+    Check(lexer.PeekNextToken().tag() == TOKEN::IDENTIFIER &&
+              lexer.token_list().size() == 2,
+          "the next peek lexes one more");
+    lexer.ConsumeToken();
+    Check(lexer.token_list().size() == 2, "consuming a peeked token");
+  }
+
+  // An error early in the file is reported before the rest is lexed.
+  {
+    string text = "int a;\n\x01 b;\n";
+    for (int i = 0; i < 100000; ++i) {
+      text += "int x_" + to_string(i) + ";\n";
+    }
+    Lexer lexer(Source(text), "early.c", false);
+    Diagnostics diagnostics;
+    bool failed = false;
+    try {
+      while (lexer.ConsumeToken().tag() != TOKEN::FILE_EOF) {
+      }
+    } catch (const Diagnostics::Fatal &) {
+      failed = true;
+    }
+    Check(failed && diagnostics.messages().size() == 1 &&
+              diagnostics.messages()[0] == "Invalid character 1 at 2:1.",
+          "the error is reported");
+    Check(lexer.token_list().size() == 3, "the rest is never lexed");
+  }
+
+  // Every index past the end is the one FILE_EOF token.
+  {
+    Lexer lexer(Source("a b"), "end.c", false);
+    lexer.ConsumeToken();
+    lexer.ConsumeToken();
+    bool eof = true;
+    for (int i = 0; i < 5; ++i) {
+      eof = eof && lexer.PeekNextToken().tag() == TOKEN::FILE_EOF &&
+            lexer.ConsumeToken().tag() == TOKEN::FILE_EOF;
+    }
+    Check(eof, "FILE_EOF past the end");
+    auto &tokens = lexer.token_list();
+    Check(tokens.size() == 3 && tokens[2].tag() == TOKEN::FILE_EOF &&
+              tokens[1].tag() == TOKEN::IDENTIFIER,
+          "a single FILE_EOF token");
+  }
+
+  cout << (passed ? "stream: ok" : "stream: FAILED") << endl;
+  return passed ? 0 : 1;
+}
@@ -4,8 +4,9 @@
 using namespace std;
 
 int main() {
-    Lexer *lexer = new Lexer("test.txt");
+    Lexer *lexer = new Lexer("test.txt", false);
     lexer->Tokenize();
     lexer->PrintTokenList();
+    lexer->source().PrintStatistics(std::cerr);
     return 0;
 }
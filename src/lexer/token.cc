@@ -1,52 +1,6 @@
 #include "token.h"
 
-std::unordered_map<std::string, TOKEN> Token::string_to_tag{
-    {"auto", TOKEN::AUTO},
-    {"break", TOKEN::BREAK},
-    {"case", TOKEN::CASE},
-    {"char", TOKEN::CHAR},
-    {"const", TOKEN::CONST},
-    {"continue", TOKEN::CONTINUE},
-    {"default", TOKEN::DEFAULT},
-    {"do", TOKEN::DO},
-    {"double", TOKEN::DOUBLE},
-    {"else", TOKEN::ELSE},
-    {"enum", TOKEN::ENUM},
-    {"extern", TOKEN::EXTERN},
-    {"float", TOKEN::FLOAT},
-    {"for", TOKEN::FOR},
-    {"goto", TOKEN::GOTO},
-    {"if", TOKEN::IF},
-    {"inline", TOKEN::INLINE},
-    {"int", TOKEN::INT},
-    {"long", TOKEN::LONG},
-    {"register", TOKEN::REGISTER},
-    {"restrict", TOKEN::RESTRICT},
-    {"return", TOKEN::RETURN},
-    {"short", TOKEN::SHORT},
-    {"signed", TOKEN::SIGNED},
-    {"sizeof", TOKEN::SIZEOF},
-    {"static", TOKEN::STATIC},
-    {"struct", TOKEN::STRUCT},
-    {"switch", TOKEN::SWITCH},
-    {"typedef", TOKEN::TYPEDEF},
-    {"union", TOKEN::UNION},
-    {"unsigned", TOKEN::UNSIGNED},
-    {"void", TOKEN::VOID},
-    {"volatile", TOKEN::VOLATILE},
-    {"while", TOKEN::WHILE},
-    {"alignas", TOKEN::ALIGNAS},
-    {"alignof", TOKEN::ALIGNOF},
-    {"atomic", TOKEN::ATOMIC},
-    {"complex", TOKEN::COMPLEX},
-    {"generic", TOKEN::GENERIC},
-    {"imaginary", TOKEN::IMAGINARY},
-    {"noreturn", TOKEN::NORETURN},
-    {"static_assert", TOKEN::STATIC_ASSERT},
-    {"thread_local", TOKEN::THREAD_LOCAL},
-};
-
-std::unordered_map<TOKEN, std::string> Token::tag_to_string{
+const std::unordered_map<TOKEN, std::string> Token::tag_to_string{
     {TOKEN::AUTO, "AUTO"},
     {TOKEN::BREAK, "BREAK"},
     {TOKEN::CASE, "CASE"},
@@ -107,3 +61,9 @@ std::unordered_map<TOKEN, std::string> Token::tag_to_string{
     {TOKEN::EQ, "=="},
     {TOKEN::ASSIGN, ":="},
 };
+
+const std::string &Token::TagName(TOKEN tag) {
+  static const std::string none;
+  auto found = tag_to_string.find(tag);
+  return found == tag_to_string.end() ? none : found->second;
+}
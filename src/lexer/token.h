@@ -3,13 +3,24 @@
 
 #include "../public/position.h"
 #include "./value.h"
+#include "source_buffer.h"
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 class Token;
-enum class TOKEN;
+enum class TOKEN : uint8_t;
 
-enum class TOKEN {
+// Where a token is, for a message: a Preprocessor's Location, say.
+using Locator = std::function<std::string(const Token &)>;
+
+enum class TOKEN : uint8_t {
   FILE_EOF = 0,
   // ASCII characters
   TAB = '\t',
@@ -153,35 +164,239 @@ enum class TOKEN {
   CONSTANT_END
 };
 
+class TokenList;
+
+/**
+ * Lightweight handle of a token: the list it lives in and its 32-bit index.
+ * It is as cheap to copy as a pointer and involves no reference counting;
+ * it stays valid as long as the TokenList (owned by the Lexer) is alive.
+ * A default-constructed Token refers to no token at all.
+ */
 class Token {
 private:
-  TOKEN _tag = TOKEN::FILE_EOF;
-  const Position _position;
-  std::unique_ptr<Value> _value;
+  const TokenList *_list = nullptr;
+  uint32_t _index = 0;
 
 public:
-  Token(TOKEN tag, const Position &position) : _tag(tag), _position(position) {}
-  Token(TOKEN tag, const Position &position, std::unique_ptr<Value> &value)
-      : _tag(tag), _position(position), _value(std::move(value)) {}
-  TOKEN tag() { return _tag; }
-  std::unique_ptr<Value> &value() { return _value; }
-  const Position &position() const { return _position; }
+  Token() = default;
+  Token(const TokenList *list, uint32_t index) : _list(list), _index(index) {}
+  explicit operator bool() const { return _list != nullptr; }
+  uint32_t index() const { return _index; }
+  inline TOKEN tag() const;
+  // An empty Value if the token carries none.
+  inline Value value() const;
+  // Resolved through the source's line table; meant for diagnostics.
+  inline Position position() const;
+  inline uint32_t offset() const;
+  inline uint32_t length() const;
+  // The source of a list that has several; see TokenList.
+  inline uint32_t source_id() const;
   friend std::ostream &operator<<(std::ostream &os, const Token &token) {
-    os << "[Token: " << tag_to_string[token._tag];
-    if (token._tag == TOKEN::IDENTIFIER) {
-      os << " : " << *token._value;
+    if (!token) {
+      os << "[Token: none]";
+      return os;
+    }
+    os << "[Token: " << TagName(token.tag());
+    if (token.tag() == TOKEN::IDENTIFIER) {
+      os << " : " << token.value();
+    }
+    os << "] [" << token.position() << "]";
+    if (token.value()) {
+      os << " ---> " << token.value();
     }
-    os << "] [" << token._position << "] ---> " << *token._value;
     return os;
   }
   bool IsKeyword() const {
-    return TOKEN::KEYWORD_START < _tag && _tag < TOKEN::KEYWORD_END;
+    return TOKEN::KEYWORD_START < tag() && tag() < TOKEN::KEYWORD_END;
   }
   bool IsConstant() const {
-    return TOKEN::CONSTANT_START < _tag && _tag < TOKEN::CONSTANT_END;
+    return TOKEN::CONSTANT_START < tag() && tag() < TOKEN::CONSTANT_END;
   }
-  static std::unordered_map<std::string, TOKEN> string_to_tag;
-  static std::unordered_map<TOKEN, std::string> tag_to_string;
+  // The name of a tag, or "" for one without.
+  static const std::string &TagName(TOKEN tag);
+  static const std::unordered_map<TOKEN, std::string> tag_to_string;
 };
 
+/**
+ * Contiguous token storage in structure-of-arrays form. Each column is
+ * indexed by the token index. The value of a token is kept inline as an
+ * 8-byte payload whose meaning follows from the tag, so a token costs 17
+ * bytes and lexing allocates nothing per token. A token's location is just
+ * its offset; the SourceBuffer turns it into a row and column when asked.
+ *
+ * A lexer's list has one source. A list that gathers tokens from several,
+ * such as a preprocessor's output, numbers its sources and adds a column
+ * of source numbers; offsets and text payloads are then relative to each
+ * token's own source.
+ */
+class TokenList {
+public:
+  static Value::Kind ValueKind(TOKEN tag) {
+    if (tag == TOKEN::IDENTIFIER ||
+        (TOKEN::KEYWORD_START < tag && tag < TOKEN::KEYWORD_END)) {
+      return Value::Kind::ATOM;
+    }
+    switch (tag) {
+    case TOKEN::INTEGER_CONTANT:
+      return Value::Kind::INTEGER;
+    case TOKEN::FLOATING_CONSTANT:
+      return Value::Kind::FLOAT;
+    case TOKEN::STRING_LITERAL:
+    case TOKEN::CHARACTER_CONSTANT:
+      return Value::Kind::TEXT;
+    default:
+      return Value::Kind::NONE;
+    }
+  }
+
+  uint32_t size() const { return _tags.size(); }
+  bool empty() const { return _tags.empty(); }
+  Token operator[](uint32_t index) const { return Token(this, index); }
+  Token back() const { return Token(this, size() - 1); }
+  // Sets source 0, the only one of a lexer's list.
+  void set_source(const SourceBuffer *source) { _sources[0] = source; }
+  // Numbers one more source and keeps it alive as long as the list.
+  uint32_t AddSource(std::shared_ptr<const SourceBuffer> source) {
+    _sources.push_back(source.get());
+    _owned_sources.push_back(std::move(source));
+    return static_cast<uint32_t>(_sources.size() - 1);
+  }
+  uint32_t source_count() const { return _sources.size(); }
+  const SourceBuffer &source(uint32_t index) const {
+    return *_sources[_source_ids.empty() ? 0 : _source_ids[index]];
+  }
+  uint32_t source_id(uint32_t index) const {
+    return _source_ids.empty() ? 0 : _source_ids[index];
+  }
+  void reserve(uint32_t n) {
+    _tags.reserve(n);
+    _offsets.reserve(n);
+    _lengths.reserve(n);
+    _payloads.reserve(n);
+  }
+
+  uint32_t Add(TOKEN tag, uint32_t offset, uint32_t length) {
+    _tags.push_back(tag);
+    _offsets.push_back(offset);
+    _lengths.push_back(length);
+    _payloads.push_back(0);
+    if (!_source_ids.empty()) {
+      _source_ids.push_back(0);
+    }
+    return size() - 1;
+  }
+  uint32_t Add(TOKEN tag, uint32_t offset, uint32_t length,
+               const Value &value) {
+    assert(value.kind() == ValueKind(tag));
+    auto index = Add(tag, offset, length);
+    _payloads[index] = Encode(value);
+    return index;
+  }
+
+  // Adds a token whose value is already encoded, as payload() returns it.
+  // Atom payloads are only meaningful in the process that interned them.
+  uint32_t AddEncoded(TOKEN tag, uint32_t offset, uint32_t length,
+                      uint64_t payload) {
+    auto index = Add(tag, offset, length);
+    _payloads[index] = payload;
+    return index;
+  }
+  // The same for a token of source `source`.
+  uint32_t AddEncoded(TOKEN tag, uint32_t offset, uint32_t length,
+                      uint64_t payload, uint32_t source) {
+    auto index = AddEncoded(tag, offset, length, payload);
+    if (source != 0 && _source_ids.empty()) {
+      _source_ids.assign(size(), 0);
+    }
+    if (!_source_ids.empty()) {
+      _source_ids[index] = source;
+    }
+    return index;
+  }
+
+  TOKEN tag(uint32_t index) const { return _tags[index]; }
+  uint32_t offset(uint32_t index) const { return _offsets[index]; }
+  uint32_t length(uint32_t index) const { return _lengths[index]; }
+  uint64_t payload(uint32_t index) const { return _payloads[index]; }
+  inline Position position(uint32_t index) const;
+  inline Value value(uint32_t index) const;
+
+private:
+  inline uint64_t Encode(const Value &value) const;
+
+  std::vector<TOKEN> _tags;
+  std::vector<uint32_t> _offsets;
+  std::vector<uint32_t> _lengths;
+  std::vector<uint64_t> _payloads;
+  // Empty while every token is from source 0.
+  std::vector<uint32_t> _source_ids;
+  std::vector<const SourceBuffer *> _sources = {nullptr};
+  std::vector<std::shared_ptr<const SourceBuffer>> _owned_sources;
+};
+
+TOKEN Token::tag() const { return _list->tag(_index); }
+Value Token::value() const { return _list->value(_index); }
+Position Token::position() const { return _list->position(_index); }
+uint32_t Token::offset() const { return _list->offset(_index); }
+uint32_t Token::length() const { return _list->length(_index); }
+uint32_t Token::source_id() const { return _list->source_id(_index); }
+
+Position TokenList::position(uint32_t index) const {
+  return source(index).position(_offsets[index]);
+}
+
+// Text is stored as its offset in the source (high half) and its length.
+// Values added through Add are always from source 0.
+uint64_t TokenList::Encode(const Value &value) const {
+  uint64_t payload = 0;
+  switch (value.kind()) {
+  case Value::Kind::INTEGER: {
+    auto integer = value.get_integral_value();
+    std::memcpy(&payload, &integer, sizeof(integer));
+    break;
+  }
+  case Value::Kind::FLOAT: {
+    auto number = value.get_float_value();
+    std::memcpy(&payload, &number, sizeof(number));
+    break;
+  }
+  case Value::Kind::ATOM:
+    payload = static_cast<uint32_t>(value.get_atom());
+    break;
+  case Value::Kind::TEXT: {
+    auto text = value.text();
+    auto offset = static_cast<uint64_t>(text.data() - _sources[0]->data());
+    payload = offset << 32 | text.size();
+    break;
+  }
+  case Value::Kind::NONE:
+    break;
+  }
+  return payload;
+}
+
+Value TokenList::value(uint32_t index) const {
+  auto payload = _payloads[index];
+  switch (ValueKind(_tags[index])) {
+  case Value::Kind::INTEGER: {
+    long long integer;
+    std::memcpy(&integer, &payload, sizeof(integer));
+    return Value(integer);
+  }
+  case Value::Kind::FLOAT: {
+    double number;
+    std::memcpy(&number, &payload, sizeof(number));
+    return Value(number);
+  }
+  case Value::Kind::ATOM:
+    return Value(static_cast<Atom>(payload));
+  case Value::Kind::TEXT:
+    return Value(source(index).data() + (payload >> 32),
+                 static_cast<uint32_t>(payload));
+  case Value::Kind::NONE:
+    break;
+  }
+  return Value();
+}
+
 #endif
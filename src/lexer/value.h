@@ -1,42 +1,79 @@
 #ifndef YYQC_SRC_VALUE_H_
 #define YYQC_SRC_VALUE_H_
-#include <cwchar>
+#include "interner.h"
+#include <cassert>
+#include <cstdint>
 #include <iostream>
-#include <memory>
 #include <string>
-#include <variant>
-#include <vector>
+#include <string_view>
 
+/**
+ * Payload of a token: an integer or floating constant, the atom of an
+ * identifier or keyword, or the text between the quotes of a string literal
+ * or character constant. Text points into the SourceBuffer, so no Value
+ * ever owns memory; TokenList keeps just the 8-byte payload of each token
+ * and rebuilds the Value from the token's tag when asked.
+ */
 class Value {
   friend std::ostream &operator<<(std::ostream &os, const Value &value) {
-    auto val_ptr = &value._value;
-    if (auto pval = std::get_if<long long>(val_ptr)) {
-      os << "Integer value: " << *pval;
-    } else if (auto pval = std::get_if<double>(val_ptr)) {
-      os << "Float value: " << *pval;
-    } else if (auto pval = std::get_if<char>(val_ptr)) {
-      os << "Char value: " << *pval;
-    } else if (auto pval = std::get_if<std::string>(val_ptr)) {
-      os << "String value: " << *pval;
-    } else {
+    switch (value._kind) {
+    case Kind::INTEGER:
+      os << "Integer value: " << value._integer;
+      break;
+    case Kind::FLOAT:
+      os << "Float value: " << value._float;
+      break;
+    case Kind::ATOM:
+      os << "String value: " << Interner::ForThread().spelling(value._atom);
+      break;
+    case Kind::TEXT:
+      os << "String value: " << value.text();
+      break;
+    default:
       os << "Cannot convert!!!";
     }
     return os;
   }
 
 public:
-  Value(long long x) : _value(x) {}
-  Value(double x) : _value(x) {}
-  Value(std::string x) : _value(std::move(x)) {}
-  ~Value() {}
+  enum class Kind : uint8_t { NONE, INTEGER, FLOAT, ATOM, TEXT };
 
-  long long get_integral_value() { return std::get<long long>(_value); }
-  double get_float_value() { return std::get<double>(_value); }
-  char get_char_value() { return std::get<char>(_value); }
-  std::string get_string_value() { return std::get<std::string>(_value); }
+  Value() : _integer(0) {}
+  Value(long long x) : _kind(Kind::INTEGER), _integer(x) {}
+  Value(double x) : _kind(Kind::FLOAT), _float(x) {}
+  Value(Atom x) : _kind(Kind::ATOM), _atom(x) {}
+  Value(const char *text, uint32_t length)
+      : _kind(Kind::TEXT), _length(length), _text(text) {}
+
+  Kind kind() const { return _kind; }
+  explicit operator bool() const { return _kind != Kind::NONE; }
+  long long get_integral_value() const {
+    assert(_kind == Kind::INTEGER);
+    return _integer;
+  }
+  double get_float_value() const {
+    assert(_kind == Kind::FLOAT);
+    return _float;
+  }
+  std::string_view text() const {
+    assert(_kind == Kind::TEXT);
+    return std::string_view(_text, _length);
+  }
+  std::string get_string_value() const { return std::string(text()); }
+  Atom get_atom() const {
+    assert(_kind == Kind::ATOM);
+    return _atom;
+  }
 
 private:
-  std::variant<long long, double, char, std::string> _value = "";
+  Kind _kind = Kind::NONE;
+  uint32_t _length = 0;
+  union {
+    long long _integer;
+    double _float;
+    Atom _atom;
+    const char *_text;
+  };
 };
 
 #endif
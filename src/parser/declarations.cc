@@ -14,7 +14,7 @@
 //   // Token *type_token = nullptr;
 //   Type *type_base = nullptr;
 //   // std::tie(type_token, type_base) = SpecifierQualifierList();
-//   // auto tag = PeekToken()->tag();
+//   // auto tag = PeekToken().tag();
 //   // if (tag == TOKEN::STAR || tag == TOKEN::LPAR || tag == TOKEN::LSQUBRKT)
 //   {
 //   //   type_base = AbstractDeclarator(type_base);
@@ -23,36 +23,81 @@
 //   return nullptr;
 // }
 
-std::vector<std::unique_ptr<Symbol>> Parser::Declaration() {
-  std::vector<std::unique_ptr<Symbol>> declarations;
-  auto snapshot = LexerSnapShot();
-  std::unique_ptr<Type> type_base = DeclarationSpecifier();
+/**
+ *  declaration ->
+ *        declaration-specifiers init-declarator-list_{opt} ;
+ */
+std::vector<Symbol *> Parser::Declaration() {
+  uint32_t specifiers = 0;
+  auto type_base = DeclarationSpecifier(specifiers);
   if (type_base == nullptr) {
-    LexerPutBack(snapshot);
     return {};
-  } else {
-    bool first_declarator = true;
-    do {
-      if (first_declarator) {
-        first_declarator = false;
-      } else {
-        Match(TOKEN::COMMA);
-      }
-      auto declarator = Declarator(type_base);
-      /* TODO: assign value in declarator. */
-      std::unique_ptr<Symbol> symbol = std::move(declarator);
-      declarations.push_back(std::move(symbol));
-    } while (PeekToken()->tag() == TOKEN::COMMA);
-    if (PeekToken()->tag() == TOKEN::SEMI) {
-      Match(TOKEN::SEMI);
-      return declarations;
-    } else {
-      LexerPutBack(snapshot);
+  }
+  return DeclarationRest(type_base, specifiers, Declarator(type_base));
+}
+
+/**
+ *  init-declarator-list  ->
+ *        init-declarator
+ *        init-declarator-list , init-declarator
+ *
+ * The declaration specifiers and the first declarator have been parsed
+ * already; ExternalDeclaration needs to see the declarator before it knows
+ * whether it has a declaration or a function definition.
+ *
+ * A name is in scope from the end of its declarator on, so each is added
+ * to the symbol table as soon as it is parsed. A typedef makes it a
+ * typedef-name; any other declaration hides a typedef-name of an enclosing
+ * scope.
+ */
+std::vector<Symbol *>
+Parser::DeclarationRest(const Type *type_base, uint32_t specifiers,
+                        std::unique_ptr<Symbol> first_declarator) {
+  std::vector<Symbol *> declarations;
+  if (first_declarator == nullptr) {
+    return {};
+  }
+  bool is_typedef = specifiers & SCS_TYPEDEF;
+  first_declarator->set_specifiers(specifiers);
+  declarations.push_back(
+      _symbols.AddSymbol(std::move(first_declarator), is_typedef));
+  while (PeekToken().tag() == TOKEN::COMMA) {
+    Match(TOKEN::COMMA);
+    auto declarator = Declarator(type_base);
+    /* TODO: assign value in declarator. */
+    if (declarator == nullptr) {
       return {};
     }
+    declarator->set_specifiers(specifiers);
+    declarations.push_back(
+        _symbols.AddSymbol(std::move(declarator), is_typedef));
+  }
+  if (PeekToken().tag() != TOKEN::SEMI) {
+    return {};
+  }
+  Match(TOKEN::SEMI);
+  return declarations;
+}
+
+// The function owns the parameters; the scope of its body only names them.
+void Parser::DeclareParameters(const Symbol &function) {
+  for (auto &parameter : function.parameters()) {
+    _symbols.Declare(parameter.get());
   }
 }
 
+/**
+ * typedef-name -> identifier
+ *
+ * The type `token` names if it is a typedef-name in scope, else nullptr.
+ */
+const Type *Parser::TypedefName(const Token &token) const {
+  if (token.tag() != TOKEN::IDENTIFIER) {
+    return nullptr;
+  }
+  return _symbols.LookupTypedefName(token.value().get_atom());
+}
+
 /**
  *  declaration-specifiers  ->
  *        storage-class-specifier declaration-specifiers_{opt}
@@ -61,28 +106,22 @@ std::vector<std::unique_ptr<Symbol>> Parser::Declaration() {
  *        function-specifier declaration-specifiers_{opt}
  *        alignment-specifier declaration-specifiers_{opt}
  */
-std::unique_ptr<Type> Parser::DeclarationSpecifier() {
+const Type *Parser::DeclarationSpecifier(uint32_t &specifiers) {
   uint32_t storage_class_specifier_flag = 0;
   uint32_t type_specifier_flag = 0;
   uint32_t type_qualifier_flag = 0;
   uint32_t function_specifier_flag = 0;
-  std::unique_ptr<Type> type = nullptr;
+  const Type *typedef_type = nullptr;
+  auto token = PeekToken();
   while (true) {
     uint32_t temp_flag = 0x0;
-    std::unique_ptr<Type> temp_type = nullptr;
     temp_flag = TryStorageClassSpecifier();
     if (temp_flag != 0) {
       storage_class_specifier_flag |= temp_flag;
       continue;
     }
 
-    temp_type =
-        TryTypeSpecifier(storage_class_specifier_flag, type_specifier_flag,
-                         type_qualifier_flag, function_specifier_flag);
-    if (temp_type != nullptr) {
-      assert(type == nullptr);
-      type = std::move(temp_type);
-      type_specifier_flag |= temp_flag;
+    if (TryTypeSpecifier(type_specifier_flag, typedef_type)) {
       continue;
     }
 
@@ -103,13 +142,31 @@ std::unique_ptr<Type> Parser::DeclarationSpecifier() {
     // None of them matches, break.
     break;
   }
-  return type;
+  specifiers = storage_class_specifier_flag | type_specifier_flag;
+  if (typedef_type != nullptr) {
+    if (type_specifier_flag != TS_TYPEDEF) {
+      Error{"A typedef-name with other type specifiers at " +
+            Location(token) + "."};
+    }
+    return typedef_type;
+  }
+  if (type_specifier_flag == 0) {
+    return nullptr;
+  }
+  // The specifiers may come in any order, so they are only resolved to a
+  // type once all of them are in.
+  auto builtin = BuiltinOf(type_specifier_flag);
+  if (builtin == BuiltinKind::NONE) {
+    Error{"Invalid combination of type specifiers at " + Location(token) + "."};
+  }
+  return _types.Builtin(builtin,
+                        type_qualifier_flag | function_specifier_flag);
 }
 
 // Try to match storage-class-specifier. If succeeds, match, else pass.
 uint32_t Parser::TryStorageClassSpecifier() {
   uint32_t flag = 0;
-  auto tag = PeekToken()->tag();
+  auto tag = PeekToken().tag();
   switch (tag) {
   case TOKEN::TYPEDEF:
     Match(TOKEN::TYPEDEF);
@@ -141,81 +198,57 @@ uint32_t Parser::TryStorageClassSpecifier() {
   return flag;
 }
 
-std::unique_ptr<Type> Parser::TryTypeSpecifier(
-    uint32_t storage_class_specifier_flag, uint32_t &type_specifier_flag,
-    uint32_t type_qualifier_flag, uint32_t function_specifier_flag) {
-  std::unique_ptr<Type> type = nullptr;
+// Try to match type-specifier. If succeeds, match, add its flag to
+// `type_specifier_flag`, and for a typedef-name set `typedef_type`.
+bool Parser::TryTypeSpecifier(uint32_t &type_specifier_flag,
+                              const Type *&typedef_type) {
+  uint32_t flag = 0;
   auto token = PeekToken();
-  auto tag = token->tag();
+  auto tag = token.tag();
   switch (tag) {
   case TOKEN::VOID:
-    Match(TOKEN::VOID);
-    type_specifier_flag |= TS_VOID;
-    type = std::make_unique<VoidType>();
+    flag = TS_VOID;
     break;
   case TOKEN::CHAR:
-    Match(TOKEN::CHAR);
-    type_specifier_flag |= TS_CHAR;
-    type = std::make_unique<CharType>();
+    flag = TS_CHAR;
     break;
   case TOKEN::SHORT:
-    Match(TOKEN::SHORT);
-    type_specifier_flag |= TS_SHORT;
-    type = std::make_unique<IntType>(storage_class_specifier_flag,
-                                     type_specifier_flag, type_qualifier_flag,
-                                     function_specifier_flag);
+    flag = TS_SHORT;
     break;
   case TOKEN::INT:
-    Match(TOKEN::INT);
-    type_specifier_flag |= TS_INT;
-    if (type == nullptr) {
-      type = std::make_unique<IntType>(storage_class_specifier_flag,
-                                       type_specifier_flag, type_qualifier_flag,
-                                       function_specifier_flag);
-    }
+    flag = TS_INT;
     break;
   case TOKEN::LONG:
-    Match(TOKEN::INT);
-    type_specifier_flag |= TS_LONG;
-    type = std::make_unique<IntType>(storage_class_specifier_flag,
-                                     type_specifier_flag, type_qualifier_flag,
-                                     function_specifier_flag);
+    flag = TS_LONG;
     break;
   case TOKEN::FLOAT:
-    Match(TOKEN::FLOAT);
-    type_specifier_flag |= TS_FLOAT;
-    type = std::make_unique<FloatType>();
+    flag = TS_FLOAT;
     break;
   case TOKEN::DOUBLE:
-    Match(TOKEN::DOUBLE);
-    type_specifier_flag |= TS_DOUBLE;
-    type = std::make_unique<FloatType>();
+    flag = TS_DOUBLE;
     break;
   case TOKEN::SIGNED:
-    Match(TOKEN::SIGNED);
-    type_specifier_flag |= TS_SIGNED;
-    if (type == nullptr) {
-      type = std::make_unique<IntType>();
-    }
+    flag = TS_SIGNED;
     break;
   case TOKEN::UNSIGNED:
-    Match(TOKEN::UNSIGNED);
-    type_specifier_flag |= TS_UNSIGNED;
-    if (type == nullptr) {
-      type = std::make_unique<IntType>(storage_class_specifier_flag,
-                                       type_specifier_flag, type_qualifier_flag,
-                                       function_specifier_flag);
-    }
+    flag = TS_UNSIGNED;
     break;
   case TOKEN::BOOL:
-    Match(TOKEN::BOOL);
-    type_specifier_flag |= TS_BOOL;
-    type = std::make_unique<BoolType>();
+    flag = TS_BOOL;
     break;
   case TOKEN::COMPLEX:
-    Match(TOKEN::COMPLEX);
-    type_specifier_flag |= TS_COMPLEX;
     // TODO: complex
+    flag = TS_COMPLEX;
+    break;
+  case TOKEN::IDENTIFIER:
+    // A typedef-name is a type specifier only where no other type specifier
+    // has been seen; in "T T;" the second T is the declarator.
+    if (type_specifier_flag == 0) {
+      typedef_type = TypedefName(token);
+      if (typedef_type != nullptr) {
+        flag = TS_TYPEDEF;
+      }
+    }
     break;
   case TOKEN::ATOMIC:
   case TOKEN::STRUCT:
@@ -225,13 +258,26 @@ std::unique_ptr<Type> Parser::TryTypeSpecifier(
   default:
     break;
   };
-  return type;
+  if (flag == 0) {
+    return false;
+  }
+  Match(tag);
+  // The second long of `long long`.
+  if (flag == TS_LONG && (type_specifier_flag & TS_LONG)) {
+    type_specifier_flag &= ~TS_LONG;
+    flag = TS_LONGLONG;
+  }
+  if (type_specifier_flag & flag) {
+    Error{"Duplicate type specifier at " + Location(token) + "."};
+  }
+  type_specifier_flag |= flag;
+  return true;
 }
 
 // Try to match type-specifier. If succeeds, match, else pass.
 uint32_t Parser::TryTypeQualifier() {
   uint32_t flag = 0;
-  auto tag = PeekToken()->tag();
+  auto tag = PeekToken().tag();
   switch (tag) {
   case TOKEN::CONST:
     Match(TOKEN::CONST);
@@ -257,7 +303,7 @@ uint32_t Parser::TryTypeQualifier() {
 
 uint32_t Parser::TryFunctionSpecifier() {
   uint32_t flag = 0;
-  auto tag = PeekToken()->tag();
+  auto tag = PeekToken().tag();
   switch (tag) {
   case TOKEN::INLINE:
     Match(TOKEN::INLINE);
@@ -281,7 +327,7 @@ std::tuple<Token *, Type *> Parser::SpecifierQualifierList() {
   // Type *type = nullptr;
   // Token *returned_token = nullptr;
   // while (true) {
-  //   switch (token->tag()) {
+  //   switch (token.tag()) {
   //   case TOKEN::VOID:
   //     assert(type == nullptr);
   //     type = new VoidType();
@@ -352,7 +398,7 @@ std::tuple<Token *, Type *> Parser::SpecifierQualifierList() {
   //     Match(TOKEN::COMPLEX);
   //     break;
   //   case TOKEN::ATOMIC:
-  //     if (PeekNextToken()->tag() == TOKEN::LPAR) {
+  //     if (PeekNextToken().tag() == TOKEN::LPAR) {
   //       // type = new AtomicType(); // TODO
   //       type = AtomicTypeSpecifier(type);
   //     } else {
@@ -362,7 +408,7 @@ std::tuple<Token *, Type *> Parser::SpecifierQualifierList() {
   //   case TOKEN::STRUCT:
   //   case TOKEN::UNION:
   //     assert(type == nullptr);
-  //     if (token->tag() == TOKEN::STRUCT) {
+  //     if (token.tag() == TOKEN::STRUCT) {
   //       type = new StructType();
   //     } else {
   //       type = new UnionType();
@@ -429,12 +475,12 @@ std::tuple<Token *, Type *> Parser::StructOrUnionSpecifier() {
   // Type *s_type = nullptr;
   // uint32_t type_specifier_flag = 0x0;
   // auto token = PeekToken();
-  // if (token->tag() == TOKEN::STRUCT) {
+  // if (token.tag() == TOKEN::STRUCT) {
   //   Match(TOKEN::STRUCT);
   //   // s_type->AddFlag(TS_STRUCT_UNION);
   //   type_specifier_flag |= TS_STRUCT_UNION;
   //   auto type = new StructType();
-  // } else if (token->tag() == TOKEN::UNION) {
+  // } else if (token.tag() == TOKEN::UNION) {
   //   Match(TOKEN::UNION);
   //   type_specifier_flag |= TS_STRUCT_UNION;
   //   // s_type->AddFlag(TS_STRUCT_UNION);
@@ -446,7 +492,7 @@ std::tuple<Token *, Type *> Parser::StructOrUnionSpecifier() {
   //   return std::make_tuple(nullptr, nullptr);
   // }
   // token = PeekToken();
-  // if (token->tag() == TOKEN::IDENTIFIER) { // We have seen an identifier.
+  // if (token.tag() == TOKEN::IDENTIFIER) { // We have seen an identifier.
   //   auto struct_union_tag = Match(TOKEN::IDENTIFIER);
   //   // Check the existence of this struct identifier in this scope.
   //   Identifier *identifier = nullptr; // TODO: check symbol table of this
@@ -454,7 +500,7 @@ std::tuple<Token *, Type *> Parser::StructOrUnionSpecifier() {
   //     // Check: if the struct/union of this identifier is complete, then it
   //     is
   //     // an error of redefinition.
-  //     if (token->tag() == TOKEN::LBRACE) {
+  //     if (token.tag() == TOKEN::LBRACE) {
   //       if (identifier->type()->completed()) {
   //         // Invalid, since try to redefine an existed completed struct.
   //         Error("Redefinition of an existed struct/union.");
@@ -479,7 +525,7 @@ std::tuple<Token *, Type *> Parser::StructOrUnionSpecifier() {
   //     s_type);
   //     // TODO: New identifier. Add this identifier to symbol table of this
   //     // scope.
-  //     if (token->tag() != TOKEN::LBRACE) {
+  //     if (token.tag() != TOKEN::LBRACE) {
   //       // Only a declarator.
   //       return std::make_tuple(struct_union_tag, s_type);
   //     } else {
@@ -494,7 +540,7 @@ std::tuple<Token *, Type *> Parser::StructOrUnionSpecifier() {
   //   struct/union.
   //   // Thus, { struct-declaration-list } must exist.
   //   token = PeekToken();
-  //   if (token->tag() != TOKEN::LBRACE) {
+  //   if (token.tag() != TOKEN::LBRACE) {
   //     Error("In struct-or-union: anonymous struct/union must have { "
   //           "struct-declaration-list }");
   //     return std::make_tuple(nullptr, nullptr);
@@ -541,7 +587,7 @@ void Parser::StructDeclarationListPrime(Type *s_type) {
 void Parser::StructDeclaration(Type *s_type) {
   (void)s_type;
   // auto token = PeekToken();
-  // auto tag = token->tag();
+  // auto tag = token.tag();
   // if (tag == TOKEN::STATIC_ASSERT) {
   //   StaticAssertDeclaration(s_type);
   // } else {
@@ -574,15 +620,13 @@ void Parser::StructDeclaration(Type *s_type) {
  *                  * type-qualifier-list_{opt}
  *                  * type-qualifier-list_{opt} pointer
  */
-std::unique_ptr<Type> Parser::Pointer(const std::unique_ptr<Type> &type_base) {
+const Type *Parser::Pointer(const Type *type_base) {
   auto token = PeekToken();
-  // std::unique_ptr<Type> pointer_type = std::make_unique<Type>(type_base);
-  auto pointer_type = type_base->clone();
-  while (token->tag() == TOKEN::STAR) {
+  auto pointer_type = type_base;
+  while (token.tag() == TOKEN::STAR) {
     Match(TOKEN::STAR);
-    pointer_type = std::make_unique<PointerType>(pointer_type);
     // TODO: double-check which node is qualified by type-qualifier-list
-    TypeQualifierList(pointer_type);
+    pointer_type = _types.Pointer(pointer_type, TypeQualifierList());
     token = PeekToken();
   }
   return pointer_type;
@@ -592,17 +636,18 @@ std::unique_ptr<Type> Parser::Pointer(const std::unique_ptr<Type> &type_base) {
  *  parameter-type-list ->
  *                          parameter-list
  *                          parameter-list , ...
+ *
+ * True if the list ends in an ellipsis.
  */
-void Parser::ParameterTypeList(std::unique_ptr<FunctionType> &function_type) {
-  auto parameter_list = ParameterList();
-  function_type->AddParameters(parameter_list);
-  if (PeekToken()->tag() == TOKEN::COMMA) {
+bool Parser::ParameterTypeList(
+    std::vector<std::unique_ptr<Symbol>> &parameters) {
+  parameters = ParameterList();
+  if (PeekToken().tag() == TOKEN::COMMA) {
     Match(TOKEN::COMMA);
     Match(TOKEN::ELLIPSIS);
-    function_type->set_variadic(true);
-  } else {
-    function_type->set_variadic(false);
+    return true;
   }
+  return false;
 }
 
 /**
@@ -613,8 +658,8 @@ void Parser::ParameterTypeList(std::unique_ptr<FunctionType> &function_type) {
 std::vector<std::unique_ptr<Symbol>> Parser::ParameterList() {
   std::vector<std::unique_ptr<Symbol>> parameter_list;
   parameter_list.push_back(ParameterDeclaration());
-  while (PeekToken()->tag() == TOKEN::COMMA &&
-         PeekNextToken()->tag() != TOKEN::ELLIPSIS) {
+  while (PeekToken().tag() == TOKEN::COMMA &&
+         PeekNextToken().tag() != TOKEN::ELLIPSIS) {
     Match(TOKEN::COMMA);
     parameter_list.push_back(ParameterDeclaration());
   }
@@ -628,8 +673,16 @@ std::vector<std::unique_ptr<Symbol>> Parser::ParameterList() {
  *
  */
 std::unique_ptr<Symbol> Parser::ParameterDeclaration() {
-  std::unique_ptr<Type> type_base = DeclarationSpecifier();
-  return GeneralDeclarator(type_base);
+  uint32_t specifiers = 0;
+  auto type_base = DeclarationSpecifier(specifiers);
+  if (type_base == nullptr) {
+    Error{"Expected a parameter type at " + Location(PeekToken()) + "."};
+  }
+  auto parameter = GeneralDeclarator(type_base);
+  if (parameter) {
+    parameter->set_specifiers(specifiers);
+  }
+  return parameter;
 }
 
 /**
@@ -637,28 +690,29 @@ std::unique_ptr<Symbol> Parser::ParameterDeclaration() {
  *                              type-qualifier
  *                              type-qualifier-list type-qualifier
  */
-void Parser::TypeQualifierList(std::unique_ptr<Type> &type) {
+uint32_t Parser::TypeQualifierList() {
+  uint32_t flags = 0;
   auto token = PeekToken();
   while (true) {
-    switch (token->tag()) {
+    switch (token.tag()) {
     case TOKEN::CONST:
       Match(TOKEN::CONST);
-      type->add_type_qualifier(TQ_CONST);
+      flags |= TQ_CONST;
       break;
     case TOKEN::RESTRICT:
       Match(TOKEN::RESTRICT);
-      type->add_type_qualifier(TQ_RESTRICT);
+      flags |= TQ_RESTRICT;
       break;
     case TOKEN::VOLATILE:
       Match(TOKEN::VOLATILE);
-      type->add_type_qualifier(TQ_VOLATILE);
+      flags |= TQ_VOLATILE;
       break;
     case TOKEN::ATOMIC:
       Match(TOKEN::ATOMIC);
-      type->add_type_qualifier(TQ_ATOMIC);
+      flags |= TQ_ATOMIC;
       break;
     default:
-      return;
+      return flags;
     }
     token = PeekToken();
   }
@@ -695,7 +749,7 @@ Type *Parser::EnumSpecifier(Type *node) {
   // TODO:
   // Match(TOKEN::ENUM);
   // auto token = PeekToken();
-  // if (token->tag() == TOKEN::IDENTIFIER) {
+  // if (token.tag() == TOKEN::IDENTIFIER) {
   //   token = Match(TOKEN::IDENTIFIER);
   //   // auto identifier = new StructUnionEnumTag(token, )
   // } else {
@@ -719,7 +773,7 @@ Type *Parser::EnumSpecifier(Type *node) {
 // Type *Parser::EnumeratorList(Type *node) {
 //   // node = Enumerator(node);
 //   // auto token = PeekToken();
-//   // while (token->tag() == TOKEN::COMMA) {
+//   // while (token.tag() == TOKEN::COMMA) {
 //   //   Match(TOKEN::COMMA);
 //   //   node = Enumerator(node);
 //   // }
@@ -735,7 +789,7 @@ Type *Parser::EnumSpecifier(Type *node) {
 // Type *Parser::Enumerator(Type *node) {
 //   // node = EnumerationConstant(node);
 //   // auto token = PeekToken();
-//   // if (token->tag() == TOKEN::ASSIGN) {
+//   // if (token.tag() == TOKEN::ASSIGN) {
 //   //   Match(TOKEN::ASSIGN);
 //   //   auto constant = Const();
 //   //   // TODO: Add this constant to the enumeration-constant.
@@ -12,22 +12,18 @@
 
 /**
  * declarator  ->  pointer_{opt} direct-declarator
- * Here type base should not be a unique_ptr with ownership since this function
- * just uses it to construct type for some symbols.
  *
- * type_base is only used for constructing new type. For example,
+ * Types are shared, so every declarator of a declaration derives its type
+ * from the same `type_base`. For example, in
  * int a, b, *c;
- * When a, b and c are all constructed, type_base will be deconstructed.
+ * a and b have the very type the specifiers name, and c the one int *.
  */
-std::unique_ptr<Symbol>
-Parser::Declarator(const std::unique_ptr<Type> &type_base) {
-  auto token = PeekToken();
-  auto tag = token->tag();
-  std::unique_ptr<Type> cloned_type_base = type_base->clone();
-  if (tag == TOKEN::STAR) {
-    cloned_type_base = Pointer(cloned_type_base);
+std::unique_ptr<Symbol> Parser::Declarator(const Type *type_base) {
+  auto type = type_base;
+  if (PeekToken(TOKEN::STAR)) {
+    type = Pointer(type);
   }
-  return DirectDeclarator(cloned_type_base);
+  return DirectDeclarator(type);
 }
 
 /**
@@ -55,24 +51,23 @@ Parser::Declarator(const std::unique_ptr<Type> &type_base) {
  * ( identifier-list_{opt} ) direct-declarator'
  * ${epsilon}
  */
-std::unique_ptr<Symbol>
-Parser::DirectDeclarator(std::unique_ptr<Type> &cloned_type_base) {
+std::unique_ptr<Symbol> Parser::DirectDeclarator(const Type *type_base) {
   auto token = PeekToken();
-  if (token->tag() == TOKEN::IDENTIFIER) {
+  if (token.tag() == TOKEN::IDENTIFIER) {
     /**
      * If, in the declaration "T D1", D1 has the form identifier then the
      type
     * specified for ident is T .
     */
     auto identifier_token = Match(TOKEN::IDENTIFIER);
-#ifdef DEBUG
-    std::cout << "See an Identifier. Its name is [ "
-              << *identifier_token->value() << " ]." << std::endl;
-#endif // DEBUG
-    auto type = DirectDeclaratorPrime(cloned_type_base);
+    TRACE(DECLARATIONS, "See an Identifier. Its name is [ "
+          << identifier_token.value() << " ].\n");
+    std::vector<std::unique_ptr<Symbol>> parameters;
+    auto type = DirectDeclaratorPrime(type_base, parameters);
     auto symbol = std::make_unique<Symbol>(identifier_token, type);
+    symbol->set_parameters(std::move(parameters));
     return symbol;
-  } else if (token->tag() == TOKEN::LPAR) {
+  } else if (token.tag() == TOKEN::LPAR) {
     /**
      * If, in the declaration "T D1", D1 has the form (D) then ident has the
      * type specified by the declaration "T D". Thus, a declarator in
@@ -80,29 +75,30 @@ Parser::DirectDeclarator(std::unique_ptr<Type> &cloned_type_base) {
      * binding of complicated declarators may be altered by parentheses.
      */
     Match(TOKEN::LPAR);
-    auto symbol = Declarator(cloned_type_base);
+    auto symbol = Declarator(type_base);
     Match(TOKEN::RPAR);
-    auto new_type = DirectDeclaratorPrime(symbol->type());
-    symbol->set_type(new_type);
+    std::vector<std::unique_ptr<Symbol>> parameters;
+    auto type = DirectDeclaratorPrime(symbol->type(), parameters);
+    if (type != symbol->type()) {
+      symbol->set_type(type);
+      symbol->set_parameters(std::move(parameters));
+    }
     return symbol;
   } else {
     return nullptr;
   }
 }
 
-std::unique_ptr<Type>
-Parser::DirectDeclaratorPrime(std::unique_ptr<Type> &cloned_type_base) {
+const Type *Parser::DirectDeclaratorPrime(
+    const Type *type_base, std::vector<std::unique_ptr<Symbol>> &parameters) {
   auto token = PeekToken();
-  std::unique_ptr<Type> derived_type = nullptr;
-  if (token->tag() == TOKEN::LSQUBRKT) {
-    derived_type = ArrayDeclarator(cloned_type_base);
-  } else if (token->tag() == TOKEN::LPAR) {
-    derived_type = FunctionDeclarator(cloned_type_base);
-  } else {
-    return std::move(cloned_type_base);
+  if (token.tag() == TOKEN::LSQUBRKT) {
+    return ArrayDeclarator(type_base);
+  } else if (token.tag() == TOKEN::LPAR) {
+    return FunctionDeclarator(type_base, parameters);
   }
-  // TODO: DirectDeclaratorPrime(cloned_type_base);
-  return derived_type;
+  // TODO: DirectDeclaratorPrime(type_base);
+  return type_base;
 }
 
 /**
@@ -111,13 +107,11 @@ Parser::DirectDeclaratorPrime(std::unique_ptr<Type> &cloned_type_base) {
  * [ type-qualifier-list static assignment-expression ]
  * [ type-qualifier-list_{opt} * ]
  */
-std::unique_ptr<ArrayType>
-Parser::ArrayDeclarator(std::unique_ptr<Type> &cloned_array_base) {
-  assert(cloned_array_base != nullptr);
+const ArrayType *Parser::ArrayDeclarator(const Type *array_base) {
+  assert(array_base != nullptr);
   Match(TOKEN::LSQUBRKT);
   int array_length = ArrayDeclaratorInBracket();
-  auto array_type =
-      std::make_unique<ArrayType>(cloned_array_base, array_length);
+  auto array_type = _types.Array(array_base, array_length);
   Match(TOKEN::RSQUBRKT);
   return array_type;
 }
@@ -139,11 +133,11 @@ Parser::ArrayDeclarator(std::unique_ptr<Type> &cloned_array_base) {
  */
 long long Parser::ArrayDeclaratorInBracket() {
   auto token = PeekToken();
-  if (token->tag() == TOKEN::INTEGER_CONTANT) {
-    auto ll = token->value()->get_integral_value();
+  if (token.tag() == TOKEN::INTEGER_CONTANT) {
+    auto ll = token.value().get_integral_value();
     Match(TOKEN::INTEGER_CONTANT);
     return ll;
-  } else if (token->tag() == TOKEN::RSQUBRKT) {
+  } else if (token.tag() == TOKEN::RSQUBRKT) {
     return -1; // The length has not been determined.
   } else {
     return -1;
@@ -154,26 +148,23 @@ long long Parser::ArrayDeclaratorInBracket() {
  * ( parameter-type-list )
  * ( identifier-list_{opt} )
  */
-std::unique_ptr<FunctionType>
-Parser::FunctionDeclarator(std::unique_ptr<Type> &cloned_function_base) {
-#ifdef DEBUG
-  std::cout << ">>> Function Declarator" << std::endl;
-#endif // DEBUG
+const FunctionType *Parser::FunctionDeclarator(
+    const Type *function_base,
+    std::vector<std::unique_ptr<Symbol>> &parameters) {
+  TRACE(DECLARATIONS, ">>> Function Declarator\n");
   Match(TOKEN::LPAR);
-  auto function_type = std::make_unique<FunctionType>(cloned_function_base);
-  if (PeekToken()->tag() != TOKEN::RPAR) {
-    FunctionDeclaratorInParanthesis(function_type);
+  bool variadic = false;
+  if (PeekToken().tag() != TOKEN::RPAR) {
+    variadic = ParameterTypeList(parameters);
+  }
+  std::vector<const Type *> parameter_types;
+  parameter_types.reserve(parameters.size());
+  for (auto &parameter : parameters) {
+    parameter_types.push_back(parameter->type());
   }
   Match(TOKEN::RPAR);
-#ifdef DEBUG
-  std::cout << "<<< Function Declarator" << std::endl;
-#endif // DEBUG
-  return function_type;
-}
-
-void Parser::FunctionDeclaratorInParanthesis(
-    std::unique_ptr<FunctionType> &function_type) {
-  ParameterTypeList(function_type);
+  TRACE(DECLARATIONS, "<<< Function Declarator\n");
+  return _types.Function(function_base, std::move(parameter_types), variadic);
 }
 
 /**
@@ -183,17 +174,14 @@ void Parser::FunctionDeclaratorInParanthesis(
  *                          direct-abstract-declarator
  *  Compared to declarator, besides the "abstract", it can ends with pointer.
  */
-std::unique_ptr<Symbol>
-Parser::AbstractDeclarator(const std::unique_ptr<Type> &type_base) {
+std::unique_ptr<Symbol> Parser::AbstractDeclarator(const Type *type_base) {
   auto token = PeekToken();
-  auto tag = token->tag();
-  std::unique_ptr<Type> cloned_type_base = type_base->clone();
+  auto tag = token.tag();
   if (tag == TOKEN::STAR) {
-    cloned_type_base = Pointer(cloned_type_base);
-    auto symbol = DirectAbstractDeclarator(cloned_type_base);
+    auto symbol = DirectAbstractDeclarator(Pointer(type_base));
     return symbol;
   } else if (tag == TOKEN::LPAR || tag == TOKEN::LSQUBRKT) {
-    auto symbol = DirectAbstractDeclarator(cloned_type_base);
+    auto symbol = DirectAbstractDeclarator(type_base);
     return symbol;
   } else {
     // abstract-declarator starts with (, [ or *.
@@ -239,14 +227,14 @@ Parser::AbstractDeclarator(const std::unique_ptr<Type> &type_base) {
  *
  */
 std::unique_ptr<Symbol>
-Parser::DirectAbstractDeclarator(std::unique_ptr<Type> &cloned_type_base) {
+Parser::DirectAbstractDeclarator(const Type *type_base) {
   auto token = PeekToken();
-  auto tag = token->tag();
+  auto tag = token.tag();
   if (tag == TOKEN::LPAR || tag == TOKEN::LSQUBRKT) {
-    DirectAbstractDeclarator(cloned_type_base);
-    return std::make_unique<Symbol>(nullptr, cloned_type_base);
+    DirectAbstractDeclarator(type_base);
+    return std::make_unique<Symbol>(Token(), type_base);
   } else {
-    return std::make_unique<Symbol>(nullptr, cloned_type_base);
+    return std::make_unique<Symbol>(Token(), type_base);
   }
 }
 
@@ -263,76 +251,76 @@ Parser::DirectAbstractDeclarator(std::unique_ptr<Type> &cloned_type_base) {
  * ( parameter-type-list_{opt} )      derect-abstract-declarator'
  * ${epsilon}
  */
-void Parser::DirectAbstractDeclaratorPrime(
-    std::unique_ptr<Type> &cloned_type_base) {
+const Type *Parser::DirectAbstractDeclaratorPrime(const Type *type_base) {
   auto token = PeekToken();
-  if (token->tag() == TOKEN::LSQUBRKT) {
+  if (token.tag() == TOKEN::LSQUBRKT) {
     Match(TOKEN::LSQUBRKT);
-    cloned_type_base = ArrayDeclarator(cloned_type_base);
-    DirectAbstractDeclaratorPrime(cloned_type_base);
-  } else if (token->tag() == TOKEN::LPAR) {
+    return DirectAbstractDeclaratorPrime(ArrayDeclarator(type_base));
+  } else if (token.tag() == TOKEN::LPAR) {
     Match(TOKEN::LPAR);
     token = PeekToken();
-    if (token->tag() == TOKEN::RPAR) {
+    if (token.tag() == TOKEN::RPAR) {
       Match(TOKEN::RPAR);
       // return DirectAbstractDeclaratorPrime(type_base);
-      cloned_type_base = std::make_unique<FunctionType>(cloned_type_base);
+      return _types.Function(type_base, {}, false);
     } else {
       // This is the case of parameter-type-list
       // bool is_variadic = false;
       // TODO
-      return;
     }
   }
+  return type_base;
 }
 
-std::unique_ptr<Symbol>
-Parser::GeneralDeclarator(const std::unique_ptr<Type> &type_base) {
-  auto token = PeekToken();
-  auto tag = token->tag();
-  std::unique_ptr<Type> cloned_type_base = type_base->clone();
-  if (tag == TOKEN::STAR) {
-    cloned_type_base = Pointer(cloned_type_base);
+std::unique_ptr<Symbol> Parser::GeneralDeclarator(const Type *type_base) {
+  auto type = type_base;
+  if (PeekToken(TOKEN::STAR)) {
+    type = Pointer(type);
   }
-  return GeneralDirectDeclarator(cloned_type_base);
+  auto symbol = GeneralDirectDeclarator(type);
+  if (symbol == nullptr) {
+    // An abstract declarator, as of an unnamed parameter.
+    symbol = std::make_unique<Symbol>(Token(), type);
+  }
+  return symbol;
 }
 
-std::unique_ptr<Symbol>
-Parser::GeneralDirectDeclarator(std::unique_ptr<Type> &cloned_type_base) {
+std::unique_ptr<Symbol> Parser::GeneralDirectDeclarator(const Type *type_base) {
   auto token = PeekToken();
-  if (token->tag() == TOKEN::IDENTIFIER) {
+  if (token.tag() == TOKEN::IDENTIFIER) {
     auto identifier_token = Match(TOKEN::IDENTIFIER);
-#ifdef DEBUG
-    std::cout << "See an Identifier. Its name is [ "
-              << *identifier_token->value() << " ]." << std::endl;
-#endif // DEBUG
-    auto type = GeneralDirectDeclaratorPrime(cloned_type_base);
+    TRACE(DECLARATIONS, "See an Identifier. Its name is [ "
+          << identifier_token.value() << " ].\n");
+    std::vector<std::unique_ptr<Symbol>> parameters;
+    auto type = GeneralDirectDeclaratorPrime(type_base, parameters);
     auto symbol = std::make_unique<Symbol>(identifier_token, type);
+    symbol->set_parameters(std::move(parameters));
     return symbol;
-  } else if (token->tag() == TOKEN::LPAR) {
+  } else if (token.tag() == TOKEN::LPAR) {
     Match(TOKEN::LPAR);
-    auto symbol = GeneralDeclarator(cloned_type_base);
+    auto symbol = GeneralDeclarator(type_base);
     Match(TOKEN::RPAR);
-    auto new_type = GeneralDirectDeclaratorPrime(symbol->type());
-    symbol->set_type(new_type);
+    std::vector<std::unique_ptr<Symbol>> parameters;
+    auto type = GeneralDirectDeclaratorPrime(symbol->type(), parameters);
+    if (type != symbol->type()) {
+      symbol->set_type(type);
+      symbol->set_parameters(std::move(parameters));
+    }
     return symbol;
   } else {
     return nullptr;
   }
 }
 
-std::unique_ptr<Type>
-Parser::GeneralDirectDeclaratorPrime(std::unique_ptr<Type> &cloned_type_base) {
+const Type *Parser::GeneralDirectDeclaratorPrime(
+    const Type *type_base, std::vector<std::unique_ptr<Symbol>> &parameters) {
   auto token = PeekToken();
-  std::unique_ptr<Type> derived_type = nullptr;
-  if (token->tag() == TOKEN::LSQUBRKT) {
-    derived_type = ArrayDeclarator(cloned_type_base);
-  } else if (token->tag() == TOKEN::LPAR) {
-    derived_type = FunctionDeclarator(cloned_type_base);
-  } else {
-    return std::move(cloned_type_base);
+  if (token.tag() == TOKEN::LSQUBRKT) {
+    return ArrayDeclarator(type_base);
+  } else if (token.tag() == TOKEN::LPAR) {
+    return FunctionDeclarator(type_base, parameters);
   }
-  return derived_type;
+  return type_base;
 }
 
 /**
@@ -1,5 +1,6 @@
 #include "parser.h"
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstddef>
 #include <iostream>
@@ -17,20 +18,20 @@
  *                        | ( expression )
  *                        | generic-selection
  */
-std::unique_ptr<Expr> Parser::PrimaryExpression() {
+Expr *Parser::PrimaryExpression() {
   auto token = PeekToken();
-  auto tag = token->tag();
+  auto tag = token.tag();
   if (tag == TOKEN::IDENTIFIER) {
     Match(TOKEN::IDENTIFIER);
-    return std::make_unique<Identifier>(token);
+    return MakeNode<Identifier>(token);
   } else if (tag == TOKEN::INTEGER_CONTANT || tag == TOKEN::FLOATING_CONSTANT ||
              tag == TOKEN::ENUMERATION_CONSTANT ||
              tag == TOKEN::CHARACTER_CONSTANT) {
     ConsumeToken();
-    return std::make_unique<Constant>(token);
+    return MakeNode<Constant>(token);
   } else if (tag == TOKEN::STRING_LITERAL) {
     Match(TOKEN::STRING_LITERAL);
-    return std::make_unique<Constant>(token);
+    return MakeNode<Constant>(token);
   } else if (tag == TOKEN::LPAR) {
     Match(TOKEN::LPAR);
     auto expr = Expression();
@@ -44,22 +45,14 @@ std::unique_ptr<Expr> Parser::PrimaryExpression() {
   }
 }
 
-std::unique_ptr<Expr> Parser::Expression() {
-  auto snapshot = LexerSnapShot();
+Expr *Parser::Expression() {
   auto expr = AssignmentExpr();
   if (!expr) {
-#ifdef DEBUG
-    std::cout << "Expression failed: in AssignmentExpr()" << std::endl;
-#endif
-    LexerPutBack(snapshot);
+    TRACE(EXPRESSIONS, "Expression failed: in AssignmentExpr()\n");
     return nullptr;
   }
-#ifdef DEBUG
-  print_line();
-  std::cout << "Expression: succeeded: " << std::endl;
-  std::cout << *expr << std::endl;
-  print_line();
-#endif
+  TRACE(EXPRESSIONS, Trace::RULE << "Expression: succeeded: \n" << *expr << '\n'
+        << Trace::RULE);
   return expr;
   // TODO: expression, assignment-expression
 }
@@ -80,43 +73,29 @@ std::unique_ptr<Expr> Parser::Expression() {
  *    | -- postfix-expression'
  *    | $epsilon$
  */
-std::unique_ptr<Expr> Parser::PostfixExpr() {
-  auto snapshot = LexerSnapShot();
+Expr *Parser::PostfixExpr() {
   auto expr = PrimaryExpression();
   if (!expr) {
-#ifdef DEBUG
-    std::cout << "Postfix Expression failed: in PrimaryExpression."
-              << std::endl;
-#endif
-    LexerPutBack(snapshot);
+    TRACE(EXPRESSIONS, "Postfix Expression failed: in PrimaryExpression.\n");
     return nullptr;
   }
   auto postfix_expr_success = PostfixExprPrime(expr);
   if (postfix_expr_success) {
-#ifdef DEBUG
-    print_line();
-    std::cout << "Postfix: succeeded: " << std::endl;
-    std::cout << *expr << std::endl;
-    print_line();
-#endif
+    TRACE(EXPRESSIONS, Trace::RULE << "Postfix: succeeded: \n" << *expr << '\n'
+          << Trace::RULE);
     return expr;
   } else {
-#ifdef DEBUG
-    std::cout << "Postfix Expression failed: in PostfixPrime(expr)."
-              << std::endl;
-#endif
-    LexerPutBack(snapshot);
+    TRACE(EXPRESSIONS, "Postfix Expression failed: in PostfixPrime(expr).\n");
     return nullptr;
   }
   // TODO: support compound literal feature.
   // Error("Compound literals feature is not supported yet.");
 }
 
-bool Parser::PostfixExprPrime(std::unique_ptr<Expr> &expr) {
-  auto snapshot = LexerSnapShot();
+bool Parser::PostfixExprPrime(Expr *&expr) {
   auto token = PeekToken();
   bool scan_success = true;
-  switch (token->tag()) {
+  switch (token.tag()) {
   case TOKEN::LSQUBRKT:
     scan_success = ArraySubscripting(expr);
     break;
@@ -139,10 +118,7 @@ bool Parser::PostfixExprPrime(std::unique_ptr<Expr> &expr) {
   if (scan_success) {
     return PostfixExprPrime(expr);
   } else {
-#ifdef DEBUG
-    std::cout << "!!! Postfix Expression Prime failed!" << std::endl;
-#endif
-    LexerPutBack(snapshot);
+    TRACE(EXPRESSIONS, "!!! Postfix Expression Prime failed!\n");
     return false;
   }
 }
@@ -152,59 +128,52 @@ bool Parser::PostfixExprPrime(std::unique_ptr<Expr> &expr) {
  * syntax sugar for equivalent expression:
  * *(ptr + offset)
  */
-bool Parser::ArraySubscripting(std::unique_ptr<Expr> &expr) {
-  auto snapshot = LexerSnapShot();
+bool Parser::ArraySubscripting(Expr *&expr) {
   auto token = PeekToken();
   Match(TOKEN::LSQUBRKT);
   auto offset = Expression();
   if (!offset) {
-#ifdef DEBUG
-    std::cout << "!!! Array Subscripting failed!" << std::endl;
-#endif
-    LexerPutBack(snapshot);
+    TRACE(EXPRESSIONS, "!!! Array Subscripting failed!\n");
     return false;
   }
   Match(TOKEN::RSQUBRKT);
   // Handle ptr_to = ptr + offset
-  std::unique_ptr<Expr> point_to =
-      std::make_unique<BinaryOperatorExpr>(OP::PLUS, expr, offset);
+  Expr *point_to =
+      MakeNode<BinaryOperatorExpr>(OP::PLUS, expr, offset);
   // return dereference(ptr_to)
   auto dereference =
-      std::make_unique<UnaryOperatorExpr>(OP::DEREFERENCE, point_to, token);
-  expr = std::move(dereference);
+      MakeNode<UnaryOperatorExpr>(OP::DEREFERENCE, point_to, token);
+  expr = dereference;
   return true;
 }
 
-bool Parser::FunctionCall(std::unique_ptr<Expr> &designator) {
-  auto snapshot = LexerSnapShot();
+bool Parser::FunctionCall(Expr *&designator) {
   auto token = PeekToken();
   Match(TOKEN::LPAR);
-  auto function_call = std::make_unique<FunctionCallExpr>(designator, token);
+  auto function_call = MakeNode<FunctionCallExpr>(designator, token);
   if (PeekToken(TOKEN::RPAR)) {
     Match(TOKEN::RPAR);
-    designator = std::move(function_call);
+    designator = function_call;
   } else {
     auto argument_expression_list = ArgumentExpressionList();
     if (argument_expression_list.size() == 0) {
-#ifdef DEBUG
-      std::cout << "!!! Function Call failed!" << std::endl;
-#endif
-      LexerPutBack(snapshot);
+      TRACE(EXPRESSIONS, "!!! Function Call failed!\n");
       return false;
     }
-    function_call->AddParameters(argument_expression_list);
+    function_call->set_parameters(
+        _ast_arena.NewArray(argument_expression_list));
     Match(TOKEN::RPAR);
-    designator = std::move(function_call);
+    designator = function_call;
   }
   return true;
 }
 
-std::vector<std::unique_ptr<Expr>> Parser::ArgumentExpressionList() {
-  std::vector<std::unique_ptr<Expr>> argument_expressions;
+std::vector<Expr *> Parser::ArgumentExpressionList() {
+  std::vector<Expr *> argument_expressions;
   return argument_expressions;
 }
 
-bool Parser::MemberReference(std::unique_ptr<Expr> &ptr) {
+bool Parser::MemberReference(Expr *&ptr) {
   OP op;
   if (PeekToken(TOKEN::PTR_MEM_REF)) {
     Match(TOKEN::PTR_MEM_REF);
@@ -217,26 +186,26 @@ bool Parser::MemberReference(std::unique_ptr<Expr> &ptr) {
   }
   auto token = PeekToken();
   Match(TOKEN::IDENTIFIER);
-  std::unique_ptr<Expr> identifier = std::make_unique<Identifier>(
+  Expr *identifier = MakeNode<Identifier>(
       token, IdentifierNameSpace::STRUCT_UNION_MEM);
-  auto expr = std::make_unique<BinaryOperatorExpr>(op, ptr, identifier, token);
-  ptr = std::move(expr);
+  auto expr = MakeNode<BinaryOperatorExpr>(op, ptr, identifier, token);
+  ptr = expr;
   return true;
 }
 
-bool Parser::PostfixIncrement(std::unique_ptr<Expr> &operand) {
+bool Parser::PostfixIncrement(Expr *&operand) {
   auto token = Match(TOKEN::INCREMENT);
   auto expr =
-      std::make_unique<UnaryOperatorExpr>(OP::POSTFIX_INC, operand, token);
-  operand = std::move(expr);
+      MakeNode<UnaryOperatorExpr>(OP::POSTFIX_INC, operand, token);
+  operand = expr;
   return true;
 }
 
-bool Parser::PostfixDecrement(std::unique_ptr<Expr> &operand) {
+bool Parser::PostfixDecrement(Expr *&operand) {
   auto token = Match(TOKEN::DECREMENT);
   auto expr =
-      std::make_unique<UnaryOperatorExpr>(OP::POSTFIX_DEC, operand, token);
-  operand = std::move(expr);
+      MakeNode<UnaryOperatorExpr>(OP::POSTFIX_DEC, operand, token);
+  operand = expr;
   return true;
 }
 
@@ -245,29 +214,20 @@ bool Parser::PostfixDecrement(std::unique_ptr<Expr> &operand) {
 //   return nullptr;
 // }
 
-std::unique_ptr<Expr> Parser::UnaryExpr() {
-  auto snapshot = LexerSnapShot();
+Expr *Parser::UnaryExpr() {
   auto token = PeekToken();
-  auto tag = token->tag();
+  auto tag = token.tag();
   if (tag == TOKEN::INCREMENT) {
     return PrefixIncrement();
   } else if (tag == TOKEN::DECREMENT) {
     auto expr = PrefixDecrement();
-#ifdef DEBUG
-    print_line();
-    std::cout << "Unary Expr: succeeded: " << std::endl;
-    std::cout << *expr << std::endl;
-    print_line();
-#endif
+    TRACE(EXPRESSIONS, Trace::RULE << "Unary Expr: succeeded: \n" << *expr
+          << '\n' << Trace::RULE);
     return expr;
   } else if (tag == TOKEN::SIZEOF) {
     auto expr = Sizeof();
-#ifdef DEBUG
-    print_line();
-    std::cout << "Unary Expr: succeeded: " << std::endl;
-    std::cout << *expr << std::endl;
-    print_line();
-#endif
+    TRACE(EXPRESSIONS, Trace::RULE << "Unary Expr: succeeded: \n" << *expr
+          << '\n' << Trace::RULE);
     return expr;
   } else if (tag == TOKEN::ALIGNOF) {
     return nullptr; // TODO
@@ -290,60 +250,49 @@ std::unique_ptr<Expr> Parser::UnaryExpr() {
     auto token = ConsumeToken();
     auto operand = CastExpr();
     if (!operand) {
-      LexerPutBack(snapshot);
       return nullptr;
     }
-    auto expr = std::make_unique<UnaryOperatorExpr>(op, operand, token);
-#ifdef DEBUG
-    print_line();
-    std::cout << "Unary Expr: succeeded: " << std::endl;
-    std::cout << *expr << std::endl;
-    print_line();
-#endif
+    auto expr = MakeNode<UnaryOperatorExpr>(op, operand, token);
+    TRACE(EXPRESSIONS, Trace::RULE << "Unary Expr: succeeded: \n" << *expr
+          << '\n' << Trace::RULE);
     return expr;
   } else {
     return PostfixExpr();
   }
 }
 
-std::unique_ptr<Expr> Parser::PrefixIncrement() {
-  auto snapshot = LexerSnapShot();
+Expr *Parser::PrefixIncrement() {
   auto token = PeekToken();
   Match(TOKEN::INCREMENT);
   auto operand = UnaryExpr();
   if (!operand) {
-    LexerPutBack(snapshot);
     return nullptr;
   }
   auto expr =
-      std::make_unique<UnaryOperatorExpr>(OP::PREFIX_INC, operand, token);
+      MakeNode<UnaryOperatorExpr>(OP::PREFIX_INC, operand, token);
   return expr;
 }
 
-std::unique_ptr<Expr> Parser::PrefixDecrement() {
-  auto snapshot = LexerSnapShot();
+Expr *Parser::PrefixDecrement() {
   auto token = PeekToken();
   Match(TOKEN::DECREMENT);
   auto operand = UnaryExpr();
   if (!operand) {
-    LexerPutBack(snapshot);
     return nullptr;
   }
   auto expr =
-      std::make_unique<UnaryOperatorExpr>(OP::PREFIX_DEC, operand, token);
+      MakeNode<UnaryOperatorExpr>(OP::PREFIX_DEC, operand, token);
   return expr;
 }
 
-std::unique_ptr<Expr> Parser::Sizeof() {
-  auto snapshot = LexerSnapShot();
+Expr *Parser::Sizeof() {
   auto token = Match(TOKEN::SIZEOF);
   auto expr = UnaryExpr();
   if (!expr) {
-    LexerPutBack(snapshot);
     return nullptr;
   }
   auto sizeof_expr =
-      std::make_unique<UnaryOperatorExpr>(OP::SIZEOF, expr, token);
+      MakeNode<UnaryOperatorExpr>(OP::SIZEOF, expr, token);
   // TODO: sizeof (type-name)
   return sizeof_expr;
 }
@@ -352,769 +301,194 @@ std::unique_ptr<Expr> Parser::Sizeof() {
 
 // Token *Parser::UnaryOperator() { return ConsumeToken(); }
 
-std::unique_ptr<Expr> Parser::CastExpr() {
+Expr *Parser::CastExpr() {
   if (PeekToken(TOKEN::LPAR) && false) {
     // TODO: Handle ( type-name ) cast-expresssion
     return nullptr;
   }
-  auto snapshot = LexerSnapShot();
-  auto expr = UnaryExpr();
-  if (expr) {
-    return expr;
-  } else {
-    LexerPutBack(snapshot);
-    return nullptr;
-  }
-}
-
-/**
- * multiplicative-expression  ->
- *                             cast-expression
- *                           | multiplicative-expression * cast-expression
- *                           | multiplicative-expression / cast-expression
- *                           | multiplicative-expression % cast-expression
- *
- * which is a left recursive formula and can be re-written as:
- * multiplicative-expression  ->
- *                             cast-expression multiplicative-expression'
- * multiplicative-expression' ->
- *                             * cast-expression multiplicative-expression'
- *                           | / cast-expression multiplicative-expression'
- *                           | % cast-expression multiplicative-expression'
- *                           | $\epsilon$
- */
-std::unique_ptr<Expr> Parser::MultiplicativeExpr() {
-  auto snapshot = LexerSnapShot();
-  auto expr1 = CastExpr();
-  if (!expr1) {
-#ifdef DEBUG
-    std::cout << "MultiplicativeExpr: failed at CastExpr()." << std::endl;
-#endif
-    LexerPutBack(snapshot);
-    return nullptr;
-  }
-#ifdef DEBUG
-  print_line();
-  std::cout << "MultiplicativeExpr: CastExpr succeeded: " << std::endl;
-  std::cout << *expr1 << std::endl;
-  print_line();
-#endif
-  if (MultiplicativeExprPrime(expr1)) {
-#ifdef DEBUG
-    print_line();
-    std::cout << "MultiplicativeExpr: succeeded, and returned " << std::endl;
-    std::cout << *expr1 << std::endl;
-    print_line();
-#endif
-    return expr1;
-  } else {
-#ifdef DEBUG
-    std::cout << "MultiplicativeExpr: failed at MultiplicativExprPrime(expr1)."
-              << std::endl;
-#endif
-    LexerPutBack(snapshot);
-    return nullptr;
-  }
+  return UnaryExpr();
 }
 
-bool Parser::MultiplicativeExprPrime(std::unique_ptr<Expr> &operand1) {
-  auto snapshot = LexerSnapShot();
-  auto token = PeekToken();
-  auto tag = token->tag();
-  if (tag == TOKEN::STAR) {
-    Match(TOKEN::STAR);
-    auto operand2 = CastExpr();
-    if (!operand2) {
-      LexerPutBack(snapshot);
-      return false;
-    }
-    operand1 = std::make_unique<BinaryOperatorExpr>(OP::MULTIPLY, operand1,
-                                                    operand2, token);
-  } else if (tag == TOKEN::DIV) {
-    Match(TOKEN::DIV);
-    auto operand2 = CastExpr();
-    if (!operand2) {
-      LexerPutBack(snapshot);
-      return false;
-    }
-    operand1 = std::make_unique<BinaryOperatorExpr>(OP::DIVIDE, operand1,
-                                                    operand2, token);
-  } else if (tag == TOKEN::MOD) {
-    Match(TOKEN::MOD);
-    auto operand2 = CastExpr();
-    if (!operand2) {
-      LexerPutBack(snapshot);
-      return false;
-    }
-    operand1 = std::make_unique<BinaryOperatorExpr>(OP::MOD, operand1, operand2,
-                                                    token);
-  } else {
-    return true;
-  }
-  auto res = MultiplicativeExprPrime(operand1);
-  if (res) {
-    return true;
-  } else {
-    LexerPutBack(snapshot);
-    return false;
-  }
-}
-
-/**
- * additive-expression  ->
- *                          multiplicative-expression
- *                          | additive-expression + multiplicative-expression
- *                          | additive-expression - multiplicative-expression
- *
- * which is a left recursive formula and can be re-written as:
- * additive-expression  ->
- *                             multiplicative additive-expression'
- * additive-expression' ->
- *                             + multiplicative-expression
- additive-expression'
- *                           | - multiplicative-expression
- additive-expression'
- *                           | $\epsilon$
- */
-std::unique_ptr<Expr> Parser::AdditiveExpr() {
-  auto snapshot = LexerSnapShot();
-  auto operand1 = MultiplicativeExpr();
-  if (!operand1) {
-#ifdef DEBUG
-    std::cout << "AdditiveExpr: failed at MultiplicativeExpr()." << std::endl;
-#endif
-    LexerPutBack(snapshot);
-    return nullptr;
-  }
-#ifdef DEBUG
-  print_line();
-  std::cout << "AdditiveExpr: MultiplicativeExpr succeeded: " << std::endl;
-  std::cout << *operand1 << std::endl;
-  print_line();
-#endif
-  if (AdditiveExprPrime(operand1)) {
-#ifdef DEBUG
-    print_line();
-    std::cout << "AdditiveExpr: succeeded: " << std::endl;
-    std::cout << *operand1 << std::endl;
-    print_line();
-#endif
-    return operand1;
-  } else {
-#ifdef DEBUG
-    std::cout << "AdditiveExpr: failed at AdditiveExprPrime(operand1)."
-              << std::endl;
-#endif
-    LexerPutBack(snapshot);
-    return nullptr;
-  }
-}
-
-bool Parser::AdditiveExprPrime(std::unique_ptr<Expr> &operand1) {
-  auto snapshot = LexerSnapShot();
-  auto token = PeekToken();
-  auto tag = token->tag();
-  if (tag == TOKEN::ADD) {
-    Match(TOKEN::ADD);
-    auto operand2 = MultiplicativeExpr();
-    if (!operand2) {
-      LexerPutBack(snapshot);
-      return false;
-    }
-    operand1 = std::make_unique<BinaryOperatorExpr>(OP::PLUS, operand1,
-                                                    operand2, token);
-  } else if (tag == TOKEN::SUB) {
-    Match(TOKEN::SUB);
-    auto operand2 = MultiplicativeExpr();
-    if (!operand2) {
-      LexerPutBack(snapshot);
-      return false;
-    }
-    operand1 = std::make_unique<BinaryOperatorExpr>(OP::MINUS, operand1,
-                                                    operand2, token);
-  } else {
-    return true;
-  }
-  auto res = AdditiveExprPrime(operand1);
-  if (res) {
-    return true;
-  } else {
-    LexerPutBack(snapshot);
-    return false;
-  }
-}
+namespace {
 
 /**
- * shift-expression  ->
- *                      additive-expression
- *                    | shift-expression << additive-expression
- *                    | shift-expression >> additive-expression
- * which is a left recursive formula and can be re-written as:
- *
- * shift-expression  ->
- *                      additive-expression shift-expression'
- * shift-expression' ->
- *                      << additive-expression shift-expression'
- *                    | >> additive-expression shift-expression'
- *                    | ${epsilon}
+ * Binding strength of the binary operators, loosest first. Every level of
+ * the standard's expression grammar from logical-OR-expression down to
+ * multiplicative-expression is one entry here, and all of them associate
+ * to the left.
  */
-std::unique_ptr<Expr> Parser::ShiftExpr() {
-  auto snapshot = LexerSnapShot();
-  auto operand1 = AdditiveExpr();
-  if (!operand1) {
-#ifdef DEBUG
-    std::cout << "ShiftExpr: failed at AdditiveExpr()." << std::endl;
-#endif
-    LexerPutBack(snapshot);
-    return nullptr;
-  }
-  if (ShiftExprPrime(operand1)) {
-#ifdef DEBUG
-    print_line();
-    std::cout << "ShiftExpr: succeeded: " << std::endl;
-    std::cout << *operand1 << std::endl;
-    print_line();
-#endif
-    return operand1;
-  } else {
-#ifdef DEBUG
-    std::cout << "ShiftExpr: failed at ShiftExprPrime(operand1)." << std::endl;
-#endif
-    LexerPutBack(snapshot);
-    return nullptr;
-  }
-}
-
-bool Parser::ShiftExprPrime(std::unique_ptr<Expr> &operand1) {
-  auto snapshot = LexerSnapShot();
-  auto token = PeekToken();
-  auto tag = token->tag();
-  if (tag == TOKEN::LEFT_SHIFT) {
-    Match(TOKEN::LEFT_SHIFT);
-    auto operand2 = AdditiveExpr();
-    if (!operand2) {
-      LexerPutBack(snapshot);
-      return false;
-    }
-    operand1 = std::make_unique<BinaryOperatorExpr>(OP::LEFT_SHIFT, operand1,
-                                                    operand2, token);
-  } else if (tag == TOKEN::RIGHT_SHIFT) {
-    Match(TOKEN::RIGHT_SHIFT);
-    auto operand2 = AdditiveExpr();
-    if (!operand2) {
-      LexerPutBack(snapshot);
-      return false;
-    }
-    operand1 = std::make_unique<BinaryOperatorExpr>(OP::RIGHT_SHIFT, operand1,
-                                                    operand2, token);
-  } else {
-    return true;
-  }
-  auto res = ShiftExprPrime(operand1);
-  if (res) {
-    return true;
-  } else {
-    LexerPutBack(snapshot);
-    return false;
-  }
-}
+enum Precedence : uint8_t {
+  NOT_BINARY = 0,
+  LOGICAL_OR_PRECEDENCE,
+  LOGICAL_AND_PRECEDENCE,
+  OR_PRECEDENCE,
+  XOR_PRECEDENCE,
+  AND_PRECEDENCE,
+  EQUALITY_PRECEDENCE,
+  RELATIONAL_PRECEDENCE,
+  SHIFT_PRECEDENCE,
+  ADDITIVE_PRECEDENCE,
+  MULTIPLICATIVE_PRECEDENCE,
+};
+
+struct OperatorInfo {
+  uint8_t precedence = NOT_BINARY;
+  bool assignment = false;
+  OP op = OP::PLUS;
+};
+
+constexpr std::array<OperatorInfo, 256> MakeOperatorTable() {
+  std::array<OperatorInfo, 256> table{};
+  auto binary = [&table](TOKEN tag, Precedence precedence, OP op) {
+    table[static_cast<uint8_t>(tag)] = {precedence, false, op};
+  };
+  auto assignment = [&table](TOKEN tag, OP op) {
+    table[static_cast<uint8_t>(tag)] = {NOT_BINARY, true, op};
+  };
+  binary(TOKEN::LOGICAL_OR, LOGICAL_OR_PRECEDENCE, OP::LOGICAL_OR);
+  binary(TOKEN::LOGICAL_AND, LOGICAL_AND_PRECEDENCE, OP::LOGICAL_AND);
+  binary(TOKEN::OR, OR_PRECEDENCE, OP::OR);
+  binary(TOKEN::XOR, XOR_PRECEDENCE, OP::XOR);
+  binary(TOKEN::AND, AND_PRECEDENCE, OP::AND);
+  binary(TOKEN::EQ, EQUALITY_PRECEDENCE, OP::EQ);
+  binary(TOKEN::NE, EQUALITY_PRECEDENCE, OP::NE);
+  binary(TOKEN::LESS, RELATIONAL_PRECEDENCE, OP::LESS);
+  binary(TOKEN::GREATER, RELATIONAL_PRECEDENCE, OP::GREATER);
+  binary(TOKEN::LE, RELATIONAL_PRECEDENCE, OP::LE);
+  binary(TOKEN::GE, RELATIONAL_PRECEDENCE, OP::GE);
+  binary(TOKEN::LEFT_SHIFT, SHIFT_PRECEDENCE, OP::LEFT_SHIFT);
+  binary(TOKEN::RIGHT_SHIFT, SHIFT_PRECEDENCE, OP::RIGHT_SHIFT);
+  binary(TOKEN::ADD, ADDITIVE_PRECEDENCE, OP::PLUS);
+  binary(TOKEN::SUB, ADDITIVE_PRECEDENCE, OP::MINUS);
+  binary(TOKEN::STAR, MULTIPLICATIVE_PRECEDENCE, OP::MULTIPLY);
+  binary(TOKEN::DIV, MULTIPLICATIVE_PRECEDENCE, OP::DIVIDE);
+  binary(TOKEN::MOD, MULTIPLICATIVE_PRECEDENCE, OP::MOD);
+  assignment(TOKEN::ASSIGN, OP::ASSIGN);
+  assignment(TOKEN::MUL_ASSIGN, OP::MULTIPLY_ASSIGN);
+  assignment(TOKEN::DIV_ASSIGN, OP::DIVIDE_ASSIGN);
+  assignment(TOKEN::MOD_ASSIGN, OP::MOD_ASSIGN);
+  assignment(TOKEN::ADD_ASSIGN, OP::PLUS_ASSIGN);
+  assignment(TOKEN::SUB_ASSIGN, OP::MINUS_ASSIGN);
+  assignment(TOKEN::LEFT_ASSIGN, OP::LEFT_SHIFT_ASSIGN);
+  assignment(TOKEN::RIGHT_ASSIGN, OP::RIGHT_SHIFT_ASSIGN);
+  assignment(TOKEN::AND_ASSIGN, OP::AND_ASSIGN);
+  assignment(TOKEN::XOR_ASSIGN, OP::XOR_ASSIGN);
+  assignment(TOKEN::OR_ASSIGN, OP::OR_ASSIGN);
+  return table;
+}
+
+constexpr auto OPERATORS = MakeOperatorTable();
+
+inline const OperatorInfo &Operator(TOKEN tag) {
+  return OPERATORS[static_cast<uint8_t>(tag)];
+}
+
+} // namespace
 
 /**
- * relational-expression  ->
- *                            shift-expression
- *                          | relational-expression < shift-expression
- *                          | relational-expression > shift-expression
- *                          | relational-expression <= shift-expression
- *                          | relational-expression >= shift-expression
+ * multiplicative-expression, additive-expression, ... up to
+ * logical-OR-expression, by precedence climbing:
  *
- * which is a left recursive formula and can be re-written as:
+ *   binary-expression(p) ->
+ *       cast-expression { binary-operator(q >= p) binary-expression(q + 1) }
  *
- * relational-expression  ->
- *                            shift-expression relational-expression'
- * relational-expression' ->  < shift-expression relational-expression'
- *                          | > shift-expression relational-expression'
- *                          | >= shift-expression relational-expression'
- *                          | <= shift-expression relational-expression'
- *                          | ${epsilon}
+ * `operand` is the cast-expression that has already been parsed. The loop
+ * folds operators of the same level to the left, and recursion only goes
+ * one level deeper for each operator that binds tighter than the one before
+ * it, so a lone primary expression costs no recursion at all (the
+ * standard's grammar goes through ten levels for it).
  */
-std::unique_ptr<Expr> Parser::RelationalExpr() {
-  auto snapshot = LexerSnapShot();
-  auto operand1 = ShiftExpr();
-  if (!operand1) {
-#ifdef DEBUG
-    std::cout << "RelationalExpr: failed at ShiftExpr()." << std::endl;
-#endif
-    LexerPutBack(snapshot);
-    return nullptr;
-  }
-#ifdef DEBUG
-  print_line();
-  std::cout << "RelationalExpr: succeeded: " << std::endl;
-  std::cout << *operand1 << std::endl;
-  print_line();
-#endif
-  if (RelationalExprPrime(operand1)) {
-    return operand1;
-  } else {
-    LexerPutBack(snapshot);
-    return nullptr;
-  }
-}
-
-bool Parser::RelationalExprPrime(std::unique_ptr<Expr> &operand1) {
-  auto snapshot = LexerSnapShot();
-  auto token = PeekToken();
-  auto tag = token->tag();
-
-  if (tag == TOKEN::LESS) {
-    Match(TOKEN::LESS);
-    auto operand2 = ShiftExpr();
-    if (!operand2) {
-      LexerPutBack(snapshot);
-      return false;
-    }
-    operand1 = std::make_unique<BinaryOperatorExpr>(OP::LESS, operand1,
-                                                    operand2, token);
-  } else if (tag == TOKEN::GREATER) {
-    Match(TOKEN::GREATER);
-    auto operand2 = ShiftExpr();
-    if (!operand2) {
-      LexerPutBack(snapshot);
-      return false;
+Expr *Parser::BinaryExprRest(Expr *operand, unsigned min_precedence) {
+  for (;;) {
+    auto token = PeekToken();
+    auto &info = Operator(token.tag());
+    if (info.precedence == NOT_BINARY || info.precedence < min_precedence) {
+      return operand;
     }
-    operand1 = std::make_unique<BinaryOperatorExpr>(OP::GREATER, operand1,
-                                                    operand2, token);
-  } else if (tag == TOKEN::LE) {
-    Match(TOKEN::LE);
-    auto operand2 = ShiftExpr();
+    ConsumeToken();
+    auto operand2 = CastExpr();
     if (!operand2) {
-      LexerPutBack(snapshot);
-      return false;
+      TRACE(EXPRESSIONS, "BinaryExpr: failed at CastExpr() after "
+            << Expr::op_to_string.at(info.op) << ".\n");
+      return nullptr;
     }
-    operand1 =
-        std::make_unique<BinaryOperatorExpr>(OP::LE, operand1, operand2, token);
-  } else if (tag == TOKEN::GE) {
-    Match(TOKEN::GE);
-    auto operand2 = ShiftExpr();
-    if (!operand2) {
-      LexerPutBack(snapshot);
-      return false;
+    while (Operator(PeekToken().tag()).precedence > info.precedence) {
+      operand2 = BinaryExprRest(operand2, info.precedence + 1);
+      if (!operand2) {
+        return nullptr;
+      }
     }
-    operand1 =
-        std::make_unique<BinaryOperatorExpr>(OP::GE, operand1, operand2, token);
-  } else {
-    return true;
-  }
-  auto res = RelationalExprPrime(operand1);
-  if (res) {
-    return true;
-  } else {
-    LexerPutBack(snapshot);
-    return false;
+    operand = MakeNode<BinaryOperatorExpr>(info.op, operand, operand2, token);
   }
 }
 
 /**
- * equality-expression  ->
- *                            relational-expression
- *                          | equality-expression == relational-expression
- *                          | equality-expression != relational-expression
- *
- * which is a left recursive formula and can be re-written as:
+ * conditional-expression ->
+ *                          logical-OR-expression
+ *                        | logical-OR-expression ? expression :
+ *                              conditional-expression
  *
- * equality-expression  ->
- *                            relational-expression equality-expression'
- * equality-expression' ->
- *                            == relational-expression equality-expression'
- *                          | != relational-expression equality-expression'
- *                          | ${epsilon}
+ * `cond` is the logical-OR-expression that has already been parsed.
  */
-std::unique_ptr<Expr> Parser::EqualityExpr() {
-  auto snapshot = LexerSnapShot();
-  auto operand1 = RelationalExpr();
-  if (!operand1) {
-    LexerPutBack(snapshot);
-    return nullptr;
-  }
-  if (EqualityExprPrime(operand1)) {
-    return operand1;
-  } else {
-    return nullptr;
-  }
-}
-
-bool Parser::EqualityExprPrime(std::unique_ptr<Expr> &operand1) {
-  auto snapshot = LexerSnapShot();
+Expr *Parser::ConditionalExprRest(Expr *cond) {
   auto token = PeekToken();
-  auto tag = token->tag();
-  if (tag == TOKEN::EQ) {
-    Match(TOKEN::EQ);
-    auto operand2 = RelationalExpr();
-    if (!operand2) {
-      LexerPutBack(snapshot);
-      return false;
-    }
-    operand1 =
-        std::make_unique<BinaryOperatorExpr>(OP::EQ, operand1, operand2, token);
-  } else if (tag == TOKEN::NE) {
-    Match(TOKEN::NE);
-    auto operand2 = RelationalExpr();
-    if (!operand2) {
-      LexerPutBack(snapshot);
-      return false;
-    }
-    operand1 =
-        std::make_unique<BinaryOperatorExpr>(OP::NE, operand1, operand2, token);
-  } else {
-    return true;
-  }
-  auto res = EqualityExprPrime(operand1);
-  if (res) {
-    return true;
-  } else {
-    LexerPutBack(snapshot);
-    return false;
+  if (!cond || token.tag() != TOKEN::COND) {
+    return cond;
   }
-}
-
-/**
- * AND-expression  ->
- *                            equality-expression
- *                          | AND-expression & equality-expression
- *
- * which is a left recursive formula and is needed to be re-written.
- */
-std::unique_ptr<Expr> Parser::ANDExpr() {
-  auto snapshot = LexerSnapShot();
-  auto operand1 = EqualityExpr();
-  if (!operand1) {
-    LexerPutBack(snapshot);
+  Match(TOKEN::COND);
+  auto true_operand = Expression();
+  if (!true_operand) {
     return nullptr;
   }
-  if (ANDExprPrime(operand1)) {
-    return operand1;
-  } else {
-    LexerPutBack(snapshot);
+  Match(TOKEN::COLON);
+  auto false_operand = ConditionalExpr();
+  if (!false_operand) {
     return nullptr;
   }
+  return MakeNode<TenaryOperatorExpr>(
+      OP::COND, OP::COLON, cond, true_operand, false_operand, token);
 }
 
-bool Parser::ANDExprPrime(std::unique_ptr<Expr> &operand1) {
-  auto snapshot = LexerSnapShot();
-  auto token = PeekToken();
-  auto tag = token->tag();
-  if (tag == TOKEN::AND) {
-    Match(TOKEN::AND);
-    auto operand2 = EqualityExpr();
-    if (!operand2) {
-      LexerPutBack(snapshot);
-      return false;
-    }
-    operand1 = std::make_unique<BinaryOperatorExpr>(OP::AND, operand1, operand2,
-                                                    token);
-    auto res = ANDExprPrime(operand1);
-    if (res) {
-      return true;
-    } else {
-      LexerPutBack(snapshot);
-      return false;
-    }
-  } else {
-    return true;
-  }
-}
-
-/**
- * XOR-expression   ->
- *                        AND-expression
- *                      | XOR-expression ^ AND-expression
- *
- * which is a left-recursive expression, and needed to be rewritten as:
- *
- * XOR-expression   ->    AND-expression XOR-expression'
- * XOR-expression'  ->    ^ AND-expression XOR-expression'
- *                      | ${epsilon}
- */
-std::unique_ptr<Expr> Parser::XORExpr() {
-  auto snapshot = LexerSnapShot();
-  auto operand1 = ANDExpr();
-  if (!operand1) {
-    LexerPutBack(snapshot);
-    return nullptr;
-  }
-  if (XORExprPrime(operand1)) {
-    return operand1;
-  } else {
-    LexerPutBack(snapshot);
+Expr *Parser::ConditionalExpr() {
+  auto operand = CastExpr();
+  if (!operand) {
     return nullptr;
   }
-}
-
-bool Parser::XORExprPrime(std::unique_ptr<Expr> &operand1) {
-  auto snapshot = LexerSnapShot();
-  auto token = PeekToken();
-  auto tag = token->tag();
-  if (tag == TOKEN::XOR) {
-    Match(TOKEN::XOR);
-    auto operand2 = ANDExpr();
-    if (!operand2) {
-      LexerPutBack(snapshot);
-      return false;
-    }
-    operand1 = std::make_unique<BinaryOperatorExpr>(OP::XOR, operand1, operand2,
-                                                    token);
-    return XORExprPrime(operand1);
-  } else {
-    return true;
-  }
+  return ConditionalExprRest(BinaryExprRest(operand, LOGICAL_OR_PRECEDENCE));
 }
 
 /**
- * OR-expression    ->
- *                      XOR-expression
- *                      OR-expression | XOR-expression
- * which is a left recursive expression, and needed to be rewritten as:
- * OR-expression    ->
- *                      XOR-expression OR-expression'
- * OR-expression'   ->  | XOR-expression OR-expression'
- *                  ->  ${epsilon}
+ * assignment-expression ->
+ *                          conditional-expression
+ *                        | unary-expression assignment-operator
+ *                              assignment-expression
+ *
+ * Both alternatives start with a cast-expression (casts are not parsed yet,
+ * so that is a unary-expression), which is parsed once and then either
+ * assigned to or continued as the first operand of a conditional-expression.
  */
-std::unique_ptr<Expr> Parser::ORExpr() {
-  auto snapshot = LexerSnapShot();
-  auto operand1 = XORExpr();
-  if (!operand1) {
-    LexerPutBack(snapshot);
-    return nullptr;
-  }
-  if (ORExprPrime(operand1)) {
-    return operand1;
-  } else {
-    LexerPutBack(snapshot);
-    return nullptr;
-  }
-}
-
-bool Parser::ORExprPrime(std::unique_ptr<Expr> &operand1) {
-  auto snapshot = LexerSnapShot();
-  auto token = PeekToken();
-  auto tag = token->tag();
-  if (tag == TOKEN::OR) {
-    Match(TOKEN::OR);
-    auto operand2 = XORExpr();
-    if (!operand2) {
-      LexerPutBack(snapshot);
-      return false;
-    }
-    operand1 =
-        std::make_unique<BinaryOperatorExpr>(OP::OR, operand1, operand2, token);
-    auto res = ORExprPrime(operand1);
-    if (res) {
-      return true;
-    } else {
-      LexerPutBack(snapshot);
-      return false;
-    }
-  } else {
-    return true;
-  }
-}
-
-std::unique_ptr<Expr> Parser::LogicalANDExpr() {
-  auto snapshot = LexerSnapShot();
-  auto operand1 = ORExpr();
-  if (!operand1) {
-    LexerPutBack(snapshot);
-    return nullptr;
-  }
-  if (LogicalANDExprPrime(operand1)) {
-    return operand1;
-  } else {
-    LexerPutBack(snapshot);
-    return nullptr;
-  }
-}
-
-bool Parser::LogicalANDExprPrime(std::unique_ptr<Expr> &operand1) {
-  auto snapshot = LexerSnapShot();
-  auto token = PeekToken();
-  auto tag = token->tag();
-  if (tag == TOKEN::LOGICAL_AND) {
-    Match(TOKEN::LOGICAL_AND);
-    auto operand2 = ORExpr();
-    if (!operand2) {
-      LexerPutBack(snapshot);
-      return false;
-    }
-    operand1 = std::make_unique<BinaryOperatorExpr>(OP::LOGICAL_AND, operand1,
-                                                    operand2, token);
-    auto res = LogicalANDExprPrime(operand1);
-    if (res) {
-      return true;
-    } else {
-      LexerPutBack(snapshot);
-      return false;
-    }
-  } else {
-    return true;
-  }
-}
-
-std::unique_ptr<Expr> Parser::LogicalORExpr() {
-  auto snapshot = LexerSnapShot();
-  auto operand1 = LogicalANDExpr();
-  if (!operand1) {
-    LexerPutBack(snapshot);
-    return nullptr;
-  }
-  if (LogicalORExprPrime(operand1)) {
-    return operand1;
-  } else {
-    LexerPutBack(snapshot);
-    return nullptr;
-  }
-}
-
-bool Parser::LogicalORExprPrime(std::unique_ptr<Expr> &operand1) {
-  auto snapshot = LexerSnapShot();
-  auto token = PeekToken();
-  auto tag = token->tag();
-  if (tag == TOKEN::LOGICAL_OR) {
-    Match(TOKEN::LOGICAL_OR);
-    auto operand2 = LogicalANDExpr();
-    if (!operand2) {
-      LexerPutBack(snapshot);
-      return false;
-    }
-    operand1 = std::make_unique<BinaryOperatorExpr>(OP::LOGICAL_OR, operand1,
-                                                    operand2, token);
-    auto res = LogicalORExprPrime(operand1);
-    if (res) {
-      return true;
-    } else {
-      LexerPutBack(snapshot);
-      return false;
-    }
-  } else {
-    return true;
-  }
-}
-
-std::unique_ptr<Expr> Parser::ConditionalExpr() {
-  auto snapshot = LexerSnapShot();
-  auto cond = LogicalORExpr();
-  auto token = PeekToken();
-  auto tag = token->tag();
-  if (tag == TOKEN::COND) {
-    Match(TOKEN::COND);
-    auto true_operand = Expression();
-    if (!true_operand) {
-      LexerPutBack(snapshot);
-      return nullptr;
-    }
-    Match(TOKEN::COLON);
-    auto false_operand = ConditionalExpr();
-    if (!false_operand) {
-      LexerPutBack(snapshot);
-      return nullptr;
-    }
-    auto expr = std::make_unique<TenaryOperatorExpr>(
-        OP::COND, OP::COLON, cond, true_operand, false_operand, token);
-    return expr;
-  } else {
-    return cond;
-  }
-}
-
-std::unique_ptr<Expr> Parser::AssignmentExpr() {
-  auto snapshot = LexerSnapShot();
-  // assignment-expression
-  //  -> unary-expression assignment-operator assignment-expression
-  auto lhs = UnaryExpr();
+Expr *Parser::AssignmentExpr() {
+  auto lhs = CastExpr();
   if (!lhs) {
-    LexerPutBack(snapshot);
-    auto conditional_expr = ConditionalExpr();
-    if (!conditional_expr) {
-      LexerPutBack(snapshot);
-      return nullptr;
-    } else {
-      return conditional_expr;
-    }
+    return nullptr;
   }
-#ifdef DEBUG
-  print_line();
-  std::cout << "AssignmentExpr: lhs succeeded: " << std::endl;
-  std::cout << *lhs << std::endl;
-  print_line();
-#endif
   auto token = PeekToken();
-  auto tag = token->tag();
-  OP op;
-  if (tag == TOKEN::ASSIGN) {
-    op = OP::ASSIGN;
-  } else if (tag == TOKEN::MUL_ASSIGN) {
-    op = OP::MULTIPLY_ASSIGN;
-  } else if (tag == TOKEN::DIV_ASSIGN) {
-    op = OP::DIVIDE_ASSIGN;
-  } else if (tag == TOKEN::MOD_ASSIGN) {
-    op = OP::MOD_ASSIGN;
-  } else if (tag == TOKEN::ADD_ASSIGN) {
-    op = OP::PLUS_ASSIGN;
-  } else if (tag == TOKEN::SUB_ASSIGN) {
-    op = OP::MINUS_ASSIGN;
-  } else if (tag == TOKEN::LEFT_ASSIGN) {
-    op = OP::LEFT_SHIFT_ASSIGN;
-  } else if (tag == TOKEN::RIGHT_ASSIGN) {
-    op = OP::RIGHT_SHIFT_ASSIGN;
-  } else if (tag == TOKEN::AND_ASSIGN) {
-    op = OP::AND_ASSIGN;
-  } else if (tag == TOKEN::NOT_ASSIGN) {
-    op = OP::NOT_ASSIGN;
-  } else if (tag == TOKEN::OR_ASSIGN) {
-    op = OP::OR_ASSIGN;
-  } else {
-    LexerPutBack(snapshot);
-    auto conditional_expr = ConditionalExpr();
-    if (!conditional_expr) {
-      LexerPutBack(snapshot);
-      return nullptr;
-    } else {
-      return conditional_expr;
-    }
+  auto &info = Operator(token.tag());
+  if (!info.assignment) {
+    return ConditionalExprRest(BinaryExprRest(lhs, LOGICAL_OR_PRECEDENCE));
   }
+  TRACE(EXPRESSIONS, Trace::RULE << "AssignmentExpr: lhs succeeded: \n" << *lhs
+        << '\n' << Trace::RULE);
   ConsumeToken();
-#ifdef DEBUG
-  print_line();
-  std::cout << "AssignmentExpr: OP succeeded: " << std::endl;
-  std::cout << Expr::op_to_string[op] << std::endl;
-  print_line();
-#endif
   auto rhs = AssignmentExpr();
   if (!rhs) {
-    auto conditional_expr = ConditionalExpr();
-    if (!conditional_expr) {
-      LexerPutBack(snapshot);
-      return nullptr;
-    } else {
-#ifdef DEBUG
-      print_line();
-      std::cout << "AssignmentExpr: rhs failed." << std::endl;
-      std::cout << "New conditional_expr: " << std::endl;
-      std::cout << *conditional_expr << std::endl;
-      print_line();
-#endif
-      return conditional_expr;
-    }
+    return nullptr;
   }
-  auto expr = std::make_unique<BinaryOperatorExpr>(op, lhs, rhs, token);
-#ifdef DEBUG
-  print_line();
-  std::cout
-      << "AssignmentExpr: recognition succeeded. make BinaryOperatorExpr: "
-      << std::endl;
-  std::cout << *expr << std::endl;
-  print_line();
-#endif
+  auto expr = MakeNode<BinaryOperatorExpr>(info.op, lhs, rhs, token);
+  TRACE(EXPRESSIONS, Trace::RULE
+        << "AssignmentExpr: recognition succeeded. make BinaryOperatorExpr: \n"
+        << *expr << '\n' << Trace::RULE);
   return expr;
 }
 
-std::unique_ptr<Expr> Parser::ConstantExpr() { return ConditionalExpr(); }
+Expr *Parser::ConstantExpr() { return ConditionalExpr(); }
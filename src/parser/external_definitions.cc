@@ -11,80 +11,75 @@
  */
 bool Parser::TranslationUnit() {
   bool scan = true;
-  while (scan && _lexer->PeekCurrentToken()->tag() != TOKEN::FILE_EOF) {
+  while (scan && _lexer->PeekCurrentToken().tag() != TOKEN::FILE_EOF) {
     scan = ExternalDeclaration();
   }
-  return scan || PeekToken()->tag() == TOKEN::FILE_EOF;
+  return scan || PeekToken().tag() == TOKEN::FILE_EOF;
 }
 
 /**
  *  external-declaration  ->
  *      function-definition
  *      declaration
+ *
+ * Both alternatives start with declaration-specifiers and a declarator, so
+ * those are parsed once; a following { makes it a function-definition.
  */
 bool Parser::ExternalDeclaration() {
-  auto declarations = Declaration();
-  if (declarations.size() >= 1) {
-#ifdef DEBUG
-      print_line();
-      auto &last_element = declarations.back();
-      std::cout << "Symbol added: " << *last_element << std::endl;
-      std::cout << *(last_element->type());
-      print_line();
-#endif // DEBUG
-    _current_scope.lock()->AddSymbols(declarations);
-    return true;
+  TRACE(DECLARATIONS, ">>> External Declaration\n>>> Declaration Specifier\n");
+  uint32_t specifiers = 0;
+  auto type_base = DeclarationSpecifier(specifiers);
+  if (!type_base) {
+    return false;
+  }
+  TRACE(DECLARATIONS, "<<< Declaration Specifier\n>>> Declarator\n");
+  auto declarator = Declarator(type_base);
+  if (!declarator) {
+    return false;
+  }
+  TRACE(DECLARATIONS, "<<< Declarator\n");
+  if (PeekToken(TOKEN::LBRACE) && declarator->type()->IsFunctionType()) {
+    declarator->set_specifiers(specifiers);
+    return FunctionDeclaration(declarator);
   }
-  if (FunctionDeclaration()) {
-    return true;
+  auto declarations =
+      DeclarationRest(type_base, specifiers, std::move(declarator));
+  if (declarations.empty()) {
+    return false;
   }
-  return false;
+  TRACE(DECLARATIONS, Trace::RULE
+        << "Symbol added: " << *declarations.back() << '\n'
+        << DeclarationMessage{*declarations.back()} << Trace::RULE);
+  return true;
 }
 
 /**
- * function-declaration ->
+ * function-definition ->
  *      declaration-specifier declarator
  *          declaration-list_{opt} compound-statement
+ *
+ * `delegator` is the declarator ExternalDeclaration has already parsed.
  */
-bool Parser::FunctionDeclaration() {
-  auto snapshot = LexerSnapShot();
-#ifdef DEBUG
-  std::cout << ">>> Function Declaration" << std::endl;
-  std::cout << ">>> Declaration Specifier" << std::endl;
-#endif
-  auto type_base = DeclarationSpecifier();
-  if (!type_base) {
-    LexerPutBack(snapshot);
-    return false;
-  }
-#ifdef DEBUG
-  std::cout << "<<< Declaration Specifier" << std::endl;
-  std::cout << ">>> Declarator" << std::endl;
-#endif
-  auto delegator = Declarator(type_base);
-  if (!delegator) {
-    LexerPutBack(snapshot);
-    return false;
-  }
-#ifdef DEBUG
-  std::cout << "<<< Declarator" << std::endl;
-  std::cout << ">>> Compound Statement" << std::endl;
-#endif
+bool Parser::FunctionDeclaration(std::unique_ptr<Symbol> &delegator) {
+  TRACE(DECLARATIONS, ">>> Compound Statement\n");
   /* TODO: declaration_list_{opt} */
-  auto compound_statement = CompoundStatement();
+  auto function_type = static_cast<const FunctionType *>(delegator->type());
+  // Owned by _function_definitions, but visible in the file scope from
+  // here on, so the body can call it (6.2.1p7). It is kept even if the body
+  // fails, since the table has seen its parameters by then.
+  auto function = delegator.get();
+  _symbols.Declare(function);
+  _function_definitions.push_back(std::move(delegator));
+  auto compound_statement = CompoundStatement(function);
   if (!compound_statement) {
-    LexerPutBack(snapshot);
     return false;
   }
-  ((FunctionType *)((delegator->type()).get()))->set_compound_stmt(compound_statement);
-  // _current_scope.lock()->AddSymbol(delegator);
-#ifdef DEBUG
-  std::cout << "<<< CompoundStatement" << std::endl;
-      print_line();
-      std::cout << "Symbol added: " << *delegator << std::endl;
-      std::cout << *(delegator->type());
-      print_line();
-#endif // DEBUG
+  function->set_body(compound_statement);
+  TRACE(DECLARATIONS, "<<< CompoundStatement\n"
+        << Trace::RULE << "Symbol added: " << *function << '\n'
+        << (FunctionDefinitionMessage{*function_type, compound_statement,
+                                      function->specifiers()})
+        << Trace::RULE);
   return true;
 }
 
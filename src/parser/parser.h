@@ -1,66 +1,93 @@
 #ifndef _PARSER_H_
 #define _PARSER_H_
 
+#include "../ast/ast_printer.h"
 #include "../ast/expr.h"
 #include "../ast/stmt.h"
 #include "../error/error.h"
 #include "../lexer/lexer.h"
-#include "../symbol/scope.h"
+#include "../symbol/symbol_table.h"
 #include "../type/type_arithmetic.h"
 #include "../type/type_base.h"
+#include "../type/type_context.h"
 #include "../type/type_derived.h"
-#include "../util/print_info.h"
+#include "../util/arena.h"
+#include "../util/trace.h"
+#include "token_classes.h"
 #include <cassert>
 #include <iostream>
 #include <memory>
-#include <set>
 #include <string>
 #include <tuple>
 #include <utility>
 
-#define DEBUG
-
-bool IsSpecifier(TOKEN tag);
 char stoc(const std::string &);
 
 class Parser {
 private:
-  std::shared_ptr<Token> PeekToken() const {
-    return _lexer->PeekCurrentToken();
-  }
-  bool PeekToken(TOKEN tag) const { return tag == PeekToken()->tag(); }
-  std::shared_ptr<Token> PeekNextToken() const {
-    return _lexer->PeekNextToken();
-  }
-  bool PeekNextToken(TOKEN tag) const { return tag == PeekNextToken()->tag(); }
-  std::shared_ptr<Token> ConsumeToken() { return _lexer->ConsumeToken(); }
-  std::shared_ptr<Token> Match(TOKEN tag) {
-#ifdef DEBUG
-    std::cout << "Match: " << Token::tag_to_string[tag] << " ----> "
-              << PeekToken()->position() << std::endl;
-    std::cout << "Current Token: " << Token::tag_to_string[PeekToken()->tag()] << std::endl;
-    std::cout << "Next Token: " << Token::tag_to_string[PeekNextToken()->tag()] << std::endl;
-#endif // DEBUG
-    assert(PeekToken(tag));
+  Token PeekToken() const { return _lexer->PeekCurrentToken(); }
+  bool PeekToken(TOKEN tag) const { return tag == PeekToken().tag(); }
+  Token PeekNextToken() const { return _lexer->PeekNextToken(); }
+  bool PeekNextToken(TOKEN tag) const { return tag == PeekNextToken().tag(); }
+  Token ConsumeToken() { return _lexer->ConsumeToken(); }
+  Token Match(TOKEN tag) {
+    TRACE(PARSER, "Match: " << Token::TagName(tag) << " ----> "
+          << PeekToken().position() << "\nCurrent Token: "
+          << Token::TagName(PeekToken().tag()) << "\nNext Token: "
+          << Token::TagName(PeekNextToken().tag()) << '\n');
+    if (!PeekToken(tag)) {
+      Error{"Syntax error at " + Location(PeekToken()) + "."};
+    }
     return ConsumeToken();
   }
   unsigned LexerSnapShot() { return _lexer->ScreenShot(); }
   void LexerPutBack(unsigned screenshot) { return _lexer->PutBack(screenshot); }
-  std::weak_ptr<Scope> &CurrentScope() { return _current_scope; }
-  bool isRootScope() { return _current_scope.lock()->parent().lock() == nullptr; }
+  // Allocates an AST node in the translation unit's arena.
+  template <typename Node, typename... Args> Node *MakeNode(Args &&... args) {
+    return _ast_arena.New<Node>(std::forward<Args>(args)...);
+  }
 
 public:
-  void EnterNewSubScope() {
-    auto &curr = _current_scope.lock()->AddSubScope();
-    _current_scope = curr;
-  }
-  void ExitCurrentSubScope() {
-    _current_scope = _current_scope.lock()->parent();
-  }
+  // The lexer streams, so lexing overlaps parsing and the first syntax
+  // error is reported before the rest of the file has been lexed.
   explicit Parser(const std::string &filename)
-      : _lexer(std::make_unique<Lexer>(filename)),
-        _root_scope(std::make_shared<Scope>()), _current_scope(_root_scope) {}
+      : Parser(std::make_unique<Lexer>(filename, false)) {}
+  // Parses a source that is already loaded; `filename` only names it.
+  Parser(std::shared_ptr<const SourceBuffer> source,
+         const std::string &filename)
+      : Parser(std::make_unique<Lexer>(std::move(source), filename, false)) {}
+  // Parses the tokens `lexer` hands out, such as a Preprocessor's output.
+  explicit Parser(std::unique_ptr<Lexer> lexer) : _lexer(std::move(lexer)) {}
   ~Parser() = default;
+  const Arena &ast_arena() const { return _ast_arena; }
+  const Lexer &lexer() const { return *_lexer; }
+  const SymbolTable &symbol_table() const { return _symbols; }
+  const TypeContext &types() const { return _types; }
+  // The file scope, as the root of a scope tree built on demand.
+  Scope &root_scope() const {
+    return _symbols.scope(SymbolTable::FILE_SCOPE);
+  }
+  // Every function-definition of the translation unit, in source order,
+  // each holding its parameters and body.
+  const std::vector<std::unique_ptr<Symbol>> &function_definitions() const {
+    return _function_definitions;
+  }
+  // Tokens the parser backed up over. Every decision is made from lookahead,
+  // so this is 0 unless a rewind has crept back in.
+  uint64_t rewound_tokens() const { return _lexer->rewound_tokens(); }
+  // The token parsing stopped at, once TranslationUnit() has returned.
+  Token current_token() const { return PeekToken(); }
+  // Where `token` is, for a message: "file:row:column" in the file the
+  // lexer read, unless a locator, such as a Preprocessor's, is set.
+  std::string Location(const Token &token) const {
+    if (_locate) {
+      return _locate(token);
+    }
+    auto position = token.position();
+    return _lexer->file_name() + ":" + std::to_string(position.row()) + ":" +
+           std::to_string(position.column());
+  }
+  void set_locator(Locator locate) { _locate = std::move(locate); }
   bool Scan() {
     auto result = TranslationUnit();
     if (result) {
@@ -73,32 +100,21 @@ public:
   }
 
   // Expressions
-  std::unique_ptr<Expr> Expression();
-  std::unique_ptr<Expr> PrimaryExpression();
-  std::unique_ptr<Expr> PostfixExpr();
-  std::unique_ptr<Expr> UnaryExpr();
+  Expr *Expression();
+  Expr *PrimaryExpression();
+  Expr *PostfixExpr();
+  Expr *UnaryExpr();
   // Expr *Alignof();
-  std::unique_ptr<Expr> CastExpr();
-  std::unique_ptr<Expr> MultiplicativeExpr();
-  std::unique_ptr<Expr> AdditiveExpr();
-  std::unique_ptr<Expr> ShiftExpr();
-  std::unique_ptr<Expr> RelationalExpr();
-  std::unique_ptr<Expr> EqualityExpr();
-  std::unique_ptr<Expr> ANDExpr();
-  std::unique_ptr<Expr> XORExpr();
-  std::unique_ptr<Expr> ORExpr();
-  std::unique_ptr<Expr> LogicalANDExpr();
-  std::unique_ptr<Expr> LogicalORExpr();
-  std::unique_ptr<Expr> ConditionalExpr();
-  std::unique_ptr<Expr> AssignmentExpr();
-  std::unique_ptr<Expr> ConstantExpr();
+  Expr *CastExpr();
+  Expr *ConditionalExpr();
+  Expr *AssignmentExpr();
+  Expr *ConstantExpr();
 
   // Declarators
-  std::vector<std::unique_ptr<Symbol>> Declaration();
+  std::vector<Symbol *> Declaration();
   // Type *TypeName();                    // 6.7.7         // in cc
   uint32_t TryStorageClassSpecifier(); // in cc
-  std::unique_ptr<Type> TryTypeSpecifier(uint32_t, uint32_t &, uint32_t,
-                                         uint32_t);
+  bool TryTypeSpecifier(uint32_t &, const Type *&);
   uint32_t TryTypeQualifier();
   uint32_t TryFunctionSpecifier();
   uint32_t TryAlignmentSpecifier();
@@ -110,118 +126,102 @@ public:
   void StructDeclaratorList(Type *, StructUnionType *); // in cc
   std::tuple<Token *, Type *> StructDeclarator(Type *); // in cc
   Type *EnumSpecifier(Type *);                          // in cc
-  std::unique_ptr<Symbol> Declarator(const std::unique_ptr<Type> &);    // in cc
-  std::unique_ptr<Symbol> DirectDeclarator(std::unique_ptr<Type> &);    // in cc
-  std::unique_ptr<Type> DirectDeclaratorPrime(std::unique_ptr<Type> &); // in cc
-  std::unique_ptr<Type> Pointer(const std::unique_ptr<Type> &);         // in cc
-  void TypeQualifierList(std::unique_ptr<Type> &);                      // in cc
+  std::unique_ptr<Symbol> Declarator(const Type *);        // in cc
+  std::unique_ptr<Symbol> DirectDeclarator(const Type *);  // in cc
+  const Type *
+  DirectDeclaratorPrime(const Type *,
+                        std::vector<std::unique_ptr<Symbol>> &); // in cc
+  const Type *Pointer(const Type *);                             // in cc
+  uint32_t TypeQualifierList();                                  // in cc
   // Type *StaticAssertDeclaration(Type *);                                // in
   // cc Type *EnumeratorList(Type *);                                         //
   // in cc Type *Enumerator(Type *); // in cc Type *EnumerationConstant(Type *);
   // // in cc
-  void ParameterTypeList(std::unique_ptr<FunctionType> &); // in cc
-  std::vector<std::unique_ptr<Symbol>> ParameterList();    // in cc
-  std::unique_ptr<Symbol> ParameterDeclaration();          // in cc
-  std::unique_ptr<Symbol>
-  AbstractDeclarator(const std::unique_ptr<Type> &); // in cc
-  std::unique_ptr<Symbol>
-  DirectAbstractDeclarator(std::unique_ptr<Type> &); // in cc
-  std::unique_ptr<Type> DeclarationSpecifier();
-  //  void TypedefName();
+  bool ParameterTypeList(std::vector<std::unique_ptr<Symbol>> &); // in cc
+  std::vector<std::unique_ptr<Symbol>> ParameterList();           // in cc
+  std::unique_ptr<Symbol> ParameterDeclaration();                 // in cc
+  std::unique_ptr<Symbol> AbstractDeclarator(const Type *);       // in cc
+  std::unique_ptr<Symbol> DirectAbstractDeclarator(const Type *); // in cc
+  // The type the specifiers name; the storage-class and type specifiers as
+  // written go to `specifiers`, since they are not part of it.
+  const Type *DeclarationSpecifier(uint32_t &specifiers);
+  const Type *TypedefName(const Token &token) const;
 
   // Statements
-  std::unique_ptr<Stmt> Statement();
-  std::unique_ptr<LabeledStmt> LabeledStatement();
-  std::unique_ptr<CompoundStmt> CompoundStatement();
-  std::pair<bool, std::unique_ptr<ExpressionStmt>> ExpressionStatement();
-  std::unique_ptr<SelectionStmt> SelectionStatement();
-  std::unique_ptr<IterationStmt> IterationStatement();
-  std::unique_ptr<JumpStmt> JumpStatement();
-  std::pair<bool, std::vector<std::unique_ptr<Stmt>>> BlockItemList();
+  Stmt *Statement();
+  LabeledStmt *LabeledStatement();
+  CompoundStmt *CompoundStatement(const Symbol *function = nullptr);
+  std::pair<bool, ExpressionStmt *> ExpressionStatement();
+  SelectionStmt *SelectionStatement();
+  IterationStmt *IterationStatement();
+  JumpStmt *JumpStatement();
+  std::pair<bool, std::vector<Stmt *>> BlockItemList();
 
   // External Definitions
   bool TranslationUnit();
   bool ExternalDeclaration();
-  bool FunctionDeclaration();
+  bool FunctionDeclaration(std::unique_ptr<Symbol> &declarator);
   void DeclarationList();
 
 private:
-  bool PostfixExprPrime(std::unique_ptr<Expr> &);
-  bool ArraySubscripting(std::unique_ptr<Expr> &);
-  bool FunctionCall(std::unique_ptr<Expr> &);
-  bool MemberReference(std::unique_ptr<Expr> &);
-  bool PostfixIncrement(std::unique_ptr<Expr> &);
-  bool PostfixDecrement(std::unique_ptr<Expr> &);
-  std::vector<std::unique_ptr<Expr>> ArgumentExpressionList();
+  bool PostfixExprPrime(Expr *&);
+  bool ArraySubscripting(Expr *&);
+  bool FunctionCall(Expr *&);
+  bool MemberReference(Expr *&);
+  bool PostfixIncrement(Expr *&);
+  bool PostfixDecrement(Expr *&);
+  std::vector<Expr *> ArgumentExpressionList();
   //  Expr *CompoundLiterals(Expr *);
   //  Expr *UnaryExpr(Expr *);
   //  Token *UnaryOperator();
-  std::unique_ptr<Expr> PrefixIncrement();
-  std::unique_ptr<Expr> PrefixDecrement();
-  std::unique_ptr<Expr> Sizeof();
-  bool AdditiveExprPrime(std::unique_ptr<Expr> &operand1);
-  bool ShiftExprPrime(std::unique_ptr<Expr> &operand1);
-  bool RelationalExprPrime(std::unique_ptr<Expr> &operand1);
-  bool EqualityExprPrime(std::unique_ptr<Expr> &operand1);
-  bool ANDExprPrime(std::unique_ptr<Expr> &operand1);
-  bool XORExprPrime(std::unique_ptr<Expr> &operand1);
-  bool ORExprPrime(std::unique_ptr<Expr> &operand1);
-  bool LogicalANDExprPrime(std::unique_ptr<Expr> &operand1);
-  bool LogicalORExprPrime(std::unique_ptr<Expr> &operand1);
-
-  bool MultiplicativeExprPrime(std::unique_ptr<Expr> &);
+  Expr *PrefixIncrement();
+  Expr *PrefixDecrement();
+  Expr *Sizeof();
+  // Binary operators from multiplicative-expression up to
+  // logical-OR-expression, by precedence climbing.
+  Expr *BinaryExprRest(Expr *operand, unsigned min_precedence);
+  Expr *ConditionalExprRest(Expr *cond);
   // Declarations
+  std::vector<Symbol *>
+  DeclarationRest(const Type *type_base, uint32_t specifiers,
+                  std::unique_ptr<Symbol> first_declarator);
+  void DeclareParameters(const Symbol &function);
   void StructDeclarationListPrime(Type *);                   // in cc
   void StructDeclaratorListPrime(Type *, StructUnionType *); // in cc
-  std::unique_ptr<ArrayType>
-  ArrayDeclarator(std::unique_ptr<Type> &); // 6.7.6.2      // in cc
+  const ArrayType *ArrayDeclarator(const Type *); // 6.7.6.2      // in cc
   long long ArrayDeclaratorInBracket();           // in cc
-  std::unique_ptr<FunctionType>
-  FunctionDeclarator(std::unique_ptr<Type> &); // 6.7.6.3      // in cc
-  void FunctionDeclaratorInParanthesis(std::unique_ptr<FunctionType> &);
-  void DirectAbstractDeclaratorPrime(std::unique_ptr<Type> &);
-
-  std::unique_ptr<Symbol> GeneralDeclarator(const std::unique_ptr<Type> &);
-  std::unique_ptr<Symbol> GeneralDirectDeclarator(std::unique_ptr<Type> &);
-  std::unique_ptr<Type> GeneralDirectDeclaratorPrime(std::unique_ptr<Type> &);
+  // Parameters of the declarator go to `parameters`.
+  const FunctionType *
+  FunctionDeclarator(const Type *,
+                     std::vector<std::unique_ptr<Symbol>> &parameters);
+  const Type *DirectAbstractDeclaratorPrime(const Type *);
+
+  std::unique_ptr<Symbol> GeneralDeclarator(const Type *);
+  std::unique_ptr<Symbol> GeneralDirectDeclarator(const Type *);
+  const Type *
+  GeneralDirectDeclaratorPrime(const Type *,
+                               std::vector<std::unique_ptr<Symbol>> &);
 
 private:
+  // A CachedUnit rebuilds a parser's results without running it, and a
+  // PrecompiledHeader starts it where a header's tokens end.
+  friend class CachedUnit;
+  friend class PrecompiledHeader;
+
+  // Every AST node of the translation unit; freed with the parser.
+  Arena _ast_arena;
+  // Every type of the translation unit, one object per structure.
+  TypeContext _types;
   std::unique_ptr<Lexer> _lexer;
-  std::shared_ptr<Scope> _root_scope;
-  std::weak_ptr<Scope> _current_scope;
+  SymbolTable _symbols;
+  std::vector<std::unique_ptr<Symbol>> _function_definitions;
+  Locator _locate;
 
 private:
-  std::set<TOKEN> scs{TOKEN::TYPEDEF,      TOKEN::EXTERN, TOKEN::STATIC,
-                      TOKEN::THREAD_LOCAL, TOKEN::AUTO,   TOKEN::REGISTER};
-  std::set<TOKEN> ts{
-      TOKEN::VOID,     TOKEN::CHAR,  TOKEN::SHORT,   TOKEN::INT,
-      TOKEN::LONG,     TOKEN::FLOAT, TOKEN::DOUBLE,  TOKEN::SIGNED,
-      TOKEN::UNSIGNED, TOKEN::BOOL,  TOKEN::COMPLEX, TOKEN::ATOMIC,
-      TOKEN::STRUCT,   TOKEN::UNION, TOKEN::ENUM,    TOKEN::TYPEDEF};
-  std::set<TOKEN> sus{TOKEN::STRUCT, TOKEN::UNION};
-  std::set<TOKEN> tq{TOKEN::CONST, TOKEN::RESTRICT, TOKEN::VOLATILE,
-                     TOKEN::ATOMIC};
-
-  std::set<TOKEN> fs{TOKEN::INLINE, TOKEN::NORETURN};
-
-  std::set<TOKEN> as{TOKEN::ALIGNAS};
-  bool InFirstSetOfDeclarationSpecifier(TOKEN tag) {
-    if (scs.find(tag) != scs.end()) {
-      return true;
-    }
-    if (ts.find(tag) != ts.end()) {
-      return true;
-    }
-    if (tq.find(tag) != tq.end()) {
-      return true;
-    }
-    if (fs.find(tag) != fs.end()) {
-      return true;
-    }
-    if (as.find(tag) != as.end()) {
-      return true;
-    }
-    return false;
+  // One token decides between a declaration and a statement: it either
+  // starts a declaration-specifier or names a typedef in scope.
+  bool StartsDeclaration(const Token &token) {
+    return IsSpecifier(token.tag()) || TypedefName(token) != nullptr;
   }
 };
 
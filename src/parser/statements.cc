@@ -13,56 +13,33 @@
  *                iteration-statement
  *                jump-statement
  */
-std::unique_ptr<Stmt> Parser::Statement() {
-  auto snapshot = LexerSnapShot();
+Stmt *Parser::Statement() {
   auto token = PeekToken();
-  auto tag = token->tag();
+  auto tag = token.tag();
+  TRACE(STATEMENTS, "Statement: " << Token::TagName(tag) << " ----> "
+        << token.position() << '\n');
+  if (!StartsStatement(tag)) {
+    return nullptr;
+  }
   if (tag == TOKEN::WHILE || tag == TOKEN::DO || tag == TOKEN::FOR) {
-    auto iteration_stmt = IterationStatement();
-    if (!iteration_stmt) {
-      LexerPutBack(snapshot);
-      return nullptr;
-    }
-    return iteration_stmt;
+    return IterationStatement();
   } else if (tag == TOKEN::GOTO || tag == TOKEN::CONTINUE ||
              tag == TOKEN::BREAK || tag == TOKEN::RETURN) {
-    auto jump_stmt = JumpStatement();
-    if (!jump_stmt) {
-      LexerPutBack(snapshot);
-      return nullptr;
-    }
-    return jump_stmt;
+    return JumpStatement();
   } else if (tag == TOKEN::IF || tag == TOKEN::SWITCH) {
-    auto selection_stmt = SelectionStatement();
-    if (!selection_stmt) {
-      LexerPutBack(snapshot);
-      return nullptr;
-    }
-    return selection_stmt;
+    return SelectionStatement();
   } else if (tag == TOKEN::LBRACE) {
-    auto compound_stmt = CompoundStatement();
-    if (!compound_stmt) {
-      LexerPutBack(snapshot);
-      return nullptr;
-    }
-    return compound_stmt;
+    return CompoundStatement();
   } else if (tag == TOKEN::CASE || tag == TOKEN::DEFAULT ||
              (tag == TOKEN::IDENTIFIER &&
-              PeekNextToken()->tag() == TOKEN::COLON)) {
-    auto labeled_stmt = LabeledStatement();
-    if (!labeled_stmt) {
-      LexerPutBack(snapshot);
-      return nullptr;
-    }
-    return labeled_stmt;
+              PeekNextToken().tag() == TOKEN::COLON)) {
+    return LabeledStatement();
   } else {
     auto expression_pair = ExpressionStatement();
     if (!expression_pair.first) {
-      LexerPutBack(snapshot);
       return nullptr;
     }
-    auto expression_stmt = std::move(expression_pair.second);
-    return expression_stmt;
+    return expression_pair.second;
   }
 }
 
@@ -72,10 +49,10 @@ std::unique_ptr<Stmt> Parser::Statement() {
  *                case constant-expression : statement
  *                default : statement
  */
-std::unique_ptr<LabeledStmt> Parser::LabeledStatement() {
+LabeledStmt *Parser::LabeledStatement() {
   // TODO
   auto token = PeekToken();
-  auto tag = token->tag();
+  auto tag = token.tag();
   if (tag == TOKEN::IDENTIFIER) {
     token = Match(TOKEN::IDENTIFIER);
     Match(TOKEN::COLON);
@@ -92,24 +69,28 @@ std::unique_ptr<LabeledStmt> Parser::LabeledStatement() {
 /**
  * compound-statement ->
  *                { block-item-list_{opt} }
+ *
+ * The parameters of `function`, whose body this is, have the block scope
+ * of the body (6.2.1).
  */
-std::unique_ptr<CompoundStmt> Parser::CompoundStatement() {
-  auto snapshot = LexerSnapShot();
+CompoundStmt *Parser::CompoundStatement(const Symbol *function) {
   Match(TOKEN::LBRACE);
-  EnterNewSubScope();
-  auto tag = PeekToken()->tag();
-  auto compound_stmt = std::make_unique<CompoundStmt>();
-  compound_stmt->set_scope(_current_scope);
+  auto scope = _symbols.EnterScope();
+  if (function) {
+    DeclareParameters(*function);
+  }
+  auto tag = PeekToken().tag();
+  auto compound_stmt = MakeNode<CompoundStmt>();
+  compound_stmt->set_scope(scope);
   if (tag != TOKEN::RBRACE) {
     auto pair = BlockItemList();
     if (pair.first) {
-      compound_stmt->AddStmts(pair.second);
+      compound_stmt->set_stmts(_ast_arena.NewArray(pair.second));
     } else {
-      LexerPutBack(snapshot);
       return nullptr;
     }
   }
-  ExitCurrentSubScope();
+  _symbols.ExitScope();
   Match(TOKEN::RBRACE);
   return compound_stmt;
 }
@@ -118,22 +99,22 @@ std::unique_ptr<CompoundStmt> Parser::CompoundStatement() {
  *  expression-statement  ->
  *                expression_{opt};
  */
-std::pair<bool, std::unique_ptr<ExpressionStmt>> Parser::ExpressionStatement() {
-  auto snapshot = LexerSnapShot();
+std::pair<bool, ExpressionStmt *> Parser::ExpressionStatement() {
   auto token = PeekToken();
-  auto tag = token->tag();
+  auto tag = token.tag();
   if (tag == TOKEN::SEMI) {
     Match(TOKEN::SEMI);
     return std::make_pair(true, nullptr);
+  } else if (!StartsExpression(tag)) {
+    return std::make_pair(false, nullptr);
   } else {
     auto expression = Expression();
     if (!expression) {
-      LexerPutBack(snapshot);
       return std::make_pair(false, nullptr);
     }
-    auto expression_stmt = std::make_unique<ExpressionStmt>(expression);
+    auto expression_stmt = MakeNode<ExpressionStmt>(expression);
     Match(TOKEN::SEMI);
-    return std::make_pair(true, std::move(expression_stmt));
+    return std::make_pair(true, expression_stmt);
   }
 }
 
@@ -143,28 +124,28 @@ std::pair<bool, std::unique_ptr<ExpressionStmt>> Parser::ExpressionStatement() {
  *                if ( expression ) statement else statement
  *                switch ( expression ) statement
  */
-std::unique_ptr<SelectionStmt> Parser::SelectionStatement() {
+SelectionStmt *Parser::SelectionStatement() {
   auto token = PeekToken();
-  if (token->tag() == TOKEN::IF) {
+  if (token.tag() == TOKEN::IF) {
     Match(TOKEN::IF);
     Match(TOKEN::LPAR);
     auto condition = Expression();
     Match(TOKEN::RPAR);
     auto true_stmt = Statement();
-    std::unique_ptr<Stmt> false_stmt = nullptr;
+    Stmt *false_stmt = nullptr;
     token = PeekToken();
-    if (token->tag() == TOKEN::ELSE) {
+    if (token.tag() == TOKEN::ELSE) {
       Match(TOKEN::ELSE);
       false_stmt = Statement();
     }
-    return std::make_unique<IfStmt>(condition, true_stmt, false_stmt);
+    return MakeNode<IfStmt>(condition, true_stmt, false_stmt);
   } else {
     // Match(TOKEN::SWITCH);
     // Match(TOKEN::LPAR);
     // Match(TOKEN::RPAR);
     // auto stmt = Statement();
     // TODO: support switch statement.
-    std::cerr << "switch statement is not supported yet." << std::endl;
+    Warning{"switch statement is not supported yet."};
     return nullptr;
   }
 }
@@ -176,8 +157,8 @@ std::unique_ptr<SelectionStmt> Parser::SelectionStatement() {
  *      for ( expression_{opt}; expression_{opt}; expression_{opt} ) statement
  *      for ( declaration expression_{opt} ; expression_{opt} ) statement
  */
-std::unique_ptr<IterationStmt> Parser::IterationStatement() {
-  auto tag = PeekToken()->tag();
+IterationStmt *Parser::IterationStatement() {
+  auto tag = PeekToken().tag();
   if (tag == TOKEN::WHILE) {
     Match(TOKEN::WHILE);
     Match(TOKEN::LPAR);
@@ -186,7 +167,7 @@ std::unique_ptr<IterationStmt> Parser::IterationStatement() {
     auto body = Statement();
     // "next field" in while should be evaluate later.
     // return new WhileStmt(condition, body, nullptr);
-    auto while_stmt = std::make_unique<WhileStmt>(condition, body);
+    auto while_stmt = MakeNode<WhileStmt>(condition, body);
     return while_stmt;
   } else if (tag == TOKEN::DO) {
     Match(TOKEN::DO);
@@ -196,7 +177,7 @@ std::unique_ptr<IterationStmt> Parser::IterationStatement() {
     auto condition = Expression();
     Match(TOKEN::RPAR);
     Match(TOKEN::SEMI);
-    auto do_while_stmt = std::make_unique<DoWhileStmt>(condition, body);
+    auto do_while_stmt = MakeNode<DoWhileStmt>(condition, body);
     return do_while_stmt;
   } else if (tag == TOKEN::FOR) {
     Match(TOKEN::FOR);
@@ -216,9 +197,9 @@ std::unique_ptr<IterationStmt> Parser::IterationStatement() {
  *      break ;
  *      return expression_{opt} ;
  */
-std::unique_ptr<JumpStmt> Parser::JumpStatement() {
+JumpStmt *Parser::JumpStatement() {
   // TODO
-  auto tag = PeekToken()->tag();
+  auto tag = PeekToken().tag();
   if (tag == TOKEN::GOTO) {
     Match(TOKEN::GOTO);
     auto ident_token = Match(TOKEN::IDENTIFIER);
@@ -249,23 +230,27 @@ std::unique_ptr<JumpStmt> Parser::JumpStatement() {
  *  block-item-list ->
  *      block-item
  *      block-item-list block-item
+ *
+ *  block-item ->
+ *      declaration
+ *      statement
+ *
+ * The first token of a block-item tells the two apart: a declaration starts
+ * with a declaration-specifier keyword or a typedef-name.
  */
-std::pair<bool, std::vector<std::unique_ptr<Stmt>>> Parser::BlockItemList() {
-  auto snapshot = LexerSnapShot();
-  std::vector<std::unique_ptr<Stmt>> stmt_items;
-  auto token = PeekToken();
-  while (PeekToken()->tag() != TOKEN::RBRACE) {
-    auto declaration = Declaration();
-    if (declaration.size() == 0) {
-      auto statement = Statement();
-      if (statement) {
-        stmt_items.push_back(std::move(statement));
-      } else {
-        LexerPutBack(snapshot);
-        return std::make_pair(false, std::vector<std::unique_ptr<Stmt>>());
+std::pair<bool, std::vector<Stmt *>> Parser::BlockItemList() {
+  std::vector<Stmt *> stmt_items;
+  while (PeekToken().tag() != TOKEN::RBRACE) {
+    if (StartsDeclaration(PeekToken())) {
+      if (Declaration().empty()) {
+        return std::make_pair(false, std::vector<Stmt *>());
       }
     } else {
-      _current_scope.lock()->AddSymbols(declaration);
+      auto statement = Statement();
+      if (!statement) {
+        return std::make_pair(false, std::vector<Stmt *>());
+      }
+      stmt_items.push_back(statement);
     }
   }
   return std::make_pair(true, std::move(stmt_items));
@@ -0,0 +1,77 @@
+#include "../../ast/ast_visitor.h"
+#include "../parser.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+using namespace std;
+
+// Writes expression-dense code, in the style of macro-expanded arithmetic
+// and generated tables: long statements that mix every binary operator
+// level with assignments, conditionals and parentheses.
+static void WriteCorpus(const string &path, int functions) {
+  ofstream out(path);
+  char line[512];
+  for (int i = 0; i < functions; ++i) {
+    out << "int table_" << i << "(int a, int b, int c) {\n";
+    for (int j = 0; j < 8; ++j) {
+      snprintf(line, sizeof(line),
+               "  a = (a * %d + b / 3 - c %% 7) << 2 | (b & 0xff) ^ c >> 1;\n"
+               "  b += a < %d && b >= c || a != b ? a - 1 : (c + %d) * 2;\n"
+               "  c = a + b + c + %d + a * b * c - (a - b) - (b - c);\n"
+               "  a = b == c;\n",
+               j, i, j, i);
+      out << line;
+    }
+    out << "}\n";
+  }
+}
+
+// Counts the nodes of a tree, the cheapest pass there is, to measure the
+// cost of the traversal itself.
+struct NodeCounter : RecursiveASTWalker<NodeCounter> {
+  size_t nodes = 0;
+  bool VisitNode(ASTNode *) {
+    ++nodes;
+    return true;
+  }
+};
+
+int main(int argc, char **argv) {
+  string path = argc > 1 ? argv[1] : "bench_input.c";
+  if (argc <= 1) {
+    WriteCorpus(path, 2000);
+  }
+  const int rounds = 5;
+  double best = 1e30;
+  uint64_t rewound = 0;
+  for (int round = 0; round < rounds; ++round) {
+    auto start = chrono::steady_clock::now();
+    Parser parser(path);
+    parser.Scan();
+    auto end = chrono::steady_clock::now();
+    best = min(best, chrono::duration<double>(end - start).count());
+    rewound = parser.rewound_tokens();
+  }
+  cout << path << ": best of " << rounds << ": " << best * 1e3 << " ms, "
+       << rewound << " tokens rewound" << endl;
+
+  Parser parser(path);
+  parser.Scan();
+  best = 1e30;
+  NodeCounter counter;
+  for (int round = 0; round < rounds; ++round) {
+    counter.nodes = 0;
+    auto start = chrono::steady_clock::now();
+    for (auto &function : parser.function_definitions()) {
+      counter.Walk(function->body());
+    }
+    auto end = chrono::steady_clock::now();
+    best = min(best, chrono::duration<double>(end - start).count());
+  }
+  cout << "walk of " << counter.nodes << " AST nodes: best of " << rounds
+       << ": " << best * 1e3 << " ms" << endl;
+  return 0;
+}
@@ -0,0 +1,189 @@
+#include "../../ast/ast_visitor.h"
+#include "../../cache/ast_cache.h"
+#include "../../preprocessor/preprocessor.h"
+#include "../parser.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+using namespace std;
+
+// Declarations at file and block scope, typedef-names and their hiding,
+// and every kind of expression and statement the parser builds, some of
+// them from a header and its macros.
+static void WriteCorpus(const string &path, int functions) {
+  auto header = path.substr(0, path.rfind('/')) + "/corpus.h";
+  ofstream(header) << "#define SCALE(x) ((x) * 3)\ntypedef int count_t;\n";
+  ofstream out(path);
+  out << "#include \"corpus.h\"\nint get, put;\nint ***p;\nint c[10];\n"
+         "int foo(int a, int b, ...);\nstatic int *s[2];\nextern int e;\n";
+  for (int i = 0; i < functions; ++i) {
+    out << (i % 2 ? "static " : "") << "count_t func_" << i
+        << "(count_t a, char *s) {\n"
+        << "  count_t b;\n  float *f;\n  static int n;\n"
+        << "  a = (SCALE(a) + b / " << i + 1
+        << ") << 2 | (b & 0xff) ^ a >> 1;\n"
+        << "  b += a < " << i << " && b >= a || a != b ? a - 1 : -b;\n"
+        << "  while (a) { int count_t; count_t = a--; }\n"
+        << "  do { ++b; } while (b < 10);\n"
+        << "  if (a == 5) { a = 1.5 + 'x'; } else { foo(); }\n"
+        << "  a->field;\n  (a++)++;\n  \"text\";\n}\n";
+  }
+}
+
+// Everything the parser produced, in an order that does not depend on
+// addresses: symbols and types scope by scope, then each function body.
+struct Dumper : RecursiveASTWalker<Dumper> {
+  explicit Dumper(const SymbolTable &table) : table(table) {}
+  const SymbolTable &table;
+  ostringstream os;
+  bool VisitNode(ASTNode *node) {
+    os << static_cast<int>(node->kind());
+    if (auto expr = dyn_cast<Expr>(node)) {
+      os << ' ' << expr->token() << ' ' << *expr;
+    }
+    if (auto compound = dyn_cast<CompoundStmt>(node)) {
+      os << " scope with "
+         << table.scope(compound->scope()).symbols().size() << " symbols";
+    }
+    os << '\n';
+    return true;
+  }
+};
+
+static void DumpScope(Scope &scope, ostream &os) {
+  os << "scope: " << scope.typedef_names().size() << " typedef entries\n";
+  for (auto &symbol : scope.symbols()) {
+    os << *symbol << '\n' << DeclarationMessage{*symbol};
+  }
+  for (auto &child : scope.children()) {
+    DumpScope(*child, os);
+  }
+}
+
+static string Dump(const Parser &parser) {
+  Dumper dumper(parser.symbol_table());
+  DumpScope(parser.root_scope(), dumper.os);
+  for (auto &function : parser.function_definitions()) {
+    auto type = static_cast<const FunctionType *>(function->type());
+    dumper.os << *function << '\n'
+              << FunctionDefinitionMessage{*type, function->body(),
+                                           function->specifiers()};
+    for (auto &parameter : function->parameters()) {
+      dumper.os << *parameter << '\n' << DeclarationMessage{*parameter};
+    }
+    dumper.Walk(function->body());
+  }
+  return dumper.os.str();
+}
+
+static bool Check(bool condition, const string &what) {
+  if (!condition) {
+    cout << "FAILED: " << what << endl;
+  }
+  return condition;
+}
+
+// Whether the names a parse leaves visible in the file scope resolve to
+// the same declarations in `loaded`.
+static bool SameFileScope(const Parser &parsed, const Parser &loaded) {
+  for (auto symbol : parsed.root_scope().symbols()) {
+    auto name = symbol->name();
+    auto found = loaded.symbol_table().Lookup(name);
+    if (found == nullptr ||
+        found->token().index() != symbol->token().index() ||
+        (parsed.symbol_table().LookupTypedefName(name) == nullptr) !=
+            (loaded.symbol_table().LookupTypedefName(name) == nullptr)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// `path` loaded from `cache`, or else preprocessed, parsed and stored, as
+// the driver does. nullptr on a syntax error.
+static unique_ptr<Parser> Parse(ASTCache &cache, FileCache &files,
+                                const string &path) {
+  Preprocessor preprocessor(files);
+  if (auto parser = cache.Load(preprocessor, path)) {
+    return parser;
+  }
+  Preprocessor fresh(files);
+  auto parser = make_unique<Parser>(fresh.Run(path));
+  if (!parser->TranslationUnit()) {
+    return nullptr;
+  }
+  cache.Store(fresh, *parser, path);
+  return parser;
+}
+
+// Preprocesses and parses `path` directly and through a cache, twice, and
+// checks that the second lookup hits and reproduces the same results.
+static bool RoundTrip(const string &path, const string &directory) {
+  FileCache files;
+  Preprocessor preprocessor(files);
+  Parser direct(preprocessor.Run(path));
+  direct.TranslationUnit();
+  string expected = Dump(direct);
+
+  ASTCache cache(directory);
+  auto first = Parse(cache, files, path);
+  auto second = Parse(cache, files, path);
+  bool passed = Check(first && second, path + ": parsed") &&
+                Check(cache.misses() == 1 && cache.hits() == 1,
+                      path + ": one miss, then one hit") &&
+                Check(Dump(*first) == expected, path + ": parsed unit") &&
+                Check(Dump(*second) == expected, path + ": loaded unit") &&
+                Check(SameFileScope(direct, *second),
+                      path + ": file scope names");
+  cout << path << ": " << (passed ? "ok" : "FAILED") << endl;
+  return passed;
+}
+
+int main(int argc, char **argv) {
+  char directory[] = "/tmp/yyqc_cache_XXXXXX";
+  if (mkdtemp(directory) == nullptr) {
+    cout << "Cannot create a cache directory" << endl;
+    return 1;
+  }
+  string corpus = string(directory) + "/corpus.c";
+  WriteCorpus(corpus, 50);
+  bool passed = RoundTrip("test.txt", directory) &&
+                RoundTrip(corpus, directory);
+
+  // An edited source misses and is parsed afresh, and so does one whose
+  // header is edited.
+  FileCache files;
+  ASTCache cache(directory);
+  ofstream(corpus, ios::app) << "int appended;\n";
+  auto parser = Parse(cache, files, corpus);
+  passed = Check(parser && cache.misses() == 1, "edited source misses") &&
+           passed;
+  ofstream(string(directory) + "/corpus.h", ios::app) << "int added;\n";
+  FileCache edited;
+  parser = Parse(cache, edited, corpus);
+  passed = Check(parser && cache.misses() == 2 &&
+                     parser->symbol_table().Lookup(
+                         Interner::ForThread().Intern("added")) != nullptr,
+                 "edited header misses") &&
+           passed;
+  Parse(cache, edited, corpus);
+  passed = Check(cache.hits() == 1, "then hits") && passed;
+
+  // A damaged file is not loaded.
+  Preprocessor preprocessor(files);
+  auto file = cache.PathFor(preprocessor, corpus);
+  {
+    fstream out(file, ios::in | ios::out | ios::binary);
+    out.seekp(64);
+    out.write("\xff\xff\xff\xff\xff\xff\xff\xff", 8);
+  }
+  Parse(cache, edited, corpus);
+  passed = Check(cache.misses() == 3, "damaged file misses") && passed;
+
+  system(("rm -rf " + string(directory)).c_str());
+  cout << (passed ? "cache: ok" : "cache: FAILED") << endl;
+  return passed ? 0 : 1;
+}
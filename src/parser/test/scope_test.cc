@@ -0,0 +1,208 @@
+#include "../../util/check.h"
+#include "../parser.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+using namespace std;
+
+static Atom Name(const string &spelling) {
+  return Interner::ForThread().Intern(spelling);
+}
+
+// Row of the declaration `name` resolves to from `scope`, or 0.
+static unsigned RowOf(const Scope &scope, const string &name,
+                      IdentifierNameSpace name_space =
+                          IdentifierNameSpace::ORDINARY_IDENTIFIER) {
+  auto symbol = scope.Lookup(Name(name), name_space);
+  return symbol ? symbol->token().position().row() : 0;
+}
+
+int main() {
+  const string path = "scope_input.c";
+  {
+    ofstream out(path);
+    out << "int x;\n"                   // 1
+           "int y;\n"                   // 2
+           "int f(int x, int z) {\n"    // 3
+           "  int y;\n"                 // 4
+           "  {\n"                      // 5
+           "    float x;\n"             // 6
+           "    x;\n"                   // 7
+           "  }\n"                      // 8
+           "  y;\n"                     // 9
+           "}\n";
+  }
+  Parser parser(path);
+  Check(parser.Scan(), "parses");
+  auto &root = parser.root_scope();
+  Check(root.children().size() == 1, "one function body");
+  auto &body = *root.children()[0];
+  Check(body.children().size() == 1, "one inner block");
+  auto &block = *body.children()[0];
+
+  Check(RowOf(root, "x") == 1, "file scope x");
+  Check(RowOf(root, "f") == 3, "the definition of f is in the file scope");
+  Check(RowOf(root, "z") == 0, "parameters are not in the file scope");
+  Check(RowOf(body, "x") == 3, "a parameter hides the file scope x");
+  Check(RowOf(body, "z") == 3, "parameters are in the body's scope");
+  Check(RowOf(body, "y") == 4, "a local hides the file scope y");
+  Check(RowOf(block, "x") == 6, "the innermost x");
+  Check(RowOf(block, "y") == 4, "y from the enclosing block");
+  Check(RowOf(block, "f") == 3, "f from the file scope");
+  Check(block.LookupLocal(Name("y")) == nullptr, "y is not local to a block");
+  Check(RowOf(block, "undeclared") == 0, "an undeclared name");
+  Check(block.enclosing() == &body && body.enclosing() == &root &&
+            root.enclosing() == nullptr,
+        "enclosing scopes");
+
+  // Name spaces are separate: a label does not hide a variable.
+  auto local_y = body.LookupLocal(Name("y"));
+  block.Declare(root.LookupLocal(Name("x")), IdentifierNameSpace::LABEL_NAME);
+  Check(RowOf(block, "x", IdentifierNameSpace::LABEL_NAME) == 1,
+        "x as a label");
+  Check(RowOf(block, "x") == 6, "x as a variable");
+  Check(root.Lookup(Name("x"), IdentifierNameSpace::LABEL_NAME) == nullptr,
+        "the label is only in the block");
+  Check(body.Declare(local_y) == local_y, "redeclaring returns the previous");
+
+  // After the parse only the file scope is open in the table.
+  auto &table = parser.symbol_table();
+  Check(table.Lookup(Name("x"))->token().position().row() == 1,
+        "the table is back at file scope");
+  Check(table.Lookup(Name("z")) == nullptr, "parameters went with the body");
+  Check(table.scope_count() == 3 && table.parent(2) == 1 &&
+            table.parent(1) == SymbolTable::FILE_SCOPE,
+        "scopes numbered as entered");
+
+  // Entering and leaving scopes shadows a name and restores it.
+  {
+    SymbolTable names;
+    auto file_x = root.LookupLocal(Name("x"));
+    auto param_x = body.LookupLocal(Name("x"));
+    auto float_x = block.LookupLocal(Name("x"));
+    names.Declare(file_x);
+    names.EnterScope();
+    Check(names.Declare(param_x) == nullptr, "x is not local yet");
+    names.EnterScope();
+    names.Declare(float_x);
+    Check(names.Lookup(Name("x")) == float_x, "innermost binding");
+    Check(names.LookupLocal(Name("x")) == float_x, "local binding");
+    names.ExitScope();
+    Check(names.Lookup(Name("x")) == param_x, "restored on exit");
+    Check(names.Declare(float_x) == param_x, "redeclaring returns previous");
+    names.ExitScope();
+    Check(names.Lookup(Name("x")) == file_x, "file scope binding restored");
+    Check(names.scope(2).enclosing() == &names.scope(1) &&
+              names.scope(1).LookupLocal(Name("x")) == float_x,
+          "tree built from the log");
+  }
+
+  // A parameter hides a typedef-name, so `T;` is an expression.
+  {
+    ofstream out(path);
+    out << "typedef int T;\n"
+           "int f(int T) {\n"
+           "  T;\n"
+           "}\n"
+           "T t;\n";
+  }
+  Parser hiding(path);
+  Check(hiding.Scan(), "parses a parameter hiding a typedef");
+  Check(hiding.symbol_table().LookupTypedefName(Name("T")) != nullptr,
+        "T is a typedef-name again after the body");
+
+  // Types are built once per structure and shared.
+  {
+    ofstream out(path);
+    out << "typedef int *P;\n"
+           "int *p;\n"
+           "int *q;\n"
+           "P r;\n"
+           "const int *c;\n"
+           "int a[4];\n"
+           "int b[4];\n"
+           "int f(int *, char);\n"
+           "int g(int *x, char y);\n"
+           "static int *s[4];\n"
+           "int *t[4];\n"
+           "static P u;\n"
+           "extern int i;\n"
+           "typedef int I;\n"
+           "static int h(int *x, char y);\n";
+  }
+  Parser typed(path);
+  Check(typed.Scan(), "parses declarations of shared types");
+  auto &types = typed.symbol_table();
+  auto type_of = [&](const string &name) {
+    return types.Lookup(Name(name))->type();
+  };
+  Check(type_of("p") == type_of("q"), "int * is one type");
+  Check(type_of("r") == types.LookupTypedefName(Name("P")),
+        "a typedef-name names the same type");
+  Check(type_of("p") != type_of("c"), "qualifiers make another type");
+  Check(type_of("a") == type_of("b"), "int[4] is one type");
+  Check(type_of("f") == type_of("g"), "parameter names do not matter");
+  Check(types.Lookup(Name("g"))->parameters().size() == 2,
+        "the declarator keeps its parameters");
+  // Storage classes belong to the declaration, not to the type.
+  Check(type_of("s") == type_of("t") && type_of("u") == type_of("p") &&
+            type_of("i") == types.LookupTypedefName(Name("I")) &&
+            type_of("h") == type_of("g"),
+        "storage classes make no other type");
+  Check(types.Lookup(Name("s"))->storage_class() == SCS_STATIC &&
+            types.Lookup(Name("t"))->storage_class() == 0 &&
+            types.Lookup(Name("u"))->storage_class() == SCS_STATIC &&
+            types.Lookup(Name("i"))->storage_class() == SCS_EXTERN &&
+            types.Lookup(Name("h"))->storage_class() == SCS_STATIC,
+        "the symbol keeps its storage class");
+
+  // Deep nesting, with the same name declared at every level.
+  const int depth = 500;
+  {
+    ofstream out(path);
+    out << "int f() {\n";
+    for (int i = 0; i < depth; ++i) {
+      out << "int v; {\n";
+    }
+    out << "v;\n";
+    for (int i = 0; i < depth; ++i) {
+      out << "}\n";
+    }
+    out << "}\n";
+  }
+  Parser deep(path);
+  Check(deep.Scan(), "parses deep nesting");
+  auto innermost = &deep.root_scope();
+  for (int i = 0; i <= depth; ++i) {
+    innermost = innermost->children().empty() ? nullptr
+                                              : innermost->children()[0];
+    if (innermost == nullptr) {
+      break;
+    }
+  }
+  Check(innermost != nullptr && RowOf(*innermost, "v") == unsigned(depth + 1),
+        "the innermost v");
+  Check(deep.symbol_table().Lookup(Name("v")) == nullptr,
+        "every v went with its block");
+
+  // Many names in one scope, past several rehashes.
+  {
+    ofstream out(path);
+    for (int i = 0; i < 5000; ++i) {
+      out << "int v" << i << ";\n";
+    }
+  }
+  Parser many(path);
+  Check(many.Scan(), "parses many declarations");
+  for (int i = 0; i < 5000; ++i) {
+    if (RowOf(many.root_scope(), "v" + to_string(i)) != unsigned(i + 1)) {
+      Check(false, "v" + to_string(i));
+      break;
+    }
+  }
+
+  remove(path.c_str());
+  cout << (passed ? "scope: ok" : "scope: FAILED") << endl;
+  return passed ? 0 : 1;
+}
@@ -1,12 +1,35 @@
 #include "../parser.h"
 #include "../../lexer/lexer.h"
+#include "../../util/trace.h"
 #include <iostream>
 #include <string>
 #include <memory>
 using namespace std;
 
-int main() {
-    std::unique_ptr<Parser> parser = std::make_unique<Parser>("test.txt");
+// Usage: test [--trace=lexer,parser,declarations,expressions,statements|all]
+//             [file]
+int main(int argc, char **argv) {
+    string path = "test.txt";
+    const string trace_flag = "--trace=";
+    for (int i = 1; i < argc; ++i) {
+        string argument = argv[i];
+        if (argument.compare(0, trace_flag.size(), trace_flag) == 0) {
+            if (!Trace::Global().Enable(argument.substr(trace_flag.size()))) {
+                cerr << "Unknown trace category in " << argument << endl;
+                return 1;
+            }
+        } else {
+            path = argument;
+        }
+    }
+    std::unique_ptr<Parser> parser = std::make_unique<Parser>(path);
     parser->Scan();
+    Trace::Global().Flush();
+    // Every parsing decision is made from lookahead; a rewind is a bug.
+    if (parser->rewound_tokens() != 0) {
+        cerr << "Parser rewound " << parser->rewound_tokens() << " tokens."
+             << endl;
+        return 1;
+    }
     return 0;
 }
@@ -0,0 +1,120 @@
+#include "../../util/check.h"
+#include "../parser.h"
+#include <fstream>
+#include <iostream>
+#include <string>
+using namespace std;
+
+static const Symbol *Find(const Parser &parser, const string &name) {
+  return parser.symbol_table().Lookup(Interner::ForThread().Intern(name));
+}
+
+static BuiltinKind BuiltinOfName(const Parser &parser, const string &name) {
+  auto symbol = Find(parser, name);
+  return symbol ? symbol->type()->builtin() : BuiltinKind::NONE;
+}
+
+int main() {
+  // Every spelling of a type canonicalizes to one builtin.
+  Check(BuiltinOf(TS_INT) == BuiltinKind::INT, "int");
+  Check(BuiltinOf(TS_SIGNED) == BuiltinKind::INT, "signed");
+  Check(BuiltinOf(TS_SIGNED | TS_INT) == BuiltinKind::INT, "signed int");
+  Check(BuiltinOf(TS_UNSIGNED) == BuiltinKind::UNSIGNED_INT, "unsigned");
+  Check(BuiltinOf(TS_UNSIGNED | TS_CHAR) == BuiltinKind::UNSIGNED_CHAR,
+        "unsigned char");
+  Check(BuiltinOf(TS_LONG | TS_INT) == BuiltinKind::LONG, "long int");
+  Check(BuiltinOf(TS_UNSIGNED | TS_LONGLONG | TS_INT) ==
+            BuiltinKind::UNSIGNED_LONG_LONG,
+        "unsigned long long int");
+  Check(BuiltinOf(TS_LONG | TS_DOUBLE) == BuiltinKind::LONG_DOUBLE,
+        "long double");
+  Check(BuiltinOf(TS_SIGNED | TS_UNSIGNED) == BuiltinKind::NONE,
+        "signed unsigned");
+  Check(BuiltinOf(TS_UNSIGNED | TS_FLOAT) == BuiltinKind::NONE,
+        "unsigned float");
+  Check(BuiltinOf(TS_SHORT | TS_CHAR) == BuiltinKind::NONE, "short char");
+  Check(BuiltinOf(TS_LONG | TS_DOUBLE | TS_INT) == BuiltinKind::NONE,
+        "long int double");
+
+  // Sizes come from the layout table.
+  TypeContext types;
+  Check(types.Builtin(BuiltinKind::SHORT)->width() == 2, "short is 2 bytes");
+  Check(types.Builtin(BuiltinKind::LONG_LONG)->width() == 8,
+        "long long is 8 bytes");
+  Check(types.Builtin(BuiltinKind::DOUBLE)->width() == 8, "double");
+  auto int_type = types.Builtin(BuiltinKind::INT);
+  Check(types.Pointer(int_type)->width() == POINTER_LAYOUT.size, "pointer");
+  Check(types.Array(int_type, 10)->width() == 40, "int[10]");
+
+  // The usual arithmetic conversions.
+  auto common = [&](BuiltinKind kind1, BuiltinKind kind2) {
+    return ArithmeticType::Max(
+        *static_cast<const ArithmeticType *>(types.Builtin(kind1)),
+        *static_cast<const ArithmeticType *>(types.Builtin(kind2)));
+  };
+  Check(common(BuiltinKind::CHAR, BuiltinKind::SHORT) == BuiltinKind::INT,
+        "char and short promote to int");
+  Check(common(BuiltinKind::INT, BuiltinKind::UNSIGNED_INT) ==
+            BuiltinKind::UNSIGNED_INT,
+        "int and unsigned int");
+  Check(common(BuiltinKind::UNSIGNED_INT, BuiltinKind::LONG) ==
+            BuiltinKind::LONG,
+        "long holds every unsigned int");
+  Check(common(BuiltinKind::LONG, BuiltinKind::UNSIGNED_LONG_LONG) ==
+            BuiltinKind::UNSIGNED_LONG_LONG,
+        "unsigned long long outranks long");
+  Check(common(BuiltinKind::LONG_LONG, BuiltinKind::UNSIGNED_LONG) ==
+            BuiltinKind::UNSIGNED_LONG_LONG,
+        "long long does not hold every unsigned long");
+  Check(common(BuiltinKind::UNSIGNED_LONG_LONG, BuiltinKind::FLOAT) ==
+            BuiltinKind::FLOAT,
+        "any floating type wins");
+  Check(common(BuiltinKind::DOUBLE, BuiltinKind::FLOAT) ==
+            BuiltinKind::DOUBLE,
+        "double and float");
+
+  // Specifiers in any order, resolved once per declaration.
+  const string path = "type_input.c";
+  {
+    ofstream out(path);
+    out << "unsigned u;\n"
+           "long unsigned int lu;\n"
+           "int long long ll;\n"
+           "char c;\n"
+           "unsigned char uc;\n"
+           "const signed short s;\n"
+           "long double ld;\n"
+           "typedef unsigned long size;\n"
+           "size n;\n"
+           "long a; long int b;\n"
+           "int i; signed si;\n"
+           "long *p; long int *q;\n";
+  }
+  Parser parser(path);
+  Check(parser.Scan(), "parses");
+  Check(BuiltinOfName(parser, "u") == BuiltinKind::UNSIGNED_INT, "u");
+  Check(BuiltinOfName(parser, "lu") == BuiltinKind::UNSIGNED_LONG, "lu");
+  Check(BuiltinOfName(parser, "ll") == BuiltinKind::LONG_LONG, "ll");
+  Check(BuiltinOfName(parser, "c") == BuiltinKind::CHAR, "c");
+  Check(BuiltinOfName(parser, "uc") == BuiltinKind::UNSIGNED_CHAR, "uc");
+  Check(BuiltinOfName(parser, "s") == BuiltinKind::SHORT, "s");
+  Check(BuiltinOfName(parser, "ld") == BuiltinKind::LONG_DOUBLE, "ld");
+  Check(BuiltinOfName(parser, "n") == BuiltinKind::UNSIGNED_LONG,
+        "a typedef-name keeps its builtin");
+  auto s = Find(parser, "s");
+  Check(s->type()->type_qualifier() == TQ_CONST, "qualifiers stay in the type");
+  // The specifiers as written are the declaration's, not the type's.
+  Check(Find(parser, "a")->type() == Find(parser, "b")->type(),
+        "long and long int are one type");
+  Check(Find(parser, "i")->type() == Find(parser, "si")->type(),
+        "int and signed are one type");
+  Check(Find(parser, "p")->type() == Find(parser, "q")->type(),
+        "long * and long int * are one type");
+  Check(Find(parser, "a")->type_specifier() == TS_LONG &&
+            Find(parser, "b")->type_specifier() == (TS_LONG | TS_INT),
+        "the symbol keeps its spelling");
+
+  remove(path.c_str());
+  cout << (passed ? "types: ok" : "types: FAILED") << endl;
+  return passed ? 0 : 1;
+}
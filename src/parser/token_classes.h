@@ -0,0 +1,95 @@
+#ifndef _TOKEN_CLASSES_H_
+#define _TOKEN_CLASSES_H_
+
+#include "../lexer/token.h"
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+
+/**
+ * The grammar classes a token can belong to, one bit each. A FIRST set of
+ * the grammar is a mask of these, so asking whether a token can start a
+ * rule is one table load and one AND.
+ */
+enum TokenClass : uint16_t {
+  STORAGE_CLASS_SPECIFIER = 1 << 0,
+  TYPE_SPECIFIER = 1 << 1,
+  TYPE_QUALIFIER = 1 << 2,
+  FUNCTION_SPECIFIER = 1 << 3,
+  ALIGNMENT_SPECIFIER = 1 << 4,
+  PRIMARY_EXPRESSION_START = 1 << 5,
+  UNARY_OPERATOR = 1 << 6,
+  STATEMENT_KEYWORD = 1 << 7,
+
+  DECLARATION_SPECIFIER = STORAGE_CLASS_SPECIFIER | TYPE_SPECIFIER |
+                          TYPE_QUALIFIER | FUNCTION_SPECIFIER |
+                          ALIGNMENT_SPECIFIER,
+  EXPRESSION_START = PRIMARY_EXPRESSION_START | UNARY_OPERATOR,
+  STATEMENT_START = STATEMENT_KEYWORD | EXPRESSION_START,
+};
+
+namespace token_classes {
+
+/**
+ * The grammar description: which tokens make up each class. Typedef-names
+ * are identifiers, so they are decided by the scope, not here.
+ */
+constexpr std::array<uint16_t, 256> MakeTokenClasses() {
+  std::array<uint16_t, 256> classes{};
+  auto add = [&classes](TokenClass token_class,
+                        std::initializer_list<TOKEN> tags) {
+    for (auto tag : tags) {
+      classes[static_cast<uint8_t>(tag)] |= token_class;
+    }
+  };
+  add(STORAGE_CLASS_SPECIFIER,
+      {TOKEN::TYPEDEF, TOKEN::EXTERN, TOKEN::STATIC, TOKEN::THREAD_LOCAL,
+       TOKEN::AUTO, TOKEN::REGISTER});
+  add(TYPE_SPECIFIER,
+      {TOKEN::VOID, TOKEN::CHAR, TOKEN::SHORT, TOKEN::INT, TOKEN::LONG,
+       TOKEN::FLOAT, TOKEN::DOUBLE, TOKEN::SIGNED, TOKEN::UNSIGNED,
+       TOKEN::BOOL, TOKEN::COMPLEX, TOKEN::ATOMIC, TOKEN::STRUCT, TOKEN::UNION,
+       TOKEN::ENUM});
+  add(TYPE_QUALIFIER,
+      {TOKEN::CONST, TOKEN::RESTRICT, TOKEN::VOLATILE, TOKEN::ATOMIC});
+  add(FUNCTION_SPECIFIER, {TOKEN::INLINE, TOKEN::NORETURN});
+  add(ALIGNMENT_SPECIFIER, {TOKEN::ALIGNAS});
+  add(PRIMARY_EXPRESSION_START,
+      {TOKEN::IDENTIFIER, TOKEN::INTEGER_CONTANT, TOKEN::FLOATING_CONSTANT,
+       TOKEN::ENUMERATION_CONSTANT, TOKEN::CHARACTER_CONSTANT,
+       TOKEN::STRING_LITERAL, TOKEN::LPAR, TOKEN::GENERIC});
+  add(UNARY_OPERATOR,
+      {TOKEN::INCREMENT, TOKEN::DECREMENT, TOKEN::AND, TOKEN::STAR,
+       TOKEN::ADD, TOKEN::SUB, TOKEN::NOT, TOKEN::LOGICAL_NOT, TOKEN::SIZEOF,
+       TOKEN::ALIGNOF});
+  add(STATEMENT_KEYWORD,
+      {TOKEN::CASE, TOKEN::DEFAULT, TOKEN::LBRACE, TOKEN::IF, TOKEN::SWITCH,
+       TOKEN::WHILE, TOKEN::DO, TOKEN::FOR, TOKEN::GOTO, TOKEN::CONTINUE,
+       TOKEN::BREAK, TOKEN::RETURN, TOKEN::SEMI});
+  return classes;
+}
+
+inline constexpr auto TOKEN_CLASSES = MakeTokenClasses();
+
+} // namespace token_classes
+
+inline constexpr bool InTokenClass(TOKEN tag, uint16_t mask) {
+  return token_classes::TOKEN_CLASSES[static_cast<uint8_t>(tag)] & mask;
+}
+
+// FIRST(declaration-specifiers), not counting typedef-names.
+inline constexpr bool IsSpecifier(TOKEN tag) {
+  return InTokenClass(tag, DECLARATION_SPECIFIER);
+}
+
+// FIRST(expression).
+inline constexpr bool StartsExpression(TOKEN tag) {
+  return InTokenClass(tag, EXPRESSION_START);
+}
+
+// FIRST(statement); an identifier also covers the labeled-statement.
+inline constexpr bool StartsStatement(TOKEN tag) {
+  return InTokenClass(tag, STATEMENT_START);
+}
+
+#endif
@@ -0,0 +1,338 @@
+#include "preprocessor.h"
+#include <climits>
+#include <cstdlib>
+
+namespace {
+
+// Preprocessing arithmetic is done in intmax_t and uintmax_t (6.10.1p4).
+struct Number {
+  long long value;
+  bool is_unsigned;
+
+  unsigned long long bits() const {
+    return static_cast<unsigned long long>(value);
+  }
+};
+
+struct Operand {
+  TOKEN tag;
+  Number number;
+};
+
+/**
+ * Evaluates the controlling expression of an #if once defined and macros
+ * are replaced and every remaining name is 0: a constant-expression over
+ * integers, by precedence climbing as the parser does binary operators.
+ * Operands that are not evaluated (6.5.13p4, 6.5.14p4, 6.5.15p4) may
+ * divide by zero.
+ */
+class ConditionEvaluator {
+public:
+  explicit ConditionEvaluator(const std::vector<Operand> &operands)
+      : _operands(operands) {}
+
+  bool Evaluate(Number &result) {
+    result = Conditional();
+    if (_error.empty() && _next != _operands.size()) {
+      Fail("missing binary operator");
+    }
+    return _error.empty();
+  }
+  const std::string &error() const { return _error; }
+
+private:
+  static unsigned Precedence(TOKEN tag) {
+    switch (tag) {
+    case TOKEN::STAR:
+    case TOKEN::DIV:
+    case TOKEN::MOD:
+      return 10;
+    case TOKEN::ADD:
+    case TOKEN::SUB:
+      return 9;
+    case TOKEN::LEFT_SHIFT:
+    case TOKEN::RIGHT_SHIFT:
+      return 8;
+    case TOKEN::LESS:
+    case TOKEN::GREATER:
+    case TOKEN::LE:
+    case TOKEN::GE:
+      return 7;
+    case TOKEN::EQ:
+    case TOKEN::NE:
+      return 6;
+    case TOKEN::AND:
+      return 5;
+    case TOKEN::XOR:
+      return 4;
+    case TOKEN::OR:
+      return 3;
+    case TOKEN::LOGICAL_AND:
+      return 2;
+    case TOKEN::LOGICAL_OR:
+      return 1;
+    default:
+      return 0;
+    }
+  }
+
+  bool Peek(TOKEN tag) const {
+    return _next < _operands.size() && _operands[_next].tag == tag;
+  }
+  Number Fail(const std::string &message) {
+    if (_error.empty()) {
+      _error = message;
+    }
+    _next = _operands.size();
+    return {0, false};
+  }
+
+  Number Conditional() {
+    auto condition = Binary(Unary(), 1);
+    if (!Peek(TOKEN::COND)) {
+      return condition;
+    }
+    ++_next;
+    _unevaluated += condition.value == 0;
+    auto then = Conditional();
+    _unevaluated -= condition.value == 0;
+    if (!Peek(TOKEN::COLON)) {
+      return Fail("expected ':'");
+    }
+    ++_next;
+    _unevaluated += condition.value != 0;
+    auto otherwise = Conditional();
+    _unevaluated -= condition.value != 0;
+    auto result = condition.value != 0 ? then : otherwise;
+    result.is_unsigned = then.is_unsigned || otherwise.is_unsigned;
+    return result;
+  }
+
+  Number Binary(Number left, unsigned min_precedence) {
+    while (_next < _operands.size()) {
+      auto op = _operands[_next].tag;
+      auto precedence = Precedence(op);
+      if (precedence == 0 || precedence < min_precedence) {
+        break;
+      }
+      ++_next;
+      bool skipped = (op == TOKEN::LOGICAL_AND && left.value == 0) ||
+                     (op == TOKEN::LOGICAL_OR && left.value != 0);
+      _unevaluated += skipped;
+      auto right = Binary(Unary(), precedence + 1);
+      _unevaluated -= skipped;
+      left = Apply(op, left, right);
+    }
+    return left;
+  }
+
+  Number Unary() {
+    if (_next == _operands.size()) {
+      return Fail("expected an expression");
+    }
+    auto &operand = _operands[_next++];
+    switch (operand.tag) {
+    case TOKEN::INTEGER_CONTANT:
+      return operand.number;
+    case TOKEN::LPAR: {
+      auto inner = Conditional();
+      if (!Peek(TOKEN::RPAR)) {
+        return Fail("missing ')'");
+      }
+      ++_next;
+      return inner;
+    }
+    case TOKEN::ADD:
+      return Unary();
+    case TOKEN::SUB: {
+      auto inner = Unary();
+      return {static_cast<long long>(0 - inner.bits()), inner.is_unsigned};
+    }
+    case TOKEN::NOT: {
+      auto inner = Unary();
+      return {static_cast<long long>(~inner.bits()), inner.is_unsigned};
+    }
+    case TOKEN::LOGICAL_NOT:
+      return {Unary().value == 0, false};
+    default:
+      return Fail("token is not valid in a preprocessor expression");
+    }
+  }
+
+  Number Apply(TOKEN op, Number left, Number right) {
+    bool is_unsigned = left.is_unsigned || right.is_unsigned;
+    auto a = left.bits(), b = right.bits();
+    auto wrap = [is_unsigned](unsigned long long bits) {
+      return Number{static_cast<long long>(bits), is_unsigned};
+    };
+    auto truth = [](bool value) { return Number{value, false}; };
+    switch (op) {
+    case TOKEN::STAR:
+      return wrap(a * b);
+    case TOKEN::DIV:
+    case TOKEN::MOD:
+      if (b == 0) {
+        return _unevaluated > 0 ? Number{0, is_unsigned}
+                                : Fail("division by zero");
+      }
+      if (is_unsigned) {
+        return wrap(op == TOKEN::DIV ? a / b : a % b);
+      }
+      if (left.value == LLONG_MIN && right.value == -1) {
+        return wrap(op == TOKEN::DIV ? a : 0);
+      }
+      return op == TOKEN::DIV ? Number{left.value / right.value, false}
+                              : Number{left.value % right.value, false};
+    case TOKEN::ADD:
+      return wrap(a + b);
+    case TOKEN::SUB:
+      return wrap(a - b);
+    case TOKEN::LEFT_SHIFT:
+      return {static_cast<long long>(b >= 64 ? 0 : a << b),
+              left.is_unsigned};
+    case TOKEN::RIGHT_SHIFT:
+      if (b >= 64) {
+        return {left.is_unsigned || left.value >= 0 ? 0 : -1,
+                left.is_unsigned};
+      }
+      return left.is_unsigned
+                 ? Number{static_cast<long long>(a >> b), true}
+                 : Number{left.value >> b, false};
+    case TOKEN::LESS:
+      return truth(is_unsigned ? a < b : left.value < right.value);
+    case TOKEN::GREATER:
+      return truth(is_unsigned ? a > b : left.value > right.value);
+    case TOKEN::LE:
+      return truth(is_unsigned ? a <= b : left.value <= right.value);
+    case TOKEN::GE:
+      return truth(is_unsigned ? a >= b : left.value >= right.value);
+    case TOKEN::EQ:
+      return truth(a == b);
+    case TOKEN::NE:
+      return truth(a != b);
+    case TOKEN::AND:
+      return wrap(a & b);
+    case TOKEN::XOR:
+      return wrap(a ^ b);
+    case TOKEN::OR:
+      return wrap(a | b);
+    case TOKEN::LOGICAL_AND:
+      return truth(left.value != 0 && right.value != 0);
+    case TOKEN::LOGICAL_OR:
+      return truth(left.value != 0 || right.value != 0);
+    default:
+      return Fail("unknown operator");
+    }
+  }
+
+  const std::vector<Operand> &_operands;
+  size_t _next = 0;
+  // Depth of operands that are parsed but not evaluated.
+  unsigned _unevaluated = 0;
+  std::string _error;
+};
+
+// The value of a character constant's text: its first character, or the
+// escape sequence it starts with. Plain char is signed.
+long long CharacterValue(std::string_view text) {
+  if (text.empty()) {
+    return 0;
+  }
+  if (text[0] != '\\' || text.size() == 1) {
+    return static_cast<signed char>(text[0]);
+  }
+  char escape = text[1];
+  switch (escape) {
+  case 'n':
+    return '\n';
+  case 't':
+    return '\t';
+  case 'r':
+    return '\r';
+  case 'a':
+    return '\a';
+  case 'b':
+    return '\b';
+  case 'f':
+    return '\f';
+  case 'v':
+    return '\v';
+  case 'x':
+    return static_cast<signed char>(
+        std::strtol(std::string(text.substr(2)).c_str(), nullptr, 16));
+  default:
+    if (escape >= '0' && escape <= '7') {
+      return static_cast<signed char>(
+          std::strtol(std::string(text.substr(1, 3)).c_str(), nullptr, 8));
+    }
+    return escape;
+  }
+}
+
+} // namespace
+
+// 6.10.1: `defined` is evaluated first, then macros are replaced and any
+// name left is 0.
+bool Preprocessor::EvaluateCondition(const PPToken &directive,
+                                     std::vector<PPToken> line) {
+  std::vector<PPToken> replaced;
+  for (size_t i = 0; i < line.size(); ++i) {
+    if (!line[i].IsName() || line[i].atom() != _names.defined) {
+      replaced.push_back(line[i]);
+      continue;
+    }
+    size_t name = i + 1;
+    bool parenthesized = name < line.size() && line[name].tag == TOKEN::LPAR;
+    name += parenthesized;
+    if (name == line.size() || !line[name].IsName()) {
+      Error{"Operator \"defined\" requires an identifier at " +
+            Location(line[i]) + "."};
+    }
+    if (parenthesized &&
+        (name + 1 == line.size() || line[name + 1].tag != TOKEN::RPAR)) {
+      Error{"Missing ')' after \"defined\" at " + Location(line[i]) + "."};
+    }
+    replaced.push_back({TOKEN::INTEGER_CONTANT, 0, 0, NONE, line[i].offset,
+                        0, IsDefined(line[name].atom()), 0, NONE});
+    i = name + parenthesized;
+  }
+  std::vector<Operand> operands;
+  for (auto &token : ExpandAll(replaced)) {
+    Operand operand{token.tag, {0, false}};
+    if (token.IsName()) {
+      operand.tag = TOKEN::INTEGER_CONTANT;
+    } else if (token.tag == TOKEN::INTEGER_CONTANT && token.source == NONE) {
+      operand.number.value = static_cast<long long>(token.payload);
+    } else if (token.tag == TOKEN::INTEGER_CONTANT) {
+      // The lexer's value saturates at LLONG_MAX; read it again with its
+      // suffix.
+      std::string spelling(Spelling(token));
+      char *suffix;
+      auto bits = std::strtoull(spelling.c_str(), &suffix, 0);
+      operand.number.value = static_cast<long long>(bits);
+      operand.number.is_unsigned = bits > LLONG_MAX;
+      for (; *suffix != '\0'; ++suffix) {
+        operand.number.is_unsigned |= *suffix == 'u' || *suffix == 'U';
+      }
+    } else if (token.tag == TOKEN::CHARACTER_CONSTANT) {
+      operand.tag = TOKEN::INTEGER_CONTANT;
+      auto spelling = Spelling(token);
+      operand.number.value =
+          CharacterValue(spelling.substr(1, spelling.size() - 2));
+    } else if (token.tag == TOKEN::FLOATING_CONSTANT ||
+               token.tag == TOKEN::STRING_LITERAL) {
+      Error{"Invalid token in #if at " + Location(token) + "."};
+    }
+    operands.push_back(operand);
+  }
+  if (operands.empty()) {
+    Error{"#if with no expression at " + Location(directive) + "."};
+  }
+  ConditionEvaluator evaluator(operands);
+  Number result;
+  if (!evaluator.Evaluate(result)) {
+    Error{"Invalid #if expression at " + Location(directive) + ": " +
+          evaluator.error() + "."};
+  }
+  return result.value != 0;
+}
@@ -0,0 +1,841 @@
+#include "preprocessor.h"
+#include <algorithm>
+
+void Preprocessor::DefineMacro(Macro macro) {
+  auto index = static_cast<uint32_t>(macro.name);
+  if (index >= _macro_of.size()) {
+    auto size = std::max<size_t>(index + 1, _macro_of.size() * 2);
+    _macro_of.resize(size, NONE);
+    _hide_bit_of.resize(size, NONE);
+  }
+  if (_hide_bit_of[index] == NONE) {
+    _hide_bit_of[index] = _hide_bits++;
+  }
+  _macro_of[index] = static_cast<uint32_t>(_macros.size());
+  _macros.push_back(std::move(macro));
+  MacrosChanged();
+}
+
+// `line` is what follows #define: the name, a parameter list if a '('
+// touches it, and the replacement list. '##' is kept as one PASTE token,
+// and names of parameters are numbered.
+void Preprocessor::DefineDirective(const PPToken &directive,
+                                   const std::vector<PPToken> &line) {
+  if (line.empty() || !line[0].IsName()) {
+    Error{"Macro names must be identifiers at " + Location(directive) + "."};
+  }
+  Macro macro{line[0].atom(), Builtin::NONE, false, false, 0, {}};
+  if (macro.name == _names.defined) {
+    Error{"\"defined\" cannot be used as a macro name at " +
+          Location(line[0]) + "."};
+  }
+  size_t i = 1;
+  std::vector<Atom> parameters;
+  if (i < line.size() && line[i].tag == TOKEN::LPAR &&
+      !(line[i].flags & LEADING_SPACE)) {
+    macro.function_like = true;
+    ++i;
+    if (i < line.size() && line[i].tag == TOKEN::RPAR) {
+      ++i;
+    } else {
+      for (;;) {
+        if (i < line.size() && line[i].tag == TOKEN::ELLIPSIS) {
+          macro.variadic = true;
+          parameters.push_back(_names.va_args);
+          ++i;
+        } else if (i < line.size() && line[i].IsName()) {
+          parameters.push_back(line[i++].atom());
+          // GNU: a named variable argument, "args...".
+          if (i < line.size() && line[i].tag == TOKEN::ELLIPSIS) {
+            macro.variadic = true;
+            ++i;
+          }
+        } else {
+          Error{"Invalid parameter list of macro at " + Location(line[0]) +
+                "."};
+        }
+        if (i < line.size() && line[i].tag == TOKEN::RPAR) {
+          ++i;
+          break;
+        }
+        if (macro.variadic || i == line.size() ||
+            line[i].tag != TOKEN::COMMA) {
+          Error{"Invalid parameter list of macro at " + Location(line[0]) +
+                "."};
+        }
+        ++i;
+      }
+    }
+    macro.parameter_count = static_cast<uint16_t>(parameters.size());
+  }
+  for (; i < line.size(); ++i) {
+    auto token = line[i];
+    token.flags &= LEADING_SPACE;
+    if (token.tag == TOKEN::SHARP && i + 1 < line.size() &&
+        line[i + 1].tag == TOKEN::SHARP &&
+        line[i + 1].offset == token.offset + 1) {
+      token.flags |= PASTE;
+      macro.pastes = true;
+      ++i;
+    } else if (token.IsName()) {
+      auto parameter =
+          std::find(parameters.begin(), parameters.end(), token.atom());
+      if (parameter != parameters.end()) {
+        token.parameter =
+            static_cast<uint16_t>(parameter - parameters.begin() + 1);
+      }
+    }
+    macro.body.push_back(token);
+  }
+  auto &body = macro.body;
+  if (!body.empty() && ((body.front().flags & PASTE) ||
+                        (body.back().flags & PASTE))) {
+    Error{"'##' cannot appear at either end of a macro expansion at " +
+          Location(line[0]) + "."};
+  }
+  if (macro.function_like) {
+    for (size_t k = 0; k < body.size(); ++k) {
+      if (body[k].tag == TOKEN::SHARP && !(body[k].flags & PASTE) &&
+          (k + 1 == body.size() || body[k + 1].parameter == 0)) {
+        Error{"'#' is not followed by a macro parameter at " +
+              Location(body[k]) + "."};
+      }
+    }
+  }
+  TRACE(PREPROCESSOR, "Define: " << Interner::ForThread().spelling(macro.name)
+                                 << '\n');
+  DefineMacro(std::move(macro));
+}
+
+// The next token after macro replacement. A replaced name becomes a context
+// that reads its replacement list, which is replaced again as it is read.
+Preprocessor::PPToken Preprocessor::ExpandToken() {
+  for (;;) {
+    auto token = ReadToken();
+    if (!token.IsName() || (token.flags & (NO_EXPAND | FINAL))) {
+      return Emit(token);
+    }
+    auto name = token.atom();
+    auto macro = FindMacro(name);
+    if (macro == nullptr) {
+      if (name != _names.pragma_operator) {
+        return Emit(token);
+      }
+      // _Pragma("...") is dropped like a #pragma, except that it cannot
+      // say `once`.
+      ++_lookahead;
+      auto next = ReadSpelled();
+      if (next.tag != TOKEN::LPAR) {
+        --_lookahead;
+        PushBack(next);
+        return Emit(token);
+      }
+      if (ReadSpelled().tag != TOKEN::STRING_LITERAL ||
+          ReadSpelled().tag != TOKEN::RPAR) {
+        Error{"_Pragma takes a parenthesized string literal at " +
+              Location(token) + "."};
+      }
+      --_lookahead;
+      continue;
+    }
+    if (_hide_sets.Has(token.hide_set, HideBit(name))) {
+      token.flags |= NO_EXPAND;
+      return Emit(token);
+    }
+    if (macro->builtin != Builtin::NONE) {
+      return Emit(BuiltinToken(*macro, token));
+    }
+    ArgumentList list;
+    std::vector<Argument> arguments;
+    if (!macro->function_like) {
+      Replace(*macro, token, arguments,
+              _hide_sets.Add(token.hide_set, HideBit(name)));
+      continue;
+    }
+    // A function-like macro name not followed by '(' is just a name.
+    ++_lookahead;
+    auto next = ReadSpelled();
+    if (next.tag != TOKEN::LPAR) {
+      --_lookahead;
+      PushBack(next);
+      return Emit(token);
+    }
+    auto rpar = ReadArguments(*macro, token, list, arguments);
+    --_lookahead;
+    auto hide_set = _hide_sets.Intersection(token.hide_set, rpar.hide_set);
+    Replace(*macro, token, arguments, _hide_sets.Add(hide_set, HideBit(name)));
+  }
+}
+
+// Replaces every macro in the tokens of a directive.
+std::vector<Preprocessor::PPToken>
+Preprocessor::ExpandAll(const std::vector<PPToken> &tokens) {
+  auto expanded = ExpandIsolated(tokens, 0,
+                                 static_cast<uint32_t>(tokens.size()), nullptr);
+  if (std::none_of(expanded.begin(), expanded.end(),
+                   [](const PPToken &token) { return token.IsSpan(); })) {
+    return expanded;
+  }
+  std::vector<PPToken> spelled;
+  for (auto &token : expanded) {
+    Spell(token, spelled);
+  }
+  return spelled;
+}
+
+// Replaces every macro in tokens[begin, end), which are read on their own:
+// an invocation does not take its arguments from what follows them, and
+// what is memoized while they are read is kept apart. The tokens are of
+// `list` if it is not nullptr.
+std::vector<Preprocessor::PPToken>
+Preprocessor::ExpandIsolated(const std::vector<PPToken> &tokens,
+                             uint32_t begin, uint32_t end,
+                             const ArgumentList *list) {
+  auto depth = _contexts.size();
+  PushContext(tokens, begin, end, HideSetTable::EMPTY_SET, NONE);
+  _contexts.back().isolated = true;
+  _contexts.back().list = list;
+  std::vector<PPToken> log;
+  uint32_t recording = 0, lookahead = 0;
+  _memo_log.swap(log);
+  std::swap(_recording, recording);
+  std::swap(_lookahead, lookahead);
+  std::vector<PPToken> expanded;
+  for (;;) {
+    auto token = ExpandToken();
+    if (token.tag == TOKEN::FILE_EOF) {
+      break;
+    }
+    expanded.push_back(token);
+  }
+  while (_contexts.size() > depth) {
+    PopContext();
+  }
+  _memo_log.swap(log);
+  std::swap(_recording, recording);
+  std::swap(_lookahead, lookahead);
+  return expanded;
+}
+
+void Preprocessor::PushContext(const std::vector<PPToken> &tokens,
+                               uint32_t begin, uint32_t end,
+                               uint32_t hide_set, uint32_t expansion) {
+  _contexts.push_back({&tokens, begin, begin, end, hide_set, expansion, false,
+                       0, false, false, nullptr, NONE, 0, 0});
+}
+
+// A context that has been read to its end goes. If it was recording a
+// memo, what ExpandToken handed out since it came is the memo, spans
+// spelled out, unless the end was reached by looking past a name: then the
+// expansion took tokens that follow it.
+void Preprocessor::PopContext() {
+  auto &context = _contexts.back();
+  if (context.memo_key != NONE) {
+    auto recording = std::move(_recordings.back());
+    _recordings.pop_back();
+    if (_lookahead == 0 && context.memo_epoch == _memo_epoch) {
+      for (auto i = context.log_start; i < _memo_log.size(); ++i) {
+        Spell(_memo_log[i], recording.memo.tokens);
+      }
+      _memo_of.emplace(recording.key, static_cast<uint32_t>(_memos.size()));
+      _memos.push_back(std::move(recording.memo));
+    }
+    if (--_recording == 0) {
+      _memo_log.clear();
+    }
+  }
+  if (context.tokens == &_scratch) {
+    _scratch.resize(context.begin);
+  }
+  _contexts.pop_back();
+}
+
+void Preprocessor::PushBack(const PPToken &token) {
+  auto begin = static_cast<uint32_t>(_scratch.size());
+  _scratch.push_back(token);
+  PushContext(_scratch, begin, begin + 1, HideSetTable::EMPTY_SET, NONE);
+}
+
+void Preprocessor::OpenSpan(const PPToken &span) {
+  PushContext(_spans[span.payload], span.offset, span.length, span.hide_set,
+              span.expansion);
+  auto &context = _contexts.back();
+  context.respace = true;
+  context.leading_space = span.flags & LEADING_SPACE;
+}
+
+void Preprocessor::Spell(const PPToken &token, std::vector<PPToken> &tokens) {
+  if (!token.IsSpan()) {
+    tokens.push_back(token);
+    return;
+  }
+  auto first = tokens.size();
+  for (auto i = token.offset; i < token.length; ++i) {
+    auto spanned = _spans[token.payload][i];
+    spanned.hide_set = _hide_sets.Union(spanned.hide_set, token.hide_set);
+    if (spanned.expansion == NONE) {
+      spanned.expansion = token.expansion;
+    }
+    Spell(spanned, tokens);
+  }
+  tokens[first].flags =
+      (tokens[first].flags & ~LEADING_SPACE) | (token.flags & LEADING_SPACE);
+}
+
+void Preprocessor::SplitLastSpan(std::vector<PPToken> &tokens) {
+  while (tokens.back().IsSpan()) {
+    auto span = tokens.back();
+    tokens.pop_back();
+    auto last = _spans[span.payload][span.length - 1];
+    last.hide_set = _hide_sets.Union(last.hide_set, span.hide_set);
+    if (last.expansion == NONE) {
+      last.expansion = span.expansion;
+    }
+    if (--span.length > span.offset) {
+      // The rest is balanced with no ',' outside parentheses if all of it
+      // was and the last token is.
+      if (last.IsSpan() ? !(last.flags & OPAQUE)
+                        : last.tag == TOKEN::LPAR || last.tag == TOKEN::RPAR ||
+                              last.tag == TOKEN::COMMA) {
+        span.flags &= ~OPAQUE;
+      }
+      tokens.push_back(span);
+    } else {
+      last.flags = (last.flags & ~LEADING_SPACE) | (span.flags & LEADING_SPACE);
+    }
+    tokens.push_back(last);
+  }
+}
+
+// Reads the arguments of an invocation of `macro` up to the ')' that closes
+// them, which is returned. Read from the arguments of an enclosing
+// invocation, they are views of its argument list, found by the separators
+// noted in it; otherwise they are read into `list`, and the separators
+// noted.
+Preprocessor::PPToken
+Preprocessor::ReadArguments(const Macro &macro, const PPToken &name,
+                            ArgumentList &list,
+                            std::vector<Argument> &arguments) {
+  PPToken token;
+  if (!_contexts.empty() && _contexts.back().list != nullptr) {
+    // The context adds nothing to its tokens, so they are as they were
+    // read; the '(' is the one before the next.
+    auto &context = _contexts.back();
+    auto &tokens = context.list->tokens;
+    auto &separators = context.list->separators;
+    auto at = separators[context.next - 1];
+    arguments.push_back({context.list, context.next, at});
+    while (tokens[at].tag == TOKEN::COMMA) {
+      auto next = separators[at];
+      // The variable argument takes the commas of the rest.
+      if (macro.variadic && arguments.size() == macro.parameter_count) {
+        arguments.back().last = next;
+      } else {
+        arguments.push_back({context.list, at + 1, next});
+      }
+      at = next;
+    }
+    context.next = at + 1;
+    token = tokens[at];
+  } else {
+    auto &tokens = list.tokens;
+    arguments.push_back({&list, 0, 0});
+    uint32_t depth = 0;
+    bool nested = false;
+    for (;;) {
+      token = ReadToken();
+      // A span is taken whole unless a ',' or parenthesis of it counts.
+      if (token.IsSpan() && !(token.flags & OPAQUE)) {
+        OpenSpan(token);
+        continue;
+      }
+      if (token.tag == TOKEN::FILE_EOF) {
+        Error{"Unterminated argument list invoking macro \"" +
+              std::string(Interner::ForThread().spelling(macro.name)) +
+              "\" at " + Location(name) + "."};
+      }
+      // The variable argument takes the commas of the rest.
+      if (depth == 0 &&
+          (token.tag == TOKEN::RPAR ||
+           (token.tag == TOKEN::COMMA &&
+            !(macro.variadic && arguments.size() == macro.parameter_count)))) {
+        // What follows the last token of an argument is new to it.
+        if (tokens.size() > arguments.back().first) {
+          SplitLastSpan(tokens);
+        }
+        auto size = static_cast<uint32_t>(tokens.size());
+        arguments.back().last = size;
+        if (token.tag == TOKEN::RPAR) {
+          break;
+        }
+        tokens.push_back(token);
+        arguments.push_back({&list, size + 1, size + 1});
+        continue;
+      }
+      if (token.tag == TOKEN::LPAR) {
+        ++depth;
+        nested = true;
+      } else if (token.tag == TOKEN::RPAR) {
+        --depth;
+      }
+      tokens.push_back(token);
+    }
+    if (nested) {
+      // The '(' or ',' the tokens at each depth come after.
+      std::vector<uint32_t> open;
+      list.separators.resize(tokens.size());
+      for (uint32_t i = 0; i < tokens.size(); ++i) {
+        if (tokens[i].tag == TOKEN::LPAR) {
+          open.push_back(i);
+        } else if (tokens[i].tag == TOKEN::COMMA && !open.empty()) {
+          list.separators[open.back()] = i;
+          open.back() = i;
+        } else if (tokens[i].tag == TOKEN::RPAR) {
+          list.separators[open.back()] = i;
+          open.pop_back();
+        }
+      }
+    }
+  }
+  if (macro.parameter_count == 0 && arguments.size() == 1 &&
+      arguments[0].size() == 0) {
+    arguments.clear();
+  }
+  if (macro.variadic && arguments.size() + 1 == macro.parameter_count) {
+    arguments.push_back({&list, 0, 0});
+  }
+  if (arguments.size() != macro.parameter_count) {
+    Error{"Macro \"" + std::string(Interner::ForThread().spelling(macro.name)) +
+          "\" passed " + std::to_string(arguments.size()) +
+          " arguments, but takes " + std::to_string(macro.parameter_count) +
+          " at " + Location(name) + "."};
+  }
+  return token;
+}
+
+void Preprocessor::Replace(const Macro &macro, const PPToken &name,
+                           std::vector<Argument> &arguments,
+                           uint32_t hide_set) {
+  ++_statistics.expansions;
+  // Expanding the arguments may spell __LINE__ or __FILE__, which must
+  // keep the memo from being stored.
+  auto epoch = _memo_epoch;
+  auto expansion = AddExpansion(name);
+  auto memoized = IsMemoized(arguments);
+  auto key = memoized ? MemoKey(macro, hide_set, arguments) : 0;
+  Memo *memo = nullptr;
+  for (auto [at, end] = _memo_of.equal_range(key); memoized && at != end;
+       ++at) {
+    if (IsMemoOf(_memos[at->second], macro, hide_set, arguments)) {
+      memo = &_memos[at->second];
+      break;
+    }
+  }
+  if (memo != nullptr) {
+    ++_statistics.memo_hits;
+    if (!memo->paired) {
+      Pair(*memo);
+    }
+    auto &tokens = memo->tokens;
+    auto &from_arguments = memo->from_arguments;
+    if (from_arguments.empty()) {
+      PushContext(tokens, 0, static_cast<uint32_t>(tokens.size()),
+                  HideSetTable::EMPTY_SET, expansion);
+    } else {
+      std::vector<const PPToken *> spelled;
+      for (auto &argument : arguments) {
+        for (auto &token : argument) {
+          spelled.push_back(&token);
+        }
+      }
+      auto begin = static_cast<uint32_t>(_scratch.size());
+      _scratch.insert(_scratch.end(), tokens.begin(), tokens.end());
+      for (auto &pair : from_arguments) {
+        Respell(_scratch[begin + pair.first], *spelled[pair.second]);
+      }
+      PushContext(_scratch, begin, static_cast<uint32_t>(_scratch.size()),
+                  HideSetTable::EMPTY_SET, expansion);
+    }
+    auto &context = _contexts.back();
+    context.final = true;
+    context.respace = true;
+    context.leading_space = name.flags & LEADING_SPACE;
+    return;
+  }
+  if (!macro.function_like && !macro.pastes) {
+    // The body is read in place.
+    PushContext(macro.body, 0, static_cast<uint32_t>(macro.body.size()),
+                hide_set, expansion);
+    _contexts.back().respace = true;
+    _contexts.back().leading_space = name.flags & LEADING_SPACE;
+  } else {
+    auto begin = static_cast<uint32_t>(_scratch.size());
+    Substitute(macro, name, arguments);
+    PushContext(_scratch, begin, static_cast<uint32_t>(_scratch.size()),
+                hide_set, expansion);
+  }
+  if (!memoized) {
+    return;
+  }
+  auto &context = _contexts.back();
+  context.memo_key = static_cast<uint32_t>(_recordings.size());
+  context.log_start = static_cast<uint32_t>(_memo_log.size());
+  context.memo_epoch = epoch;
+  auto &recording = _recordings.emplace_back();
+  recording.key = key;
+  recording.memo.generation = _generation;
+  recording.memo.macro = macro.name;
+  recording.memo.hide_set = hide_set;
+  for (auto &argument : arguments) {
+    recording.memo.arguments.emplace_back(argument.begin(), argument.end());
+  }
+  ++_recording;
+}
+
+// A token spelled by several arguments takes the first one's spelling.
+void Preprocessor::Pair(Memo &memo) {
+  std::unordered_map<uint64_t, uint32_t> numbers;
+  for (auto &argument : memo.arguments) {
+    for (auto &token : argument) {
+      numbers.emplace(SpellingKey(token),
+                      static_cast<uint32_t>(numbers.size()));
+    }
+  }
+  for (uint32_t i = 0; !numbers.empty() && i < memo.tokens.size(); ++i) {
+    auto number = numbers.find(SpellingKey(memo.tokens[i]));
+    if (number != numbers.end()) {
+      memo.from_arguments.emplace_back(i, number->second);
+    }
+  }
+  memo.paired = true;
+}
+
+void Preprocessor::Respell(PPToken &token, const PPToken &argument) {
+  // Text payloads are offsets in the source too.
+  if (TokenList::ValueKind(token.tag) == Value::Kind::TEXT) {
+    auto text = (token.payload >> 32) - token.offset + argument.offset;
+    token.payload = text << 32 | static_cast<uint32_t>(token.payload);
+  }
+  token.source = argument.source;
+  token.offset = argument.offset;
+  token.length = argument.length;
+}
+
+// Appends the replacement list of an invocation of `macro` to _scratch
+// (6.10.3.1 - 6.10.3.3).
+void Preprocessor::Substitute(const Macro &macro, const PPToken &name,
+                              std::vector<Argument> &arguments) {
+  auto &body = macro.body;
+  // Arguments are replaced first, which reads contexts of their own.
+  for (size_t i = 0; i < body.size(); ++i) {
+    auto &token = body[i];
+    if ((macro.function_like && token.tag == TOKEN::SHARP) ||
+        (token.flags & PASTE)) {
+      ++i;
+    } else if (token.parameter != 0 &&
+               !(i + 1 < body.size() && (body[i + 1].flags & PASTE))) {
+      Expanded(arguments[token.parameter - 1]);
+    }
+  }
+  auto &result = _scratch;
+  auto begin = result.size();
+  // Whether result ends in a placemarker: an empty argument next to '##'.
+  bool placemarker = false;
+  for (size_t i = 0; i < body.size(); ++i) {
+    auto &token = body[i];
+    if (macro.function_like && token.tag == TOKEN::SHARP &&
+        !(token.flags & PASTE)) {
+      auto &argument = arguments[body[++i].parameter - 1];
+      result.push_back(Stringize(argument, token));
+      placemarker = false;
+      continue;
+    }
+    if (token.flags & PASTE) {
+      auto &right = body[++i];
+      if (right.parameter == 0) {
+        if (placemarker) {
+          result.push_back(right);
+        } else {
+          result.back() = Paste(result.back(), right);
+        }
+        placemarker = false;
+        continue;
+      }
+      auto first = result.size();
+      Spell(arguments[right.parameter - 1], result);
+      // GNU: in `, ## __VA_ARGS__` the comma goes if the argument is empty.
+      if (macro.variadic && right.parameter == macro.parameter_count &&
+          !placemarker && body[i - 2].tag == TOKEN::COMMA &&
+          body[i - 2].parameter == 0) {
+        if (first == result.size()) {
+          result.pop_back();
+        }
+        continue;
+      }
+      if (first == result.size()) {
+        continue;
+      }
+      if (!placemarker) {
+        result[first - 1] = Paste(result[first - 1], result[first]);
+        result.erase(result.begin() + first);
+      }
+      placemarker = false;
+      continue;
+    }
+    if (token.parameter != 0) {
+      auto &argument = arguments[token.parameter - 1];
+      // An operand of '##' is not replaced first.
+      if (i + 1 < body.size() && (body[i + 1].flags & PASTE)) {
+        auto first = result.size();
+        Spell(argument, result);
+        placemarker = first == result.size();
+      } else {
+        result.insert(result.end(), argument.expanded.begin(),
+                      argument.expanded.end());
+        placemarker = false;
+      }
+      continue;
+    }
+    result.push_back(token);
+    placemarker = false;
+  }
+  for (auto i = begin; i < result.size(); ++i) {
+    result[i].flags &= ~(LINE_START | FINAL);
+  }
+  if (begin < result.size()) {
+    result[begin].flags = (result[begin].flags & ~LEADING_SPACE) |
+                          (name.flags & LEADING_SPACE);
+  }
+}
+
+// Short arguments with no span in them, which a memo keeps a copy of.
+bool Preprocessor::IsMemoized(const std::vector<Argument> &arguments) const {
+  size_t size = 0;
+  for (auto &argument : arguments) {
+    size += argument.size();
+  }
+  if (size > MAX_MEMO_ARGUMENTS) {
+    return false;
+  }
+  for (auto &argument : arguments) {
+    if (std::any_of(argument.begin(), argument.end(),
+                    [](const PPToken &token) { return token.IsSpan(); })) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// What an expansion depends on: the macros as they are, the macro, the hide
+// set its tokens get, and the arguments.
+uint64_t Preprocessor::MemoKey(const Macro &macro, uint32_t hide_set,
+                               const std::vector<Argument> &arguments) const {
+  auto hash = HashCombine(
+      HashCombine(_generation, static_cast<uint32_t>(macro.name)), hide_set);
+  for (auto &argument : arguments) {
+    uint64_t tokens = 0;
+    for (auto &token : argument) {
+      tokens = HashToken(tokens, token);
+    }
+    hash = HashCombine(HashCombine(hash, tokens), argument.size());
+  }
+  return hash;
+}
+
+bool Preprocessor::IsMemoOf(const Memo &memo, const Macro &macro,
+                            uint32_t hide_set,
+                            const std::vector<Argument> &arguments) const {
+  if (memo.generation != _generation || memo.macro != macro.name ||
+      memo.hide_set != hide_set || memo.arguments.size() != arguments.size()) {
+    return false;
+  }
+  for (size_t k = 0; k < arguments.size(); ++k) {
+    auto &argument = arguments[k];
+    if (!std::equal(argument.begin(), argument.end(), memo.arguments[k].begin(),
+                    memo.arguments[k].end(),
+                    [this](const PPToken &a, const PPToken &b) {
+                      return SameToken(a, b);
+                    })) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Adds `token` to the hash of the tokens before it: names by atom and other
+// tokens by spelling, as SameToken compares them.
+uint64_t Preprocessor::HashToken(uint64_t hash, const PPToken &token) const {
+  hash = HashCombine(HashCombine(hash, static_cast<uint32_t>(token.tag)),
+                     token.flags & (LEADING_SPACE | NO_EXPAND));
+  hash = HashCombine(hash, token.hide_set);
+  if (token.IsName()) {
+    return HashCombine(hash, static_cast<uint32_t>(token.atom()));
+  }
+  auto spelling = Spelling(token);
+  return HashCombine(hash, HashBytes(spelling.data(), spelling.size()));
+}
+
+bool Preprocessor::SameToken(const PPToken &a, const PPToken &b) const {
+  if (a.tag != b.tag || a.hide_set != b.hide_set ||
+      ((a.flags ^ b.flags) & (LEADING_SPACE | NO_EXPAND))) {
+    return false;
+  }
+  return a.IsName() ? a.atom() == b.atom() : Spelling(a) == Spelling(b);
+}
+
+uint32_t Preprocessor::AddExpansion(const PPToken &name) {
+  auto index = static_cast<uint32_t>(_expansions.size());
+  auto parent = name.expansion;
+  _expansions.push_back({name.atom(), name.source, name.offset, parent,
+                         parent == NONE ? index : _expansions[parent].root});
+  return index;
+}
+
+// An argument as replaced. A long one is kept as a span of all its tokens
+// but the last, and that token. Rescanned, no token of the span can be
+// replaced: a name among them that was not is in its own hide set or is
+// not followed by '(', and each is followed by what it was. The last one
+// may be followed by a '(' now.
+const std::vector<Preprocessor::PPToken> &
+Preprocessor::Expanded(Argument &argument) {
+  if (argument.is_expanded) {
+    return argument.expanded;
+  }
+  argument.expanded = ExpandIsolated(argument.list->tokens, argument.first,
+                                     argument.last, argument.list);
+  if (argument.expanded.size() > MIN_SPAN) {
+    AddSpan(argument.expanded);
+  }
+  argument.is_expanded = true;
+  return argument.expanded;
+}
+
+void Preprocessor::AddSpan(std::vector<PPToken> &tokens) {
+  SplitLastSpan(tokens);
+  auto last = tokens.back();
+  tokens.pop_back();
+  bool opaque = true;
+    int depth = 0;
+  for (auto &token : tokens) {
+    if (token.IsSpan()) {
+      opaque = opaque && (token.flags & OPAQUE);
+    } else if (token.tag == TOKEN::LPAR) {
+      ++depth;
+    } else if (token.tag == TOKEN::RPAR) {
+      opaque = opaque && depth-- > 0;
+    } else if (token.tag == TOKEN::COMMA) {
+      opaque = opaque && depth > 0;
+    }
+  }
+  PPToken span{TOKEN::SPACE,
+               static_cast<uint8_t>((tokens[0].flags & LEADING_SPACE) |
+                                    (opaque && depth == 0 ? OPAQUE : 0)),
+               0,
+               NONE,
+               0,
+               static_cast<uint32_t>(tokens.size()),
+               _spans.size(),
+               HideSetTable::EMPTY_SET,
+               NONE};
+  _spans.push_back(std::move(tokens));
+  tokens = {span, last};
+}
+
+void Preprocessor::Spell(const Argument &argument,
+                         std::vector<PPToken> &tokens) {
+  for (auto &token : argument) {
+    Spell(token, tokens);
+  }
+}
+
+// A string literal spelling the tokens of `argument` (6.10.3.2): one space
+// wherever they were apart, and '"' and '\' escaped inside literals.
+Preprocessor::PPToken Preprocessor::Stringize(const Argument &argument,
+                                              const PPToken &at) {
+  std::vector<PPToken> tokens;
+  Spell(argument, tokens);
+  std::string text = "\"";
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    auto &token = tokens[i];
+    if (i > 0 && (token.flags & LEADING_SPACE)) {
+      text += ' ';
+    }
+    bool literal = token.tag == TOKEN::STRING_LITERAL ||
+                   token.tag == TOKEN::CHARACTER_CONSTANT;
+    for (char c : Spelling(token)) {
+      if (literal && (c == '"' || c == '\\')) {
+        text += '\\';
+      }
+      text += c;
+    }
+  }
+  text += '"';
+  PPToken token;
+  if (!Scratch(text, at, token)) {
+    Error{"Cannot stringize " + text + " at " + Location(at) + "."};
+  }
+  return token;
+}
+
+Preprocessor::PPToken Preprocessor::Paste(const PPToken &left,
+                                          const PPToken &right) {
+  std::string text(Spelling(left));
+  text += Spelling(right);
+  PPToken token;
+  if (!Scratch(text, left, token)) {
+    Error{"Pasting \"" + std::string(Spelling(left)) + "\" and \"" +
+          std::string(Spelling(right)) +
+          "\" does not give a valid preprocessing token at " +
+          Location(left) + "."};
+  }
+  return token;
+}
+
+// __FILE__ and __LINE__ of the line the innermost file is at.
+Preprocessor::PPToken Preprocessor::BuiltinToken(const Macro &macro,
+                                                 const PPToken &name) {
+  auto &frame = _frames.back();
+  auto offset = frame.tokens->offset(frame.next == 0 ? 0 : frame.next - 1);
+  std::string text;
+  if (macro.builtin == Builtin::LINE) {
+    text = std::to_string(PresumedRow(frame.source, offset));
+  } else {
+    text = "\"";
+    for (char c : PresumedFile(frame.source, offset)) {
+      if (c == '"' || c == '\\') {
+        text += '\\';
+      }
+      text += c;
+    }
+    text += '"';
+  }
+  // What it gives depends on where it is, so no memo being recorded can
+  // be kept.
+  ++_memo_epoch;
+  PPToken token;
+  Scratch(text, name, token);
+  token.expansion = AddExpansion(name);
+  return token;
+}
+
+bool Preprocessor::Scratch(const std::string &text, const PPToken &at,
+                           PPToken &token) {
+  std::shared_ptr<const SourceBuffer> buffer = SourceBuffer::FromText(text);
+  Lexer lexer(buffer, "<scratch>");
+  auto &tokens = lexer.token_list();
+  // One token, then FILE_EOF.
+  if (tokens.size() != 2 || tokens.offset(0) != 0 ||
+      tokens.length(0) != text.size()) {
+    return false;
+  }
+  token = {tokens.tag(0),
+           static_cast<uint8_t>(at.flags & LEADING_SPACE),
+           0,
+           AddSource(buffer, "<scratch>"),
+           0,
+           tokens.length(0),
+           tokens.payload(0),
+           at.hide_set,
+           NONE};
+  return true;
+}
@@ -0,0 +1,32 @@
+#include "file_cache.h"
+#include <sys/stat.h>
+
+FileCache::File *FileCache::Find(const std::string &path) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  ++_statistics.lookups;
+  auto known = _paths.find(path);
+  if (known != _paths.end()) {
+    return known->second;
+  }
+  ++_statistics.stats;
+  struct stat st;
+  File *file = nullptr;
+  if (stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+    auto &entry = _files[{st.st_dev, st.st_ino}];
+    if (entry == nullptr) {
+      entry = std::make_unique<File>(path);
+      ++_statistics.files;
+    }
+    file = entry.get();
+  }
+  _paths.emplace(path, file);
+  return file;
+}
+
+void FileCache::File::Load() const {
+  _source = SourceBuffer::Open(_path);
+  if (_source == nullptr) {
+    Error{"Cannot open file: " + _path};
+  }
+  _lexer = std::make_unique<Lexer>(_source, _path);
+}
@@ -0,0 +1,99 @@
+#ifndef YYQC_SRC_PREPROCESSOR_FILE_CACHE_H_
+#define YYQC_SRC_PREPROCESSOR_FILE_CACHE_H_
+
+#include "../lexer/lexer.h"
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * What a build knows about the files its translation units include, shared
+ * by all of their preprocessors. Include lookup tries one directory after
+ * another, so every path is stat(2)ed once, whether a file is there or not.
+ * A file is identified by its device and inode, so one reached through two
+ * spellings of its path is still one file; it is read and lexed once, the
+ * first time its tokens are asked for, however many units include it.
+ *
+ * What a preprocessor finds out about a file's include guard or its
+ * #pragma once is kept with the file, so a later #include of it, in the
+ * same unit or another, is skipped without looking at it again.
+ *
+ * Lookups may come from several threads. The tokens are interned by the
+ * thread that lexed them, though (see Interner), so a build that compiles
+ * units on several threads gives each thread a FileCache of its own.
+ */
+class FileCache {
+public:
+  class File {
+  public:
+    File(std::string path) : _path(std::move(path)) {}
+    // The path the file was first found under.
+    const std::string &path() const { return _path; }
+    // Its tokens, lexed on first use.
+    const Lexer &lexer() const {
+      std::call_once(_loaded, [this] { Load(); });
+      return *_lexer;
+    }
+    const std::shared_ptr<const SourceBuffer> &source() const {
+      lexer();
+      return _source;
+    }
+    // The macro whose #ifndef wraps the whole file, or Atom::NONE. While
+    // it is defined, including the file again changes nothing.
+    Atom guard() const { return _guard.load(std::memory_order_relaxed); }
+    void set_guard(Atom guard) {
+      _guard.store(guard, std::memory_order_relaxed);
+    }
+    bool pragma_once() const {
+      return _pragma_once.load(std::memory_order_relaxed);
+    }
+    void set_pragma_once() {
+      _pragma_once.store(true, std::memory_order_relaxed);
+    }
+
+  private:
+    void Load() const;
+
+    const std::string _path;
+    mutable std::once_flag _loaded;
+    mutable std::shared_ptr<const SourceBuffer> _source;
+    mutable std::unique_ptr<Lexer> _lexer;
+    std::atomic<Atom> _guard{Atom::NONE};
+    std::atomic<bool> _pragma_once{false};
+  };
+
+  struct Statistics {
+    uint64_t lookups = 0;
+    // Lookups that needed a stat(2).
+    uint64_t stats = 0;
+    uint64_t files = 0;
+  };
+
+  FileCache() = default;
+  FileCache(const FileCache &) = delete;
+  FileCache &operator=(const FileCache &) = delete;
+
+  // The regular file at `path`, or nullptr if there is none.
+  File *Find(const std::string &path);
+  Statistics statistics() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _statistics;
+  }
+
+private:
+  using FileId = std::pair<dev_t, ino_t>;
+
+  mutable std::mutex _mutex;
+  // nullptr for a path with no regular file.
+  std::unordered_map<std::string, File *> _paths;
+  std::map<FileId, std::unique_ptr<File>> _files;
+  Statistics _statistics;
+};
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef YYQC_SRC_PREPROCESSOR_HIDE_SET_H_
+#define YYQC_SRC_PREPROCESSOR_HIDE_SET_H_
+
+#include "../util/hash.h"
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * The hide sets of one translation unit's macro expansion. A set is a
+ * bitset over small numbers the preprocessor gives macro names, and is
+ * interned: one id per distinct set, so sets are compared and passed
+ * around as 32-bit ids and a token's set costs nothing to copy. The words
+ * of every set live in one array with trailing zero words dropped, so a
+ * set only takes as many words as its highest bit needs.
+ *
+ * Adding, uniting and intersecting are memoized by their operands: an
+ * expansion applies the same few operations to every token it makes, and
+ * each is done once.
+ */
+class HideSetTable {
+public:
+  static constexpr uint32_t EMPTY_SET = 0;
+
+  HideSetTable() { Intern(nullptr, 0); }
+  HideSetTable(const HideSetTable &) = delete;
+  HideSetTable &operator=(const HideSetTable &) = delete;
+
+  bool Has(uint32_t set, uint32_t bit) const {
+    auto &entry = _entries[set];
+    return bit / 64 < entry.size &&
+           (_words[entry.first + bit / 64] >> (bit % 64) & 1);
+  }
+  uint32_t Add(uint32_t set, uint32_t bit) {
+    if (Has(set, bit)) {
+      return set;
+    }
+    auto key = uint64_t(set) << 32 | bit;
+    auto known = _adds.find(key);
+    if (known != _adds.end()) {
+      return known->second;
+    }
+    auto &entry = _entries[set];
+    std::vector<uint64_t> words(std::max(entry.size, bit / 64 + 1));
+    std::copy_n(_words.begin() + entry.first, entry.size, words.begin());
+    words[bit / 64] |= uint64_t(1) << (bit % 64);
+    auto added = Intern(words.data(), static_cast<uint32_t>(words.size()));
+    _adds.emplace(key, added);
+    return added;
+  }
+  uint32_t Union(uint32_t set1, uint32_t set2) {
+    if (set1 == set2 || set2 == EMPTY_SET) {
+      return set1;
+    }
+    if (set1 == EMPTY_SET) {
+      return set2;
+    }
+    return Combine(_unions, set1, set2, false);
+  }
+  uint32_t Intersection(uint32_t set1, uint32_t set2) {
+    if (set1 == set2 || set1 == EMPTY_SET || set2 == EMPTY_SET) {
+      return set1 == set2 ? set1 : EMPTY_SET;
+    }
+    return Combine(_intersections, set1, set2, true);
+  }
+
+  // Number of distinct sets made so far.
+  size_t size() const { return _entries.size(); }
+
+private:
+  static constexpr uint32_t EMPTY = UINT32_MAX;
+
+  struct Entry {
+    uint32_t first;
+    uint32_t size;
+    uint64_t hash;
+  };
+
+  uint32_t Combine(std::unordered_map<uint64_t, uint32_t> &memo,
+                   uint32_t set1, uint32_t set2, bool intersect) {
+    auto key = uint64_t(std::min(set1, set2)) << 32 | std::max(set1, set2);
+    auto known = memo.find(key);
+    if (known != memo.end()) {
+      return known->second;
+    }
+    auto entry1 = _entries[set1], entry2 = _entries[set2];
+    std::vector<uint64_t> words(intersect
+                                    ? std::min(entry1.size, entry2.size)
+                                    : std::max(entry1.size, entry2.size));
+    for (uint32_t i = 0; i < words.size(); ++i) {
+      auto word1 = i < entry1.size ? _words[entry1.first + i] : 0;
+      auto word2 = i < entry2.size ? _words[entry2.first + i] : 0;
+      words[i] = intersect ? word1 & word2 : word1 | word2;
+    }
+    auto combined = Intern(words.data(), static_cast<uint32_t>(words.size()));
+    memo.emplace(key, combined);
+    return combined;
+  }
+
+  uint32_t Intern(const uint64_t *words, uint32_t size) {
+    while (size > 0 && words[size - 1] == 0) {
+      --size;
+    }
+    if ((_entries.size() + 1) * 2 > _slots.size()) {
+      Grow();
+    }
+    auto hash = HashBytes(words, size * sizeof(uint64_t));
+    auto mask = _slots.size() - 1;
+    for (auto i = hash & mask;; i = (i + 1) & mask) {
+      auto index = _slots[i];
+      if (index == EMPTY) {
+        _slots[i] = static_cast<uint32_t>(_entries.size());
+        _entries.push_back(
+            {static_cast<uint32_t>(_words.size()), size, hash});
+        _words.insert(_words.end(), words, words + size);
+        return _slots[i];
+      }
+      auto &entry = _entries[index];
+      if (entry.hash == hash && entry.size == size &&
+          std::equal(words, words + size, _words.begin() + entry.first)) {
+        return index;
+      }
+    }
+  }
+
+  void Grow() {
+    std::vector<uint32_t> slots(_slots.empty() ? 64 : _slots.size() * 2,
+                                EMPTY);
+    auto mask = slots.size() - 1;
+    for (uint32_t index = 0; index < _entries.size(); ++index) {
+      auto i = _entries[index].hash & mask;
+      while (slots[i] != EMPTY) {
+        i = (i + 1) & mask;
+      }
+      slots[i] = index;
+    }
+    _slots = std::move(slots);
+  }
+
+  std::vector<uint64_t> _words;
+  std::vector<Entry> _entries;
+  // Open addressing over _entries, by hash.
+  std::vector<uint32_t> _slots;
+  std::unordered_map<uint64_t, uint32_t> _adds;
+  std::unordered_map<uint64_t, uint32_t> _unions;
+  std::unordered_map<uint64_t, uint32_t> _intersections;
+};
+
+#endif
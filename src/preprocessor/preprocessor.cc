@@ -0,0 +1,622 @@
+#include "preprocessor.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+// Whether the blanks and comments in [p, end) hold a newline. A line
+// comment always ends at one.
+bool NewlineIn(const char *p, const char *end) {
+  while (p < end) {
+    if (*p == '\n' || (p[0] == '/' && p[1] == '/')) {
+      return true;
+    }
+    if (p[0] == '/' && p[1] == '*') {
+      p = scan_kernels.block_comment_end(p + 2) + 2;
+      continue;
+    }
+    ++p;
+  }
+  return false;
+}
+
+} // namespace
+
+Preprocessor::Preprocessor(FileCache &files) : _files(files) {
+  auto &interner = Interner::ForThread();
+  _names.define = interner.Intern("define");
+  _names.undef = interner.Intern("undef");
+  _names.include = interner.Intern("include");
+  _names.if_ = interner.Intern("if");
+  _names.ifdef = interner.Intern("ifdef");
+  _names.ifndef = interner.Intern("ifndef");
+  _names.elif = interner.Intern("elif");
+  _names.else_ = interner.Intern("else");
+  _names.endif = interner.Intern("endif");
+  _names.line = interner.Intern("line");
+  _names.error = interner.Intern("error");
+  _names.warning = interner.Intern("warning");
+  _names.pragma = interner.Intern("pragma");
+  _names.once = interner.Intern("once");
+  _names.defined = interner.Intern("defined");
+  _names.va_args = interner.Intern("__VA_ARGS__");
+  _names.pragma_operator = interner.Intern("_Pragma");
+  _names.file = interner.Intern("__FILE__");
+  _names.line_macro = interner.Intern("__LINE__");
+  DefineMacro({_names.file, Builtin::FILE, false, false, 0, {}});
+  DefineMacro({_names.line_macro, Builtin::LINE, false, false, 0, {}});
+  _predefined = "#define __STDC__ 1\n"
+                "#define __STDC_VERSION__ 201112L\n"
+                "#define __STDC_HOSTED__ 1\n";
+  _frames.reserve(MAX_INCLUDE_DEPTH + 2);
+}
+
+void Preprocessor::AddIncludePath(const std::string &directory) {
+  auto end = directory.find_last_not_of('/');
+  _include_paths.push_back(
+      end == std::string::npos ? directory : directory.substr(0, end + 1));
+}
+
+void Preprocessor::Define(const std::string &definition) {
+  auto equals = definition.find('=');
+  if (equals == std::string::npos) {
+    _predefined += "#define " + definition + " 1\n";
+  } else {
+    _predefined += "#define " + definition.substr(0, equals) + " " +
+                   definition.substr(equals + 1) + "\n";
+  }
+}
+
+void Preprocessor::Undefine(const std::string &name) {
+  _predefined += "#undef " + name + "\n";
+}
+
+void Preprocessor::AddInclude(const std::string &path) {
+  _predefined += "#include \"" + path + "\"\n";
+}
+
+std::unique_ptr<Lexer> Preprocessor::Run(const std::string &path) {
+  auto unit = EnterUnit(path);
+  // The predefined macros are a file of #defines read before the unit.
+  std::shared_ptr<const SourceBuffer> predefined =
+      SourceBuffer::FromText(_predefined);
+  _predefined_lexer = std::make_unique<Lexer>(predefined, "<built-in>");
+  EnterFile(nullptr, _predefined_lexer->token_list(),
+            AddSource(predefined, "<built-in>"));
+  return ExpandUnit(unit);
+}
+
+// The unit's file is source 0, the source of the output.
+FileCache::File *Preprocessor::EnterUnit(const std::string &path) {
+  auto file = _files.Find(path);
+  if (file == nullptr) {
+    Error{"Cannot open file: " + path};
+  }
+  auto &tokens = file->lexer().token_list();
+  _output.reserve(tokens.size());
+  _output_expansions.reserve(tokens.size());
+  EnterFile(file, tokens, AddSource(file->source(), path));
+  return file;
+}
+
+std::unique_ptr<Lexer> Preprocessor::ExpandUnit(FileCache::File *unit) {
+  auto &source = unit->source();
+  std::vector<PPToken> tokens;
+  for (;;) {
+    auto token = ExpandToken();
+    if (token.tag == TOKEN::FILE_EOF) {
+      break;
+    }
+    tokens.clear();
+    Spell(token, tokens);
+    for (auto &token : tokens) {
+      _output.AddEncoded(token.tag, token.offset, token.length, token.payload,
+                         token.source);
+      _output_expansions.push_back(token.expansion);
+    }
+    // Nothing refers to a span once no context is left.
+    if (_contexts.empty() && !_spans.empty()) {
+      _spans.clear();
+    }
+  }
+  LeaveFile();
+  _statistics.output_tokens = _output.size();
+  _statistics.hide_sets = _hide_sets.size();
+  _output.AddEncoded(TOKEN::FILE_EOF, source->size(), 0, 0, 0);
+  _output_expansions.push_back(NONE);
+  return std::make_unique<Lexer>(source, _source_names[0],
+                                 std::move(_output));
+}
+
+uint32_t Preprocessor::AddSource(std::shared_ptr<const SourceBuffer> source,
+                                 const std::string &name) {
+  _buffers.push_back(source.get());
+  _source_names.push_back(name);
+  _line_markers.emplace_back();
+  if (_buffers.size() == 1) {
+    _output.set_source(source.get());
+    return 0;
+  }
+  return _output.AddSource(std::move(source));
+}
+
+void Preprocessor::EnterFile(FileCache::File *file, const TokenList &tokens,
+                             uint32_t source) {
+  if (_frames.size() > MAX_INCLUDE_DEPTH) {
+    Error{"#include nested too deeply in " + _source_names[source] + "."};
+  }
+  _frames.push_back({file, &tokens, 0, source,
+                     static_cast<uint32_t>(_conditionals.size()),
+                     GuardState::START, Atom::NONE});
+  if (file != nullptr) {
+    _entered.insert(file);
+    ++_statistics.files_entered;
+    TRACE(PREPROCESSOR, "Enter: " << _source_names[source] << '\n');
+  }
+}
+
+void Preprocessor::LeaveFile() {
+  auto &frame = _frames.back();
+  if (_conditionals.size() > frame.conditional_depth) {
+    auto &open = _conditionals.back();
+    Error{"Unterminated conditional directive at " +
+          Location(open.source, open.offset) + "."};
+  }
+  if (frame.file != nullptr && frame.guard_state == GuardState::AFTER) {
+    frame.file->set_guard(frame.guard);
+    TRACE(PREPROCESSOR, "Include guard of "
+                            << _source_names[frame.source] << ": "
+                            << Interner::ForThread().spelling(frame.guard)
+                            << '\n');
+  }
+  _frames.pop_back();
+}
+
+// The next token of `frame`'s file. Flags come from the bytes in front of
+// it, and a backslash that ends a line is dropped. FILE_EOF is never
+// consumed.
+Preprocessor::PPToken Preprocessor::FileToken(Frame &frame) {
+  auto &tokens = *frame.tokens;
+  const char *data = _buffers[frame.source]->data();
+  for (;;) {
+    uint32_t i = frame.next;
+    PPToken token{tokens.tag(i), 0, 0, frame.source, tokens.offset(i),
+                  tokens.length(i), tokens.payload(i), 0, NONE};
+    if (token.tag == TOKEN::FILE_EOF) {
+      token.flags = LINE_START;
+      return token;
+    }
+    ++frame.next;
+    if (i == 0) {
+      token.flags = LINE_START;
+    } else {
+      uint32_t gap = tokens.offset(i - 1) + tokens.length(i - 1);
+      if (gap < token.offset) {
+        token.flags = LEADING_SPACE;
+        if (tokens.tag(i - 1) != TOKEN::BKSLASH &&
+            NewlineIn(data + gap, data + token.offset)) {
+          token.flags |= LINE_START;
+        }
+      }
+    }
+    if (token.tag == TOKEN::BKSLASH &&
+        NewlineIn(data + token.offset + token.length,
+                  data + tokens.offset(i + 1))) {
+      continue;
+    }
+    return token;
+  }
+}
+
+// The next token before macro replacement: the next of the innermost
+// context, or else the next of the innermost file, carrying out the
+// directives on the way.
+Preprocessor::PPToken Preprocessor::ReadToken() {
+  while (!_contexts.empty()) {
+    auto &context = _contexts.back();
+    if (context.next == context.end) {
+      if (context.isolated) {
+        return PPToken{TOKEN::FILE_EOF, 0, 0, NONE, 0, 0, 0, 0, NONE};
+      }
+      PopContext();
+      continue;
+    }
+    auto token = (*context.tokens)[context.next++];
+    if (context.final) {
+      token.flags |= FINAL;
+      token.expansion = context.expansion;
+    } else {
+      token.hide_set = _hide_sets.Union(token.hide_set, context.hide_set);
+      if (token.expansion == NONE) {
+        token.expansion = context.expansion;
+      }
+    }
+    if (context.respace && context.next == context.begin + 1) {
+      token.flags = (token.flags & ~LEADING_SPACE) | context.leading_space;
+    }
+    return token;
+  }
+  for (;;) {
+    auto &frame = _frames.back();
+    auto token = FileToken(frame);
+    if (token.tag == TOKEN::SHARP && (token.flags & LINE_START)) {
+      Directive(frame, token);
+      continue;
+    }
+    if (token.tag == TOKEN::FILE_EOF) {
+      if (_frames.size() == 1) {
+        return token;
+      }
+      LeaveFile();
+      continue;
+    }
+    if (frame.guard_state != GuardState::GUARDED) {
+      frame.guard_state = GuardState::NONE;
+    }
+    return token;
+  }
+}
+
+Preprocessor::PPToken Preprocessor::ReadSpelled() {
+  auto token = ReadToken();
+  while (token.IsSpan()) {
+    OpenSpan(token);
+    token = ReadToken();
+  }
+  return token;
+}
+
+// The rest of a directive's line.
+std::vector<Preprocessor::PPToken> Preprocessor::ReadLine(Frame &frame) {
+  std::vector<PPToken> line;
+  for (;;) {
+    auto next = frame.next;
+    auto token = FileToken(frame);
+    if (token.flags & LINE_START) {
+      frame.next = next;
+      return line;
+    }
+    line.push_back(token);
+  }
+}
+
+void Preprocessor::Directive(Frame &frame, const PPToken &sharp) {
+  ++_statistics.directives;
+  auto line = ReadLine(frame);
+  if (line.empty()) {
+    return;
+  }
+  auto directive = line[0];
+  std::vector<PPToken> rest(line.begin() + 1, line.end());
+  // Any directive outside the guard's #ifndef means the file has no guard;
+  // only that #ifndef itself may start one.
+  bool top_level = _conditionals.size() == frame.conditional_depth;
+  auto guard_state = frame.guard_state;
+  bool may_start_guard = top_level && guard_state == GuardState::START;
+  if (top_level && guard_state != GuardState::GUARDED) {
+    frame.guard_state = GuardState::NONE;
+  }
+  // GNU line markers, "# 12 "file"", as cpp writes them.
+  if (directive.tag == TOKEN::INTEGER_CONTANT) {
+    Line(frame, sharp, std::move(line));
+    return;
+  }
+  if (!directive.IsName()) {
+    Error{"Invalid preprocessing directive at " + Location(directive) + "."};
+  }
+  auto name = directive.atom();
+  TRACE(PREPROCESSOR, "Directive: #" << Interner::ForThread().spelling(name)
+                                     << " at " << Location(directive)
+                                     << '\n');
+  if (name == _names.define) {
+    DefineDirective(directive, rest);
+  } else if (name == _names.undef) {
+    if (rest.empty() || !rest[0].IsName()) {
+      Error{"Macro names must be identifiers at " + Location(directive) +
+            "."};
+    }
+    auto index = static_cast<uint32_t>(rest[0].atom());
+    if (index < _macro_of.size() && _macro_of[index] != NONE) {
+      _macro_of[index] = NONE;
+      MacrosChanged();
+    }
+  } else if (name == _names.include) {
+    Include(frame, directive, std::move(rest));
+  } else if (name == _names.ifdef || name == _names.ifndef) {
+    if (rest.empty() || !rest[0].IsName()) {
+      Error{"Macro names must be identifiers at " + Location(directive) +
+            "."};
+    }
+    if (name == _names.ifndef && may_start_guard) {
+      frame.guard_state = GuardState::GUARDED;
+      frame.guard = rest[0].atom();
+    }
+    If(frame, directive, IsDefined(rest[0].atom()) == (name == _names.ifdef));
+  } else if (name == _names.if_) {
+    // #if !defined X, or !defined(X), and nothing else.
+    if (may_start_guard && rest.size() >= 3 &&
+        rest[0].tag == TOKEN::LOGICAL_NOT && rest[1].IsName() &&
+        rest[1].atom() == _names.defined) {
+      bool parenthesized = rest.size() == 5 && rest[2].tag == TOKEN::LPAR &&
+                           rest[3].IsName() && rest[4].tag == TOKEN::RPAR;
+      if (rest.size() == 3 && rest[2].IsName()) {
+        frame.guard_state = GuardState::GUARDED;
+        frame.guard = rest[2].atom();
+      } else if (parenthesized) {
+        frame.guard_state = GuardState::GUARDED;
+        frame.guard = rest[3].atom();
+      }
+    }
+    If(frame, directive, EvaluateCondition(directive, std::move(rest)));
+  } else if (name == _names.elif || name == _names.else_) {
+    if (!Else(frame, directive, rest, name == _names.elif)) {
+      SkipGroup(frame);
+    }
+  } else if (name == _names.endif) {
+    Endif(frame, directive);
+  } else if (name == _names.line) {
+    Line(frame, directive, std::move(rest));
+  } else if (name == _names.error || name == _names.warning) {
+    std::string message;
+    if (!rest.empty()) {
+      auto begin = rest.front().offset;
+      auto end = rest.back().offset + rest.back().length;
+      message.assign(_buffers[frame.source]->data() + begin, end - begin);
+    }
+    if (name == _names.error) {
+      Error{"#error " + message + " at " + Location(directive) + "."};
+    }
+    Warning{"#warning " + message + " at " + Location(directive) + "."};
+  } else if (name == _names.pragma) {
+    // Other pragmas are for a later stage, and none of them is known yet.
+    if (!rest.empty() && rest[0].IsName() && rest[0].atom() == _names.once &&
+        frame.file != nullptr) {
+      frame.file->set_pragma_once();
+    }
+  } else {
+    Error{"Invalid preprocessing directive #" +
+          std::string(Interner::ForThread().spelling(name)) + " at " +
+          Location(directive) + "."};
+  }
+}
+
+void Preprocessor::Include(Frame &frame, const PPToken &directive,
+                           std::vector<PPToken> line) {
+  if (!line.empty() && line[0].tag != TOKEN::STRING_LITERAL &&
+      line[0].tag != TOKEN::LESS) {
+    line = ExpandAll(line);
+  }
+  std::string name;
+  bool angled = false;
+  if (line.size() == 1 && line[0].tag == TOKEN::STRING_LITERAL) {
+    auto spelling = Spelling(line[0]);
+    name = spelling.substr(1, spelling.size() - 2);
+  } else if (!line.empty() && line[0].tag == TOKEN::LESS &&
+             line.back().tag == TOKEN::GREATER) {
+    angled = true;
+    for (size_t i = 1; i + 1 < line.size(); ++i) {
+      if (i > 1 && (line[i].flags & LEADING_SPACE)) {
+        name += ' ';
+      }
+      name += Spelling(line[i]);
+    }
+  } else {
+    Error{"#include expects \"FILENAME\" or <FILENAME> at " +
+          Location(directive) + "."};
+  }
+  auto file = FindInclude(frame, name, angled);
+  if (file == nullptr) {
+    Error{"Cannot find include file " + name + " at " + Location(directive) +
+          "."};
+  }
+  if (file->pragma_once() && _entered.count(file) != 0) {
+    ++_statistics.pragma_once_skips;
+    TRACE(PREPROCESSOR, "Skip: " << name << " (#pragma once)\n");
+    return;
+  }
+  auto guard = file->guard();
+  if (guard != Atom::NONE && IsDefined(guard)) {
+    ++_statistics.guard_skips;
+    TRACE(PREPROCESSOR, "Skip: " << name << " (guarded by "
+                                 << Interner::ForThread().spelling(guard)
+                                 << ")\n");
+    return;
+  }
+  auto &tokens = file->lexer().token_list();
+  EnterFile(file, tokens, AddSource(file->source(), file->path()));
+}
+
+// "..." is looked for next to the includer first; both forms then go
+// through the include paths in order.
+FileCache::File *Preprocessor::FindInclude(const Frame &includer,
+                                           const std::string &name,
+                                           bool angled) {
+  if (!name.empty() && name[0] == '/') {
+    return _files.Find(name);
+  }
+  // A -include, from the predefined macros.
+  if (!angled && includer.file == nullptr) {
+    if (auto file = _files.Find(name)) {
+      return file;
+    }
+  }
+  if (!angled && includer.file != nullptr) {
+    auto &path = _source_names[includer.source];
+    auto slash = path.rfind('/');
+    auto directory =
+        slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+    if (auto file = _files.Find(directory + name)) {
+      return file;
+    }
+  }
+  for (auto &directory : _include_paths) {
+    if (auto file = _files.Find(directory + "/" + name)) {
+      return file;
+    }
+  }
+  return nullptr;
+}
+
+void Preprocessor::If(Frame &frame, const PPToken &directive, bool taken) {
+  _conditionals.push_back({directive.source, directive.offset, taken, false});
+  if (!taken) {
+    SkipGroup(frame);
+  }
+}
+
+bool Preprocessor::Else(Frame &frame, const PPToken &directive,
+                        const std::vector<PPToken> &line, bool is_elif) {
+  auto spelling = is_elif ? "#elif" : "#else";
+  if (_conditionals.size() == frame.conditional_depth) {
+    Error{std::string(spelling) + " without #if at " + Location(directive) +
+          "."};
+  }
+  auto &conditional = _conditionals.back();
+  if (conditional.after_else) {
+    Error{std::string(spelling) + " after #else at " + Location(directive) +
+          "."};
+  }
+  if (_conditionals.size() == frame.conditional_depth + 1 &&
+      frame.guard_state == GuardState::GUARDED) {
+    frame.guard_state = GuardState::NONE;
+  }
+  conditional.after_else = !is_elif;
+  if (conditional.taken) {
+    return false;
+  }
+  // A later group's condition is evaluated only if no group was taken.
+  conditional.taken = !is_elif || EvaluateCondition(directive, line);
+  return conditional.taken;
+}
+
+void Preprocessor::Endif(Frame &frame, const PPToken &directive) {
+  if (_conditionals.size() == frame.conditional_depth) {
+    Error{"#endif without #if at " + Location(directive) + "."};
+  }
+  _conditionals.pop_back();
+  if (_conditionals.size() == frame.conditional_depth &&
+      frame.guard_state == GuardState::GUARDED) {
+    frame.guard_state = GuardState::AFTER;
+  }
+}
+
+// Skips a group that is not taken, up to the #elif, #else or #endif that
+// ends it, which is then carried out. Only a '#' that starts a line is
+// looked at.
+void Preprocessor::SkipGroup(Frame &frame) {
+  uint32_t depth = 0;
+  for (;;) {
+    auto token = FileToken(frame);
+    if (token.tag == TOKEN::FILE_EOF) {
+      auto &open = _conditionals.back();
+      Error{"Unterminated conditional directive at " +
+            Location(open.source, open.offset) + "."};
+    }
+    if (token.tag != TOKEN::SHARP || !(token.flags & LINE_START)) {
+      continue;
+    }
+    auto line = ReadLine(frame);
+    if (line.empty() || !line[0].IsName()) {
+      continue;
+    }
+    auto name = line[0].atom();
+    if (name == _names.if_ || name == _names.ifdef ||
+        name == _names.ifndef) {
+      ++depth;
+    } else if (name == _names.endif) {
+      if (depth == 0) {
+        Endif(frame, line[0]);
+        return;
+      }
+      --depth;
+    } else if (depth == 0 && (name == _names.elif || name == _names.else_)) {
+      std::vector<PPToken> rest(line.begin() + 1, line.end());
+      if (Else(frame, line[0], rest, name == _names.elif)) {
+        return;
+      }
+    }
+  }
+}
+
+// #line number "file", or a GNU line marker, which has the same form.
+void Preprocessor::Line(Frame &frame, const PPToken &directive,
+                        std::vector<PPToken> line) {
+  if (line.empty()) {
+    Error{"#line expects a line number at " + Location(directive) + "."};
+  }
+  auto last = line.back();
+  line = ExpandAll(line);
+  if (line.empty() || line[0].tag != TOKEN::INTEGER_CONTANT) {
+    Error{"#line expects a line number at " + Location(directive) + "."};
+  }
+  std::string number(Spelling(line[0]));
+  LineMarker marker;
+  marker.offset = last.offset + last.length;
+  marker.row = _buffers[frame.source]->position(last.offset).row() + 1;
+  marker.number = std::strtoul(number.c_str(), nullptr, 10);
+  if (line.size() > 1 && line[1].tag == TOKEN::STRING_LITERAL) {
+    auto spelling = Spelling(line[1]);
+    marker.file = std::string(spelling.substr(1, spelling.size() - 2));
+  } else {
+    marker.file = PresumedFile(frame.source, directive.offset);
+  }
+  _line_markers[frame.source].push_back(std::move(marker));
+}
+
+uint32_t Preprocessor::PresumedRow(uint32_t source, uint32_t offset) const {
+  auto row = _buffers[source]->position(offset).row();
+  auto &markers = _line_markers[source];
+  auto marker = std::upper_bound(
+      markers.begin(), markers.end(), offset,
+      [](uint32_t offset, const LineMarker &m) { return offset < m.offset; });
+  if (marker == markers.begin()) {
+    return row;
+  }
+  --marker;
+  return marker->number + (row - marker->row);
+}
+
+const std::string &Preprocessor::PresumedFile(uint32_t source,
+                                              uint32_t offset) const {
+  auto &markers = _line_markers[source];
+  auto marker = std::upper_bound(
+      markers.begin(), markers.end(), offset,
+      [](uint32_t offset, const LineMarker &m) { return offset < m.offset; });
+  return marker == markers.begin() ? _source_names[source]
+                                   : std::prev(marker)->file;
+}
+
+std::string Preprocessor::Location(uint32_t source, uint32_t offset) const {
+  if (source == NONE) {
+    return "<built-in>";
+  }
+  auto position = _buffers[source]->position(offset);
+  return PresumedFile(source, offset) + ":" +
+         std::to_string(PresumedRow(source, offset)) + ":" +
+         std::to_string(position.column());
+}
+
+std::string Preprocessor::Location(const Token &token) const {
+  auto expansion = _output_expansions[token.index()];
+  if (expansion != NONE) {
+    auto &root = _expansions[_expansions[expansion].root];
+    return Location(root.source, root.offset);
+  }
+  return SpellingLocation(token);
+}
+
+std::string Preprocessor::SpellingLocation(const Token &token) const {
+  return Location(token.source_id(), token.offset());
+}
+
+std::vector<std::string>
+Preprocessor::MacroBacktrace(const Token &token) const {
+  std::vector<std::string> backtrace;
+  for (auto expansion = _output_expansions[token.index()]; expansion != NONE;
+       expansion = _expansions[expansion].parent) {
+    auto &record = _expansions[expansion];
+    backtrace.push_back(std::string(Interner::ForThread().spelling(record.macro)) +
+                        " at " + Location(record.source, record.offset));
+  }
+  return backtrace;
+}
@@ -0,0 +1,479 @@
+#ifndef YYQC_SRC_PREPROCESSOR_PREPROCESSOR_H_
+#define YYQC_SRC_PREPROCESSOR_PREPROCESSOR_H_
+
+#include "../lexer/lexer.h"
+#include "../util/trace.h"
+#include "file_cache.h"
+#include "hide_set.h"
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * The C preprocessor (6.10), working on tokens instead of text. Every file
+ * is lexed once, by a FileCache shared by the build, and directives are
+ * recognized from the tokens and the bytes between them: a '#' is the
+ * start of a directive when a newline comes before it, and a directive
+ * ends at the next token that starts a line. A macro body is kept as the
+ * tokens of its definition, and nothing is lexed again except what '#'
+ * and '##' spell anew.
+ *
+ * Expansion follows Prosser's algorithm: every token carries the set of
+ * macros it came out of, and a name in its own set is not replaced. Hide
+ * sets are interned bitsets (see HideSetTable). Replacement lists are read
+ * through a stack of contexts, each a view of a token array: an object-like
+ * macro's body itself, or the tokens a function-like macro's arguments were
+ * substituted into; a context adds its hide set to each token as it is
+ * read. An expansion with short arguments that ends without reading past
+ * its own tokens is memoized by its macro, hide set and arguments until a
+ * macro is defined or undefined, and the next one like it is a view of the
+ * tokens it gave, or a copy whose argument tokens are spelled where its own
+ * arguments are.
+ *
+ * Nothing is copied per level of invocations nested in arguments. An
+ * invocation read again from the arguments of an enclosing one takes views
+ * of them, found by the ')' and ',' ReadArguments noted when it read them.
+ * A long replaced argument becomes a span: one token standing for all of
+ * it but its last, which is substituted and rescanned as one, as none of
+ * those tokens can be replaced again (see Expanded). Spans are spelled out
+ * only where a token of one is looked at: by the output, a memo, '#', '##',
+ * or an argument list a ',' of one splits.
+ *
+ * Output tokens keep the offset of their spelling in the file it is in,
+ * each inclusion being a source of the output TokenList of its own; text
+ * made by '#', '##', __FILE__ and __LINE__ lives in small sources of its
+ * own. A token that came out of a macro also names an expansion record:
+ * the macro and where it was invoked, and the record of that invocation,
+ * so Location() reports where the outermost macro was used and
+ * MacroBacktrace() the macros in between. #line only changes what
+ * Location() reports.
+ *
+ * An #include is skipped without entering the file when the file has a
+ * #pragma once and has been entered, or when the whole of it is wrapped in
+ * `#ifndef X` ... `#endif` (or `#if !defined X`) and X is defined.
+ *
+ * One Preprocessor preprocesses one translation unit. A unit may start
+ * where a precompiled header left off instead (see PrecompiledHeader).
+ */
+class Preprocessor {
+public:
+  struct Statistics {
+    uint64_t files_entered = 0;
+    // #includes skipped because of an include guard or a #pragma once.
+    uint64_t guard_skips = 0;
+    uint64_t pragma_once_skips = 0;
+    uint64_t directives = 0;
+    uint64_t expansions = 0;
+    // Expansions that were views of a memoized one.
+    uint64_t memo_hits = 0;
+    uint64_t hide_sets = 0;
+    uint64_t output_tokens = 0;
+  };
+
+  // `files` must outlive the preprocessor.
+  explicit Preprocessor(FileCache &files);
+  Preprocessor(const Preprocessor &) = delete;
+  Preprocessor &operator=(const Preprocessor &) = delete;
+
+  // Searched in order, after the includer's directory for "...".
+  void AddIncludePath(const std::string &directory);
+  // As -D: "NAME", "NAME=VALUE" or "NAME(PARAMETERS)=VALUE".
+  void Define(const std::string &definition);
+  // As -U.
+  void Undefine(const std::string &name);
+  // As -include: the file at `path` is included before the unit's first
+  // line. A relative path is looked for in the working directory first.
+  void AddInclude(const std::string &path);
+
+  // The tokens of the translation unit at `path`, as a Lexer that hands
+  // them out, ready for a Parser.
+  std::unique_ptr<Lexer> Run(const std::string &path);
+
+  bool IsDefined(Atom name) const { return FindMacro(name) != nullptr; }
+  // "file:row:column" of a token Run produced, as #line directives have
+  // renumbered it: where it is spelled, or for a token that came out of a
+  // macro, where the outermost macro was invoked.
+  std::string Location(const Token &token) const;
+  // Where the text of a token Run produced is.
+  std::string SpellingLocation(const Token &token) const;
+  // "NAME at file:row:column" of each macro a token Run produced came out
+  // of, innermost first; the location is that of the name replaced. The
+  // tokens of a memoized expansion only know the macro that was memoized.
+  std::vector<std::string> MacroBacktrace(const Token &token) const;
+  const Statistics &statistics() const { return _statistics; }
+
+private:
+  // Saves the state after a header, and restores it for a unit.
+  friend class PrecompiledHeader;
+
+  enum TokenFlag : uint8_t {
+    LINE_START = 1,
+    LEADING_SPACE = 2,
+    // A name that was not replaced because it was in its own hide set.
+    NO_EXPAND = 4,
+    // '##' in a macro body.
+    PASTE = 8,
+    // Read from a memoized expansion: replaced already.
+    FINAL = 16,
+    // A span with its parentheses balanced and no ',' outside them, which
+    // an argument list takes as one token.
+    OPAQUE = 32,
+  };
+  // Not a parameter; not an output source.
+  static constexpr uint32_t NONE = UINT32_MAX;
+  static constexpr size_t MAX_INCLUDE_DEPTH = 200;
+  // A replaced argument longer than this becomes a span.
+  static constexpr size_t MIN_SPAN = 16;
+  // Expansions with more argument tokens than this are not memoized:
+  // comparing and keeping their arguments costs what replacing them again
+  // does.
+  static constexpr size_t MAX_MEMO_ARGUMENTS = 64;
+
+  struct PPToken {
+    TOKEN tag;
+    uint8_t flags;
+    // In a macro body, the number of the parameter a name refers to.
+    uint16_t parameter;
+    // Output source of the spelling; NONE for a value #if made up.
+    uint32_t source;
+    uint32_t offset;
+    uint32_t length;
+    uint64_t payload;
+    uint32_t hide_set;
+    // Record of the expansion it came out of, NONE for a token of a file.
+    uint32_t expansion;
+
+    bool IsName() const {
+      return TokenList::ValueKind(tag) == Value::Kind::ATOM;
+    }
+    // Tokens from `offset` to `length` of _spans[payload], with the hide
+    // set and expansion added as a context would. No token is lexed as a
+    // space.
+    bool IsSpan() const { return tag == TOKEN::SPACE; }
+    Atom atom() const { return static_cast<Atom>(payload); }
+  };
+
+  enum class Builtin : uint8_t { NONE, FILE, LINE };
+
+  struct Macro {
+    Atom name;
+    Builtin builtin;
+    bool function_like;
+    bool variadic;
+    uint16_t parameter_count;
+    std::vector<PPToken> body;
+    // A '##' in the body, which then is not read in place.
+    bool pastes = false;
+  };
+
+  // The include guard state of a file being read. The guard is found if the
+  // first thing in the file is an #ifndef, and nothing comes after the
+  // #endif that closes it.
+  enum class GuardState : uint8_t { START, GUARDED, AFTER, NONE };
+
+  struct Frame {
+    // nullptr for the predefined macros.
+    FileCache::File *file;
+    const TokenList *tokens;
+    uint32_t next;
+    uint32_t source;
+    // Conditionals open when the file was entered.
+    uint32_t conditional_depth;
+    GuardState guard_state;
+    Atom guard;
+  };
+
+  struct Conditional {
+    uint32_t source;
+    uint32_t offset;
+    // Whether a group of it has been taken.
+    bool taken;
+    bool after_else;
+  };
+
+  // The tokens between the parentheses of an invocation, and for each '('
+  // and ',' among them the next ',' or ')' at its depth.
+  struct ArgumentList {
+    std::vector<PPToken> tokens;
+    std::vector<uint32_t> separators;
+  };
+
+  // A view of tokens being read before the files are.
+  struct Context {
+    // Indexed from `begin` to `end`; _scratch holds the tokens of contexts
+    // that are not views of a macro body or a memo.
+    const std::vector<PPToken> *tokens;
+    uint32_t begin;
+    uint32_t next;
+    uint32_t end;
+    // Added to each token read.
+    uint32_t hide_set;
+    // Given to each token read that has none.
+    uint32_t expansion;
+    // The first token takes the leading space of the replaced name.
+    bool respace;
+    uint8_t leading_space;
+    // Reading stops at the end instead of going on below (ExpandAll).
+    bool isolated;
+    // A memo replayed: its tokens are replaced already.
+    bool final;
+    // The argument list `tokens` are of, when they are of one (ExpandAll).
+    const ArgumentList *list;
+    // The memo being recorded from what is read through this context,
+    // NONE if none: its entry in _recordings and where its tokens start in
+    // _memo_log.
+    uint32_t memo_key;
+    uint32_t log_start;
+    uint64_t memo_epoch;
+  };
+
+  struct Expansion {
+    Atom macro;
+    // Spelling of the name replaced.
+    uint32_t source;
+    uint32_t offset;
+    // The expansion the name came out of, and the outermost one.
+    uint32_t parent;
+    uint32_t root;
+  };
+
+  // Tokens an expansion gave, for the next one like it: one of the same
+  // generation of the macros, macro, hide set and arguments. The arguments
+  // are numbered token by token across all of them; `from_arguments` pairs
+  // each token spelled by one with its number, so that a hit gives the
+  // token the spelling of its own argument instead. They are paired at the
+  // first hit, as most memos get none.
+  struct Memo {
+    uint64_t generation;
+    Atom macro;
+    uint32_t hide_set;
+    std::vector<std::vector<PPToken>> arguments;
+    std::vector<PPToken> tokens;
+    std::vector<std::pair<uint32_t, uint32_t>> from_arguments;
+    bool paired = false;
+  };
+
+  // A memo being recorded, and its MemoKey.
+  struct Recording {
+    uint64_t key;
+    Memo memo;
+  };
+
+  // Tokens `first` to `last` of the argument list of its invocation, or
+  // of an enclosing invocation it was read again from.
+  struct Argument {
+    const ArgumentList *list;
+    uint32_t first;
+    uint32_t last;
+    std::vector<PPToken> expanded;
+    bool is_expanded = false;
+
+    const PPToken *begin() const { return list->tokens.data() + first; }
+    const PPToken *end() const { return list->tokens.data() + last; }
+    size_t size() const { return last - first; }
+  };
+
+  struct LineMarker {
+    uint32_t offset;
+    // The physical row the marker numbers `number`.
+    uint32_t row;
+    uint32_t number;
+    std::string file;
+  };
+
+  // Reading. Run enters the unit, then the predefined macros, and
+  // expands until the unit ends.
+  FileCache::File *EnterUnit(const std::string &path);
+  std::unique_ptr<Lexer> ExpandUnit(FileCache::File *unit);
+  uint32_t AddSource(std::shared_ptr<const SourceBuffer> source,
+                     const std::string &name);
+  void EnterFile(FileCache::File *file, const TokenList &tokens,
+                 uint32_t source);
+  void LeaveFile();
+  PPToken FileToken(Frame &frame);
+  PPToken ReadToken();
+  // ReadToken, with the spans it reads opened up to a token of theirs.
+  PPToken ReadSpelled();
+  std::vector<PPToken> ReadLine(Frame &frame);
+  PPToken ExpandToken();
+  std::vector<PPToken> ExpandAll(const std::vector<PPToken> &tokens);
+  std::vector<PPToken> ExpandIsolated(const std::vector<PPToken> &tokens,
+                                      uint32_t begin, uint32_t end,
+                                      const ArgumentList *list);
+  void PushContext(const std::vector<PPToken> &tokens, uint32_t begin,
+                   uint32_t end, uint32_t hide_set, uint32_t expansion);
+  void PopContext();
+  void PushBack(const PPToken &token);
+  void OpenSpan(const PPToken &span);
+  // Appends the tokens `token` stands for: itself, or those of a span.
+  void Spell(const PPToken &token, std::vector<PPToken> &tokens);
+  // Replaces a span at the end of `tokens` by the span of all its tokens
+  // but the last, and that token, until a token that is not a span ends
+  // them.
+  void SplitLastSpan(std::vector<PPToken> &tokens);
+  // A token ExpandToken hands out, kept for the memos being recorded.
+  PPToken Emit(PPToken token) {
+    token.flags &= ~FINAL;
+    if (_recording > 0) {
+      _memo_log.push_back(token);
+    }
+    return token;
+  }
+
+  // Directives.
+  void Directive(Frame &frame, const PPToken &sharp);
+  void Include(Frame &frame, const PPToken &directive,
+               std::vector<PPToken> line);
+  FileCache::File *FindInclude(const Frame &includer, const std::string &name,
+                               bool angled);
+  void If(Frame &frame, const PPToken &directive, bool taken);
+  // Whether the group the #elif or #else starts is taken.
+  bool Else(Frame &frame, const PPToken &directive,
+            const std::vector<PPToken> &line, bool is_elif);
+  void Endif(Frame &frame, const PPToken &directive);
+  void SkipGroup(Frame &frame);
+  void Line(Frame &frame, const PPToken &directive,
+            std::vector<PPToken> line);
+  bool EvaluateCondition(const PPToken &directive,
+                         std::vector<PPToken> line);
+
+  // Macros.
+  const Macro *FindMacro(Atom name) const {
+    auto index = static_cast<uint32_t>(name);
+    return index < _macro_of.size() && _macro_of[index] != NONE
+               ? &_macros[_macro_of[index]]
+               : nullptr;
+  }
+  void DefineMacro(Macro macro);
+  // Memos are of the macros as they are; a change starts new ones.
+  void MacrosChanged() {
+    ++_generation;
+    ++_memo_epoch;
+  }
+  void DefineDirective(const PPToken &directive,
+                       const std::vector<PPToken> &line);
+  PPToken ReadArguments(const Macro &macro, const PPToken &name,
+                        ArgumentList &list, std::vector<Argument> &arguments);
+  // Replaces `name` by the expansion of `macro`: a memoized one, or else
+  // the replacement list, recorded as a memo.
+  void Replace(const Macro &macro, const PPToken &name,
+               std::vector<Argument> &arguments, uint32_t hide_set);
+  void Substitute(const Macro &macro, const PPToken &name,
+                  std::vector<Argument> &arguments);
+  bool IsMemoized(const std::vector<Argument> &arguments) const;
+  uint64_t MemoKey(const Macro &macro, uint32_t hide_set,
+                   const std::vector<Argument> &arguments) const;
+  bool IsMemoOf(const Memo &memo, const Macro &macro, uint32_t hide_set,
+                const std::vector<Argument> &arguments) const;
+  uint64_t HashToken(uint64_t hash, const PPToken &token) const;
+  bool SameToken(const PPToken &a, const PPToken &b) const;
+  static uint64_t SpellingKey(const PPToken &token) {
+    return uint64_t(token.source) << 32 | token.offset;
+  }
+  // Fills in `from_arguments` of a memo.
+  static void Pair(Memo &memo);
+  // Moves `token` to where `argument` is spelled.
+  static void Respell(PPToken &token, const PPToken &argument);
+  uint32_t AddExpansion(const PPToken &name);
+  const std::vector<PPToken> &Expanded(Argument &argument);
+  // Makes all of `tokens` but the last a span.
+  void AddSpan(std::vector<PPToken> &tokens);
+  // Appends the tokens of an argument as read, spans spelled out.
+  void Spell(const Argument &argument, std::vector<PPToken> &tokens);
+  PPToken Stringize(const Argument &argument, const PPToken &at);
+  PPToken Paste(const PPToken &left, const PPToken &right);
+  PPToken BuiltinToken(const Macro &macro, const PPToken &name);
+  // A token lexed from `text`, which must spell exactly one.
+  bool Scratch(const std::string &text, const PPToken &at, PPToken &token);
+
+  // Bit of a macro name in hide sets.
+  uint32_t HideBit(Atom name) const {
+    return _hide_bit_of[static_cast<uint32_t>(name)];
+  }
+
+  std::string_view Spelling(const PPToken &token) const {
+    return std::string_view(_buffers[token.source]->data() + token.offset,
+                            token.length);
+  }
+  std::string Location(uint32_t source, uint32_t offset) const;
+  std::string Location(const PPToken &token) const {
+    if (token.expansion != NONE) {
+      auto &root = _expansions[_expansions[token.expansion].root];
+      return Location(root.source, root.offset);
+    }
+    return Location(token.source, token.offset);
+  }
+  // Row of `offset` as #line directives number it.
+  uint32_t PresumedRow(uint32_t source, uint32_t offset) const;
+  const std::string &PresumedFile(uint32_t source, uint32_t offset) const;
+
+  FileCache &_files;
+  std::vector<std::string> _include_paths;
+  std::string _predefined;
+  TokenList _output;
+  // Expansion record of each output token.
+  std::vector<uint32_t> _output_expansions;
+  // By output source.
+  std::vector<const SourceBuffer *> _buffers;
+  std::vector<std::string> _source_names;
+  std::vector<std::vector<LineMarker>> _line_markers;
+
+  std::unique_ptr<Lexer> _predefined_lexer;
+  // Reserved up front: a directive keeps a reference to its file's frame
+  // while an #include pushes another.
+  std::vector<Frame> _frames;
+  // Innermost last.
+  std::vector<Context> _contexts;
+  std::vector<PPToken> _scratch;
+  // What spans are of: arguments as replaced. Dropped when no context is
+  // left.
+  std::deque<std::vector<PPToken>> _spans;
+  // Reads that look past a name for a '(' or an argument list. A context
+  // that runs out in one of them had an expansion that depends on what
+  // follows it, which is not memoized.
+  uint32_t _lookahead = 0;
+  std::vector<Conditional> _conditionals;
+  std::unordered_set<const FileCache::File *> _entered;
+
+  // A deque, so an expansion keeps its macro while a directive read with
+  // its arguments defines another.
+  std::deque<Macro> _macros;
+  // Indexed by atom; NONE where no macro is defined.
+  std::vector<uint32_t> _macro_of;
+  // Indexed by atom; NONE for a name never defined as a macro.
+  std::vector<uint32_t> _hide_bit_of;
+  uint32_t _hide_bits = 0;
+  HideSetTable _hide_sets;
+
+  std::vector<Expansion> _expansions;
+
+  // Memoized expansions by MemoKey, as indexes of _memos. The generation
+  // of the macros moves on when one is defined or undefined.
+  std::unordered_multimap<uint64_t, uint32_t> _memo_of;
+  uint64_t _generation = 0;
+  std::deque<Memo> _memos;
+  // Tokens ExpandToken handed out while memos are being recorded, and the
+  // number of contexts recording.
+  std::vector<PPToken> _memo_log;
+  uint32_t _recording = 0;
+  // Moves on when a memo being recorded can no longer be kept: a macro is
+  // defined or undefined, or __FILE__ or __LINE__ is expanded.
+  uint64_t _memo_epoch = 0;
+  std::vector<Recording> _recordings;
+
+  // Atoms of the names the preprocessor looks for.
+  struct Names {
+    Atom define, undef, include, if_, ifdef, ifndef, elif, else_, endif,
+        line, error, warning, pragma, once, defined, va_args, pragma_operator,
+        file, line_macro;
+  } _names;
+
+  Statistics _statistics;
+};
+
+#endif
@@ -0,0 +1,269 @@
+#include "../../cache/precompiled_header.h"
+#include "../../parser/parser.h"
+#include "../preprocessor.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+using namespace std;
+
+const int HEADERS = 40;
+const int UNITS = 24;
+
+// Writes a small project: guarded headers full of declarations and
+// function-like macros, each including the ones before it as real headers
+// do, and units that include every header and use the macros in
+// expression-dense function bodies.
+static void WriteCorpus(const string &directory) {
+  for (int i = 0; i < HEADERS; ++i) {
+    ofstream out(directory + "/header_" + to_string(i) + ".h");
+    out << "#ifndef HEADER_" << i << "_H\n#define HEADER_" << i << "_H\n";
+    for (int j = 0; j < i; j += 7) {
+      out << "#include \"header_" << j << ".h\"\n";
+    }
+    out << "#define SCALE_" << i << "(x) ((x) * " << i + 1 << " + OFFSET)\n"
+        << "#define MIX_" << i << "(x, y) (SCALE_" << i
+        << "(x) ^ (y) >> 1 | MASK)\n"
+        << "typedef unsigned long size_" << i << ";\n";
+    for (int j = 0; j < 20; ++j) {
+      out << "int function_" << i << "_" << j << "(int a, char b);\n"
+          << "size_" << i << " variable_" << i << "_" << j << ";\n";
+    }
+    out << "#endif\n";
+  }
+  for (int unit = 0; unit < UNITS; ++unit) {
+    ofstream out(directory + "/unit_" + to_string(unit) + ".c");
+    out << "#define OFFSET " << unit << "\n#define MASK 0xff\n";
+    for (int i = 0; i < HEADERS; ++i) {
+      out << "#include \"header_" << i << ".h\"\n";
+    }
+    for (int f = 0; f < 40; ++f) {
+      out << "int unit_" << unit << "_" << f << "(int a, int b, int c) {\n";
+      for (int i = f % 8; i < HEADERS; i += 8) {
+        out << "  a = MIX_" << i << "(a, b) + SCALE_" << i << "(c);\n"
+            << "  b = MIX_" << i << "(MIX_" << (i + 1) % HEADERS
+            << "(a, c), b);\n";
+      }
+      out << "}\n";
+    }
+  }
+}
+
+// Writes one unit of macro-heavy code, in the style of generated tables:
+// an X-macro list applied in every function, and arithmetic macros that
+// nest to 256 copies of their argument.
+static void WriteMacroCorpus(const string &path) {
+  ofstream out(path);
+  out << "#define FIELDS(X)";
+  for (int i = 0; i < 32; ++i) {
+    out << " X(field_" << i << ", " << i + 1 << ")";
+  }
+  out << "\n"
+      << "#define AS_DECLARATION(name, value) int name##_value;\n"
+      << "#define AS_STATEMENT(name, value) a = a * value + TWICE(b);\n"
+      << "#define TWICE(x) (x + x)\n"
+      << "#define QUAD(x) TWICE(TWICE(x))\n"
+      << "#define OCT(x) QUAD(QUAD(x))\n"
+      << "#define HEX(x) OCT(OCT(x))\n"
+      << "FIELDS(AS_DECLARATION)\n";
+  for (int f = 0; f < 200; ++f) {
+    out << "int function_" << f << "(int a, int b) {\n"
+        << "  FIELDS(AS_STATEMENT)\n"
+        << "  a = HEX(b) + HEX(a);\n"
+        << "}\n";
+  }
+}
+
+int main(int argc, char **argv) {
+  char pattern[] = "/tmp/yyqc_pp_bench_XXXXXX";
+  string directory = mkdtemp(pattern);
+  WriteCorpus(directory);
+  const int rounds = 3;
+
+  // Text preprocessing, then lexing the result again.
+  if (access("/usr/bin/cpp", X_OK) == 0) {
+    double best = 1e30;
+    for (int round = 0; round < rounds; ++round) {
+      auto start = chrono::steady_clock::now();
+      for (int unit = 0; unit < UNITS; ++unit) {
+        string base = directory + "/unit_" + to_string(unit);
+        string command =
+            "/usr/bin/cpp -P " + base + ".c -o " + base + ".i";
+        if (system(command.c_str()) != 0) {
+          return 1;
+        }
+        Parser parser(base + ".i");
+        parser.Scan();
+      }
+      auto end = chrono::steady_clock::now();
+      best = min(best, chrono::duration<double>(end - start).count());
+    }
+    cout << "cpp -P then parse, " << UNITS << " units: best of " << rounds
+         << ": " << best * 1e3 << " ms" << endl;
+  }
+
+  // Preprocessing on tokens, every header lexed once for the whole build.
+  double best = 1e30;
+  Preprocessor::Statistics statistics;
+  FileCache::Statistics file_statistics;
+  for (int round = 0; round < rounds; ++round) {
+    auto start = chrono::steady_clock::now();
+    FileCache files;
+    statistics = {};
+    for (int unit = 0; unit < UNITS; ++unit) {
+      Preprocessor preprocessor(files);
+      Parser parser(preprocessor.Run(directory + "/unit_" +
+                                     to_string(unit) + ".c"));
+      parser.Scan();
+      auto &unit_statistics = preprocessor.statistics();
+      statistics.files_entered += unit_statistics.files_entered;
+      statistics.guard_skips += unit_statistics.guard_skips;
+      statistics.directives += unit_statistics.directives;
+      statistics.expansions += unit_statistics.expansions;
+      statistics.output_tokens += unit_statistics.output_tokens;
+    }
+    auto end = chrono::steady_clock::now();
+    best = min(best, chrono::duration<double>(end - start).count());
+    file_statistics = files.statistics();
+  }
+  cout << "Preprocessor then parse, " << UNITS << " units: best of " << rounds
+       << ": " << best * 1e3 << " ms" << endl
+       << "  " << statistics.files_entered << " files entered, "
+       << statistics.guard_skips << " includes skipped by their guard, "
+       << statistics.directives << " directives, " << statistics.expansions
+       << " expansions, " << statistics.output_tokens << " tokens out" << endl
+       << "  " << file_statistics.files << " files lexed, "
+       << file_statistics.stats << " stats for " << file_statistics.lookups
+       << " lookups" << endl;
+
+  // The headers as one precompiled header, built once for the build.
+  string prefix = directory + "/prefix.h";
+  {
+    ofstream out(prefix);
+    for (int i = 0; i < HEADERS; ++i) {
+      out << "#include \"header_" << i << ".h\"\n";
+    }
+  }
+  string pch = directory + "/prefix.pch";
+  auto start = chrono::steady_clock::now();
+  {
+    FileCache files;
+    Preprocessor preprocessor(files);
+    if (!PrecompiledHeader::Build(preprocessor, prefix, pch)) {
+      return 1;
+    }
+  }
+  double build = chrono::duration<double>(chrono::steady_clock::now() - start)
+                     .count();
+  best = 1e30;
+  for (int round = 0; round < rounds; ++round) {
+    auto start = chrono::steady_clock::now();
+    FileCache files;
+    auto header = PrecompiledHeader::Open(pch);
+    for (int unit = 0; unit < UNITS; ++unit) {
+      Preprocessor preprocessor(files);
+      auto parser = header->Load(preprocessor, directory + "/unit_" +
+                                                   to_string(unit) + ".c");
+      if (!parser) {
+        return 1;
+      }
+      parser->Scan();
+    }
+    auto end = chrono::steady_clock::now();
+    best = min(best, chrono::duration<double>(end - start).count());
+  }
+  cout << "Precompiled header then parse, " << UNITS
+       << " units: best of " << rounds << ": " << best * 1e3 << " ms, "
+       << "after " << build * 1e3 << " ms to build it" << endl;
+
+  // The header alone: processed from scratch, against restored.
+  string empty = directory + "/empty.c";
+  ofstream(empty) << "\n";
+  double parsed = 1e30, restored = 1e30;
+  for (int round = 0; round < rounds; ++round) {
+    auto start = chrono::steady_clock::now();
+    {
+      FileCache files;
+      Preprocessor preprocessor(files);
+      Parser parser(preprocessor.Run(prefix));
+      parser.Scan();
+    }
+    auto middle = chrono::steady_clock::now();
+    {
+      FileCache files;
+      Preprocessor preprocessor(files);
+      auto parser = PrecompiledHeader::Open(pch)->Load(preprocessor, empty);
+      parser->Scan();
+    }
+    auto end = chrono::steady_clock::now();
+    parsed = min(parsed, chrono::duration<double>(middle - start).count());
+    restored = min(restored, chrono::duration<double>(end - middle).count());
+  }
+  cout << "Header prefix alone: preprocessed and parsed " << parsed * 1e3
+       << " ms, restored " << restored * 1e3 << " ms ("
+       << PrecompiledHeader::Open(pch)->file_size() / 1024 << " KiB file)"
+       << endl;
+
+  // Macro expansion on its own.
+  string macros = directory + "/macros.c";
+  WriteMacroCorpus(macros);
+  best = 1e30;
+  for (int round = 0; round < rounds; ++round) {
+    FileCache files;
+    Preprocessor preprocessor(files);
+    auto start = chrono::steady_clock::now();
+    auto lexer = preprocessor.Run(macros);
+    auto end = chrono::steady_clock::now();
+    best = min(best, chrono::duration<double>(end - start).count());
+    statistics = preprocessor.statistics();
+  }
+  cout << "Preprocessor, macro-heavy unit: best of " << rounds << ": "
+       << best * 1e3 << " ms" << endl
+       << "  " << statistics.expansions << " expansions, "
+       << statistics.memo_hits << " memoized, " << statistics.hide_sets
+       << " hide sets, " << statistics.output_tokens << " tokens out" << endl;
+
+  // One invocation nested in the argument of the next, n deep. Nothing is
+  // copied per level, so the time is linear in n: twice as deep must take
+  // at most about twice as long.
+  double previous = 0;
+  bool linear = true;
+  for (int n : {2000, 4000, 8000}) {
+    string nested = directory + "/nested_" + to_string(n) + ".c";
+    {
+      ofstream out(nested);
+      out << "#define f(x) (x)\n";
+      for (int i = 0; i < n; ++i) {
+        out << "f(";
+      }
+      out << "1";
+      for (int i = 0; i < n; ++i) {
+        out << ")";
+      }
+      out << "\n";
+    }
+    // Milliseconds each, so more rounds for a steady best.
+    best = 1e30;
+    for (int round = 0; round < 5 * rounds; ++round) {
+      FileCache files;
+      Preprocessor preprocessor(files);
+      auto start = chrono::steady_clock::now();
+      auto lexer = preprocessor.Run(nested);
+      auto end = chrono::steady_clock::now();
+      best = min(best, chrono::duration<double>(end - start).count());
+    }
+    cout << "Preprocessor, f(f(...)) " << n << " deep: best of "
+         << 5 * rounds << ": " << best * 1e3 << " ms" << endl;
+    linear = linear && (previous == 0 || best < 3 * previous);
+    previous = best;
+  }
+  if (!linear) {
+    cout << "FAILED: nested expansion is not linear in its depth" << endl;
+  }
+
+  system(("rm -rf " + directory).c_str());
+  return linear ? 0 : 1;
+}
@@ -0,0 +1,209 @@
+#include "../../ast/ast_visitor.h"
+#include "../../cache/precompiled_header.h"
+#include "../../parser/parser.h"
+#include "../../util/check.h"
+#include "../preprocessor.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+static string directory;
+
+static string Write(const string &name, const string &text) {
+  string path = directory + "/" + name;
+  ofstream(path) << text;
+  return path;
+}
+
+// A header prefix that includes a guarded header and a #pragma once one,
+// renumbers its lines, and defines macros that paste, stringize and
+// refer to themselves, typedefs, declarations and an inline function.
+static void WriteHeaders() {
+  Write("types.h", "#ifndef TYPES_H\n#define TYPES_H\n"
+                   "typedef unsigned long size_t;\n"
+                   "typedef int count_t;\n"
+                   "#endif\n");
+  Write("once.h", "#pragma once\n"
+                  "#define ONCE(x) x ## _once\n"
+                  "int ONCE(counter);\n");
+  Write("prefix.h", "#ifndef PREFIX_H\n#define PREFIX_H\n"
+                    "#include \"types.h\"\n"
+                    "#include \"once.h\"\n"
+                    "#define SCALE(x) ((x) * FACTOR)\n"
+                    "#define FACTOR 3\n"
+                    "#define NAME(x) #x\n"
+                    "#define self (self + 1)\n"
+                    "#define CAT(a, b) a ## b\n"
+                    "#line 100 \"renamed.h\"\n"
+                    "size_t CAT(total, _size);\n"
+                    "count_t table[4];\n"
+                    "int lookup(int key, char *name);\n"
+                    "count_t twice(count_t a) {\n"
+                    "  a = SCALE(a) + self;\n"
+                    "  NAME(a);\n"
+                    "}\n"
+                    "#endif\n");
+}
+
+static const char UNIT[] = "#include \"prefix.h\"\n"
+                           "#include \"types.h\"\n"
+                           "#include \"once.h\"\n"
+                           "count_t unit_function(count_t a, size_t b) {\n"
+                           "  count_t c;\n"
+                           "  c = SCALE(a) * CAT(b, ) + self;\n"
+                           "  while (c) { int count_t; count_t = c--; }\n"
+                           "  ONCE(counter) = c;\n"
+                           "}\n"
+                           "size_t CAT(unit, _total);\n";
+
+// Everything the parser produced, in an order that does not depend on
+// addresses, as the AST cache test dumps it.
+struct Dumper : RecursiveASTWalker<Dumper> {
+  ostringstream os;
+  bool VisitNode(ASTNode *node) {
+    os << static_cast<int>(node->kind());
+    if (auto expr = dyn_cast<Expr>(node)) {
+      os << ' ' << expr->token() << ' ' << *expr;
+    }
+    os << '\n';
+    return true;
+  }
+};
+
+static void DumpScope(Scope &scope, ostream &os) {
+  os << "scope: " << scope.typedef_names().size() << " typedef entries\n";
+  for (auto &symbol : scope.symbols()) {
+    os << *symbol << '\n' << DeclarationMessage{*symbol};
+  }
+  for (auto &child : scope.children()) {
+    DumpScope(*child, os);
+  }
+}
+
+static string Dump(const Parser &parser) {
+  Dumper dumper;
+  DumpScope(parser.root_scope(), dumper.os);
+  for (auto &function : parser.function_definitions()) {
+    auto type = static_cast<const FunctionType *>(function->type());
+    dumper.os << *function << '\n'
+              << FunctionDefinitionMessage{*type, function->body(),
+                                           function->specifiers()};
+    dumper.Walk(function->body());
+  }
+  return dumper.os.str();
+}
+
+// The spelling and locations of every token of the output, and the macro
+// backtraces of the header's. A unit's expansion may be a memo hit when
+// the header was included, which knows less of its backtrace.
+static string DumpTokens(const Preprocessor &preprocessor,
+                         const TokenList &tokens) {
+  ostringstream os;
+  bool in_header = true;
+  for (uint32_t i = 0; i + 1 < tokens.size(); ++i) {
+    auto token = tokens[i];
+    auto location = preprocessor.Location(token);
+    in_header = in_header && location.find("unit.c") == string::npos;
+    os << string(tokens.source(i).data() + tokens.offset(i),
+                 tokens.length(i))
+       << ' ' << location << ' ' << preprocessor.SpellingLocation(token);
+    for (auto &macro : in_header ? preprocessor.MacroBacktrace(token)
+                                 : vector<string>()) {
+      os << " <- " << macro;
+    }
+    os << '\n';
+  }
+  return os.str();
+}
+
+// The unit parsed with the header as an -include.
+static string Expected(const string &prefix, const string &unit,
+                       string &tokens) {
+  FileCache files;
+  Preprocessor preprocessor(files);
+  preprocessor.AddInclude(prefix);
+  Parser parser(preprocessor.Run(unit));
+  Check(parser.Scan(), "unit parses with the header included");
+  tokens = DumpTokens(preprocessor, parser.lexer().token_list());
+  return Dump(parser);
+}
+
+int main() {
+  char pattern[] = "/tmp/yyqc_pp_pch_XXXXXX";
+  directory = mkdtemp(pattern);
+  WriteHeaders();
+  string prefix = directory + "/prefix.h";
+  string unit = Write("unit.c", UNIT);
+  string pch = directory + "/prefix.pch";
+  string expected_tokens;
+  string expected = Expected(prefix, unit, expected_tokens);
+
+  {
+    FileCache files;
+    Preprocessor preprocessor(files);
+    Check(PrecompiledHeader::Build(preprocessor, prefix, pch),
+          "header builds");
+  }
+  auto header = PrecompiledHeader::Open(pch);
+  Check(header != nullptr, "header opens");
+  if (header) {
+    // The same unit, in a build that has never seen the headers.
+    FileCache files;
+    Preprocessor preprocessor(files);
+    auto parser = header->Load(preprocessor, unit);
+    Check(parser != nullptr, "header loads");
+    if (parser) {
+      Check(parser->Scan(), "unit parses after the header");
+      Check(Dump(*parser) == expected, "same symbols, types and bodies");
+      Check(DumpTokens(preprocessor, parser->lexer().token_list()) ==
+                expected_tokens,
+            "same tokens, locations and macro backtraces");
+      auto &statistics = preprocessor.statistics();
+      Check(statistics.files_entered == 1,
+            "only the unit entered: " +
+                to_string(statistics.files_entered));
+      Check(statistics.guard_skips == 2 && statistics.pragma_once_skips == 1,
+            "the header's includes skipped by its guards and #pragma once");
+    }
+  }
+
+  // Other options, or an edited header, make it stale.
+  if (header) {
+    FileCache files;
+    Preprocessor preprocessor(files);
+    preprocessor.Define("FACTOR=4");
+    Check(header->Load(preprocessor, unit) == nullptr,
+          "stale with other predefined macros");
+    Parser parser(preprocessor.Run(unit));
+    Check(parser.Scan(), "a stale header leaves the preprocessor usable");
+  }
+  {
+    ofstream(directory + "/types.h", ios::app) << "/* edited */\n";
+    FileCache files;
+    Preprocessor preprocessor(files);
+    Check(header && header->Load(preprocessor, unit) == nullptr,
+          "stale with an included header edited");
+  }
+  header.reset();
+
+  // A damaged file is not used.
+  {
+    FileCache files;
+    Preprocessor preprocessor(files);
+    Check(PrecompiledHeader::Build(preprocessor, prefix, pch),
+          "header builds again");
+    fstream out(pch, ios::in | ios::out | ios::binary);
+    out.seekp(64);
+    out.write("\xff\xff\xff\xff\xff\xff\xff\xff", 8);
+  }
+  Check(PrecompiledHeader::Open(pch) == nullptr, "damaged header");
+  Check(PrecompiledHeader::Open(unit) == nullptr, "not a header");
+
+  system(("rm -rf " + directory).c_str());
+  cout << (passed ? "pch: ok" : "pch: FAILED") << endl;
+  return passed ? 0 : 1;
+}
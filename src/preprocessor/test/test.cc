@@ -0,0 +1,438 @@
+#include "../../parser/parser.h"
+#include "../../util/check.h"
+#include "../preprocessor.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+using namespace std;
+
+static string directory;
+
+static string Write(const string &name, const string &text) {
+  string path = directory + "/" + name;
+  ofstream(path) << text;
+  return path;
+}
+
+// The spellings of `tokens`, one space apart.
+static string Render(const TokenList &tokens) {
+  string text;
+  for (uint32_t i = 0; i + 1 < tokens.size(); ++i) {
+    if (i > 0) {
+      text += ' ';
+    }
+    text.append(tokens.source(i).data() + tokens.offset(i), tokens.length(i));
+  }
+  return text;
+}
+
+// `text` lexed and rendered as Render does.
+static string Tokens(const string &text) {
+  Lexer lexer(SourceBuffer::FromText(text), "<expected>");
+  return Render(lexer.token_list());
+}
+
+static string Preprocess(FileCache &files, const string &name,
+                         const string &text) {
+  Preprocessor preprocessor(files);
+  return Render(preprocessor.Run(Write(name, text))->token_list());
+}
+
+static void CheckOutput(FileCache &files, const string &name,
+                        const string &text, const string &expected) {
+  auto output = Preprocess(files, name, text);
+  Check(output == Tokens(expected),
+        name + ":\n  got      " + output + "\n  expected " + Tokens(expected));
+}
+
+int main() {
+  char pattern[] = "/tmp/yyqc_pp_XXXXXX";
+  directory = mkdtemp(pattern);
+  FileCache files;
+
+  // The examples of 6.10.3.5.
+  CheckOutput(files, "example3.c",
+              "#define x 3\n"
+              "#define f(a) f(x * (a))\n"
+              "#undef x\n"
+              "#define x 2\n"
+              "#define g f\n"
+              "#define z z[0]\n"
+              "#define h g(~\n"
+              "#define m(a) a(w)\n"
+              "#define w 0,1\n"
+              "#define t(a) a\n"
+              "#define p() int\n"
+              "#define q(x) x\n"
+              "#define r(x,y) x ## y\n"
+              "#define str(x) # x\n"
+              "f(y+1) + f(f(z)) % t(t(g)(0) + t)(1);\n"
+              "g(x+(3,4)-w) | h 5) & m\n"
+              "(f)^m(m);\n"
+              "p() i[q()] = { q(1), r(2,3), r(4,), r(,5), r(,) };\n"
+              "char c[2][6] = { str(hello), str() };\n",
+              "f(2 * (y+1)) + f(2 * (f(2 * (z[0])))) % f(2 * (0)) + t(1);\n"
+              "f(2 * (2+(3,4)-0,1)) | f(2 * (~ 5)) & f(2 * (0,1))^m(0,1);\n"
+              "int i[] = { 1, 23, 4, 5, };\n"
+              "char c[2][6] = { \"hello\", \"\" };\n");
+  CheckOutput(files, "example4.c",
+              "#define str(s) # s\n"
+              "#define xstr(s) str(s)\n"
+              "#define debug(s, t) "
+              "printf(\"x\" # s \"= %d, x\" # t \"= %s\", \\\n"
+              "  x ## s, x ## t)\n"
+              "#define INCFILE(n) vers ## n\n"
+              "#define glue(a, b) a ## b\n"
+              "#define xglue(a, b) glue(a, b)\n"
+              "#define HIGHLOW \"hello\"\n"
+              "#define LOW LOW \", world\"\n"
+              "debug(1, 2);\n"
+              "fputs(str(strncmp(\"abc\\0d\", \"abc\", '\\4') "
+              "// this goes away\n"
+              "  == 0) str(: @\\n), s);\n"
+              "xstr(INCFILE(2).h)\n"
+              "glue(HIGH, LOW);\n"
+              "xglue(HIGH, LOW)\n",
+              "printf(\"x\" \"1\" \"= %d, x\" \"2\" \"= %s\", x1, x2);\n"
+              "fputs(\"strncmp(\\\"abc\\\\0d\\\", \\\"abc\\\", '\\\\4') == 0\" "
+              "\": @\\n\", s);\n"
+              "\"vers2.h\"\n"
+              "\"hello\";\n"
+              "\"hello\" \", world\"\n");
+  CheckOutput(files, "example5.c",
+              "#define debug(...) fprintf(stderr, __VA_ARGS__)\n"
+              "#define showlist(...) puts(#__VA_ARGS__)\n"
+              "#define report(test, ...) ((test)?puts(#test):\\\n"
+              "  printf(__VA_ARGS__))\n"
+              "debug(\"Flag\");\n"
+              "debug(\"X = %d\\n\", x);\n"
+              "showlist(The first, second, and third items.);\n"
+              "report(x>y, \"x is %d but y is %d\", x, y);\n",
+              "fprintf(stderr, \"Flag\");\n"
+              "fprintf(stderr, \"X = %d\\n\", x);\n"
+              "puts(\"The first, second, and third items.\");\n"
+              "((x>y)?puts(\"x>y\"): "
+              "printf(\"x is %d but y is %d\", x, y));\n");
+
+  // A macro is not replaced inside its own replacement, however it is
+  // reached again.
+  CheckOutput(files, "recursion.c",
+              "#define foo foo\n"
+              "#define f(x) x f\n"
+              "#define a b\n"
+              "#define b a\n"
+              "#define e(x, ...) x , ## __VA_ARGS__\n"
+              "foo f(1)(2) a b e(1) e(1, 2)\n",
+              "foo 1 f(2) a b 1 1, 2\n");
+
+  // An expansion is memoized until the macros change, unless it takes
+  // tokens that follow it or depends on where it is.
+  {
+    Preprocessor preprocessor(files);
+    auto path = Write("memo.c", "#define ONE 1\n"
+                                "#define ADD(a, b) ((a) + (b))\n"
+                                "ADD(x, ONE) ADD(x, ONE) ADD(y, ONE)\n"
+                                "#define V 1\n"
+                                "V V\n"
+                                "#undef V\n"
+                                "#define V 2\n"
+                                "V\n"
+                                "#define F(x) [x]\n"
+                                "#define G F\n"
+                                "G(1) G(2) G;\n"
+                                "#define L __LINE__\n"
+                                "L\n"
+                                "L\n");
+    auto lexer = preprocessor.Run(path);
+    Check(Render(lexer->token_list()) ==
+              Tokens("((x) + (1)) ((x) + (1)) ((y) + (1)) 1 1 2 [1] [2] F;"
+                     "13 14"),
+          "memo: " + Render(lexer->token_list()));
+    // The second ADD(x, ONE), ONE in ADD(y, ONE), and the second V.
+    Check(preprocessor.statistics().memo_hits == 3,
+          "memo hits: " +
+              to_string(preprocessor.statistics().memo_hits));
+    // A hit is spelled where its own arguments are.
+    auto x = lexer->token_list()[11];
+    Check(preprocessor.SpellingLocation(x) == path + ":3:17",
+          "memo hit spelling: " + preprocessor.SpellingLocation(x));
+  }
+  // Nor when an argument does.
+  CheckOutput(files, "memo_arguments.c",
+              "#define f(x) x\n"
+              "#define str(x) #x\n"
+              "#define xstr(x) str(x)\n"
+              "f(__LINE__)\n"
+              "f(__LINE__)\n"
+              "xstr(__LINE__)\n"
+              "xstr(__LINE__)\n",
+              "4 5 \"6\" \"7\"\n");
+  {
+    // Each level of A16 is 2 of the one below; all but the first of each
+    // are memo hits, so the work is linear in the output.
+    string text = "#define A0 x\n";
+    for (int i = 1; i <= 16; ++i) {
+      text += "#define A" + to_string(i) + " A" + to_string(i - 1) + " A" +
+              to_string(i - 1) + "\n";
+    }
+    text += "#define C0 y\n";
+    for (int i = 1; i <= 2000; ++i) {
+      text += "#define C" + to_string(i) + " C" + to_string(i - 1) + "\n";
+    }
+    text += "A16 C2000\n";
+    Preprocessor preprocessor(files);
+    auto lexer = preprocessor.Run(Write("nested.c", text));
+    auto &statistics = preprocessor.statistics();
+    Check(statistics.output_tokens == (1 << 16) + 1, "A16 C2000 tokens");
+    Check(statistics.expansions == 17 + 16 + 2001 &&
+              statistics.memo_hits == 16,
+          "A16 expansions: " + to_string(statistics.expansions) + ", " +
+              to_string(statistics.memo_hits) + " memo hits");
+    auto &tokens = lexer->token_list();
+    Check(tokens.tag(1 << 16) == TOKEN::IDENTIFIER &&
+              tokens[1 << 16].value().get_atom() ==
+                  Interner::ForThread().Intern("y"),
+          "C2000");
+  }
+
+  // A long replaced argument is read as a span, and an invocation in an
+  // argument takes views of the argument list; either gives what the
+  // tokens would.
+  {
+    string many, expected;
+    for (int i = 0; i < 20; ++i) {
+      many += " a";
+    }
+    string text = "#define id(x) x\n"
+                  "#define str(x) #x\n"
+                  "#define xstr(x) str(x)\n"
+                  "#define cat(x, y) x ## y\n"
+                  "#define xcat(x, y) cat(x, y)\n"
+                  "#define second(x, y) y\n"
+                  "#define call(x) second(x)\n"
+                  "#define first(x, y) x(3)\n"
+                  "#define pass(x) first(x)\n"
+                  "#define f(x) x f\n"
+                  "#define g(x) <x>\n"
+                  "#define v(x, ...) [x: __VA_ARGS__]\n"
+                  "#define z() 0\n"
+                  "#define C ,\n"
+                  "#define MANY" + many + "\n"
+                  "id(MANY g)(1)\n"
+                  "xstr(MANY)\n"
+                  "xcat(MANY, b)\n"
+                  "call(MANY C z) call(MANY g C z)\n"
+                  "pass(MANY g C)\n"
+                  "id(MANY f(1))(2)\n"
+                  "id(v(1, v(2, 3, 4), 5)) id(v()) id(z())\n"
+                  "id(id(id(MANY g)))(4)\n";
+    string quoted = "\"" + many.substr(1) + "\"";
+    CheckOutput(files, "spans.c", text,
+                many + " <1>\n" + quoted + "\n" +
+                    many.substr(0, many.size() - 2) + " ab\n"
+                    "z z\n" +
+                    many + " <3>\n" + many + " 1 f(2)\n"
+                    "[1: [2: 3, 4], 5] [:] 0\n" +
+                    many + " <4>\n");
+
+    string nested = "#define f(x) (x)\n";
+    for (int i = 0; i < 200; ++i) {
+      nested += "f(";
+      expected += "(";
+    }
+    nested += "1";
+    expected += "1";
+    for (int i = 0; i < 200; ++i) {
+      nested += ")";
+      expected += ")";
+    }
+    CheckOutput(files, "deep.c", nested + "\n", expected);
+  }
+
+  // A token from a macro is located where the outermost macro was used.
+  {
+    Preprocessor preprocessor(files);
+    auto path = Write("backtrace.c", "#define INNER 42\n"
+                                     "#define OUTER (INNER)\n"
+                                     "int v = OUTER;\n");
+    auto lexer = preprocessor.Run(path);
+    auto &tokens = lexer->token_list();
+    auto token = tokens[4];
+    Check(Render(tokens) == Tokens("int v = (42);"), "backtrace tokens");
+    Check(preprocessor.Location(token) == path + ":3:9",
+          "expansion location: " + preprocessor.Location(token));
+    Check(preprocessor.SpellingLocation(token) == path + ":1:15",
+          "spelling location: " + preprocessor.SpellingLocation(token));
+    auto backtrace = preprocessor.MacroBacktrace(token);
+    Check(backtrace.size() == 2 &&
+              backtrace[0] == "INNER at " + path + ":2:16" &&
+              backtrace[1] == "OUTER at " + path + ":3:9",
+          "macro backtrace");
+    Check(preprocessor.MacroBacktrace(tokens[0]).empty(),
+          "no backtrace outside macros");
+  }
+
+  CheckOutput(files, "conditionals.c",
+              "#define A 2\n"
+              "#if A == 2 && defined(A) && !defined B\n"
+              "yes1\n"
+              "#elif 1/0\n"
+              "no\n"
+              "#else\n"
+              "no\n"
+              "#endif\n"
+              "#if 0\n"
+              "#if garbage (\n"
+              "#endif\n"
+              "no\n"
+              "#elif (3 > 2) ? 1 : 0\n"
+              "yes2\n"
+              "#endif\n"
+              "#ifdef B\n"
+              "no\n"
+              "#else\n"
+              "yes3\n"
+              "#endif\n"
+              "#if -1 < 0u\n"
+              "no\n"
+              "#elif 'a' == 97 && 0x10 == 16 && (1 << 3) == 8 && 7 % 4 == 3\n"
+              "yes4\n"
+              "#endif\n"
+              "#if 0 && (1/0) || UNDEFINED\n"
+              "no\n"
+              "#endif\n"
+              "# /* a null directive */\n"
+              "#pragma whatever\n"
+              "x = #y\n",
+              "yes1 yes2 yes3 yes4 x = #y\n");
+
+  // Include guards, #pragma once, computed includes and include paths.
+  mkdir((directory + "/sub").c_str(), 0755);
+  Write("guarded.h", "/* A comment before the guard. */\n"
+                     "#ifndef GUARDED_H\n"
+                     "#define GUARDED_H\n"
+                     "int guarded;\n"
+                     "#endif\n");
+  Write("once.h", "#pragma once\n"
+                  "int once;\n");
+  Write("unguarded.h", "int unguarded;\n");
+  Write("not_guard.h", "#ifndef NOT_GUARD_H\n"
+                       "#define NOT_GUARD_H\n"
+                       "int not_guard;\n"
+                       "#endif\n"
+                       "int after;\n");
+  Write("sub/path.h", "int from_path;\n");
+  {
+    Preprocessor preprocessor(files);
+    preprocessor.AddIncludePath(directory + "/sub/");
+    auto lexer = preprocessor.Run(Write("includes.c",
+                                        "#include \"guarded.h\"\n"
+                                        "#include \"guarded.h\"\n"
+                                        "#include \"once.h\"\n"
+                                        "#include \"once.h\"\n"
+                                        "#include \"unguarded.h\"\n"
+                                        "#include \"unguarded.h\"\n"
+                                        "#define HEADER \"guarded.h\"\n"
+                                        "#include HEADER\n"
+                                        "#include <path.h>\n"
+                                        "#include \"not_guard.h\"\n"
+                                        "#include \"not_guard.h\"\n"
+                                        "int end;\n"));
+    Check(Render(lexer->token_list()) ==
+              Tokens("int guarded; int once; int unguarded; int unguarded;"
+                     "int from_path; int not_guard; int after; int after;"
+                     "int end;"),
+          "included tokens: " + Render(lexer->token_list()));
+    auto &statistics = preprocessor.statistics();
+    Check(statistics.guard_skips == 2, "two includes skipped by the guard");
+    Check(statistics.pragma_once_skips == 1, "one skipped by #pragma once");
+    Check(statistics.files_entered == 8, "files entered");
+    auto &tokens = lexer->token_list();
+    Check(preprocessor.Location(tokens[1]) ==
+              directory + "/guarded.h:4:5",
+          "a token of a header is located in it: " +
+              preprocessor.Location(tokens[1]));
+  }
+  auto files_read = files.statistics().files;
+  {
+    // What the first unit learned about the guard saves the next one from
+    // entering the file at all.
+    Preprocessor preprocessor(files);
+    preprocessor.Define("GUARDED_H");
+    auto lexer = preprocessor.Run(Write("predefined.c",
+                                        "#include \"guarded.h\"\n"
+                                        "#if GUARDED_H == 1\n"
+                                        "int predefined;\n"
+                                        "#endif\n"));
+    Check(Render(lexer->token_list()) == Tokens("int predefined;"),
+          "a predefined guard");
+    Check(preprocessor.statistics().guard_skips == 1 &&
+              preprocessor.statistics().files_entered == 1,
+          "the guarded file is not entered");
+  }
+  Check(files.statistics().files == files_read + 1,
+        "only the new main file is read");
+
+  // #line renumbers what Location, __LINE__ and __FILE__ report.
+  {
+    Preprocessor preprocessor(files);
+    auto lexer = preprocessor.Run(Write("line.c",
+                                        "int a;\n"
+                                        "#line 100 \"renamed.c\"\n"
+                                        "int b;\n"
+                                        "__LINE__ __FILE__\n"
+                                        "# 7 \"marker.c\"\n"
+                                        "__LINE__\n"));
+    auto &tokens = lexer->token_list();
+    Check(Render(tokens) == Tokens("int a; int b; 101 \"renamed.c\" 7"),
+          "line: " + Render(tokens));
+    Check(preprocessor.Location(tokens[0]) == directory + "/line.c:1:1",
+          "before #line");
+    Check(preprocessor.Location(tokens[4]) == "renamed.c:100:5",
+          "after #line: " + preprocessor.Location(tokens[4]));
+  }
+
+  // The parser takes the output as it is.
+  {
+    Write("types.h", "#ifndef TYPES_H\n"
+                     "#define TYPES_H\n"
+                     "typedef unsigned long size;\n"
+                     "#endif\n");
+    Preprocessor preprocessor(files);
+    preprocessor.Define("COUNT=4");
+    auto lexer = preprocessor.Run(Write("parse.c",
+                                        "#include \"types.h\"\n"
+                                        "#define DECLARE(type, name) "
+                                        "type name##_value;\n"
+                                        "#define ARRAY(name) int name[COUNT];\n"
+                                        "DECLARE(size, first)\n"
+                                        "DECLARE(int *, second)\n"
+                                        "ARRAY(third)\n"
+                                        "int f(size n) {\n"
+                                        "  n = n * COUNT;\n"
+                                        "}\n"));
+    Parser parser(std::move(lexer));
+    Check(parser.Scan(), "parses preprocessed tokens");
+    auto &symbols = parser.symbol_table();
+    auto lookup = [&](const string &name) {
+      return symbols.Lookup(Interner::ForThread().Intern(name));
+    };
+    Check(lookup("first_value") != nullptr &&
+              lookup("first_value")->type()->builtin() ==
+                  BuiltinKind::UNSIGNED_LONG,
+          "a typedef from a header");
+    Check(lookup("second_value") != nullptr &&
+              lookup("second_value")->type()->IsPointerType(),
+          "a pasted name");
+    auto third = lookup("third");
+    Check(third != nullptr && third->type()->IsArrayType() &&
+              static_cast<const ArrayType *>(third->type())->length() == 4,
+          "a macro from the command line");
+  }
+
+  system(("rm -rf " + directory).c_str());
+  cout << (passed ? "preprocessor: ok" : "preprocessor: FAILED") << endl;
+  return passed ? 0 : 1;
+}
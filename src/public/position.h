@@ -2,6 +2,8 @@
 #define YYQC_SRC_POSITION_H_
 #include <iostream>
 
+// Row and column of a byte offset, resolved from the line table of the
+// SourceBuffer; tokens themselves only store the offset.
 class Position {
 private:
   unsigned int _index = 0;
@@ -19,16 +21,6 @@ public:
   const unsigned int row() const { return _row; }
   const unsigned int column() const { return _column; }
   const int StartAt() const { return _line_head + _column - 1; }
-  void NewLine(const unsigned int new_line_head) {
-    ++_row;
-    ++_index;
-    _column = 1;
-    _line_head = new_line_head;
-  }
-  void NextColumn() {
-    ++_column;
-    ++_index;
-  }
   friend std::ostream &operator<<(std::ostream &os, const Position &pos) {
     os << "Position: (" << pos._row << ", " << pos._column << ")";
     return os;
@@ -0,0 +1,99 @@
+#ifndef YYQC_SRC_SYMBOL_ATOM_MAP_H_
+#define YYQC_SRC_SYMBOL_ATOM_MAP_H_
+
+#include "../lexer/interner.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * Open-addressing hash map from atoms to small values, for the names one
+ * scope declares. Atoms are dense integers, so multiplying by an odd
+ * constant spreads them without collisions among nearby atoms, and linear
+ * probing at a load factor under 1/2 finds a name in about one probe.
+ * Most scopes declare a handful of names, so a map allocates nothing until
+ * its first insertion.
+ */
+template <typename V> class AtomMap {
+public:
+  // The value stored for `atom`, or nullptr if there is none.
+  const V *Find(Atom atom) const {
+    if (_slots.empty()) {
+      return nullptr;
+    }
+    auto mask = _slots.size() - 1;
+    for (auto i = Hash(atom) & mask;; i = (i + 1) & mask) {
+      auto &slot = _slots[i];
+      if (slot.atom == atom) {
+        return &slot.value;
+      }
+      if (slot.atom == Atom::NONE) {
+        return nullptr;
+      }
+    }
+  }
+
+  // The value stored for `atom`, value-initialized if it is new.
+  V &operator[](Atom atom) {
+    // Keep the load factor under 1/2.
+    if ((_size + 1) * 2 > _slots.size()) {
+      Grow();
+    }
+    auto mask = _slots.size() - 1;
+    for (auto i = Hash(atom) & mask;; i = (i + 1) & mask) {
+      auto &slot = _slots[i];
+      if (slot.atom == atom) {
+        return slot.value;
+      }
+      if (slot.atom == Atom::NONE) {
+        ++_size;
+        slot.atom = atom;
+        return slot.value;
+      }
+    }
+  }
+
+  uint32_t size() const { return _size; }
+  bool empty() const { return _size == 0; }
+  // Calls f(atom, value) for every entry, in no particular order.
+  template <typename F> void ForEach(F &&f) const {
+    for (auto &slot : _slots) {
+      if (slot.atom != Atom::NONE) {
+        f(slot.atom, slot.value);
+      }
+    }
+  }
+
+private:
+  static constexpr uint32_t INITIAL_SLOTS = 8;
+
+  struct Slot {
+    Atom atom = Atom::NONE;
+    V value{};
+  };
+
+  static uint32_t Hash(Atom atom) {
+    return static_cast<uint32_t>(atom) * 0x9e3779b1u;
+  }
+
+  void Grow() {
+    std::vector<Slot> slots(_slots.empty() ? INITIAL_SLOTS
+                                           : _slots.size() * 2);
+    auto mask = slots.size() - 1;
+    for (auto &slot : _slots) {
+      if (slot.atom == Atom::NONE) {
+        continue;
+      }
+      auto i = Hash(slot.atom) & mask;
+      while (slots[i].atom != Atom::NONE) {
+        i = (i + 1) & mask;
+      }
+      slots[i] = slot;
+    }
+    _slots = std::move(slots);
+  }
+
+  std::vector<Slot> _slots;
+  uint32_t _size = 0;
+};
+
+#endif
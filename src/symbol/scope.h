@@ -1,76 +1,102 @@
 #ifndef YYQC_ENV_H
 #define YYQC_ENV_H
 
+#include "./atom_map.h"
 #include "./symbol.h"
 #include <algorithm>
+#include <array>
 #include <iostream>
 #include <iterator>
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
-class Scope : public std::enable_shared_from_this<Scope> {
+/**
+ * One scope of a translation unit, as a node of a tree. The parser keeps
+ * its names in a SymbolTable, which builds this tree only when a consumer
+ * such as an IDE index asks for it; the tree owns nothing but its maps.
+ */
+class Scope {
 public:
-  Scope() = default;
-  ~Scope() = default;
+  explicit Scope(Scope *enclosing = nullptr) : _enclosing(enclosing) {}
 
-  Scope(std::weak_ptr<Scope> parent) : _parent(parent) {}
+  void AddChild(Scope *child) { _children.push_back(child); }
 
-  Scope(std::shared_ptr<Scope> parent) : _parent(parent) {}
-
-  std::shared_ptr<Scope> &AddSubScope() {
-    auto child = std::make_shared<Scope>();
-    child->set_parent(weak_from_this());
-    _children.push_back(std::move(child));
-    return _children.back();
+  // Lists `symbol` as declared here and declares it as an ordinary
+  // identifier.
+  void AddSymbol(Symbol *symbol) {
+    Declare(symbol);
+    _symbols.push_back(symbol);
   }
 
-  void set_parent(std::weak_ptr<Scope> parent) {
-    _parent = parent;
+  // Makes `symbol` visible here under its name, without taking it over:
+  // function definitions and parameters are owned elsewhere. A later
+  // declaration of the same name in the same scope replaces the earlier
+  // one, which is returned so a caller can diagnose it.
+  Symbol *Declare(Symbol *symbol,
+                  IdentifierNameSpace name_space =
+                      IdentifierNameSpace::ORDINARY_IDENTIFIER) {
+    auto name = symbol->name();
+    if (name == Atom::NONE) {
+      return nullptr;
+    }
+    auto &entry = names(name_space)[name];
+    auto previous = entry;
+    entry = symbol;
+    return previous;
   }
 
-  void AddSubScope(std::shared_ptr<Scope> &child) {
-    _children.push_back(std::move(child));
+  // The symbol `name` denotes in this scope alone, or nullptr.
+  Symbol *LookupLocal(Atom name,
+                      IdentifierNameSpace name_space =
+                          IdentifierNameSpace::ORDINARY_IDENTIFIER) const {
+    auto entry = names(name_space).Find(name);
+    return entry ? *entry : nullptr;
   }
 
-  void AddSymbol(std::unique_ptr<Symbol> &symbol) {
-    _symbols.push_back(std::move(symbol));
+  // The symbol `name` denotes here: the innermost declaration in this scope
+  // or an enclosing one. One hash probe per scope, through plain pointers.
+  Symbol *Lookup(Atom name,
+                 IdentifierNameSpace name_space =
+                     IdentifierNameSpace::ORDINARY_IDENTIFIER) const {
+    for (auto scope = this; scope; scope = scope->_enclosing) {
+      if (auto entry = scope->names(name_space).Find(name)) {
+        return *entry;
+      }
+    }
+    return nullptr;
   }
 
-  void AddSymbols(std::vector<std::unique_ptr<Symbol>> &symbols) {
-    _symbols.insert(_symbols.end(), std::make_move_iterator(symbols.begin()),
-                    std::make_move_iterator(symbols.end()));
+  // typedef-names, for telling declarations from statements without trying
+  // both. An ordinary identifier declared in an inner scope hides a typedef
+  // of the same name, which is recorded as a null entry.
+  void AddTypedefName(Atom name, const Type *type) {
+    _typedef_names[name] = type;
+  }
+  void HideTypedefName(Atom name) { _typedef_names[name] = nullptr; }
+  // The type a typedef-name stands for, or nullptr if `name` is not one here.
+  const Type *LookupTypedefName(Atom name) const {
+    for (auto scope = this; scope; scope = scope->_enclosing) {
+      if (auto entry = scope->_typedef_names.Find(name)) {
+        return *entry;
+      }
+    }
+    return nullptr;
   }
 
-  std::weak_ptr<Scope> parent() { return _parent; }
-
-  std::vector<std::shared_ptr<Scope>> &children() { return _children; }
-
-  std::vector<std::unique_ptr<Symbol>> &symbols() { return _symbols; }
+  const AtomMap<const Type *> &typedef_names() const {
+    return _typedef_names;
+  }
 
-  // bool FindCurrentScope(const Symbol *var) {
-  //   auto iter = std::find_if(
-  //       _symbols.begin(), _symbols.end(),
-  //       [&](std::unique_ptr<Symbol> &p) { return p.get() == var; });
-  //   return (iter == _symbols.end());
-  // }
+  // nullptr for the file scope.
+  Scope *enclosing() const { return _enclosing; }
 
-  // bool FindAncestorScope(const Symbol *var) {
-  //   auto scope = _parent;
-  //   while (scope.lock()) {
-  //     if (scope.lock()->FindCurrentScope(var)) {
-  //       return true;
-  //     } else {
-  //       scope = scope.lock()->_parent;
-  //     }
-  //   }
-  //   return false;
-  // }
+  const std::vector<Scope *> &children() const { return _children; }
 
-  // bool FindValidScope(const Symbol *var) {
-  //   return FindCurrentScope(var) || FindAncestorScope(var);
-  // }
+  // The symbols declarations of this scope declare, in source order.
+  const std::vector<Symbol *> &symbols() const { return _symbols; }
 
   void PrintCurrentSymbols() {
     std::cout << (_symbols[0]->_type->IsIntType() ? "true" : "false")
@@ -79,9 +105,20 @@ public:
   }
 
 private:
-  std::vector<std::unique_ptr<Symbol>> _symbols;
-  std::weak_ptr<Scope> _parent;
-  std::vector<std::shared_ptr<Scope>> _children;
+  AtomMap<Symbol *> &names(IdentifierNameSpace name_space) {
+    return _names[static_cast<size_t>(name_space)];
+  }
+  const AtomMap<Symbol *> &names(IdentifierNameSpace name_space) const {
+    return _names[static_cast<size_t>(name_space)];
+  }
+
+  std::vector<Symbol *> _symbols;
+  Scope *_enclosing = nullptr;
+  std::vector<Scope *> _children;
+  std::array<AtomMap<Symbol *>,
+             static_cast<size_t>(IdentifierNameSpace::COUNT)>
+      _names;
+  AtomMap<const Type *> _typedef_names;
 };
 
 #endif // YYQC_ENV_H
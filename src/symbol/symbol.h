@@ -7,19 +7,63 @@
 #include <string>
 #include <vector>
 
+class CompoundStmt;
+
 class Symbol {
 public:
-  std::unique_ptr<Type> _type;
-  std::shared_ptr<Token> _token;
+  // Owned by the TypeContext of the translation unit.
+  const Type *_type;
+  Token _token;
 
 public:
-  std::unique_ptr<Type> &type() { return _type; }
-  void set_type(std::unique_ptr<Type> &type) { _type = std::move(type); }
-  std::shared_ptr<Token> token() { return _token; }
-  Symbol(std::shared_ptr<Token> token, std::unique_ptr<Type> &type)
-      : _type(std::move(type)), _token(token) {}
+  const Type *type() const { return _type; }
+  void set_type(const Type *type) { _type = type; }
+  Token token() const { return _token; }
+  // Atom::NONE for the unnamed symbol of an abstract declarator.
+  Atom name() const {
+    return _token && _token.tag() == TOKEN::IDENTIFIER
+               ? _token.value().get_atom()
+               : Atom::NONE;
+  }
+  Symbol(Token token, const Type *type) : _type(type), _token(token) {}
+
+  // A function type has only the types of its parameters; the symbol its
+  // declarator declares keeps the parameters themselves, and the body if
+  // it is a definition.
+  const std::vector<std::unique_ptr<Symbol>> &parameters() const {
+    return _parameters;
+  }
+  void set_parameters(std::vector<std::unique_ptr<Symbol>> parameters) {
+    _parameters = std::move(parameters);
+  }
+  // In the parser's AST arena.
+  CompoundStmt *body() const { return _body; }
+  void set_body(CompoundStmt *body) { _body = body; }
+  // The storage-class and type specifiers, SCS_* and TS_*, it was declared
+  // with. Neither is part of its type: `long` and `long int` are one type,
+  // and only the trace shows which was written.
+  uint32_t specifiers() const { return _specifiers; }
+  void set_specifiers(uint32_t specifiers) { _specifiers = specifiers; }
+  uint32_t storage_class() const { return _specifiers & SCS_MASK; }
+  uint32_t type_specifier() const { return _specifiers & TS_MASK; }
+
   friend std::ostream &operator<<(std::ostream &os, const Symbol &symbol) {
-    os << *(symbol._token);
+    os << symbol._token;
+    return os;
+  }
+
+private:
+  std::vector<std::unique_ptr<Symbol>> _parameters;
+  CompoundStmt *_body = nullptr;
+  uint32_t _specifiers = 0;
+};
+
+// Streams the type of a symbol with the specifiers it was declared with.
+struct DeclarationMessage {
+  const Symbol &symbol;
+  friend std::ostream &operator<<(std::ostream &os,
+                                  const DeclarationMessage &message) {
+    message.symbol.type()->OStreamDeclaration(os, message.symbol.specifiers());
     return os;
   }
 };
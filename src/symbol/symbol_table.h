@@ -0,0 +1,237 @@
+#ifndef YYQC_SRC_SYMBOL_SYMBOL_TABLE_H_
+#define YYQC_SRC_SYMBOL_SYMBOL_TABLE_H_
+
+#include "./scope.h"
+#include "./symbol.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Scopes are numbered in the order they are entered; the file scope is 0.
+using ScopeId = uint32_t;
+
+/**
+ * The names a parser has in scope, as one flat table instead of a tree of
+ * per-scope maps. Every declaration appends a binding to a log; for each
+ * name space, the innermost binding of every name is found by indexing
+ * with its atom, and each binding links to the one it shadows. Entering a
+ * scope pushes a mark on an undo stack of the bindings made since, and
+ * leaving it pops them, restoring whatever they shadowed. So entering is
+ * constant time, leaving costs one step per name the scope declared, and
+ * a lookup is one index however deep the nesting.
+ *
+ * The log keeps every binding after its scope has closed, so the tree of
+ * scopes can be built from it when a consumer asks for one.
+ */
+class SymbolTable {
+public:
+  static constexpr ScopeId FILE_SCOPE = 0;
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  struct Binding {
+    Symbol *symbol;
+    // The binding of the same name this one hides, or NONE.
+    uint32_t shadowed;
+    ScopeId scope;
+    Atom name;
+    IdentifierNameSpace name_space;
+    // Whether the table owns `symbol`.
+    bool owned;
+    bool is_typedef;
+  };
+
+  SymbolTable() : _scope_parents{NONE}, _open_scopes{{FILE_SCOPE, 0}} {}
+  SymbolTable(const SymbolTable &) = delete;
+  SymbolTable &operator=(const SymbolTable &) = delete;
+
+  ScopeId EnterScope() {
+    auto id = static_cast<ScopeId>(_scope_parents.size());
+    _scope_parents.push_back(current_scope());
+    _open_scopes.push_back({id, static_cast<uint32_t>(_undo.size())});
+    return id;
+  }
+  void ExitScope() {
+    auto mark = _open_scopes.back().undo_mark;
+    while (_undo.size() > mark) {
+      auto &binding = _bindings[_undo.back()];
+      head(binding.name_space, binding.name) = binding.shadowed;
+      _undo.pop_back();
+    }
+    _open_scopes.pop_back();
+  }
+  ScopeId current_scope() const { return _open_scopes.back().id; }
+
+  // Takes `symbol` over and declares it as an ordinary identifier in the
+  // current scope; a typedef makes it a typedef-name.
+  Symbol *AddSymbol(std::unique_ptr<Symbol> symbol, bool is_typedef = false) {
+    auto raw = symbol.get();
+    _owned.push_back(std::move(symbol));
+    Bind(raw, current_scope(), IdentifierNameSpace::ORDINARY_IDENTIFIER,
+         true, is_typedef);
+    return raw;
+  }
+
+  // Makes `symbol` visible in the current scope without taking it over:
+  // function definitions and parameters are owned elsewhere. Returns the
+  // symbol an earlier declaration of the name in the same scope bound, so
+  // a caller can diagnose it.
+  Symbol *Declare(Symbol *symbol,
+                  IdentifierNameSpace name_space =
+                      IdentifierNameSpace::ORDINARY_IDENTIFIER) {
+    auto previous = LookupLocal(symbol->name(), name_space);
+    Bind(symbol, current_scope(), name_space, false, false);
+    return previous;
+  }
+
+  // The symbol `name` denotes in the current scope, or nullptr.
+  Symbol *Lookup(Atom name,
+                 IdentifierNameSpace name_space =
+                     IdentifierNameSpace::ORDINARY_IDENTIFIER) const {
+    auto binding = Innermost(name, name_space);
+    return binding ? binding->symbol : nullptr;
+  }
+  // The symbol `name` denotes in the current scope alone, or nullptr.
+  Symbol *LookupLocal(Atom name,
+                      IdentifierNameSpace name_space =
+                          IdentifierNameSpace::ORDINARY_IDENTIFIER) const {
+    auto binding = Innermost(name, name_space);
+    return binding && binding->scope == current_scope() ? binding->symbol
+                                                        : nullptr;
+  }
+  // The type `name` stands for if it is a typedef-name in the current
+  // scope; any other ordinary identifier declared inside hides it.
+  const Type *LookupTypedefName(Atom name) const {
+    auto binding =
+        Innermost(name, IdentifierNameSpace::ORDINARY_IDENTIFIER);
+    return binding && binding->is_typedef ? binding->symbol->type()
+                                          : nullptr;
+  }
+
+  // Rebuilding a saved table. A scope is added as a child of `parent`
+  // without being entered; a binding is made in `scope`, and only becomes
+  // visible if that is the current scope.
+  ScopeId RestoreScope(ScopeId parent) {
+    _scope_parents.push_back(parent);
+    return static_cast<ScopeId>(_scope_parents.size() - 1);
+  }
+  void Restore(std::unique_ptr<Symbol> symbol, ScopeId scope,
+               bool is_typedef) {
+    Bind(symbol.get(), scope, IdentifierNameSpace::ORDINARY_IDENTIFIER, true,
+         is_typedef);
+    _owned.push_back(std::move(symbol));
+  }
+  void Restore(Symbol *symbol, ScopeId scope,
+               IdentifierNameSpace name_space) {
+    Bind(symbol, scope, name_space, false, false);
+  }
+
+  // Every binding ever made, in the order it was made.
+  const std::vector<Binding> &bindings() const { return _bindings; }
+  uint32_t scope_count() const {
+    return static_cast<uint32_t>(_scope_parents.size());
+  }
+  // NONE for the file scope.
+  ScopeId parent(ScopeId scope) const { return _scope_parents[scope]; }
+
+  // Scope `id` as a node of the scope tree, which is built from the log
+  // on first use and again after the table has changed. The tree is a
+  // snapshot: declaring into it does not change the table.
+  Scope &scope(ScopeId id) const {
+    if (_tree.size() != _scope_parents.size() ||
+        _tree_bindings != _bindings.size()) {
+      Materialize();
+    }
+    return *_tree[id];
+  }
+
+private:
+  struct OpenScope {
+    ScopeId id;
+    // Size of the undo stack when the scope was entered.
+    uint32_t undo_mark;
+  };
+
+  void Bind(Symbol *symbol, ScopeId scope, IdentifierNameSpace name_space,
+            bool owned, bool is_typedef) {
+    auto name = symbol->name();
+    auto index = static_cast<uint32_t>(_bindings.size());
+    _bindings.push_back(
+        {symbol, NONE, scope, name, name_space, owned, is_typedef});
+    if (name == Atom::NONE || scope != current_scope()) {
+      return;
+    }
+    auto &innermost = head(name_space, name);
+    _bindings.back().shadowed = innermost;
+    innermost = index;
+    _undo.push_back(index);
+  }
+
+  const Binding *Innermost(Atom name, IdentifierNameSpace name_space) const {
+    auto &heads = _heads[static_cast<size_t>(name_space)];
+    auto atom = static_cast<uint32_t>(name);
+    if (atom >= heads.size() || heads[atom] == NONE) {
+      return nullptr;
+    }
+    return &_bindings[heads[atom]];
+  }
+
+  // Atoms are dense, so the heads are a vector grown to the largest atom
+  // declared so far.
+  uint32_t &head(IdentifierNameSpace name_space, Atom name) {
+    auto &heads = _heads[static_cast<size_t>(name_space)];
+    auto atom = static_cast<uint32_t>(name);
+    if (atom >= heads.size()) {
+      heads.resize(std::max<size_t>(atom + 1, heads.size() * 2), NONE);
+    }
+    return heads[atom];
+  }
+
+  // Replays the log into one Scope per scope. A binding hides the
+  // typedef-names of enclosing scopes only if one is visible when it is
+  // made, as it did while parsing.
+  void Materialize() const {
+    _tree.clear();
+    for (ScopeId id = 0; id < _scope_parents.size(); ++id) {
+      auto enclosing = id == FILE_SCOPE ? nullptr : _tree[parent(id)].get();
+      _tree.push_back(std::make_unique<Scope>(enclosing));
+      if (enclosing != nullptr) {
+        enclosing->AddChild(_tree.back().get());
+      }
+    }
+    for (auto &binding : _bindings) {
+      auto &scope = *_tree[binding.scope];
+      if (binding.owned) {
+        scope.AddSymbol(binding.symbol);
+      } else if (binding.name != Atom::NONE) {
+        scope.Declare(binding.symbol, binding.name_space);
+      }
+      if (binding.name == Atom::NONE ||
+          binding.name_space != IdentifierNameSpace::ORDINARY_IDENTIFIER) {
+        continue;
+      }
+      if (binding.is_typedef) {
+        scope.AddTypedefName(binding.name, binding.symbol->type());
+      } else if (scope.LookupTypedefName(binding.name) != nullptr) {
+        scope.HideTypedefName(binding.name);
+      }
+    }
+    _tree_bindings = _bindings.size();
+  }
+
+  std::vector<Binding> _bindings;
+  std::array<std::vector<uint32_t>,
+             static_cast<size_t>(IdentifierNameSpace::COUNT)>
+      _heads;
+  // Bindings made in the open scopes, innermost last.
+  std::vector<uint32_t> _undo;
+  std::vector<ScopeId> _scope_parents;
+  std::vector<OpenScope> _open_scopes;
+  std::vector<std::unique_ptr<Symbol>> _owned;
+
+  mutable std::vector<std::unique_ptr<Scope>> _tree;
+  mutable size_t _tree_bindings = 0;
+};
+
+#endif
@@ -2,18 +2,12 @@
 #define _TYPE_ARITHMETIC_
 
 #include "type_base.h"
-#define INT_SIZE 4
-#define SHORT_SIZE ((INT_SIZE) >> (1))
-#define LONG_SIZE ((INT_SIZE) << (1))
-#define LONGLONG_SIZE ((INT_SIZE) << (2))
-#define FLOAT_SIZE (INT_SIZE)
-#define DOUBLE_SIZE ((INT_SIZE) << (1))
 
 class CharType : public ArithmeticType {
 public:
-  CharType() {}
+  explicit CharType(BuiltinKind builtin = BuiltinKind::CHAR)
+      : ArithmeticType(builtin) {}
   virtual bool IsCharType() const { return true; }
-  virtual int width() const { return 1; }
 };
 
 class IntType : public ArithmeticType {
@@ -23,49 +17,17 @@ class IntType : public ArithmeticType {
   }
 
 private:
-  virtual void OStreamFullMessage(std::ostream &os) const override {
+  virtual void OStreamDeclaration(std::ostream &os,
+                                  uint32_t specifiers) const override {
     os << "Type: INT" << std::endl;
-    OStreamSpecifierQualifier(os);
+    OStreamSpecifierQualifier(os, specifiers);
     os << std::endl;
   }
 
 public:
-  IntType() = default;
-  IntType(uint32_t storage_class_specifier, uint32_t type_specifier,
-          uint32_t type_qualifier, uint32_t function_specifier,
-          bool complete = true)
-      : ArithmeticType(storage_class_specifier, type_specifier, type_qualifier,
-                       function_specifier, complete) {}
-  explicit IntType(const IntType *original)
-      : ArithmeticType(original->storage_class_specifier(),
-                       original->type_specifier(), original->type_qualifier(),
-                       original->function_specifier(), original->completed()) {}
+  explicit IntType(BuiltinKind builtin = BuiltinKind::INT)
+      : ArithmeticType(builtin) {}
   virtual bool IsIntType() const override { return true; }
-  virtual std::unique_ptr<Type> clone() const override {
-    auto new_type = std::make_unique<IntType>(this);
-    return std::move(new_type);
-  }
-  virtual int width() const override {
-    switch (type_specifier()) {
-    case TS_SHORT:
-    case TS_SHORT | TS_UNSIGNED:
-      return SHORT_SIZE;
-    case TS_INT:
-    case TS_INT | TS_UNSIGNED:
-    case TS_UNSIGNED:
-      return INT_SIZE;
-    case TS_LONG:
-    case TS_LONG | TS_UNSIGNED:
-      return LONG_SIZE;
-    case TS_LONGLONG:
-    case TS_LONGLONG | TS_UNSIGNED:
-      return LONGLONG_SIZE;
-    default:
-      // TODO: Error Handler.
-      Error("Invalid int type!");
-      return -1;
-    }
-  }
   virtual void OStreamConciseMessage(std::ostream &os) const override {
     os << "Int" << std::endl;
   }
@@ -73,25 +35,15 @@ public:
 
 class FloatType : public ArithmeticType {
 public:
+  explicit FloatType(BuiltinKind builtin = BuiltinKind::DOUBLE)
+      : ArithmeticType(builtin) {}
   virtual bool IsFloatType() const { return true; }
-  virtual int width() const {
-    switch (type_specifier()) {
-    case TS_FLOAT:
-      return FLOAT_SIZE;
-    case TS_DOUBLE:
-      return DOUBLE_SIZE;
-    default:
-      // TODO: Error Handler.
-      Error("Invalid float type!");
-      return -1;
-    }
-  }
 };
 
 class BoolType : public ArithmeticType {
 public:
-  virtual bool IsBoolType() const { return true; }
-  virtual int width() const { return 1; }
+  BoolType() : ArithmeticType(BuiltinKind::BOOL) {}
+  virtual bool IsBoolType() const override { return true; }
 };
 
 #endif
@@ -3,15 +3,12 @@
 
 #include "../error/error.h"
 #include "../ast/ast_base.h"
+#include "type_layout.h"
 #include <cassert>
 #include <cstdint>
 #include <memory>
 #include <vector>
 
-#define WORD_LENGTH 4
-#define INT_LENGTH 4
-#define POINTER_WIDTH 4
-
 class Type;
 class ArithmeticType;
 class DerivedType;
@@ -88,24 +85,71 @@ enum {
   AS_ALIGNAS_CE = 0x80000000  // -Alignas ( constant-expression )
 };
 
+// The builtin type a set of TS_ flags names, or NONE if the combination is
+// not one of the lists of 6.7.2p2. `long long` is TS_LONGLONG alone.
+inline BuiltinKind BuiltinOf(uint32_t type_specifier) {
+  bool is_signed = type_specifier & TS_SIGNED;
+  bool is_unsigned = type_specifier & TS_UNSIGNED;
+  auto base = type_specifier & ~(TS_SIGNED | TS_UNSIGNED);
+  if (is_signed && is_unsigned) {
+    return BuiltinKind::NONE;
+  }
+  auto integer = [&](BuiltinKind signed_kind, BuiltinKind unsigned_kind) {
+    return is_unsigned ? unsigned_kind : signed_kind;
+  };
+  auto other = [&](BuiltinKind kind) {
+    return is_signed || is_unsigned ? BuiltinKind::NONE : kind;
+  };
+  switch (base) {
+  case TS_VOID:
+    return other(BuiltinKind::VOID);
+  case TS_BOOL:
+    return other(BuiltinKind::BOOL);
+  case TS_CHAR:
+    return is_unsigned ? BuiltinKind::UNSIGNED_CHAR
+           : is_signed ? BuiltinKind::SIGNED_CHAR
+                       : BuiltinKind::CHAR;
+  case 0:
+    return is_signed || is_unsigned ? integer(BuiltinKind::INT,
+                                              BuiltinKind::UNSIGNED_INT)
+                                    : BuiltinKind::NONE;
+  case TS_INT:
+    return integer(BuiltinKind::INT, BuiltinKind::UNSIGNED_INT);
+  case TS_SHORT:
+  case TS_SHORT | TS_INT:
+    return integer(BuiltinKind::SHORT, BuiltinKind::UNSIGNED_SHORT);
+  case TS_LONG:
+  case TS_LONG | TS_INT:
+    return integer(BuiltinKind::LONG, BuiltinKind::UNSIGNED_LONG);
+  case TS_LONGLONG:
+  case TS_LONGLONG | TS_INT:
+    return integer(BuiltinKind::LONG_LONG, BuiltinKind::UNSIGNED_LONG_LONG);
+  case TS_FLOAT:
+    return other(BuiltinKind::FLOAT);
+  case TS_DOUBLE:
+    return other(BuiltinKind::DOUBLE);
+  case TS_LONG | TS_DOUBLE:
+    return other(BuiltinKind::LONG_DOUBLE);
+  default:
+    return BuiltinKind::NONE;
+  }
+}
+
 class Type {
 protected:
-  // uint32_t _flags = 0;
-  uint32_t _storage_class_specifier_flag = 0;
-  uint32_t _type_specifier_flag = 0;
-  uint32_t _type_qualifier_flag = 0;
-  uint32_t _function_specifier_flag = 0;
+  // The qualifier and function specifier flags, whose masks do not
+  // overlap.
+  uint32_t _flags = 0;
+  BuiltinKind _builtin = BuiltinKind::NONE;
   bool _complete = false;
 
 public:
-  // uint32_t flags() { return _flags; }
-  // void set_flags(uint32_t flags) { _flags = flags; }
-  uint32_t storage_class_specifier() const {
-    return _storage_class_specifier_flag;
-  }
-  uint32_t type_specifier() const { return _type_specifier_flag; }
-  uint32_t type_qualifier() const { return _type_qualifier_flag; }
-  uint32_t function_specifier() const { return _function_specifier_flag; }
+  uint32_t flags() const { return _flags; }
+  void set_flags(uint32_t flags) { _flags = flags; }
+  uint32_t type_qualifier() const { return _flags & TQ_MASK; }
+  uint32_t function_specifier() const { return _flags & FS_MASK; }
+  // NONE unless this is void or an arithmetic type.
+  BuiltinKind builtin() const { return _builtin; }
   bool completed() const { return _complete; }
   void set_completed(bool completed = true) { _complete = completed; }
   void set_complete(bool complete) { this->_complete = complete; }
@@ -114,45 +158,17 @@ public:
     Error("Invalid set_point_to() for current Type.\n");
   }
 
-  // void AddFlag(uint32_t flags) { _flags |= flags; }
-  void set_storage_class_specifier(uint32_t f) {
-    _storage_class_specifier_flag = f;
-  }
-  void add_storage_class_specifier(uint32_t f) {
-    _storage_class_specifier_flag |= f;
-  }
-  void set_type_specifier(uint32_t f) { _type_specifier_flag = f; }
-  void add_type_specifier(uint32_t f) { _type_specifier_flag |= f; }
-  void set_type_qualifier(uint32_t f) { _type_qualifier_flag = f; }
-  void add_type_qualifier(uint32_t f) { _type_qualifier_flag |= f; }
-  void set_function_specifier(uint32_t f) { _function_specifier_flag = f; }
-  void add_function_specifier(uint32_t f) { _function_specifier_flag |= f; }
-
   Type(bool complete = true) : _complete(complete) {}
-  Type(const std::unique_ptr<Type> &t)
-      : _storage_class_specifier_flag(t->_storage_class_specifier_flag),
-        _type_specifier_flag(t->_type_qualifier_flag),
-        _type_qualifier_flag(t->_type_qualifier_flag),
-        _function_specifier_flag(t->_function_specifier_flag),
-        _complete(t->_complete) {}
-  Type(uint32_t storage_class_specifier, uint32_t type_specifier,
-       uint32_t type_qualifier, uint32_t function_specifier,
-       bool complete = true)
-      : _storage_class_specifier_flag(storage_class_specifier),
-        _type_specifier_flag(type_specifier),
-        _type_qualifier_flag(type_qualifier),
-        _function_specifier_flag(function_specifier), _complete(complete) {}
+  Type(BuiltinKind builtin, bool complete)
+      : _builtin(builtin), _complete(complete) {}
   virtual ~Type() = default;
-  virtual std::unique_ptr<Type> clone() const {
-    auto new_type = std::make_unique<Type>(
-        this->_storage_class_specifier_flag, this->_type_specifier_flag,
-        this->_type_qualifier_flag, this->_function_specifier_flag,
-        this->_complete);
-    return new_type;
-  }
-  virtual void OStreamFullMessage(std::ostream &os) const {
+  void OStreamFullMessage(std::ostream &os) const { OStreamDeclaration(os, 0); }
+  // As the type of a declaration written with the storage-class and type
+  // specifiers `specifiers` prints. Those belong to the declaration, not to
+  // its type.
+  virtual void OStreamDeclaration(std::ostream &os, uint32_t specifiers) const {
     os << "Type:" << std::endl;
-    OStreamSpecifierQualifier(os);
+    OStreamSpecifierQualifier(os, specifiers);
     os << std::endl;
   }
 
@@ -160,86 +176,87 @@ public:
     os << "Type" << std::endl;
   }
 
-  void OStreamSpecifierQualifier(std::ostream &os) const {
+  void OStreamSpecifierQualifier(std::ostream &os, uint32_t specifiers) const {
     os << "Storage Class Specifier: ";
-    OStreamStorageClassSpecifier(os);
+    OStreamStorageClassSpecifier(os, specifiers);
     os << std::endl;
     os << "Type Specifier: ";
-    OStreamTypeSpecifier(os);
+    OStreamTypeSpecifier(os, specifiers);
     os << std::endl;
     os << "Type Qualifier: ";
     os << std::endl;
     os << "Function Specifier: ";
   }
 
-  void OStreamStorageClassSpecifier(std::ostream &os) const {
-    if (_storage_class_specifier_flag & SCS_AUTO) {
+  static void OStreamStorageClassSpecifier(std::ostream &os,
+                                           uint32_t flags) {
+    if (flags & SCS_AUTO) {
       os << "AUTO ";
     }
-    if (_storage_class_specifier_flag & SCS_EXTERN) {
+    if (flags & SCS_EXTERN) {
       os << "EXTERN ";
     }
-    if (_storage_class_specifier_flag & SCS_REGISTER) {
+    if (flags & SCS_REGISTER) {
       os << "REGISTER ";
     }
-    if (_storage_class_specifier_flag & SCS_STATIC) {
+    if (flags & SCS_STATIC) {
       os << "STATIC ";
     }
-    if (_storage_class_specifier_flag & SCS_THREAD_LOCAL) {
+    if (flags & SCS_THREAD_LOCAL) {
       os << "THREAD_LOCAL ";
     }
-    if (_storage_class_specifier_flag & SCS_TYPEDEF) {
+    if (flags & SCS_TYPEDEF) {
       os << "TYPEDEF ";
     }
   }
 
-  void OStreamTypeSpecifier(std::ostream &os) const {
-    if (_type_specifier_flag & TS_ATOMIC) {
+  static void OStreamTypeSpecifier(std::ostream &os, uint32_t flags) {
+    if (flags & TS_ATOMIC) {
       os << "ATOMIC ";
     }
-    if (_type_specifier_flag & TS_BOOL) {
+    if (flags & TS_BOOL) {
       os << "BOOL ";
     }
-    if (_type_specifier_flag & TS_CHAR) {
+    if (flags & TS_CHAR) {
       os << "CHAR ";
     }
-    if (_type_specifier_flag & TS_COMPLEX) {
+    if (flags & TS_COMPLEX) {
       os << "COMPLEX ";
     }
-    if (_type_specifier_flag & TS_DOUBLE) {
+    if (flags & TS_DOUBLE) {
       os << "DOUBLE ";
     }
-    if (_type_specifier_flag & TS_ENUM) {
+    if (flags & TS_ENUM) {
       os << "ENUM ";
     }
-    if (_type_specifier_flag & TS_FLOAT) {
+    if (flags & TS_FLOAT) {
       os << "FLOAT ";
     }
-    if (_type_specifier_flag & TS_INT) {
+    if (flags & TS_INT) {
       os << "INT ";
     }
-    if (_type_specifier_flag & TS_LONG) {
+    if (flags & TS_LONG) {
       os << "LONG ";
     }
-    if (_type_specifier_flag & TS_LONGLONG) {
+    if (flags & TS_LONGLONG) {
       os << "LONG_LONG ";
     }
-    if (_type_specifier_flag & TS_SHORT) {
+    if (flags & TS_SHORT) {
       os << "SHORT ";
     }
-    if (_type_specifier_flag & TS_SIGNED) {
+    if (flags & TS_SIGNED) {
       os << "SIGNED ";
     }
-    if (_type_specifier_flag & TS_STRUCT_UNION) {
+    if (flags & TS_STRUCT_UNION) {
       os << "STRUCT_UNION ";
     }
-    if (_type_specifier_flag & TS_TYPEDEF) {
+    if (flags & TS_TYPEDEF) {
       os << "TYPEDEF ";
     }
-    if (_type_specifier_flag & TS_UNSIGNED) {
+    if (flags & TS_UNSIGNED) {
       os << "UNSIGNED ";
     }
-    if (_type_specifier_flag & TS_VOID) {
+    if (flags & TS_VOID) {
       os << "VOID ";
     }
   }
@@ -254,7 +271,7 @@ public:
   virtual bool IsCharType() const { return false; }
   virtual bool IsIntType() const { return false; }
   virtual bool IsFloatType() const { return false; }
-  virtual bool isBoolType() const { return false; }
+  virtual bool IsBoolType() const { return false; }
 
   virtual bool IsDerivedType() const { return false; }
   virtual bool IsArrayType() const { return false; }
@@ -270,15 +287,17 @@ public:
 
 class ArithmeticType : public Type {
 public:
-  ArithmeticType() = default;
-  explicit ArithmeticType(uint32_t storage_class_specifier,
-                          uint32_t type_specifier, uint32_t type_qualifier,
-                          uint32_t function_specifier, bool complete = true)
-      : Type(storage_class_specifier, type_specifier, type_qualifier,
-             function_specifier, complete) {}
+  explicit ArithmeticType(BuiltinKind builtin) : Type(builtin, true) {}
   virtual ~ArithmeticType() = default;
   virtual bool IsArithmeticType() const { return true; }
-  static ArithmeticType *Max(ArithmeticType *type1, ArithmeticType *type2);
+  virtual int width() const override { return LayoutOf(_builtin).size; }
+  bool IsSigned() const { return LayoutOf(_builtin).is_signed; }
+  // The type of `type1 op type2` for an arithmetic operator, by the usual
+  // arithmetic conversions (6.3.1.8); a TypeContext makes it a type.
+  static BuiltinKind Max(const ArithmeticType &type1,
+                         const ArithmeticType &type2) {
+    return CommonBuiltin(type1.builtin(), type2.builtin());
+  }
 };
 
 class DerivedType : public Type {
@@ -292,8 +311,10 @@ public:
 class VoidType : public Type {
 public:
   virtual ~VoidType() = default;
-  virtual int width() const override { return 0; }
-  VoidType() : Type(false) {}
+  virtual int width() const override {
+    return LayoutOf(BuiltinKind::VOID).size;
+  }
+  VoidType() : Type(BuiltinKind::VOID, false) {}
   virtual bool IsVoidType() const override { return true; }
 };
 
@@ -0,0 +1,253 @@
+#ifndef YYQC_SRC_TYPE_TYPE_CONTEXT_H_
+#define YYQC_SRC_TYPE_TYPE_CONTEXT_H_
+
+#include "../util/hash.h"
+#include "type_arithmetic.h"
+#include "type_base.h"
+#include "type_derived.h"
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// What a type is built as. The values are written to cache files.
+enum class TypeKind : uint8_t {
+  VOID,
+  CHAR,
+  INT,
+  FLOAT,
+  BOOL,
+  ARRAY,
+  POINTER,
+  FUNCTION,
+};
+
+/**
+ * The types of a translation unit, one object per distinct type. A type is
+ * looked up by its structure: kind, builtin type, qualifier and function
+ * specifier flags, base type, array length and parameter types. It is built only if
+ * it is new, so two types are the same exactly when their pointers are, and
+ * deriving `int *` from `int` finds the one `int *` there is instead of
+ * copying. Types are immutable once made and live as long as the context.
+ *
+ * Storage-class and type specifiers are not part of a type either:
+ * `static int *a` and `int *b` have the same type, so do `long` and
+ * `long int`, and the Symbol keeps how it was declared.
+ */
+class TypeContext {
+public:
+  TypeContext() = default;
+  TypeContext(const TypeContext &) = delete;
+  TypeContext &operator=(const TypeContext &) = delete;
+
+  // Void or an arithmetic type; `flags` are the qualifiers and function
+  // specifiers it was declared with.
+  const Type *Builtin(BuiltinKind builtin, uint32_t flags = 0) {
+    Key key;
+    key.kind = KindOf(builtin);
+    key.builtin = builtin;
+    assert(!(flags & (SCS_MASK | TS_MASK)));
+    key.flags = flags;
+    return Intern(std::move(key));
+  }
+  const PointerType *Pointer(const Type *base, uint32_t type_qualifier = 0) {
+    Key key;
+    key.kind = TypeKind::POINTER;
+    key.base = base;
+    key.flags = type_qualifier;
+    return static_cast<const PointerType *>(Intern(std::move(key)));
+  }
+  // A negative `length` leaves the length unknown.
+  const ArrayType *Array(const Type *element, int length) {
+    Key key;
+    key.kind = TypeKind::ARRAY;
+    key.base = element;
+    key.length = length;
+    return static_cast<const ArrayType *>(Intern(std::move(key)));
+  }
+  const FunctionType *Function(const Type *returned,
+                               std::vector<const Type *> parameters,
+                               bool variadic) {
+    Key key;
+    key.kind = TypeKind::FUNCTION;
+    key.base = returned;
+    key.parameters = std::move(parameters);
+    key.variadic = variadic;
+    return static_cast<const FunctionType *>(Intern(std::move(key)));
+  }
+  // `type` with all of `flags` in place of its own.
+  const Type *WithFlags(const Type *type, uint32_t flags) {
+    assert(!(flags & (SCS_MASK | TS_MASK)));
+    if (type->flags() == flags) {
+      return type;
+    }
+    auto key = KeyOf(type);
+    key.flags = flags;
+    return Intern(std::move(key));
+  }
+
+  // Number of distinct types made so far.
+  size_t size() const { return _entries.size(); }
+
+  static TypeKind KindOf(BuiltinKind builtin) {
+    switch (builtin) {
+    case BuiltinKind::VOID:
+      return TypeKind::VOID;
+    case BuiltinKind::BOOL:
+      return TypeKind::BOOL;
+    case BuiltinKind::CHAR:
+    case BuiltinKind::SIGNED_CHAR:
+    case BuiltinKind::UNSIGNED_CHAR:
+      return TypeKind::CHAR;
+    default:
+      return IsFloatingBuiltin(builtin) ? TypeKind::FLOAT : TypeKind::INT;
+    }
+  }
+  static TypeKind KindOf(const Type *type) {
+    if (type->builtin() != BuiltinKind::NONE) {
+      return KindOf(type->builtin());
+    } else if (type->IsFunctionType()) {
+      return TypeKind::FUNCTION;
+    } else if (type->IsArrayType()) {
+      return TypeKind::ARRAY;
+    }
+    // Structures, unions and atomics are not made yet.
+    return TypeKind::POINTER;
+  }
+
+private:
+  static constexpr uint32_t INITIAL_SLOTS = 64;
+  static constexpr uint32_t EMPTY = UINT32_MAX;
+
+  struct Key {
+    TypeKind kind = TypeKind::VOID;
+    BuiltinKind builtin = BuiltinKind::NONE;
+    bool variadic = false;
+    uint32_t flags = 0;
+    // Element type of an array, pointee, or returned type of a function.
+    const Type *base = nullptr;
+    int length = 0;
+    std::vector<const Type *> parameters;
+
+    bool operator==(const Key &other) const {
+      return kind == other.kind && builtin == other.builtin &&
+             variadic == other.variadic && flags == other.flags &&
+             base == other.base && length == other.length &&
+             parameters == other.parameters;
+    }
+    // The base and parameters are canonical already, so their addresses
+    // stand for their structure.
+    uint64_t Hash() const {
+      uint64_t hash = static_cast<uint64_t>(kind) |
+                      uint64_t(builtin) << 8 | uint64_t(variadic) << 16 |
+                      uint64_t(flags) << 32;
+      hash = HashCombine(hash, reinterpret_cast<uintptr_t>(base));
+      hash = HashCombine(hash, static_cast<uint32_t>(length));
+      for (auto parameter : parameters) {
+        hash = HashCombine(hash, reinterpret_cast<uintptr_t>(parameter));
+      }
+      return hash;
+    }
+  };
+
+  struct Entry {
+    Key key;
+    uint64_t hash;
+    std::unique_ptr<Type> type;
+  };
+
+  const Type *Intern(Key key) {
+    // Keep the load factor under 1/2.
+    if ((_entries.size() + 1) * 2 > _slots.size()) {
+      Grow();
+    }
+    auto hash = key.Hash();
+    auto mask = _slots.size() - 1;
+    for (auto i = hash & mask;; i = (i + 1) & mask) {
+      auto index = _slots[i];
+      if (index == EMPTY) {
+        _slots[i] = static_cast<uint32_t>(_entries.size());
+        auto type = Build(key);
+        _entries.push_back({std::move(key), hash, std::move(type)});
+        return _entries.back().type.get();
+      }
+      auto &entry = _entries[index];
+      if (entry.hash == hash && entry.key == key) {
+        return entry.type.get();
+      }
+    }
+  }
+
+  void Grow() {
+    std::vector<uint32_t> slots(_slots.empty() ? INITIAL_SLOTS
+                                               : _slots.size() * 2,
+                                EMPTY);
+    auto mask = slots.size() - 1;
+    for (uint32_t index = 0; index < _entries.size(); ++index) {
+      auto i = _entries[index].hash & mask;
+      while (slots[i] != EMPTY) {
+        i = (i + 1) & mask;
+      }
+      slots[i] = index;
+    }
+    _slots = std::move(slots);
+  }
+
+  static std::unique_ptr<Type> Build(const Key &key) {
+    std::unique_ptr<Type> type;
+    switch (key.kind) {
+    case TypeKind::VOID:
+      type = std::make_unique<VoidType>();
+      break;
+    case TypeKind::CHAR:
+      type = std::make_unique<CharType>(key.builtin);
+      break;
+    case TypeKind::INT:
+      type = std::make_unique<IntType>(key.builtin);
+      break;
+    case TypeKind::FLOAT:
+      type = std::make_unique<FloatType>(key.builtin);
+      break;
+    case TypeKind::BOOL:
+      type = std::make_unique<BoolType>();
+      break;
+    case TypeKind::ARRAY:
+      type = std::make_unique<ArrayType>(key.base, key.length);
+      break;
+    case TypeKind::POINTER:
+      type = std::make_unique<PointerType>(key.base);
+      break;
+    case TypeKind::FUNCTION:
+      type = std::make_unique<FunctionType>(key.base, key.parameters,
+                                            key.variadic);
+      break;
+    }
+    type->set_flags(key.flags);
+    return type;
+  }
+
+  static Key KeyOf(const Type *type) {
+    Key key;
+    key.kind = KindOf(type);
+    key.builtin = type->builtin();
+    key.flags = type->flags();
+    if (auto array = dynamic_cast<const ArrayType *>(type)) {
+      key.base = array->base();
+      key.length = static_cast<int>(array->length());
+    } else if (auto pointer = dynamic_cast<const PointerType *>(type)) {
+      key.base = pointer->base();
+    } else if (auto function = dynamic_cast<const FunctionType *>(type)) {
+      key.base = function->base();
+      key.parameters = function->parameters();
+      key.variadic = function->variadic();
+    }
+    return key;
+  }
+
+  std::vector<Entry> _entries;
+  // Indices into _entries, EMPTY where there is none.
+  std::vector<uint32_t> _slots;
+};
+
+#endif
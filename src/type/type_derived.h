@@ -15,9 +15,9 @@ class ArrayType : public DerivedType {
   }
 
 public:
-  ArrayType(std::unique_ptr<Type> &base, int length)
-      : _base(std::move(base)), _length(length) {}
+  ArrayType(const Type *base, int length) : _base(base), _length(length) {}
   virtual bool IsArrayType() const override { return true; }
+  const Type *base() const { return _base; }
   unsigned length() const { return _length; }
   virtual int width() const override { return _base->width() * _length; }
   virtual void OStreamConciseMessage(std::ostream &os) const override {
@@ -25,17 +25,18 @@ public:
     _base->OStreamConciseMessage(os);
   }
 
-  virtual void OStreamFullMessage(std::ostream &os) const override {
+  virtual void OStreamDeclaration(std::ostream &os,
+                                  uint32_t specifiers) const override {
     os << "Type: Array of ";
     _base->OStreamConciseMessage(os);
-    OStreamSpecifierQualifier(os);
+    OStreamSpecifierQualifier(os, specifiers);
     os << std::endl;
     os << "Length: " << _length << std::endl;
     os << std::endl;
   }
 
 private:
-  std::unique_ptr<Type> _base;
+  const Type *_base;
   int _length;
 };
 
@@ -69,45 +70,61 @@ class FunctionType : public DerivedType {
   }
 
 public:
-  FunctionType(std::unique_ptr<Type> &base) : _base(std::move(base)) {}
+  // Names of parameters are not part of the type; the symbol a function
+  // declarator declares keeps them, and the body of a definition.
+  FunctionType(const Type *base, std::vector<const Type *> parameters,
+               bool variadic)
+      : _base(base), _is_variadic(variadic),
+        _parameters(std::move(parameters)) {}
   virtual bool IsFunctionType() const override { return true; }
   virtual int width() const override { return 0; }
-  void set_variadic(bool v) { _is_variadic = v; }
-  void AddParameters(std::vector<std::unique_ptr<Symbol>> &src) {
-    _parameter_list.insert(_parameter_list.end(),
-                           std::make_move_iterator(src.begin()),
-                           std::make_move_iterator(src.end()));
+  bool variadic() const { return _is_variadic; }
+  // The returned type.
+  const Type *base() const { return _base; }
+  const std::vector<const Type *> &parameters() const { return _parameters; }
+
+  virtual void OStreamDeclaration(std::ostream &os,
+                                  uint32_t specifiers) const override {
+    OStreamDefinition(os, specifiers, nullptr);
   }
-  void PrintParameters() {}
-  void set_compound_stmt(std::unique_ptr<CompoundStmt> &compound_stmt) {
-    _compound_stmt = std::move(compound_stmt);
-  }
-  std::unique_ptr<CompoundStmt> &compound_stmt() { return _compound_stmt; }
-
-private:
-  std::unique_ptr<Type> _base = nullptr; // Actually the returned one.
-  bool _is_variadic = false;
-  std::vector<std::unique_ptr<Symbol>> _parameter_list;
-  std::unique_ptr<CompoundStmt> _compound_stmt;
-
-  virtual void OStreamConciseMessage(std::ostream &os) const override {
-    os << "Function" << std::endl;
-  }
-
-  virtual void OStreamFullMessage(std::ostream &os) const override {
+  // As a definition with `body` prints.
+  void OStreamDefinition(std::ostream &os, uint32_t specifiers,
+                         const CompoundStmt *body) const {
     os << "Type: Function" << std::endl;
-    OStreamSpecifierQualifier(os);
+    OStreamSpecifierQualifier(os, specifiers);
     os << std::endl;
-    os << "Total parameters: " << _parameter_list.size() << std::endl;
+    os << "Total parameters: " << _parameters.size() << std::endl;
     os << "Total expressions: ";
-    if (_compound_stmt) {
-      os << _compound_stmt->stmts().size();
+    if (body) {
+      os << body->stmts().size();
     } else {
       os << 0;
     }
     os << std::endl;
     os << "Variadic: " << (_is_variadic ? "true" : "false") << std::endl;
   }
+
+private:
+  const Type *_base; // Actually the returned one.
+  bool _is_variadic;
+  std::vector<const Type *> _parameters;
+
+  virtual void OStreamConciseMessage(std::ostream &os) const override {
+    os << "Function" << std::endl;
+  }
+};
+
+// Streams the type of a function-definition together with its body and the
+// specifiers it was declared with.
+struct FunctionDefinitionMessage {
+  const FunctionType &type;
+  const CompoundStmt *body;
+  uint32_t specifiers;
+  friend std::ostream &operator<<(std::ostream &os,
+                                  const FunctionDefinitionMessage &message) {
+    message.type.OStreamDefinition(os, message.specifiers, message.body);
+    return os;
+  }
 };
 
 class PointerType : public DerivedType {
@@ -117,33 +134,31 @@ class PointerType : public DerivedType {
   }
 
 public:
-  PointerType(std::unique_ptr<Type> &base)
-      : DerivedType(true), _base(std::move(base)) {}
-  PointerType(std::unique_ptr<PointerType> &base)
-      : DerivedType(true), _base(std::move(base)) {}
+  explicit PointerType(const Type *base) : DerivedType(true), _base(base) {}
   virtual ~PointerType() = default;
-  virtual int width() const override { return POINTER_WIDTH; }
+  virtual int width() const override { return POINTER_LAYOUT.size; }
   virtual bool IsPointerType() const override { return true; }
-  std::unique_ptr<Type> &base() { return _base; }
+  const Type *base() const { return _base; }
   virtual void OStreamConciseMessage(std::ostream &os) const override {
     os << "Pointer" << std::endl;
   }
 
 private:
-  std::unique_ptr<Type> _base;
-  virtual void OStreamFullMessage(std::ostream &os) const override {
+  const Type *_base;
+  virtual void OStreamDeclaration(std::ostream &os,
+                                  uint32_t specifiers) const override {
     os << "Type: Pointer" << std::endl;
-    auto type = _base.get();
+    auto type = _base;
     while (true) {
       os << "Pointer -> ";
       if (type->IsPointerType()) {
-        type = (((PointerType *)type)->base()).get();
+        type = static_cast<const PointerType *>(type)->base();
       } else {
         break;
       }
     }
     type->OStreamConciseMessage(os);
-    OStreamSpecifierQualifier(os);
+    OStreamSpecifierQualifier(os, specifiers);
     os << std::endl;
   }
 };
@@ -0,0 +1,122 @@
+#ifndef YYQC_SRC_TYPE_TYPE_LAYOUT_H_
+#define YYQC_SRC_TYPE_TYPE_LAYOUT_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Void and the arithmetic types, one value per type however its specifiers
+// are spelled (6.7.2): `signed`, `int` and `signed int` are all INT. The
+// values are written to cache files.
+enum class BuiltinKind : uint8_t {
+  NONE, // a derived type
+  VOID,
+  BOOL,
+  CHAR,
+  SIGNED_CHAR,
+  UNSIGNED_CHAR,
+  SHORT,
+  UNSIGNED_SHORT,
+  INT,
+  UNSIGNED_INT,
+  LONG,
+  UNSIGNED_LONG,
+  LONG_LONG,
+  UNSIGNED_LONG_LONG,
+  FLOAT,
+  DOUBLE,
+  LONG_DOUBLE,
+  COUNT
+};
+
+/**
+ * How the target lays out a type: its size and alignment in bytes, and for
+ * an arithmetic type its signedness and conversion rank. Integer ranks
+ * follow 6.3.1.1; floating types rank above every integer type, in order
+ * of precision, so the usual arithmetic conversions only compare ranks.
+ */
+struct Layout {
+  uint8_t size;
+  uint8_t alignment;
+  bool is_signed;
+  bool is_integer;
+  uint8_t rank;
+};
+
+// The target, indexed by BuiltinKind. Plain char is signed.
+constexpr Layout BUILTIN_LAYOUTS[] = {
+    {0, 0, false, false, 0},     // NONE
+    {0, 1, false, false, 0},     // VOID
+    {1, 1, false, true, 1},      // BOOL
+    {1, 1, true, true, 2},       // CHAR
+    {1, 1, true, true, 2},       // SIGNED_CHAR
+    {1, 1, false, true, 2},      // UNSIGNED_CHAR
+    {2, 2, true, true, 3},       // SHORT
+    {2, 2, false, true, 3},      // UNSIGNED_SHORT
+    {4, 4, true, true, 4},       // INT
+    {4, 4, false, true, 4},      // UNSIGNED_INT
+    {8, 8, true, true, 5},       // LONG
+    {8, 8, false, true, 5},      // UNSIGNED_LONG
+    {8, 8, true, true, 6},       // LONG_LONG
+    {8, 8, false, true, 6},      // UNSIGNED_LONG_LONG
+    {4, 4, true, false, 7},      // FLOAT
+    {8, 8, true, false, 8},      // DOUBLE
+    {16, 16, true, false, 9},    // LONG_DOUBLE
+};
+static_assert(sizeof(BUILTIN_LAYOUTS) / sizeof(BUILTIN_LAYOUTS[0]) ==
+                  static_cast<size_t>(BuiltinKind::COUNT),
+              "one layout per builtin type");
+
+// Every object pointer, of whatever pointee.
+constexpr Layout POINTER_LAYOUT = {4, 4, false, false, 0};
+
+constexpr const Layout &LayoutOf(BuiltinKind kind) {
+  return BUILTIN_LAYOUTS[static_cast<size_t>(kind)];
+}
+constexpr bool IsIntegerBuiltin(BuiltinKind kind) {
+  return LayoutOf(kind).is_integer;
+}
+constexpr bool IsFloatingBuiltin(BuiltinKind kind) {
+  return kind >= BuiltinKind::FLOAT && kind <= BuiltinKind::LONG_DOUBLE;
+}
+
+// Integer promotion (6.3.1.1p2): a type ranked below int becomes int if
+// int holds all its values, else unsigned int.
+constexpr BuiltinKind PromoteBuiltin(BuiltinKind kind) {
+  if (!IsIntegerBuiltin(kind) ||
+      LayoutOf(kind).rank >= LayoutOf(BuiltinKind::INT).rank) {
+    return kind;
+  }
+  auto &layout = LayoutOf(kind);
+  auto &int_layout = LayoutOf(BuiltinKind::INT);
+  return layout.size < int_layout.size ||
+                 (layout.size == int_layout.size && layout.is_signed)
+             ? BuiltinKind::INT
+             : BuiltinKind::UNSIGNED_INT;
+}
+
+// The type both operands of an arithmetic operator convert to, by the
+// usual arithmetic conversions (6.3.1.8).
+constexpr BuiltinKind CommonBuiltin(BuiltinKind kind1, BuiltinKind kind2) {
+  if (!IsIntegerBuiltin(kind1) || !IsIntegerBuiltin(kind2)) {
+    return LayoutOf(kind1).rank >= LayoutOf(kind2).rank ? kind1 : kind2;
+  }
+  kind1 = PromoteBuiltin(kind1);
+  kind2 = PromoteBuiltin(kind2);
+  auto &layout1 = LayoutOf(kind1);
+  auto &layout2 = LayoutOf(kind2);
+  if (layout1.is_signed == layout2.is_signed) {
+    return layout1.rank >= layout2.rank ? kind1 : kind2;
+  }
+  auto signed_kind = layout1.is_signed ? kind1 : kind2;
+  auto unsigned_kind = layout1.is_signed ? kind2 : kind1;
+  if (LayoutOf(unsigned_kind).rank >= LayoutOf(signed_kind).rank) {
+    return unsigned_kind;
+  }
+  if (LayoutOf(signed_kind).size > LayoutOf(unsigned_kind).size) {
+    return signed_kind;
+  }
+  // The signed type is int or wider, so its unsigned counterpart follows it.
+  return static_cast<BuiltinKind>(static_cast<uint8_t>(signed_kind) + 1);
+}
+
+#endif
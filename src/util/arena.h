@@ -0,0 +1,106 @@
+#ifndef YYQC_SRC_UTIL_ARENA_H_
+#define YYQC_SRC_UTIL_ARENA_H_
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Fixed-length array whose elements live in an Arena. It does not own them,
+ * so it is as cheap to copy as a pointer and needs no destructor.
+ */
+template <typename T> class ArenaArray {
+public:
+  ArenaArray() = default;
+  ArenaArray(T *data, uint32_t size) : _data(data), _size(size) {}
+  T *begin() const { return _data; }
+  T *end() const { return _data + _size; }
+  uint32_t size() const { return _size; }
+  bool empty() const { return _size == 0; }
+  T &operator[](uint32_t i) const {
+    assert(i < _size);
+    return _data[i];
+  }
+
+private:
+  T *_data = nullptr;
+  uint32_t _size = 0;
+};
+
+/**
+ * Bump allocator for objects that all die together, such as the AST of one
+ * translation unit. Memory comes from slabs of SLAB_SIZE bytes (requests
+ * over a quarter slab get a slab of their own) and is only released when
+ * the arena is destroyed, all at once. Destructors are never run, so only
+ * trivially destructible types can be allocated; children are plain
+ * pointers into the same arena.
+ */
+class Arena {
+public:
+  static constexpr size_t SLAB_SIZE = 64 * 1024;
+
+  Arena() = default;
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  void *Allocate(size_t size, size_t align) {
+    _bytes_allocated += size;
+    if (size > SLAB_SIZE / 4) {
+      // A slab of its own, so the current slab's tail is not thrown away.
+      _slabs.emplace_back(new char[size + align]);
+      return AlignUp(_slabs.back().get(), align);
+    }
+    char *aligned = _cursor ? AlignUp(_cursor, align) : nullptr;
+    if (aligned == nullptr || aligned + size > _end) {
+      _slabs.emplace_back(new char[SLAB_SIZE]);
+      _cursor = _slabs.back().get();
+      _end = _cursor + SLAB_SIZE;
+      aligned = AlignUp(_cursor, align);
+    }
+    _cursor = aligned + size;
+    return aligned;
+  }
+
+  template <typename T, typename... Args> T *New(Args &&... args) {
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "arena objects are freed without running destructors");
+    return new (Allocate(sizeof(T), alignof(T)))
+        T(std::forward<Args>(args)...);
+  }
+
+  // Copies `elements` into the arena.
+  template <typename T>
+  ArenaArray<T> NewArray(const std::vector<T> &elements) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "arena arrays are copied bytewise");
+    if (elements.empty()) {
+      return {};
+    }
+    auto data = static_cast<T *>(
+        Allocate(sizeof(T) * elements.size(), alignof(T)));
+    std::memcpy(data, elements.data(), sizeof(T) * elements.size());
+    return {data, static_cast<uint32_t>(elements.size())};
+  }
+
+  // Bytes handed out so far, not counting alignment padding and slab tails.
+  size_t bytes_allocated() const { return _bytes_allocated; }
+
+private:
+  static char *AlignUp(char *pointer, size_t align) {
+    auto address = reinterpret_cast<uintptr_t>(pointer);
+    return pointer + ((align - address % align) % align);
+  }
+
+  std::vector<std::unique_ptr<char[]>> _slabs;
+  char *_cursor = nullptr;
+  char *_end = nullptr;
+  size_t _bytes_allocated = 0;
+};
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef YYQC_SRC_UTIL_CHECK_H_
+#define YYQC_SRC_UTIL_CHECK_H_
+
+#include <iostream>
+#include <string>
+
+/**
+ * The checks of a test program. Check() prints each condition that does
+ * not hold and clears `passed`, which main() turns into its exit status.
+ */
+static bool passed = true;
+
+static void Check(bool condition, const std::string &what) {
+  if (!condition) {
+    std::cout << "FAILED: " << what << std::endl;
+    passed = false;
+  }
+}
+
+#endif
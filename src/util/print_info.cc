@@ -1 +0,0 @@
-#include "./print_info.h"
\ No newline at end of file
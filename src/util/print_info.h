@@ -1,10 +0,0 @@
-#ifndef YYQ_SRC_UTIL_PRINT_INFO_H_
-#define YYQ_SRC_UTIL_PRINT_INFO_H_
-
-#include <iostream>
-
-inline void print_line() {
-  std::cout << "------------------------------------------------------------" << std::endl;
-}
-
-#endif // !YYQ_SRC_UTIL_PRINT_INFO_H_
\ No newline at end of file
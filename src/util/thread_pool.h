@@ -0,0 +1,184 @@
+#ifndef YYQC_SRC_UTIL_THREAD_POOL_H_
+#define YYQC_SRC_UTIL_THREAD_POOL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads, each with a deque of tasks of its own.
+ * A task submitted by a worker goes to the back of that worker's deque, and
+ * one submitted from outside the pool to the deques in turn. A worker takes
+ * its newest task first, and when its deque is empty steals the oldest task
+ * of another's, so that a worker left with long tasks hands the rest over
+ * to whoever finished early. Wait() blocks until every submitted task has
+ * finished; the destructor waits as well and then joins the workers.
+ *
+ * ParallelFor() splits one loop over the workers, from inside a task too.
+ *
+ * Each deque has a lock of its own, so workers only meet on one when
+ * stealing; the count of queued tasks that idle workers sleep on is kept
+ * under the pool's lock.
+ */
+class ThreadPool {
+public:
+  explicit ThreadPool(unsigned threads) {
+    for (unsigned i = 0; i < threads; ++i) {
+      _queues.emplace_back(new Queue);
+    }
+    for (unsigned i = 0; i < threads; ++i) {
+      _workers.emplace_back([this, i] { Work(i); });
+    }
+  }
+  ~ThreadPool() {
+    Wait();
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stopping = true;
+    }
+    _task_ready.notify_all();
+    for (auto &worker : _workers) {
+      worker.join();
+    }
+  }
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  void Submit(std::function<void()> task) {
+    unsigned self = worker();
+    Queue &queue = *_queues[self < size() ? self : _next++ % size()];
+    {
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.tasks.push_back(std::move(task));
+    }
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      ++_queued;
+      ++_pending;
+    }
+    _task_ready.notify_one();
+  }
+  // Must not be called from a task of the same pool.
+  void Wait() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _all_done.wait(lock, [this] { return _pending == 0; });
+  }
+  // Calls body(i) for every i below `count` and returns once all calls
+  // have. The calling thread takes part, as do helper tasks on whichever
+  // workers are free, each claiming the next index until none is left.
+  // The caller only ever runs calls of this loop, never another task, so
+  // unlike Wait() this may be called from a task of the same pool, and the
+  // task's thread state stays its own. `body` must not throw.
+  void ParallelFor(size_t count, const std::function<void(size_t)> &body) {
+    if (count == 0) {
+      return;
+    }
+    struct Loop {
+      std::atomic<size_t> next{0};
+      std::mutex mutex;
+      std::condition_variable finished;
+      size_t done = 0;
+    };
+    // Helpers may start after the loop is over, and then only find every
+    // index claimed; the loop outlives them, `body` need not.
+    auto loop = std::make_shared<Loop>();
+    auto run = [loop, count, &body] {
+      size_t ran = 0;
+      for (size_t i; (i = loop->next++) < count; ++ran) {
+        body(i);
+      }
+      if (ran > 0) {
+        std::lock_guard<std::mutex> lock(loop->mutex);
+        if ((loop->done += ran) == count) {
+          loop->finished.notify_all();
+        }
+      }
+    };
+    size_t helpers = std::min<size_t>(
+        worker() < size() ? size() - 1 : size(), count - 1);
+    for (size_t i = 0; i < helpers; ++i) {
+      Submit(run);
+    }
+    run();
+    std::unique_lock<std::mutex> lock(loop->mutex);
+    loop->finished.wait(lock, [&] { return loop->done == count; });
+  }
+  unsigned size() const { return _queues.size(); }
+  // The index of the calling thread among the workers, or size() if it is
+  // not a worker of this pool.
+  unsigned worker() const {
+    return current_pool == this ? current_worker : size();
+  }
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void Work(unsigned self) {
+    current_pool = this;
+    current_worker = self;
+    for (;;) {
+      std::function<void()> task;
+      if (!Take(self, task)) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _task_ready.wait(lock, [this] { return _stopping || _queued > 0; });
+        if (_queued == 0) {
+          return;
+        }
+        continue;
+      }
+      task();
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (--_pending == 0) {
+        _all_done.notify_all();
+      }
+    }
+  }
+  // The newest task of the worker's own deque, or else the oldest of the
+  // first other deque that has one.
+  bool Take(unsigned self, std::function<void()> &task) {
+    for (unsigned i = 0; i < size(); ++i) {
+      Queue &queue = *_queues[(self + i) % size()];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (queue.tasks.empty()) {
+        continue;
+      }
+      if (i == 0) {
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+      } else {
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+      }
+      std::lock_guard<std::mutex> pool_lock(_mutex);
+      --_queued;
+      return true;
+    }
+    return false;
+  }
+
+  static inline thread_local const ThreadPool *current_pool = nullptr;
+  static inline thread_local unsigned current_worker = 0;
+
+  std::vector<std::unique_ptr<Queue>> _queues;
+  std::vector<std::thread> _workers;
+  // Submissions from outside the pool, for picking a deque in turn.
+  std::atomic<unsigned> _next{0};
+  std::mutex _mutex;
+  std::condition_variable _task_ready;
+  std::condition_variable _all_done;
+  // Tasks in the deques, and tasks not yet finished.
+  unsigned _queued = 0;
+  unsigned _pending = 0;
+  bool _stopping = false;
+};
+
+#endif // !YYQC_SRC_UTIL_THREAD_POOL_H_
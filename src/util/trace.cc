@@ -0,0 +1,62 @@
+#include "./trace.h"
+#include <sstream>
+
+namespace {
+
+const char *const CATEGORY_NAMES[] = {"lexer",      "parser",
+                                      "declarations", "expressions",
+                                      "statements", "preprocessor"};
+static_assert(sizeof(CATEGORY_NAMES) / sizeof(CATEGORY_NAMES[0]) ==
+                  static_cast<size_t>(TraceCategory::COUNT),
+              "every trace category needs a name");
+
+} // namespace
+
+Trace &Trace::Global() {
+  static Trace trace;
+  return trace;
+}
+
+bool Trace::Enable(const std::string &categories) {
+  std::istringstream names(categories);
+  std::string name;
+  while (std::getline(names, name, ',')) {
+    if (name == "all") {
+      _mask = (1u << static_cast<unsigned>(TraceCategory::COUNT)) - 1;
+      continue;
+    }
+    bool found = false;
+    for (unsigned i = 0; i < static_cast<unsigned>(TraceCategory::COUNT);
+         ++i) {
+      if (name == CATEGORY_NAMES[i]) {
+        Enable(static_cast<TraceCategory>(i));
+        found = true;
+      }
+    }
+    if (!found) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Trace::set_sink(std::FILE *sink) {
+  Flush();
+  _buffer.sink = sink;
+}
+
+Trace::Buffer::int_type Trace::Buffer::overflow(int_type ch) {
+  sync();
+  if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+  }
+  return traits_type::not_eof(ch);
+}
+
+int Trace::Buffer::sync() {
+  std::fwrite(pbase(), 1, pptr() - pbase(), sink);
+  std::fflush(sink);
+  setp(_data, _data + sizeof(_data));
+  return 0;
+}
@@ -0,0 +1,92 @@
+#ifndef YYQC_SRC_UTIL_TRACE_H_
+#define YYQC_SRC_UTIL_TRACE_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+enum class TraceCategory : uint8_t {
+  LEXER,        // every token the lexer produces
+  PARSER,       // every token the parser matches
+  DECLARATIONS, // declarations, declarators and the symbols they add
+  EXPRESSIONS,  // each expression level that succeeds or fails
+  STATEMENTS,   // each statement the parser starts
+  PREPROCESSOR, // directives, included files and macro expansions
+  COUNT
+};
+
+/**
+ * Debug tracing of the lexer, the preprocessor and the parser, off by
+ * default. Categories are switched on at run time, usually through a
+ * "--trace=" flag; a disabled TRACE costs one test of a global bit mask and
+ * evaluates none of its operands. Building with -DYYQC_NO_TRACE removes the
+ * tracing altogether.
+ *
+ * Output goes through a 64 KB buffer to stderr (or a file given with
+ * set_sink) and is flushed when the buffer fills, on Flush() and at exit.
+ * Nothing locks the buffer, so only one thread may trace at a time: the
+ * driver compiles one unit at a time while tracing.
+ */
+class Trace {
+public:
+  static Trace &Global();
+
+  bool enabled(TraceCategory category) const {
+    return _mask & (1u << static_cast<unsigned>(category));
+  }
+  void Enable(TraceCategory category) {
+    _mask |= 1u << static_cast<unsigned>(category);
+  }
+  void Disable() { _mask = 0; }
+  // Takes a comma-separated list of category names or "all", as in
+  // "--trace=lexer,expressions". Returns false on an unknown name.
+  bool Enable(const std::string &categories);
+  // The sink is not owned; it must stay open until the last Flush().
+  void set_sink(std::FILE *sink);
+  std::ostream &stream() { return _stream; }
+  void Flush() { _buffer.pubsync(); }
+
+  static constexpr const char *RULE =
+      "------------------------------------------------------------\n";
+
+private:
+  Trace() : _stream(&_buffer) {}
+  ~Trace() { Flush(); }
+  Trace(const Trace &) = delete;
+  Trace &operator=(const Trace &) = delete;
+
+  class Buffer : public std::streambuf {
+  public:
+    Buffer() { setp(_data, _data + sizeof(_data)); }
+    std::FILE *sink = stderr;
+
+  protected:
+    int_type overflow(int_type ch) override;
+    int sync() override;
+
+  private:
+    char _data[64 * 1024];
+  };
+
+  uint32_t _mask = 0;
+  Buffer _buffer;
+  std::ostream _stream;
+};
+
+#ifdef YYQC_NO_TRACE
+#define TRACE(category, message)                                               \
+  do {                                                                         \
+  } while (0)
+#else
+// TRACE(EXPRESSIONS, "Expression: succeeded:\n" << *expr << '\n');
+#define TRACE(category, message)                                               \
+  do {                                                                         \
+    if (Trace::Global().enabled(TraceCategory::category)) {                    \
+      Trace::Global().stream() << message;                                     \
+    }                                                                          \
+  } while (0)
+#endif
+
+#endif // !YYQC_SRC_UTIL_TRACE_H_